@@ -0,0 +1,612 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+/*
+ * Throughput benchmarks for the decoding, encoding, copying, and teardown
+ * routines.
+ *
+ * Usage: cbor_bench [--filter SUBSTRING] [--min-time MILLISECONDS]
+ *                   [--seed N] [FILE.cbor ...]
+ *
+ * Every benchmark is run against the synthetic inputs and the files given on
+ * the command line. The results are printed to stdout as JSON, one object per
+ * benchmark and input, so that they can be compared between releases.
+ */
+
+// clock_gettime is not declared in the strict C modes otherwise
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cbor.h"
+
+/*
+ * ============================================================================
+ * Measurement
+ * ============================================================================
+ */
+
+// Wall-clock time. clock() would add up the CPU time of all threads and hide
+// the speedup of the parallel benchmarks.
+#ifndef CLOCK_MONOTONIC
+#error "The benchmarks need clock_gettime(CLOCK_MONOTONIC)"
+#endif
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static size_t allocations;
+
+static void* counting_malloc(size_t size) {
+  allocations++;
+  return malloc(size);
+}
+
+static void* counting_realloc(void* ptr, size_t size) {
+  allocations++;
+  return realloc(ptr, size);
+}
+
+struct input {
+  char name[64];
+  unsigned char* data;
+  /** Length of the first item in `data` */
+  size_t size;
+  /** Number of data items in the first item, including itself */
+  size_t items;
+};
+
+/** Measured part of a single iteration */
+struct sample {
+  uint64_t ns;
+  size_t allocations;
+};
+
+typedef struct sample (*benchmark_fn)(const struct input* input);
+
+static struct sample sample_since(uint64_t start, size_t start_allocations) {
+  return (struct sample){.ns = now_ns() - start,
+                         .allocations = allocations - start_allocations};
+}
+
+#define MEASURE(sample, code)                               \
+  do {                                                      \
+    size_t _start_allocations = allocations;                \
+    uint64_t _start = now_ns();                             \
+    code;                                                   \
+    (sample) = sample_since(_start, _start_allocations);    \
+  } while (0)
+
+static cbor_item_t* load_or_die(const struct input* input) {
+  struct cbor_load_result result;
+  cbor_item_t* item = cbor_load(input->data, input->size, &result);
+  if (item == NULL) {
+    fprintf(stderr, "Failed to decode %s\n", input->name);
+    exit(1);
+  }
+  return item;
+}
+
+/*
+ * ============================================================================
+ * Benchmarks
+ * ============================================================================
+ */
+
+static struct sample bench_load(const struct input* input) {
+  struct sample sample;
+  struct cbor_load_result result;
+  cbor_item_t* item;
+  MEASURE(sample, item = cbor_load(input->data, input->size, &result));
+  cbor_decref(&item);
+  return sample;
+}
+
+static struct sample bench_stream_decode(const struct input* input) {
+  struct sample sample;
+  MEASURE(sample, {
+    size_t offset = 0;
+    while (offset < input->size) {
+      struct cbor_decoder_result result =
+          cbor_stream_decode(input->data + offset, input->size - offset,
+                             &cbor_empty_callbacks, NULL);
+      if (result.status != CBOR_DECODER_FINISHED) break;
+      offset += result.read;
+    }
+  });
+  return sample;
+}
+
+static struct sample bench_serialize_alloc(const struct input* input) {
+  cbor_item_t* item = load_or_die(input);
+  struct sample sample;
+  unsigned char* buffer;
+  size_t buffer_size;
+  MEASURE(sample, cbor_serialize_alloc(item, &buffer, &buffer_size));
+  free(buffer);
+  cbor_decref(&item);
+  return sample;
+}
+
+static struct sample bench_serialize_parallel(const struct input* input) {
+  cbor_item_t* item = load_or_die(input);
+  struct sample sample;
+  unsigned char* buffer;
+  size_t buffer_size;
+  MEASURE(sample,
+          cbor_serialize_alloc_parallel(item, 0, &buffer, &buffer_size));
+  free(buffer);
+  cbor_decref(&item);
+  return sample;
+}
+
+static struct sample bench_copy(const struct input* input) {
+  cbor_item_t* item = load_or_die(input);
+  struct sample sample;
+  cbor_item_t* copy;
+  MEASURE(sample, copy = cbor_copy(item));
+  cbor_decref(&copy);
+  cbor_decref(&item);
+  return sample;
+}
+
+static struct sample bench_decref(const struct input* input) {
+  cbor_item_t* item = load_or_die(input);
+  struct sample sample;
+  MEASURE(sample, cbor_decref(&item));
+  return sample;
+}
+
+static struct sample bench_to_json(const struct input* input) {
+  // Sized up front, so that only the conversion is measured
+  size_t buffer_size = 8 * input->size + 64;
+  unsigned char* buffer = malloc(buffer_size);
+  cbor_writer writer;
+  cbor_writer_init_buffer(&writer, buffer, buffer_size);
+  struct sample sample;
+  struct cbor_load_result result;
+  bool converted;
+  MEASURE(sample, converted = cbor_to_json(input->data, input->size, &writer,
+                                           &result));
+  if (!converted) {
+    fprintf(stderr, "Failed to convert %s\n", input->name);
+    exit(1);
+  }
+  free(buffer);
+  return sample;
+}
+
+static size_t count_items(cbor_item_t* item, cbor_item_t** items);
+
+/*
+ * Takes and releases a reference to every item, like threads sharing a decoded
+ * tree would. Compare builds with and without CBOR_ATOMIC_REFCOUNT to see the
+ * cost of atomic updates.
+ */
+static struct sample bench_refcount(const struct input* input) {
+  cbor_item_t* item = load_or_die(input);
+  cbor_item_t** items = malloc(input->items * sizeof(cbor_item_t*));
+  count_items(item, items);
+  struct sample sample;
+  MEASURE(sample, {
+    for (size_t i = 0; i < input->items; i++) cbor_incref(items[i]);
+    for (size_t i = 0; i < input->items; i++) {
+      cbor_intermediate_decref(items[i]);
+    }
+  });
+  free(items);
+  cbor_decref(&item);
+  return sample;
+}
+
+/*
+ * Encodes the input with the low-level cbor_encode_* functions by replaying
+ * the structure of the decoded item, which mimics a hand-written encoder.
+ */
+static size_t encode_item(cbor_item_t* item, unsigned char* buffer,
+                          size_t buffer_size) {
+  size_t written = 0;
+#define ENCODE(call)                                             \
+  do {                                                           \
+    size_t _length = call;                                       \
+    if (_length == 0) return 0;                                  \
+    written += _length;                                          \
+  } while (0)
+#define REST buffer + written, buffer_size - written
+#define PAYLOAD(data, length)                          \
+  do {                                                 \
+    if (buffer_size - written < (length)) return 0;    \
+    memcpy(buffer + written, data, length);            \
+    written += (length);                               \
+  } while (0)
+  switch (cbor_typeof(item)) {
+    case CBOR_TYPE_UINT:
+      ENCODE(cbor_encode_uint(cbor_get_int(item), REST));
+      break;
+    case CBOR_TYPE_NEGINT:
+      ENCODE(cbor_encode_negint(cbor_get_int(item), REST));
+      break;
+    case CBOR_TYPE_BYTESTRING:
+      if (cbor_bytestring_is_indefinite(item)) {
+        ENCODE(cbor_encode_indef_bytestring_start(REST));
+        for (size_t i = 0; i < cbor_bytestring_chunk_count(item); i++) {
+          ENCODE(encode_item(cbor_bytestring_chunks_handle(item)[i], REST));
+        }
+        ENCODE(cbor_encode_break(REST));
+      } else {
+        size_t length = cbor_bytestring_length(item);
+        ENCODE(cbor_encode_bytestring_start(length, REST));
+        PAYLOAD(cbor_bytestring_handle(item), length);
+      }
+      break;
+    case CBOR_TYPE_STRING:
+      if (cbor_string_is_indefinite(item)) {
+        ENCODE(cbor_encode_indef_string_start(REST));
+        for (size_t i = 0; i < cbor_string_chunk_count(item); i++) {
+          ENCODE(encode_item(cbor_string_chunks_handle(item)[i], REST));
+        }
+        ENCODE(cbor_encode_break(REST));
+      } else {
+        size_t length = cbor_string_length(item);
+        ENCODE(cbor_encode_string_start(length, REST));
+        PAYLOAD(cbor_string_handle(item), length);
+      }
+      break;
+    case CBOR_TYPE_ARRAY:
+      if (cbor_array_is_definite(item)) {
+        ENCODE(cbor_encode_array_start(cbor_array_size(item), REST));
+      } else {
+        ENCODE(cbor_encode_indef_array_start(REST));
+      }
+      for (size_t i = 0; i < cbor_array_size(item); i++) {
+        ENCODE(encode_item(cbor_array_handle(item)[i], REST));
+      }
+      if (cbor_array_is_indefinite(item)) ENCODE(cbor_encode_break(REST));
+      break;
+    case CBOR_TYPE_MAP:
+      if (cbor_map_is_definite(item)) {
+        ENCODE(cbor_encode_map_start(cbor_map_size(item), REST));
+      } else {
+        ENCODE(cbor_encode_indef_map_start(REST));
+      }
+      for (size_t i = 0; i < cbor_map_size(item); i++) {
+        ENCODE(encode_item(cbor_map_handle(item)[i].key, REST));
+        ENCODE(encode_item(cbor_map_handle(item)[i].value, REST));
+      }
+      if (cbor_map_is_indefinite(item)) ENCODE(cbor_encode_break(REST));
+      break;
+    case CBOR_TYPE_TAG: {
+      ENCODE(cbor_encode_tag(cbor_tag_value(item), REST));
+      cbor_item_t* tagged = cbor_tag_item(item);
+      size_t length = encode_item(tagged, REST);
+      cbor_decref(&tagged);
+      ENCODE(length);
+      break;
+    }
+    case CBOR_TYPE_FLOAT_CTRL:
+      switch (cbor_float_get_width(item)) {
+        case CBOR_FLOAT_0:
+          ENCODE(cbor_encode_ctrl(cbor_ctrl_value(item), REST));
+          break;
+        case CBOR_FLOAT_16:
+          ENCODE(cbor_encode_half(cbor_float_get_float2(item), REST));
+          break;
+        case CBOR_FLOAT_32:
+          ENCODE(cbor_encode_single(cbor_float_get_float4(item), REST));
+          break;
+        case CBOR_FLOAT_64:
+          ENCODE(cbor_encode_double(cbor_float_get_float8(item), REST));
+          break;
+      }
+      break;
+  }
+#undef PAYLOAD
+#undef REST
+#undef ENCODE
+  return written;
+}
+
+static struct sample bench_encode(const struct input* input) {
+  cbor_item_t* item = load_or_die(input);
+  // Non-canonical inputs may encode to a slightly different size
+  size_t buffer_size = 2 * input->size + 64;
+  unsigned char* buffer = malloc(buffer_size);
+  struct sample sample;
+  size_t written;
+  MEASURE(sample, written = encode_item(item, buffer, buffer_size));
+  if (written == 0) {
+    fprintf(stderr, "Failed to encode %s\n", input->name);
+    exit(1);
+  }
+  free(buffer);
+  cbor_decref(&item);
+  return sample;
+}
+
+static const struct {
+  const char* name;
+  benchmark_fn run;
+} benchmarks[] = {
+    {"load", bench_load},
+    {"stream_decode", bench_stream_decode},
+    {"serialize_alloc", bench_serialize_alloc},
+    {"serialize_parallel", bench_serialize_parallel},
+    {"encode", bench_encode},
+    {"copy", bench_copy},
+    {"decref", bench_decref},
+    {"refcount", bench_refcount},
+    {"to_json", bench_to_json},
+};
+
+/*
+ * ============================================================================
+ * Inputs
+ * ============================================================================
+ */
+
+static uint64_t rng_state;
+
+// xorshift64*, good enough for generating test data
+static uint64_t rng_next(void) {
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static void random_string(cbor_writer* writer, size_t max_length) {
+  char buffer[64];
+  size_t length = 1 + rng_next() % max_length;
+  for (size_t i = 0; i < length; i++) {
+    buffer[i] = (char)('a' + rng_next() % 26);
+  }
+  cbor_writer_string(writer, buffer, length);
+}
+
+static void generate_wide_map(cbor_writer* writer) {
+  size_t count = 10000;
+  cbor_writer_map_start(writer, count);
+  for (size_t i = 0; i < count; i++) {
+    char key[32];
+    int length = snprintf(key, sizeof(key), "key_%zu", i);
+    cbor_writer_string(writer, key, (size_t)length);
+    cbor_writer_uint(writer, rng_next() >> (rng_next() % 64));
+  }
+}
+
+static void generate_deep_nesting(cbor_writer* writer) {
+  size_t depth = CBOR_MAX_STACK_SIZE / 2;
+  for (size_t i = 0; i < depth; i++) {
+    cbor_writer_array_start(writer, 2);
+    cbor_writer_uint(writer, i);
+  }
+  cbor_writer_null(writer);
+}
+
+static void generate_float_array(cbor_writer* writer) {
+  size_t count = 100000;
+  cbor_writer_array_start(writer, count);
+  for (size_t i = 0; i < count; i++) {
+    cbor_writer_double(writer, (double)rng_next() / (double)UINT64_MAX);
+  }
+}
+
+static void generate_short_strings(cbor_writer* writer) {
+  size_t count = 50000;
+  cbor_writer_array_start(writer, count);
+  for (size_t i = 0; i < count; i++) {
+    random_string(writer, 16);
+  }
+}
+
+static const struct {
+  const char* name;
+  void (*generate)(cbor_writer* writer);
+} generators[] = {
+    {"synthetic:wide_map", generate_wide_map},
+    {"synthetic:deep_nesting", generate_deep_nesting},
+    {"synthetic:float_array", generate_float_array},
+    {"synthetic:short_strings", generate_short_strings},
+};
+
+// Counts the items, and stores them to `items` unless it is NULL
+static size_t count_items(cbor_item_t* item, cbor_item_t** items) {
+  size_t count = 1;
+  if (items != NULL) *items = item;
+  switch (cbor_typeof(item)) {
+    case CBOR_TYPE_BYTESTRING:
+      if (cbor_bytestring_is_indefinite(item)) {
+        for (size_t i = 0; i < cbor_bytestring_chunk_count(item); i++) {
+          count += count_items(cbor_bytestring_chunks_handle(item)[i],
+                               items ? items + count : NULL);
+        }
+      }
+      break;
+    case CBOR_TYPE_STRING:
+      if (cbor_string_is_indefinite(item)) {
+        for (size_t i = 0; i < cbor_string_chunk_count(item); i++) {
+          count += count_items(cbor_string_chunks_handle(item)[i],
+                               items ? items + count : NULL);
+        }
+      }
+      break;
+    case CBOR_TYPE_ARRAY:
+      for (size_t i = 0; i < cbor_array_size(item); i++) {
+        count += count_items(cbor_array_handle(item)[i],
+                             items ? items + count : NULL);
+      }
+      break;
+    case CBOR_TYPE_MAP:
+      for (size_t i = 0; i < cbor_map_size(item); i++) {
+        count += count_items(cbor_map_handle(item)[i].key,
+                             items ? items + count : NULL);
+        count += count_items(cbor_map_handle(item)[i].value,
+                             items ? items + count : NULL);
+      }
+      break;
+    case CBOR_TYPE_TAG: {
+      cbor_item_t* tagged = cbor_tag_item(item);
+      count += count_items(tagged, items ? items + count : NULL);
+      cbor_decref(&tagged);
+      break;
+    }
+    default:
+      break;
+  }
+  return count;
+}
+
+// Trims the input to its first item and counts the items
+static void finish_input(struct input* input, size_t size) {
+  struct cbor_load_result result;
+  cbor_item_t* item = cbor_load(input->data, size, &result);
+  if (item == NULL) {
+    fprintf(stderr, "Failed to decode %s\n", input->name);
+    exit(1);
+  }
+  input->size = result.read;
+  input->items = count_items(item, NULL);
+  cbor_decref(&item);
+}
+
+static void read_file(struct input* input, const char* path) {
+  const char* name = strrchr(path, '/');
+  snprintf(input->name, sizeof(input->name), "%s", name ? name + 1 : path);
+  FILE* file = fopen(path, "rb");
+  if (file == NULL || fseek(file, 0, SEEK_END) != 0) {
+    fprintf(stderr, "Cannot read %s\n", path);
+    exit(1);
+  }
+  long size = ftell(file);
+  rewind(file);
+  input->data = malloc(size > 0 ? (size_t)size : 1);
+  if (size <= 0 || fread(input->data, 1, (size_t)size, file) != (size_t)size) {
+    fprintf(stderr, "Cannot read %s\n", path);
+    exit(1);
+  }
+  fclose(file);
+  finish_input(input, (size_t)size);
+}
+
+/*
+ * ============================================================================
+ * Driver
+ * ============================================================================
+ */
+
+static void run(const char* benchmark, benchmark_fn fn,
+                const struct input* input, uint64_t min_time_ns,
+                bool* first) {
+  // Warm up the caches and the allocator
+  fn(input);
+
+  size_t iterations = 0;
+  uint64_t total_ns = 0;
+  size_t total_allocations = 0;
+  uint64_t start = now_ns();
+  do {
+    struct sample sample = fn(input);
+    total_ns += sample.ns;
+    total_allocations += sample.allocations;
+    iterations++;
+  } while (now_ns() - start < min_time_ns);
+
+  double seconds = (double)total_ns / 1e9;
+  if (seconds <= 0) seconds = 1e-9;
+  double items = (double)input->items * (double)iterations;
+  double bytes = (double)input->size * (double)iterations;
+  printf("%s\n    {\"benchmark\": \"%s\", \"input\": \"%s\", "
+         "\"bytes\": %zu, \"items\": %zu, \"iterations\": %zu, "
+         "\"mb_per_s\": %.3f, \"items_per_s\": %.1f, \"ns_per_item\": %.3f, "
+         "\"allocations_per_iteration\": %.2f}",
+         *first ? "" : ",", benchmark, input->name, input->size, input->items,
+         iterations, bytes / seconds / 1e6, items / seconds,
+         (double)total_ns / items,
+         (double)total_allocations / (double)iterations);
+  *first = false;
+  fflush(stdout);
+}
+
+static void usage(void) {
+  fprintf(stderr,
+          "Usage: cbor_bench [--filter SUBSTRING] [--min-time MILLISECONDS] "
+          "[--seed N] [FILE.cbor ...]\n");
+  exit(1);
+}
+
+int main(int argc, char* argv[]) {
+  const char* filter = "";
+  unsigned long min_time_ms = 200;
+  unsigned long long seed = 42;
+  int first_file = argc;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+      min_time_ms = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = strtoull(argv[++i], NULL, 10);
+    } else if (argv[i][0] == '-') {
+      usage();
+    } else {
+      first_file = i;
+      break;
+    }
+  }
+  // xorshift must not be seeded with zero
+  rng_state = seed == 0 ? 1 : (uint64_t)seed;
+
+  size_t generator_count = sizeof(generators) / sizeof(generators[0]);
+  size_t input_count = generator_count + (size_t)(argc - first_file);
+  struct input* inputs = calloc(input_count, sizeof(struct input));
+  for (size_t i = 0; i < generator_count; i++) {
+    snprintf(inputs[i].name, sizeof(inputs[i].name), "%s", generators[i].name);
+    cbor_writer writer;
+    cbor_writer_init_growable(&writer);
+    generators[i].generate(&writer);
+    size_t size;
+    inputs[i].data = cbor_writer_take_buffer(&writer, &size);
+    if (inputs[i].data == NULL) {
+      fprintf(stderr, "Failed to generate %s\n", inputs[i].name);
+      return 1;
+    }
+    finish_input(&inputs[i], size);
+  }
+  for (int i = first_file; i < argc; i++) {
+    read_file(&inputs[generator_count + (size_t)(i - first_file)], argv[i]);
+  }
+
+  cbor_set_allocs(counting_malloc, counting_realloc, free);
+  printf("{\n  \"version\": \"%d.%d.%d\",\n  \"seed\": %llu,\n"
+         "  \"atomic_refcount\": %s,\n  \"results\": [",
+         CBOR_MAJOR_VERSION, CBOR_MINOR_VERSION, CBOR_PATCH_VERSION, seed,
+         CBOR_ATOMIC_REFCOUNT ? "true" : "false");
+  bool first = true;
+  for (size_t b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); b++) {
+    for (size_t i = 0; i < input_count; i++) {
+      char name[128];
+      snprintf(name, sizeof(name), "%s/%s", benchmarks[b].name,
+               inputs[i].name);
+      if (strstr(name, filter) == NULL) continue;
+      run(benchmarks[b].name, benchmarks[b].run, &inputs[i],
+          (uint64_t)min_time_ms * 1000000u, &first);
+    }
+  }
+  printf("\n  ]\n}\n");
+
+  for (size_t i = 0; i < input_count; i++) free(inputs[i].data);
+  free(inputs);
+  return 0;
+}
@@ -161,6 +161,12 @@ int main(int argc, char* argv[]) {
       case CBOR_ERR_SYNTAXERROR:
         fprintf(stderr, "syntax error\n");
         break;
+      case CBOR_ERR_INVALID_UTF8:
+        fprintf(stderr, "invalid UTF-8\n");
+        break;
+      case CBOR_ERR_FILE: /* Fallthrough, only reported by cbor_load_file */
+      case CBOR_ERR_BUFFER_TOO_SMALL: /* Fallthrough, not reported by
+                                         cbor_load */
       case CBOR_ERR_NONE:
         break;
     }
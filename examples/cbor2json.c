@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cbor.h"
+
+void usage(void) {
+  printf("Usage: cbor2json [input file]\n");
+  exit(1);
+}
+
+/*
+ * Converts every item of a CBOR sequence in a file to a line of JSON, without
+ * decoding it into items. Example usage:
+ * $ ./examples/cbor2json examples/data/map.cbor
+ */
+
+int main(int argc, char* argv[]) {
+  if (argc != 2) usage();
+  cbor_file_t file;
+  if (!cbor_file_open(&file, argv[1], CBOR_FILE_SEQUENTIAL)) usage();
+
+  unsigned char buffer[4096];
+  cbor_writer writer;
+  cbor_writer_init_file(&writer, stdout, buffer, sizeof(buffer));
+
+  size_t offset = 0;
+  while (offset < file.size) {
+    struct cbor_load_result result;
+    if (!cbor_to_json(file.data + offset, file.size - offset, &writer,
+                      &result)) {
+      fprintf(stderr, "Conversion failed near byte %zu\n",
+              offset + result.error.position);
+      return 1;
+    }
+    cbor_writer_bytes(&writer, (cbor_data) "\n", 1);
+    offset += result.read;
+  }
+
+  bool success = cbor_writer_flush(&writer);
+  cbor_file_close(&file);
+  return success ? 0 : 1;
+}
@@ -48,36 +48,18 @@ void write_cbor_sequence(const char* filename) {
 }
 
 void read_cbor_sequence(const char* filename) {
-  FILE* file = fopen(filename, "rb");
-  if (!file) {
+  cbor_file_t file;
+  if (!cbor_file_open(&file, filename, CBOR_FILE_SEQUENTIAL)) {
     fprintf(stderr, "Error: Could not open file %s\n", filename);
     return;
   }
 
-  fseek(file, 0, SEEK_END);
-  size_t file_size = ftell(file);
-  fseek(file, 0, SEEK_SET);
-
-  unsigned char* buffer = malloc(file_size);
-  if (!buffer) {
-    fprintf(stderr, "Error: Could not allocate memory\n");
-    fclose(file);
-    return;
-  }
-
-  if (fread(buffer, 1, file_size, file) != file_size) {
-    fprintf(stderr, "Error: Failed to read file\n");
-    free(buffer);
-    fclose(file);
-    return;
-  }
-  fclose(file);
-
   struct cbor_load_result result;
   size_t offset = 0;
 
-  while (offset < file_size) {
-    cbor_item_t* item = cbor_load(buffer + offset, file_size - offset, &result);
+  while (offset < file.size) {
+    cbor_item_t* item =
+        cbor_load(file.data + offset, file.size - offset, &result);
     if (result.error.code != CBOR_ERR_NONE) {
       fprintf(stderr, "Error: Failed to parse CBOR item at offset %zu\n",
               offset);
@@ -91,7 +73,7 @@ void read_cbor_sequence(const char* filename) {
     cbor_decref(&item);
   }
 
-  free(buffer);
+  cbor_file_close(&file);
 }
 
 int main(int argc, char* argv[]) {
@@ -21,21 +21,10 @@ void usage(void) {
 
 int main(int argc, char* argv[]) {
   if (argc != 2) usage();
-  FILE* f = fopen(argv[1], "rb");
-  if (f == NULL) usage();
-  fseek(f, 0, SEEK_END);
-  size_t length = (size_t)ftell(f);
-  fseek(f, 0, SEEK_SET);
-  unsigned char* buffer = malloc(length);
-  if (fread(buffer, length, 1, f) != 1) {
-    fprintf(stderr, "Failed to read input\n");
-    exit(1);
-  }
 
-  /* Assuming `buffer` contains `length` bytes of input data */
+  /* The file is mapped into memory rather than read into a buffer */
   struct cbor_load_result result;
-  cbor_item_t* item = cbor_load(buffer, length, &result);
-  free(buffer);
+  cbor_item_t* item = cbor_load_file(argv[1], CBOR_FILE_SEQUENTIAL, &result);
 
   if (result.error.code != CBOR_ERR_NONE) {
     printf(
@@ -65,6 +54,18 @@ int main(int argc, char* argv[]) {
             "https://www.rfc-editor.org/info/std94\n");
         break;
       }
+      case CBOR_ERR_INVALID_UTF8: {
+        printf("Invalid UTF-8 in a text string\n");
+        break;
+      }
+      case CBOR_ERR_FILE: {
+        printf("Cannot open the file\n");
+        break;
+      }
+      case CBOR_ERR_BUFFER_TOO_SMALL: {
+        // Only reported when decoding into a caller-provided buffer
+        break;
+      }
       case CBOR_ERR_NONE: {
         // GCC's cheap dataflow analysis gag
         break;
@@ -78,6 +79,4 @@ int main(int argc, char* argv[]) {
   fflush(stdout);
   /* Deallocate the result */
   cbor_decref(&item);
-
-  fclose(f);
 }
@@ -15,35 +15,30 @@ void usage(void) {
   exit(1);
 }
 
-#define BUFFER_SIZE 8
-unsigned char buffer[BUFFER_SIZE];
-FILE* out;
-
-void flush(size_t bytes) {
-  if (bytes == 0) exit(1);  // All items should be successfully encoded
-  if (fwrite(buffer, sizeof(unsigned char), bytes, out) != bytes) exit(1);
-  if (fflush(out)) exit(1);
-}
-
 /*
  * Example of using the streaming encoding API to create an array of integers
- * on the fly. Notice that a partial output is produced with every element.
+ * on the fly. The writer batches the encoded items and passes them to the
+ * output file whenever its buffer fills up.
  */
 int main(int argc, char* argv[]) {
   if (argc != 2) usage();
   size_t n;
   if (sscanf(argv[1], "%zu", &n) != 1) usage();
-  out = freopen(NULL, "wb", stdout);
+  FILE* out = freopen(NULL, "wb", stdout);
   if (!out) exit(1);
 
+  unsigned char buffer[4096];
+  cbor_writer writer;
+  cbor_writer_init_file(&writer, out, buffer, sizeof(buffer));
   // Start an indefinite-length array
-  flush(cbor_encode_indef_array_start(buffer, BUFFER_SIZE));
+  cbor_writer_indef_array_start(&writer);
   // Write the array items one by one
   for (size_t i = 0; i < n; i++) {
-    flush(cbor_encode_uint32(i, buffer, BUFFER_SIZE));
+    cbor_writer_uint(&writer, i);
   }
-  // Close the array
-  flush(cbor_encode_break(buffer, BUFFER_SIZE));
+  // Close the array. Errors are sticky, so checking the final flush is enough.
+  cbor_writer_break(&writer);
+  if (!cbor_writer_flush(&writer)) exit(1);
 
   if (fclose(out)) exit(1);
 }
@@ -13,51 +13,25 @@
 #include "cbor/internal/loaders.h"
 #include "cbor/internal/memory_utils.h"
 
-cbor_item_t* cbor_load(cbor_data source, size_t source_size,
-                       struct cbor_load_result* result) {
-  /* Context stack */
-  static struct cbor_callbacks callbacks = {
-      .uint8 = &cbor_builder_uint8_callback,
-      .uint16 = &cbor_builder_uint16_callback,
-      .uint32 = &cbor_builder_uint32_callback,
-      .uint64 = &cbor_builder_uint64_callback,
-
-      .negint8 = &cbor_builder_negint8_callback,
-      .negint16 = &cbor_builder_negint16_callback,
-      .negint32 = &cbor_builder_negint32_callback,
-      .negint64 = &cbor_builder_negint64_callback,
-
-      .byte_string = &cbor_builder_byte_string_callback,
-      .byte_string_start = &cbor_builder_byte_string_start_callback,
-
-      .string = &cbor_builder_string_callback,
-      .string_start = &cbor_builder_string_start_callback,
-
-      .array_start = &cbor_builder_array_start_callback,
-      .indef_array_start = &cbor_builder_indef_array_start_callback,
-
-      .map_start = &cbor_builder_map_start_callback,
-      .indef_map_start = &cbor_builder_indef_map_start_callback,
-
-      .tag = &cbor_builder_tag_callback,
-
-      .null = &cbor_builder_null_callback,
-      .undefined = &cbor_builder_undefined_callback,
-      .boolean = &cbor_builder_boolean_callback,
-      .float2 = &cbor_builder_float2_callback,
-      .float4 = &cbor_builder_float4_callback,
-      .float8 = &cbor_builder_float8_callback,
-      .indef_break = &cbor_builder_indef_break_callback};
-
+static cbor_item_t* _cbor_load_with_stack(
+    cbor_data source, size_t source_size,
+    const struct cbor_allocator* allocator, bool borrow_strings,
+    bool validate_strings, struct _cbor_stack* stack,
+    struct cbor_load_result* result) {
   if (source_size == 0) {
     result->error.code = CBOR_ERR_NODATA;
     return NULL;
   }
-  struct _cbor_stack stack = _cbor_stack_init();
 
   /* Target for callbacks */
   struct _cbor_decoder_context context = (struct _cbor_decoder_context){
-      .stack = &stack, .creation_failed = false, .syntax_error = false};
+      .stack = stack,
+      .creation_failed = false,
+      .syntax_error = false,
+      .allocator = allocator,
+      .borrow_strings = borrow_strings,
+      .validate_strings = validate_strings,
+      .invalid_string = false};
   struct cbor_decoder_result decode_result;
   *result =
       (struct cbor_load_result){.read = 0, .error = {.code = CBOR_ERR_NONE}};
@@ -66,7 +40,7 @@ cbor_item_t* cbor_load(cbor_data source, size_t source_size,
     if (source_size > result->read) { /* Check for overflows */
       decode_result =
           cbor_stream_decode(source + result->read, source_size - result->read,
-                             &callbacks, &context);
+                             &_cbor_builder_callbacks, &context);
     } else {
       result->error = (struct cbor_error){.code = CBOR_ERR_NOTENOUGHDATA,
                                           .position = result->read};
@@ -101,8 +75,11 @@ cbor_item_t* cbor_load(cbor_data source, size_t source_size,
     } else if (context.syntax_error) {
       result->error.code = CBOR_ERR_SYNTAXERROR;
       goto error;
+    } else if (context.invalid_string) {
+      result->error.code = CBOR_ERR_INVALID_UTF8;
+      goto error;
     }
-  } while (stack.size > 0);
+  } while (stack->size > 0);
 
   return context.root;
 
@@ -111,13 +88,74 @@ error:
   // debug_print("Failed with decoder error %d at %d\n", result->error.code,
   // result->error.position); cbor_describe(stack.top->item, stdout);
   /* Free the stack */
-  while (stack.size > 0) {
-    cbor_decref(&stack.top->item);
-    _cbor_stack_pop(&stack);
+  while (stack->size > 0) {
+    cbor_decref(&stack->top->item);
+    _cbor_stack_pop(stack);
   }
   return NULL;
 }
 
+static cbor_item_t* _cbor_load(cbor_data source, size_t source_size,
+                               const struct cbor_allocator* allocator,
+                               bool borrow_strings, bool validate_strings,
+                               struct cbor_load_result* result) {
+  struct _cbor_stack stack = _cbor_stack_init();
+  cbor_item_t* item =
+      _cbor_load_with_stack(source, source_size, allocator, borrow_strings,
+                            validate_strings, &stack, result);
+  _cbor_stack_release(&stack);
+  return item;
+}
+
+cbor_item_t* cbor_load(cbor_data source, size_t source_size,
+                       struct cbor_load_result* result) {
+  return _cbor_load(source, source_size, NULL, false, false, result);
+}
+
+cbor_item_t* cbor_load_borrowed(cbor_data source, size_t source_size,
+                                struct cbor_load_result* result) {
+  return _cbor_load(source, source_size, NULL, true, false, result);
+}
+
+cbor_item_t* cbor_load_validated(cbor_data source, size_t source_size,
+                                 struct cbor_load_result* result) {
+  return _cbor_load(source, source_size, NULL, false, true, result);
+}
+
+cbor_item_t* cbor_view_load(cbor_view_t view,
+                            struct cbor_load_result* result) {
+  return cbor_load(view.data, view.size, result);
+}
+
+cbor_item_t* cbor_load_with(cbor_data source, size_t source_size,
+                            const struct cbor_allocator* allocator,
+                            struct cbor_load_result* result) {
+  return _cbor_load(source, source_size, allocator, false, false, result);
+}
+
+cbor_item_t* cbor_load_arena(cbor_data source, size_t source_size,
+                             cbor_arena* arena,
+                             struct cbor_load_result* result) {
+  return _cbor_load(source, source_size, &arena->allocator, false, false,
+                    result);
+}
+
+cbor_item_t* cbor_decoder_load(cbor_decoder_t* decoder, cbor_data source,
+                               size_t source_size,
+                               struct cbor_load_result* result) {
+  struct _cbor_stack stack = _cbor_stack_init();
+  stack.records = decoder->stack;
+  stack.capacity = decoder->stack_capacity;
+  cbor_item_t* item = _cbor_load_with_stack(
+      source, source_size,
+      decoder->recycle_items ? &decoder->allocator : NULL, false, false,
+      &stack, result);
+  // The stack is empty again, keep its storage for the next load
+  decoder->stack = stack.records;
+  decoder->stack_capacity = stack.capacity;
+  return item;
+}
+
 static cbor_item_t* _cbor_copy_int(cbor_item_t* item, bool negative) {
   CBOR_ASSERT(cbor_isa_uint(item) || cbor_isa_negint(item));
   CBOR_ASSERT(cbor_int_get_width(item) >= CBOR_INT_8 &&
@@ -125,7 +163,9 @@ static cbor_item_t* _cbor_copy_int(cbor_item_t* item, bool negative) {
   cbor_item_t* res = NULL;
   switch (cbor_int_get_width(item)) {
     case CBOR_INT_8:
-      res = cbor_build_uint8(cbor_get_uint8(item));
+      // Not cbor_build_uint8, which returns shared items for small values
+      res = cbor_new_int8();
+      if (res != NULL) cbor_set_uint8(res, cbor_get_uint8(item));
       break;
     case CBOR_INT_16:
       res = cbor_build_uint16(cbor_get_uint16(item));
@@ -149,8 +189,13 @@ static cbor_item_t* _cbor_copy_float_ctrl(cbor_item_t* item) {
   CBOR_ASSERT(cbor_float_get_width(item) >= CBOR_FLOAT_0 &&
               cbor_float_get_width(item) <= CBOR_FLOAT_64);
   switch (cbor_float_get_width(item)) {
-    case CBOR_FLOAT_0:
-      return cbor_build_ctrl(cbor_ctrl_value(item));
+    case CBOR_FLOAT_0: {
+      // Not cbor_build_ctrl, which returns shared items for simple values
+      cbor_item_t* res = cbor_new_ctrl();
+      _CBOR_NOTNULL(res);
+      cbor_set_ctrl(res, cbor_ctrl_value(item));
+      return res;
+    }
     case CBOR_FLOAT_16:
       return cbor_build_float2(cbor_float_get_float2(item));
     case CBOR_FLOAT_32:
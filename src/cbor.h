@@ -11,19 +11,28 @@
 #include "cbor/common.h"
 #include "cbor/data.h"
 
+#include "cbor/arena.h"
 #include "cbor/arrays.h"
 #include "cbor/bytestrings.h"
+#include "cbor/decoder.h"
+#include "cbor/file.h"
 #include "cbor/floats_ctrls.h"
 #include "cbor/ints.h"
 #include "cbor/maps.h"
+#include "cbor/parallel.h"
+#include "cbor/parser.h"
 #include "cbor/strings.h"
 #include "cbor/tags.h"
+#include "cbor/typed_arrays.h"
+#include "cbor/view.h"
 
 #include "cbor/callbacks.h"
 #include "cbor/cbor_export.h"
 #include "cbor/encoding.h"
+#include "cbor/json.h"
 #include "cbor/serialization.h"
 #include "cbor/streaming.h"
+#include "cbor/writer.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -47,12 +56,148 @@ extern "C" {
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_load(
     cbor_data source, size_t source_size, struct cbor_load_result* result);
 
+/** Loads data item from a buffer without copying string data
+ *
+ * Behaves like #cbor_load, except that definite strings and byte strings
+ * (including the chunks of indefinite ones) point into \p source instead of
+ * owning a copy of their data. This avoids a copy for inputs dominated by
+ * large strings, such as binary blobs.
+ *
+ * \p source must outlive the returned item and must not be modified while
+ * the item is in use. The borrowed data must not be modified either, see
+ * #cbor_bytestring_is_borrowed and #cbor_string_is_borrowed. #cbor_decref
+ * does not free borrowed data and #cbor_copy creates owned copies.
+ *
+ * @param source The buffer
+ * @param source_size
+ * @param[out] result Result indicator. #CBOR_ERR_NONE on success
+ * @return Decoded CBOR item. The item's reference count is initialized to one.
+ * @return `NULL` on failure. In that case, \p result contains the location and
+ * description of the error.
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_load_borrowed(
+    cbor_data source, size_t source_size, struct cbor_load_result* result);
+
+/** Loads data item from a buffer, rejecting invalid UTF-8 text strings
+ *
+ * Behaves like #cbor_load, except that every definite text string and every
+ * chunk of an indefinite one is checked to be valid UTF-8 while decoding.
+ * #cbor_load defers this work until #cbor_string_codepoint_count is called,
+ * so use this variant when malformed text must be rejected up front, e.g. for
+ * untrusted input that is passed on to other systems.
+ *
+ * @param source The buffer
+ * @param source_size
+ * @param[out] result Result indicator. #CBOR_ERR_NONE on success,
+ * #CBOR_ERR_INVALID_UTF8 if a text string is not valid UTF-8
+ * @return Decoded CBOR item. The item's reference count is initialized to one.
+ * @return `NULL` on failure. In that case, \p result contains the location and
+ * description of the error.
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_load_validated(
+    cbor_data source, size_t source_size, struct cbor_load_result* result);
+
+/** Loads data item from a buffer using a custom allocator
+ *
+ * Behaves like #cbor_load, except that the item, its subitems, and all of
+ * their data are allocated from \p allocator instead of the global routines
+ * set by #cbor_set_allocs. The items keep using \p allocator when they are
+ * modified or released, so it must outlive them. The temporary parser stack
+ * still comes from the global routines.
+ *
+ * This makes it possible to decode into a per-request or per-thread heap
+ * without changing the global state:
+ *
+ * \rst
+ * .. code-block:: c
+ *
+ *    struct cbor_allocator pool = {.allocate = pool_alloc,
+ *                                  .reallocate = pool_realloc,
+ *                                  .deallocate = pool_free,
+ *                                  .context = &thread_pool};
+ *    cbor_item_t* item = cbor_load_with(data, length, &pool, &result);
+ * \endrst
+ *
+ * @param source The buffer
+ * @param source_size
+ * @param allocator The allocator to use. `NULL` behaves like #cbor_load.
+ * @param[out] result Result indicator. #CBOR_ERR_NONE on success
+ * @return Decoded CBOR item. The item's reference count is initialized to one.
+ * @return `NULL` on failure. In that case, \p result contains the location and
+ * description of the error.
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_load_with(
+    cbor_data source, size_t source_size,
+    const struct cbor_allocator* allocator, struct cbor_load_result* result);
+
+/** Loads data item from a buffer into an arena
+ *
+ * Behaves like #cbor_load, except that the item and all of its subitems are
+ * allocated from \p arena. This replaces one allocation per item with a
+ * pointer bump and allows releasing the whole tree at once with
+ * #cbor_arena_reset or #cbor_arena_release instead of #cbor_decref.
+ *
+ * The items must not be used after the arena has been reset or released.
+ * Containers and strings loaded this way keep allocating from \p arena when
+ * modified, and data handles assigned to them (e.g. using
+ * #cbor_string_set_handle) must come from the same arena.
+ *
+ * @param source The buffer
+ * @param source_size
+ * @param arena An initialized arena. Memory used by a failed load is
+ * reclaimed on the next reset.
+ * @param[out] result Result indicator. #CBOR_ERR_NONE on success
+ * @return Decoded CBOR item owned by \p arena. Its reference count is
+ * initialized to one.
+ * @return `NULL` on failure. In that case, \p result contains the location and
+ * description of the error.
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_load_arena(
+    cbor_data source, size_t source_size, cbor_arena* arena,
+    struct cbor_load_result* result);
+
+/** Loads data item from a buffer using a reusable decoder
+ *
+ * Behaves like #cbor_load, except that the parser stack is kept in
+ * \p decoder and reused by the following loads. If \p decoder recycles items
+ * (see #cbor_decoder_init), the item and its subitems are allocated from
+ * memory released by previously decoded items.
+ *
+ * \rst
+ * .. code-block:: c
+ *
+ *    cbor_decoder_t decoder;
+ *    cbor_decoder_init(&decoder, true);
+ *    while (next_message(&message, &length)) {
+ *      struct cbor_load_result result;
+ *      cbor_item_t* item = cbor_decoder_load(&decoder, message, length,
+ *                                            &result);
+ *      process(item, result);
+ *      cbor_decref(&item);
+ *    }
+ *    cbor_decoder_release(&decoder);
+ * \endrst
+ *
+ * @param decoder An initialized decoder
+ * @param source The buffer
+ * @param source_size
+ * @param[out] result Result indicator. #CBOR_ERR_NONE on success
+ * @return Decoded CBOR item. The item's reference count is initialized to one.
+ * @return `NULL` on failure. In that case, \p result contains the location and
+ * description of the error.
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_decoder_load(
+    cbor_decoder_t* decoder, cbor_data source, size_t source_size,
+    struct cbor_load_result* result);
+
 /** Take a deep copy of an item
  *
  * All items this item points to (array and map members, string chunks, tagged
  * items) will be copied recursively using #cbor_copy. The new item doesn't
  * alias or point to any items from the original \p item. All the reference
- * counts in the new structure are set to one.
+ * counts in the new structure are set to one. Shared read-only items (see
+ * #cbor_build_uint8 and #cbor_build_ctrl) are copied too, so the copy can be
+ * modified.
  *
  * @param item item to copy
  * @return Reference to the new item. The item's reference count is initialized
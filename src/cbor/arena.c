@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include "arena.h"
+#include <string.h>
+#include "internal/memory_utils.h"
+
+struct _cbor_arena_block {
+  struct _cbor_arena_block* next;
+  size_t capacity;
+  size_t used;
+};
+
+/* Strictest alignment required by any of the item members */
+union _cbor_arena_max_align {
+  uint64_t u;
+  double d;
+  void* p;
+};
+
+#define _CBOR_ARENA_ALIGNMENT sizeof(union _cbor_arena_max_align)
+
+/* Round up to the alignment; zero-sized requests still get a distinct slot */
+static size_t _cbor_arena_align(size_t size) {
+  if (size == 0) size = 1;
+  return (size + _CBOR_ARENA_ALIGNMENT - 1) & ~(_CBOR_ARENA_ALIGNMENT - 1);
+}
+
+#define _CBOR_ARENA_HEADER_SIZE \
+  ((sizeof(struct _cbor_arena_block) + _CBOR_ARENA_ALIGNMENT - 1) & \
+   ~(_CBOR_ARENA_ALIGNMENT - 1))
+
+static unsigned char* _cbor_arena_payload(struct _cbor_arena_block* block) {
+  return (unsigned char*)block + _CBOR_ARENA_HEADER_SIZE;
+}
+
+static struct _cbor_arena_block* _cbor_arena_new_block(size_t capacity) {
+  if (!_cbor_safe_to_add(capacity, _CBOR_ARENA_HEADER_SIZE)) return NULL;
+  struct _cbor_arena_block* block =
+      _cbor_malloc(_CBOR_ARENA_HEADER_SIZE + capacity);
+  _CBOR_NOTNULL(block);
+  *block = (struct _cbor_arena_block){
+      .next = NULL, .capacity = capacity, .used = 0};
+  return block;
+}
+
+static void* _cbor_arena_allocate(void* context, size_t size) {
+  cbor_arena* arena = context;
+  if (size > SIZE_MAX - _CBOR_ARENA_ALIGNMENT) return NULL;
+  size = _cbor_arena_align(size);
+
+  struct _cbor_arena_block* head = arena->blocks;
+  if (head != NULL && head->capacity - head->used >= size) {
+    void* result = _cbor_arena_payload(head) + head->used;
+    head->used += size;
+    return result;
+  }
+
+  if (size > arena->block_size) {
+    /* Oversized allocations get a dedicated block behind the current one so
+     * that the free space left in the current block is not wasted */
+    struct _cbor_arena_block* block = _cbor_arena_new_block(size);
+    _CBOR_NOTNULL(block);
+    block->used = size;
+    if (head != NULL) {
+      block->next = head->next;
+      head->next = block;
+    } else {
+      arena->blocks = block;
+    }
+    return _cbor_arena_payload(block);
+  }
+
+  struct _cbor_arena_block* block = _cbor_arena_new_block(arena->block_size);
+  _CBOR_NOTNULL(block);
+  block->next = head;
+  block->used = size;
+  arena->blocks = block;
+  return _cbor_arena_payload(block);
+}
+
+static void* _cbor_arena_reallocate(void* context, void* pointer,
+                                    size_t old_size, size_t new_size) {
+  cbor_arena* arena = context;
+  if (pointer == NULL) return _cbor_arena_allocate(context, new_size);
+
+  /* The most recent allocation from the current block can grow in place */
+  struct _cbor_arena_block* head = arena->blocks;
+  if (head != NULL && new_size <= SIZE_MAX - _CBOR_ARENA_ALIGNMENT) {
+    unsigned char* payload = _cbor_arena_payload(head);
+    if ((unsigned char*)pointer >= payload &&
+        (unsigned char*)pointer < payload + head->used) {
+      size_t offset = (size_t)((unsigned char*)pointer - payload);
+      if (offset + _cbor_arena_align(old_size) == head->used &&
+          head->capacity - offset >= _cbor_arena_align(new_size)) {
+        head->used = offset + _cbor_arena_align(new_size);
+        return pointer;
+      }
+    }
+  }
+
+  void* result = _cbor_arena_allocate(context, new_size);
+  _CBOR_NOTNULL(result);
+  memcpy(result, pointer, old_size < new_size ? old_size : new_size);
+  return result;
+}
+
+static void _cbor_arena_deallocate(void* context _CBOR_UNUSED,
+                                   void* pointer _CBOR_UNUSED) {
+  /* Memory is reclaimed in bulk by cbor_arena_reset/cbor_arena_release */
+}
+
+void cbor_arena_init(cbor_arena* arena, size_t block_size) {
+  *arena = (cbor_arena){
+      .blocks = NULL,
+      .block_size = _cbor_arena_align(
+          block_size == 0 ? CBOR_ARENA_DEFAULT_BLOCK_SIZE : block_size),
+      .allocator = {.allocate = _cbor_arena_allocate,
+                    .reallocate = _cbor_arena_reallocate,
+                    .deallocate = _cbor_arena_deallocate,
+                    .context = arena}};
+}
+
+static void _cbor_arena_free_blocks(struct _cbor_arena_block* block) {
+  while (block != NULL) {
+    struct _cbor_arena_block* next = block->next;
+    _cbor_free(block);
+    block = next;
+  }
+}
+
+void cbor_arena_reset(cbor_arena* arena) {
+  struct _cbor_arena_block* head = arena->blocks;
+  if (head == NULL) return;
+  if (head->next == NULL) {
+    head->used = 0;
+    return;
+  }
+  size_t capacity = cbor_arena_capacity(arena);
+  _cbor_arena_free_blocks(head);
+  /* If this fails, the arena simply starts from scratch on the next use */
+  arena->blocks = _cbor_arena_new_block(capacity);
+}
+
+void cbor_arena_release(cbor_arena* arena) {
+  _cbor_arena_free_blocks(arena->blocks);
+  arena->blocks = NULL;
+}
+
+size_t cbor_arena_capacity(const cbor_arena* arena) {
+  size_t capacity = 0;
+  for (struct _cbor_arena_block* block = arena->blocks; block != NULL;
+       block = block->next) {
+    capacity += block->capacity;
+  }
+  return capacity;
+}
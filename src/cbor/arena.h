@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#ifndef LIBCBOR_ARENA_H
+#define LIBCBOR_ARENA_H
+
+#include "cbor/cbor_export.h"
+#include "cbor/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * ============================================================================
+ * Arena allocation
+ * ============================================================================
+ */
+
+/** Default size of an arena block */
+#define CBOR_ARENA_DEFAULT_BLOCK_SIZE 16384
+
+struct _cbor_arena_block;
+
+/** Bump allocator owning a whole decoded item tree
+ *
+ * Items allocated from an arena (see #cbor_load_arena) live until the arena is
+ * reset or released. Releasing their references with #cbor_decref is allowed
+ * but not required, and never returns memory to the arena.
+ *
+ * The arena is referenced by the items it owns, so it must not be moved or
+ * copied while any of them are in use. All members are private.
+ */
+typedef struct cbor_arena {
+  /** Block currently being allocated from, followed by the older ones */
+  struct _cbor_arena_block* blocks;
+  /** Size of newly allocated blocks */
+  size_t block_size;
+  /** Allocator routines handed out to the items */
+  struct cbor_allocator allocator;
+} cbor_arena;
+
+/** Initialize an empty arena
+ *
+ * No memory is allocated until the first item is created.
+ *
+ * @param arena The arena to initialize
+ * @param block_size Size of a single allocation block in bytes. Pass 0 for
+ * #CBOR_ARENA_DEFAULT_BLOCK_SIZE. Allocations larger than a block get a block
+ * of their own.
+ */
+CBOR_EXPORT void cbor_arena_init(cbor_arena* arena, size_t block_size);
+
+/** Invalidate all items allocated from the arena and make its memory
+ * available for reuse
+ *
+ * If the previous use spilled over to multiple blocks, they are merged into a
+ * single block large enough to fit the same amount of data, so that decoding
+ * similar inputs in a loop settles on a single allocation per cycle at most.
+ *
+ * @param arena An initialized arena
+ */
+CBOR_EXPORT void cbor_arena_reset(cbor_arena* arena);
+
+/** Invalidate all items allocated from the arena and release its memory
+ *
+ * The arena can be reused afterwards as if it was freshly initialized.
+ *
+ * @param arena An initialized arena
+ */
+CBOR_EXPORT void cbor_arena_release(cbor_arena* arena);
+
+/** Get the amount of memory held by the arena
+ *
+ * @param arena An initialized arena
+ * @return The sum of all block capacities in bytes
+ */
+_CBOR_NODISCARD CBOR_EXPORT size_t cbor_arena_capacity(const cbor_arena* arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // LIBCBOR_ARENA_H
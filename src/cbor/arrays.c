@@ -69,8 +69,9 @@ bool cbor_array_push(cbor_item_t* array, cbor_item_t* pushee) {
                                   ? 1
                                   : CBOR_BUFFER_GROWTH * metadata->allocated;
 
-      unsigned char* new_data = _cbor_realloc_multiple(
-          array->data, sizeof(cbor_item_t*), new_allocation);
+      unsigned char* new_data = _cbor_realloc_multiple_with(
+          array->allocator, array->data, sizeof(cbor_item_t*),
+          metadata->allocated, new_allocation);
       if (new_data == NULL) {
         return false;
       }
@@ -99,11 +100,16 @@ cbor_item_t** cbor_array_handle(const cbor_item_t* item) {
   return (cbor_item_t**)item->data;
 }
 
-cbor_item_t* cbor_new_definite_array(size_t size) {
-  cbor_item_t* item = _cbor_malloc(sizeof(cbor_item_t));
+cbor_item_t* cbor_new_definite_array_with(
+    const struct cbor_allocator* allocator, size_t size) {
+  cbor_item_t* item = _cbor_alloc_with(allocator, sizeof(cbor_item_t));
   _CBOR_NOTNULL(item);
-  cbor_item_t** data = _cbor_alloc_multiple(sizeof(cbor_item_t*), size);
-  _CBOR_DEPENDENT_NOTNULL(item, data);
+  cbor_item_t** data =
+      _cbor_alloc_multiple_with(allocator, sizeof(cbor_item_t*), size);
+  if (data == NULL) {
+    _cbor_free_with(allocator, item);
+    return NULL;
+  }
 
   for (size_t i = 0; i < size; i++) {
     data[i] = NULL;
@@ -115,13 +121,19 @@ cbor_item_t* cbor_new_definite_array(size_t size) {
       .metadata = {.array_metadata = {.type = _CBOR_METADATA_DEFINITE,
                                       .allocated = size,
                                       .end_ptr = 0}},
-      .data = (unsigned char*)data};
+      .data = (unsigned char*)data,
+      .allocator = allocator};
 
   return item;
 }
 
-cbor_item_t* cbor_new_indefinite_array(void) {
-  cbor_item_t* item = _cbor_malloc(sizeof(cbor_item_t));
+cbor_item_t* cbor_new_definite_array(size_t size) {
+  return cbor_new_definite_array_with(NULL, size);
+}
+
+cbor_item_t* cbor_new_indefinite_array_with(
+    const struct cbor_allocator* allocator) {
+  cbor_item_t* item = _cbor_alloc_with(allocator, sizeof(cbor_item_t));
   _CBOR_NOTNULL(item);
 
   *item = (cbor_item_t){
@@ -130,7 +142,11 @@ cbor_item_t* cbor_new_indefinite_array(void) {
       .metadata = {.array_metadata = {.type = _CBOR_METADATA_INDEFINITE,
                                       .allocated = 0,
                                       .end_ptr = 0}},
-      .data = NULL /* Can be safely realloc-ed */
-  };
+      .data = NULL, /* Can be safely realloc-ed */
+      .allocator = allocator};
   return item;
 }
+
+cbor_item_t* cbor_new_indefinite_array(void) {
+  return cbor_new_indefinite_array_with(NULL);
+}
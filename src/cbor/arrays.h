@@ -109,6 +109,19 @@ CBOR_EXPORT cbor_item_t** cbor_array_handle(const cbor_item_t* item);
 _CBOR_NODISCARD
 CBOR_EXPORT cbor_item_t* cbor_new_definite_array(size_t size);
 
+/** Like #cbor_new_definite_array, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @param size Number of slots to preallocate
+ * @return Reference to the new array item. The item's reference count is
+ * initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
+_CBOR_NODISCARD
+CBOR_EXPORT cbor_item_t* cbor_new_definite_array_with(
+    const struct cbor_allocator* allocator, size_t size);
+
 /** Create new indefinite array
  *
  * @return Reference to the new array item. The item's reference count is
@@ -118,6 +131,18 @@ CBOR_EXPORT cbor_item_t* cbor_new_definite_array(size_t size);
 _CBOR_NODISCARD
 CBOR_EXPORT cbor_item_t* cbor_new_indefinite_array(void);
 
+/** Like #cbor_new_indefinite_array, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @return Reference to the new array item. The item's reference count is
+ * initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
+_CBOR_NODISCARD
+CBOR_EXPORT cbor_item_t* cbor_new_indefinite_array_with(
+    const struct cbor_allocator* allocator);
+
 /** Append to the end
  *
  * For indefinite items, storage may be reallocated. For definite items, only
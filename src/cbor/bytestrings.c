@@ -28,27 +28,44 @@ bool cbor_bytestring_is_indefinite(const cbor_item_t* item) {
   return !cbor_bytestring_is_definite(item);
 }
 
-cbor_item_t* cbor_new_definite_bytestring(void) {
-  cbor_item_t* item = _cbor_malloc(sizeof(cbor_item_t));
+bool cbor_bytestring_is_borrowed(const cbor_item_t* item) {
+  CBOR_ASSERT(cbor_isa_bytestring(item));
+  return item->flags & _CBOR_ITEM_BORROWED;
+}
+
+cbor_item_t* cbor_new_definite_bytestring_with(
+    const struct cbor_allocator* allocator) {
+  cbor_item_t* item = _cbor_alloc_with(allocator, sizeof(cbor_item_t));
   _CBOR_NOTNULL(item);
   *item = (cbor_item_t){
       .refcount = 1,
       .type = CBOR_TYPE_BYTESTRING,
       .metadata = {.bytestring_metadata = {.type = _CBOR_METADATA_DEFINITE,
-                                           .length = 0}}};
+                                           .length = 0}},
+      .allocator = allocator};
   return item;
 }
 
-cbor_item_t* cbor_new_indefinite_bytestring(void) {
-  cbor_item_t* item = _cbor_malloc(sizeof(cbor_item_t));
+cbor_item_t* cbor_new_definite_bytestring(void) {
+  return cbor_new_definite_bytestring_with(NULL);
+}
+
+cbor_item_t* cbor_new_indefinite_bytestring_with(
+    const struct cbor_allocator* allocator) {
+  cbor_item_t* item = _cbor_alloc_with(allocator, sizeof(cbor_item_t));
   _CBOR_NOTNULL(item);
   *item = (cbor_item_t){
       .refcount = 1,
       .type = CBOR_TYPE_BYTESTRING,
       .metadata = {.bytestring_metadata = {.type = _CBOR_METADATA_INDEFINITE,
                                            .length = 0}},
-      .data = _cbor_malloc(sizeof(struct cbor_indefinite_string_data))};
-  _CBOR_DEPENDENT_NOTNULL(item, item->data);
+      .data = _cbor_alloc_with(allocator,
+                               sizeof(struct cbor_indefinite_string_data)),
+      .allocator = allocator};
+  if (item->data == NULL) {
+    _cbor_free_with(allocator, item);
+    return NULL;
+  }
   *((struct cbor_indefinite_string_data*)item->data) =
       (struct cbor_indefinite_string_data){
           .chunk_count = 0,
@@ -58,22 +75,35 @@ cbor_item_t* cbor_new_indefinite_bytestring(void) {
   return item;
 }
 
-cbor_item_t* cbor_build_bytestring(cbor_data handle, size_t length) {
-  cbor_item_t* item = cbor_new_definite_bytestring();
+cbor_item_t* cbor_new_indefinite_bytestring(void) {
+  return cbor_new_indefinite_bytestring_with(NULL);
+}
+
+cbor_item_t* cbor_build_bytestring_with(const struct cbor_allocator* allocator,
+                                        cbor_data handle, size_t length) {
+  cbor_item_t* item = cbor_new_definite_bytestring_with(allocator);
   _CBOR_NOTNULL(item);
-  void* content = _cbor_malloc(length);
-  _CBOR_DEPENDENT_NOTNULL(item, content);
+  void* content = _cbor_alloc_with(allocator, length);
+  if (content == NULL) {
+    _cbor_free_with(allocator, item);
+    return NULL;
+  }
   memcpy(content, handle, length);
   cbor_bytestring_set_handle(item, content, length);
   return item;
 }
 
+cbor_item_t* cbor_build_bytestring(cbor_data handle, size_t length) {
+  return cbor_build_bytestring_with(NULL, handle, length);
+}
+
 void cbor_bytestring_set_handle(cbor_item_t* item,
                                 cbor_mutable_data CBOR_RESTRICT_POINTER data,
                                 size_t length) {
   CBOR_ASSERT(cbor_isa_bytestring(item));
   CBOR_ASSERT(cbor_bytestring_is_definite(item));
   item->data = data;
+  item->flags &= (uint8_t)~_CBOR_ITEM_BORROWED;
   item->metadata.bytestring_metadata.length = length;
 }
 
@@ -105,8 +135,9 @@ bool cbor_bytestring_add_chunk(cbor_item_t* item, cbor_item_t* chunk) {
         data->chunk_capacity == 0 ? 1
                                   : CBOR_BUFFER_GROWTH * (data->chunk_capacity);
 
-    cbor_item_t** new_chunks_data = _cbor_realloc_multiple(
-        data->chunks, sizeof(cbor_item_t*), new_chunk_capacity);
+    cbor_item_t** new_chunks_data = _cbor_realloc_multiple_with(
+        item->allocator, data->chunks, sizeof(cbor_item_t*),
+        data->chunk_capacity, new_chunk_capacity);
 
     if (new_chunks_data == NULL) {
       return false;
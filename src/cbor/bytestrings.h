@@ -47,10 +47,22 @@ CBOR_EXPORT bool cbor_bytestring_is_definite(const cbor_item_t* item);
 _CBOR_NODISCARD
 CBOR_EXPORT bool cbor_bytestring_is_indefinite(const cbor_item_t* item);
 
+/** Does the byte string point into a buffer it does not own?
+ *
+ * Byte strings loaded by #cbor_load_borrowed reference the input buffer.
+ * Their data must not be modified and is valid only as long as the buffer.
+ *
+ * @param item a byte string
+ * @return Is the byte string data borrowed?
+ */
+_CBOR_NODISCARD
+CBOR_EXPORT bool cbor_bytestring_is_borrowed(const cbor_item_t* item);
+
 /** Get the handle to the binary data
  *
- * Definite items only. Modifying the data is allowed. In that case, the caller
- * takes responsibility for the effect on items this item might be a part of
+ * Definite items only. Borrowed data (see #cbor_bytestring_is_borrowed) must
+ * not be modified. Other data can be modified, in which case the caller takes
+ * responsibility for the effect on items this item might be a part of
  *
  * @param item A definite byte string
  * @return The address of the underlying binary data
@@ -119,6 +131,18 @@ CBOR_EXPORT bool cbor_bytestring_add_chunk(cbor_item_t* item,
 _CBOR_NODISCARD
 CBOR_EXPORT cbor_item_t* cbor_new_definite_bytestring(void);
 
+/** Like #cbor_new_definite_bytestring, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @return Reference to the new bytestring item. The item's reference count is
+ * initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
+_CBOR_NODISCARD
+CBOR_EXPORT cbor_item_t* cbor_new_definite_bytestring_with(
+    const struct cbor_allocator* allocator);
+
 /** Creates a new indefinite byte string
  *
  * The chunks array is initialized to `NULL` and chunk count to 0
@@ -130,6 +154,18 @@ CBOR_EXPORT cbor_item_t* cbor_new_definite_bytestring(void);
 _CBOR_NODISCARD
 CBOR_EXPORT cbor_item_t* cbor_new_indefinite_bytestring(void);
 
+/** Like #cbor_new_indefinite_bytestring, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @return Reference to the new bytestring item. The item's reference count is
+ * initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
+_CBOR_NODISCARD
+CBOR_EXPORT cbor_item_t* cbor_new_indefinite_bytestring_with(
+    const struct cbor_allocator* allocator);
+
 /** Creates a new byte string and initializes it
  *
  * The `handle` will be copied to a newly allocated block
@@ -143,6 +179,20 @@ CBOR_EXPORT cbor_item_t* cbor_new_indefinite_bytestring(void);
 _CBOR_NODISCARD
 CBOR_EXPORT cbor_item_t* cbor_build_bytestring(cbor_data handle, size_t length);
 
+/** Like #cbor_build_bytestring, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @param handle Block of binary data
+ * @param length Length of `data`
+ * @return Reference to the new bytestring item. The item's reference count is
+ * initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
+_CBOR_NODISCARD
+CBOR_EXPORT cbor_item_t* cbor_build_bytestring_with(
+    const struct cbor_allocator* allocator, cbor_data handle, size_t length);
+
 #ifdef __cplusplus
 }
 #endif
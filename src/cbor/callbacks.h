@@ -38,6 +38,14 @@ typedef void (*cbor_string_callback)(void*, cbor_data, uint64_t);
 /** Callback prototype */
 typedef void (*cbor_collection_callback)(void*, uint64_t);
 
+/** Callback prototype for a part of a definite string
+ *
+ * Receives the context, the part, its length, and the number of bytes of the
+ * string that follow the part. The last part has zero bytes remaining.
+ */
+typedef void (*cbor_string_part_callback)(void*, cbor_data, uint64_t,
+                                          uint64_t);
+
 /** Callback prototype */
 typedef void (*cbor_float_callback)(void*, float);
 
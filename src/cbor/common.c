@@ -10,6 +10,8 @@
 #include "bytestrings.h"
 #include "data.h"
 #include "floats_ctrls.h"
+#include "internal/atomics.h"
+#include "internal/memory_utils.h"
 #include "ints.h"
 #include "maps.h"
 #include "strings.h"
@@ -82,14 +84,20 @@ bool cbor_is_float(const cbor_item_t* item) {
 }
 
 cbor_item_t* cbor_incref(cbor_item_t* item) {
-  item->refcount++;
+  if (!(item->flags & _CBOR_ITEM_IMMORTAL))
+    _cbor_atomic_increment(&item->refcount);
   return item;
 }
 
 void cbor_decref(cbor_item_t** item_ref) {
   cbor_item_t* item = *item_ref;
-  CBOR_ASSERT(item->refcount > 0);
-  if (--item->refcount == 0) {
+  if (item->flags & _CBOR_ITEM_IMMORTAL) {
+    // Behaves as if this was the last reference, but there is nothing to free
+    *item_ref = NULL;
+    return;
+  }
+  CBOR_ASSERT(_cbor_atomic_load(&item->refcount) > 0);
+  if (_cbor_atomic_decrement(&item->refcount) == 0) {
     switch (item->type) {
       case CBOR_TYPE_UINT:
         /* Fallthrough */
@@ -98,27 +106,33 @@ void cbor_decref(cbor_item_t** item_ref) {
         { break; }
       case CBOR_TYPE_BYTESTRING: {
         if (cbor_bytestring_is_definite(item)) {
-          _cbor_free(item->data);
+          if (!(item->flags & _CBOR_ITEM_BORROWED))
+            _cbor_free_with(item->allocator, item->data);
         } else {
           /* We need to decref all chunks */
           cbor_item_t** handle = cbor_bytestring_chunks_handle(item);
           for (size_t i = 0; i < cbor_bytestring_chunk_count(item); i++)
             cbor_decref(&handle[i]);
-          _cbor_free(((struct cbor_indefinite_string_data*)item->data)->chunks);
-          _cbor_free(item->data);
+          _cbor_free_with(
+              item->allocator,
+              ((struct cbor_indefinite_string_data*)item->data)->chunks);
+          _cbor_free_with(item->allocator, item->data);
         }
         break;
       }
       case CBOR_TYPE_STRING: {
         if (cbor_string_is_definite(item)) {
-          _cbor_free(item->data);
+          if (!(item->flags & _CBOR_ITEM_BORROWED))
+            _cbor_free_with(item->allocator, item->data);
         } else {
           /* We need to decref all chunks */
           cbor_item_t** handle = cbor_string_chunks_handle(item);
           for (size_t i = 0; i < cbor_string_chunk_count(item); i++)
             cbor_decref(&handle[i]);
-          _cbor_free(((struct cbor_indefinite_string_data*)item->data)->chunks);
-          _cbor_free(item->data);
+          _cbor_free_with(
+              item->allocator,
+              ((struct cbor_indefinite_string_data*)item->data)->chunks);
+          _cbor_free_with(item->allocator, item->data);
         }
         break;
       }
@@ -128,7 +142,7 @@ void cbor_decref(cbor_item_t** item_ref) {
         size_t size = cbor_array_size(item);
         for (size_t i = 0; i < size; i++)
           if (handle[i] != NULL) cbor_decref(&handle[i]);
-        _cbor_free(item->data);
+        _cbor_free_with(item->allocator, item->data);
         break;
       }
       case CBOR_TYPE_MAP: {
@@ -138,13 +152,14 @@ void cbor_decref(cbor_item_t** item_ref) {
           cbor_decref(&handle->key);
           if (handle->value != NULL) cbor_decref(&handle->value);
         }
-        _cbor_free(item->data);
+        _cbor_map_drop_index(item);
+        _cbor_free_with(item->allocator, item->data);
         break;
       }
       case CBOR_TYPE_TAG: {
         if (item->metadata.tag_metadata.tagged_item != NULL)
           cbor_decref(&item->metadata.tag_metadata.tagged_item);
-        _cbor_free(item->data);
+        _cbor_free_with(item->allocator, item->data);
         break;
       }
       case CBOR_TYPE_FLOAT_CTRL: {
@@ -152,18 +167,21 @@ void cbor_decref(cbor_item_t** item_ref) {
         break;
       }
     }
-    _cbor_free(item);
+    _cbor_free_with(item->allocator, item);
     *item_ref = NULL;
   }
 }
 
 void cbor_intermediate_decref(cbor_item_t* item) { cbor_decref(&item); }
 
-size_t cbor_refcount(const cbor_item_t* item) { return item->refcount; }
+size_t cbor_refcount(const cbor_item_t* item) {
+  return _cbor_atomic_load(&item->refcount);
+}
 
 cbor_item_t* cbor_move(cbor_item_t* item) {
   if (item == NULL) return NULL;
-  item->refcount--;
+  if (!(item->flags & _CBOR_ITEM_IMMORTAL))
+    _cbor_atomic_decrement(&item->refcount);
   return item;
 }
 
@@ -343,6 +343,9 @@ CBOR_EXPORT void cbor_intermediate_decref(cbor_item_t* item);
  *   This does *not* account for transitive references.
  * \endrst
  *
+ * Shared items returned by e.g. #cbor_build_uint8 are never released and
+ * report `SIZE_MAX`.
+ *
  * @todo Add some inline examples for reference counting
  *
  * @param item the item
@@ -52,6 +52,17 @@ typedef enum {
                        your allocator? */
   ,
   CBOR_ERR_SYNTAXERROR /** Stack parsing algorithm failed */
+  ,
+  CBOR_ERR_INVALID_UTF8 /** A text string is not valid UTF-8. Only reported by
+                           #cbor_load_validated */
+  ,
+  CBOR_ERR_FILE /** The file could not be opened. Only reported by
+                   #cbor_load_file */
+  ,
+  CBOR_ERR_BUFFER_TOO_SMALL /** The caller-provided buffer cannot hold the
+                               result. Only reported by
+                               #cbor_load_int64_array and
+                               #cbor_load_double_array */
 } cbor_error_code;
 
 /** Possible widths of #CBOR_TYPE_UINT items */
@@ -107,8 +118,9 @@ struct _cbor_bytestring_metadata {
 /** Strings specific metadata */
 struct _cbor_string_metadata {
   size_t length;
-  size_t codepoint_count; /* Sum of chunks' codepoint_counts for indefinite
-                             strings */
+  /* Computed on first use for definite strings, `SIZE_MAX` until then. Zero
+   * for indefinite strings. */
+  size_t codepoint_count;
   _cbor_dst_metadata type;
 };
 
@@ -167,6 +179,39 @@ union cbor_item_metadata {
   struct _cbor_float_ctrl_metadata float_ctrl_metadata;
 };
 
+/** Memory management routines with an explicit context
+ *
+ * Items remember the allocator they were created with, so that #cbor_decref
+ * and the growth of indefinite containers go back to the same routines. A
+ * `NULL` allocator stands for the global routines set by #cbor_set_allocs.
+ *
+ * Pass an allocator to #cbor_load_with, the `cbor_new_*_with` and
+ * `cbor_build_*_with` constructors, or #cbor_serialize_alloc_with. See
+ * #cbor_arena for an implementation.
+ */
+struct cbor_allocator {
+  /** Allocate \p size bytes, returns `NULL` on failure */
+  void* (*allocate)(void* context, size_t size);
+  /** Resize \p ptr (previously allocated with \p old_size bytes) to
+   * \p new_size bytes, returns `NULL` on failure */
+  void* (*reallocate)(void* context, void* ptr, size_t old_size,
+                      size_t new_size);
+  /** Release \p ptr */
+  void (*deallocate)(void* context, void* ptr);
+  /** Passed as the first argument to the routines */
+  void* context;
+};
+
+/** Flags describing how the item owns its memory - see cbor_item_t#flags */
+enum _cbor_item_flags {
+  /** cbor_item_t#data points into a buffer the item does not own and must
+   * not be freed or modified */
+  _CBOR_ITEM_BORROWED = 0x01,
+  /** The item is a statically allocated instance shared by all its users. It
+   * is never released and must not be modified. */
+  _CBOR_ITEM_IMMORTAL = 0x02,
+};
+
 /** The item handle */
 typedef struct cbor_item_t {
   /** Discriminated by type */
@@ -175,8 +220,12 @@ typedef struct cbor_item_t {
   size_t refcount;
   /** Major type discriminator */
   cbor_type type;
+  /** Combination of #_cbor_item_flags */
+  uint8_t flags;
   /** Raw data block - interpretation depends on metadata */
   unsigned char* data;
+  /** Routines owning the item and its data, `NULL` for the global ones */
+  const struct cbor_allocator* allocator;
 } cbor_item_t;
 
 /** Defines cbor_item_t#data structure for indefinite strings and bytestrings
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include "decoder.h"
+
+#include <string.h>
+
+#include "internal/memory_utils.h"
+
+struct _cbor_decoder_slab {
+  struct _cbor_decoder_slab* next;
+  /** Number of blocks in the slab */
+  size_t count;
+};
+
+/* Strictest alignment required by any of the item members */
+union _cbor_decoder_max_align {
+  uint64_t u;
+  double d;
+  void* p;
+};
+
+#define _CBOR_DECODER_ALIGN(size)                          \
+  (((size) + sizeof(union _cbor_decoder_max_align) - 1) & \
+   ~(sizeof(union _cbor_decoder_max_align) - 1))
+
+/* Size of a recycled block. Allocations up to this size are served from the
+ * slabs, which covers the items themselves (including the inline payload of
+ * integers and floats) and most small string and array buffers. */
+#define _CBOR_DECODER_BLOCK_SIZE \
+  _CBOR_DECODER_ALIGN(sizeof(cbor_item_t) + sizeof(uint64_t))
+
+#define _CBOR_DECODER_HEADER_SIZE \
+  _CBOR_DECODER_ALIGN(sizeof(struct _cbor_decoder_slab))
+
+/* Number of blocks in the first slab, every following slab doubles it */
+#define _CBOR_DECODER_INITIAL_SLAB 64
+#define _CBOR_DECODER_MAX_SLAB 65536
+
+static unsigned char* _cbor_decoder_payload(struct _cbor_decoder_slab* slab) {
+  return (unsigned char*)slab + _CBOR_DECODER_HEADER_SIZE;
+}
+
+static bool _cbor_decoder_owns(const cbor_decoder_t* decoder, void* ptr) {
+  uintptr_t address = (uintptr_t)ptr;
+  for (struct _cbor_decoder_slab* slab = decoder->slabs; slab != NULL;
+       slab = slab->next) {
+    uintptr_t begin = (uintptr_t)_cbor_decoder_payload(slab);
+    if (address >= begin &&
+        address < begin + slab->count * _CBOR_DECODER_BLOCK_SIZE) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void _cbor_decoder_recycle(cbor_decoder_t* decoder, void* block) {
+  memcpy(block, &decoder->free_blocks, sizeof(void*));
+  decoder->free_blocks = block;
+}
+
+static bool _cbor_decoder_add_slab(cbor_decoder_t* decoder) {
+  size_t count = decoder->slabs == NULL
+                     ? _CBOR_DECODER_INITIAL_SLAB
+                     : CBOR_BUFFER_GROWTH * decoder->slabs->count;
+  if (count > _CBOR_DECODER_MAX_SLAB) count = _CBOR_DECODER_MAX_SLAB;
+  struct _cbor_decoder_slab* slab = _cbor_malloc(
+      _CBOR_DECODER_HEADER_SIZE + count * _CBOR_DECODER_BLOCK_SIZE);
+  if (slab == NULL) return false;
+  *slab = (struct _cbor_decoder_slab){.next = decoder->slabs, .count = count};
+  decoder->slabs = slab;
+  // Push the blocks in reverse so that they are handed out in address order
+  for (size_t i = count; i > 0; i--) {
+    _cbor_decoder_recycle(decoder, _cbor_decoder_payload(slab) +
+                                       (i - 1) * _CBOR_DECODER_BLOCK_SIZE);
+  }
+  return true;
+}
+
+static void* _cbor_decoder_allocate(void* context, size_t size) {
+  cbor_decoder_t* decoder = context;
+  if (size > _CBOR_DECODER_BLOCK_SIZE) return _cbor_malloc(size);
+  if (decoder->free_blocks == NULL && !_cbor_decoder_add_slab(decoder)) {
+    return NULL;
+  }
+  void* block = decoder->free_blocks;
+  memcpy(&decoder->free_blocks, block, sizeof(void*));
+  return block;
+}
+
+static void* _cbor_decoder_reallocate(void* context, void* ptr,
+                                      size_t old_size, size_t new_size) {
+  cbor_decoder_t* decoder = context;
+  if (ptr == NULL) return _cbor_decoder_allocate(context, new_size);
+  if (!_cbor_decoder_owns(decoder, ptr)) return _cbor_realloc(ptr, new_size);
+  if (new_size <= _CBOR_DECODER_BLOCK_SIZE) return ptr;
+  void* moved = _cbor_malloc(new_size);
+  if (moved == NULL) return NULL;
+  memcpy(moved, ptr, old_size);
+  _cbor_decoder_recycle(decoder, ptr);
+  return moved;
+}
+
+static void _cbor_decoder_deallocate(void* context, void* ptr) {
+  cbor_decoder_t* decoder = context;
+  if (ptr != NULL && _cbor_decoder_owns(decoder, ptr)) {
+    _cbor_decoder_recycle(decoder, ptr);
+  } else {
+    _cbor_free(ptr);
+  }
+}
+
+void cbor_decoder_init(cbor_decoder_t* decoder, bool recycle_items) {
+  *decoder = (cbor_decoder_t){
+      .stack = NULL,
+      .stack_capacity = 0,
+      .slabs = NULL,
+      .free_blocks = NULL,
+      .allocator = {.allocate = _cbor_decoder_allocate,
+                    .reallocate = _cbor_decoder_reallocate,
+                    .deallocate = _cbor_decoder_deallocate,
+                    .context = decoder},
+      .recycle_items = recycle_items};
+}
+
+void cbor_decoder_release(cbor_decoder_t* decoder) {
+  _cbor_free(decoder->stack);
+  struct _cbor_decoder_slab* slab = decoder->slabs;
+  while (slab != NULL) {
+    struct _cbor_decoder_slab* next = slab->next;
+    _cbor_free(slab);
+    slab = next;
+  }
+  cbor_decoder_init(decoder, decoder->recycle_items);
+}
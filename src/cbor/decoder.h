@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#ifndef LIBCBOR_DECODER_H
+#define LIBCBOR_DECODER_H
+
+#include "cbor/cbor_export.h"
+#include "cbor/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * ============================================================================
+ * Reusable decoder
+ * ============================================================================
+ */
+
+struct _cbor_stack_record;
+struct _cbor_decoder_slab;
+
+/** State kept between #cbor_decoder_load calls
+ *
+ * Decoding many small messages with #cbor_load spends a noticeable share of
+ * the time setting up and tearing down the parser. A decoder keeps the parser
+ * stack between loads and can optionally recycle the memory of released
+ * items, so that a steady stream of similar messages is decoded with few or
+ * no calls to the global allocator.
+ *
+ * A decoder is not thread-safe. It is meant to be created once per thread and
+ * used for all the messages decoded by that thread. All members are private.
+ */
+typedef struct cbor_decoder {
+  /** Parser stack storage, `stack_capacity` records */
+  struct _cbor_stack_record* stack;
+  size_t stack_capacity;
+  /** Blocks for recycled items, newest first */
+  struct _cbor_decoder_slab* slabs;
+  /** Released blocks, linked through their first bytes */
+  void* free_blocks;
+  /** Allocator routines handed out to the items when recycling */
+  struct cbor_allocator allocator;
+  bool recycle_items;
+} cbor_decoder_t;
+
+/** Initialize a decoder
+ *
+ * No memory is allocated until the first load.
+ *
+ * When \p recycle_items is set, items decoded by #cbor_decoder_load (and any
+ * small buffers they own) are allocated from slabs owned by the decoder.
+ * Releasing them with #cbor_decref puts the memory on a free-list for the
+ * next load instead of returning it to the global allocator. Such items must
+ * be released on the thread that owns the decoder, and before the decoder is
+ * released.
+ *
+ * @param decoder The decoder to initialize
+ * @param recycle_items Whether to recycle the memory of released items
+ */
+CBOR_EXPORT void cbor_decoder_init(cbor_decoder_t* decoder,
+                                   bool recycle_items);
+
+/** Release the memory held by a decoder
+ *
+ * If the decoder recycles items, all items it has decoded must have been
+ * released already. The decoder can be reused afterwards as if it was freshly
+ * initialized.
+ *
+ * @param decoder An initialized decoder
+ */
+CBOR_EXPORT void cbor_decoder_release(cbor_decoder_t* decoder);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // LIBCBOR_DECODER_H
@@ -7,6 +7,7 @@
 
 #include "encoding.h"
 
+#include <float.h>
 #include <math.h>
 
 #include "internal/encoders.h"
@@ -214,6 +215,85 @@ size_t cbor_encode_double(double value, unsigned char* buffer,
       buffer_size, 0xE0);
 }
 
+// Store the half-precision encoding of `bits` in `half` if it represents the
+// value exactly. NaNs are handled by the callers.
+static bool _cbor_half_exact(uint32_t bits, uint16_t* half) {
+  uint16_t sign = (uint16_t)((bits >> 16u) & 0x8000u);
+  int exponent = (int)((bits >> 23u) & 0xFFu) - 127;
+  uint32_t mantissa = bits & 0x7FFFFFu;
+  if (exponent == 128) { /* Infinity */
+    *half = (uint16_t)(sign | 0x7C00u);
+    return mantissa == 0;
+  }
+  if (exponent == -127) { /* Zero, single-precision subnormals are too small */
+    *half = sign;
+    return mantissa == 0;
+  }
+  if (exponent >= -14 && exponent <= 15) { /* Normal numbers */
+    *half = (uint16_t)(sign | (uint16_t)((exponent + 15) << 10u) |
+                       (uint16_t)(mantissa >> 13u));
+    return (mantissa & 0x1FFFu) == 0;
+  }
+  if (exponent >= -24 && exponent < -14) { /* Half-precision subnormals */
+    uint32_t significand = mantissa | 0x800000u;
+    unsigned shift = (unsigned)(-1 - exponent);
+    *half = (uint16_t)(sign | (uint16_t)(significand >> shift));
+    return (significand & ((1u << shift) - 1u)) == 0;
+  }
+  return false;
+}
+
+static size_t _cbor_encode_preferred_single(float value, unsigned char* buffer,
+                                            size_t buffer_size) {
+  if (isnan(value)) {
+    return _cbor_encode_uint16(0x7E00, buffer, buffer_size, 0xE0);
+  }
+  uint32_t bits = ((union _cbor_float_helper){.as_float = value}).as_uint;
+  uint16_t half;
+  if (_cbor_half_exact(bits, &half)) {
+    return _cbor_encode_uint16(half, buffer, buffer_size, 0xE0);
+  }
+  return _cbor_encode_uint32(bits, buffer, buffer_size, 0xE0);
+}
+
+size_t cbor_encode_preferred_float(double value, unsigned char* buffer,
+                                   size_t buffer_size) {
+  // Converting a double outside of the range of float is undefined
+  if (isnan(value) || isinf(value) || fabs(value) <= FLT_MAX) {
+    float single = (float)value;
+    if (isnan(value) || (double)single == value) {
+      return _cbor_encode_preferred_single(single, buffer, buffer_size);
+    }
+  }
+  return cbor_encode_double(value, buffer, buffer_size);
+}
+
+size_t cbor_encode_preferred_floats(const float* values, size_t count,
+                                    unsigned char* buffer,
+                                    size_t buffer_size) {
+  size_t written = 0;
+  for (size_t i = 0; i < count; i++) {
+    size_t value_written = _cbor_encode_preferred_single(
+        values[i], buffer + written, buffer_size - written);
+    if (value_written == 0) return 0;
+    written += value_written;
+  }
+  return written;
+}
+
+size_t cbor_encode_preferred_doubles(const double* values, size_t count,
+                                     unsigned char* buffer,
+                                     size_t buffer_size) {
+  size_t written = 0;
+  for (size_t i = 0; i < count; i++) {
+    size_t value_written = cbor_encode_preferred_float(
+        values[i], buffer + written, buffer_size - written);
+    if (value_written == 0) return 0;
+    written += value_written;
+  }
+  return written;
+}
+
 size_t cbor_encode_break(unsigned char* buffer, size_t buffer_size) {
   return _cbor_encode_byte(0xFF, buffer, buffer_size);
 }
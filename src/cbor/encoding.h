@@ -133,6 +133,55 @@ _CBOR_NODISCARD CBOR_EXPORT size_t cbor_encode_single(float, unsigned char*,
 _CBOR_NODISCARD CBOR_EXPORT size_t cbor_encode_double(double, unsigned char*,
                                                       size_t);
 
+/** Encodes a float using the shortest precision that represents it exactly
+ *
+ * Picks the smallest of half, single, and double precision that decodes back
+ * to exactly \p value, as recommended by the preferred serialization of
+ * RFC 8949, section 4.1. Infinities and zeroes keep their sign and take three
+ * bytes. All NaNs are encoded as the half-precision quiet NaN (`0xF97E00`).
+ *
+ * @param value The value
+ * @param buffer Buffer to encode to
+ * @param buffer_size Size of the \p buffer
+ * @return Number of bytes written, 0 if the \p buffer_size doesn't fit the
+ * result
+ */
+_CBOR_NODISCARD CBOR_EXPORT size_t cbor_encode_preferred_float(double value,
+                                                               unsigned char*
+                                                                   buffer,
+                                                               size_t
+                                                                   buffer_size);
+
+/** Encodes consecutive floats using #cbor_encode_preferred_float
+ *
+ * The values are written one after another, e.g. after a header written by
+ * #cbor_encode_array_start. Checks whether each value fits half precision
+ * without converting it to a double first.
+ *
+ * @param values The values
+ * @param count Number of \p values
+ * @param buffer Buffer to encode to
+ * @param buffer_size Size of the \p buffer
+ * @return Number of bytes written, 0 if the \p buffer_size doesn't fit the
+ * result
+ */
+_CBOR_NODISCARD CBOR_EXPORT size_t
+cbor_encode_preferred_floats(const float* values, size_t count,
+                             unsigned char* buffer, size_t buffer_size);
+
+/** Encodes consecutive doubles using #cbor_encode_preferred_float
+ *
+ * @param values The values
+ * @param count Number of \p values
+ * @param buffer Buffer to encode to
+ * @param buffer_size Size of the \p buffer
+ * @return Number of bytes written, 0 if the \p buffer_size doesn't fit the
+ * result
+ */
+_CBOR_NODISCARD CBOR_EXPORT size_t
+cbor_encode_preferred_doubles(const double* values, size_t count,
+                              unsigned char* buffer, size_t buffer_size);
+
 _CBOR_NODISCARD CBOR_EXPORT size_t cbor_encode_break(unsigned char*, size_t);
 
 _CBOR_NODISCARD CBOR_EXPORT size_t cbor_encode_ctrl(uint8_t, unsigned char*,
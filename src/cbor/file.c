@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+// mmap and posix_madvise are not declared in the strict C modes otherwise
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "file.h"
+
+#include <errno.h>
+#include <stdio.h>
+
+#include "cbor.h"
+#include "internal/memory_utils.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/** Size of the first buffer when the file is read rather than mapped */
+#define _CBOR_FILE_INITIAL_BUFFER 4096
+
+// Read the whole file into an allocated buffer
+static cbor_error_code _cbor_file_read(cbor_file_t* file, const char* path) {
+  FILE* stream = fopen(path, "rb");
+  if (stream == NULL) return CBOR_ERR_FILE;
+  unsigned char* buffer = NULL;
+  size_t size = 0, capacity = 0;
+  cbor_error_code code = CBOR_ERR_NONE;
+  while (true) {
+    if (size == capacity) {
+      size_t new_capacity = capacity == 0 ? _CBOR_FILE_INITIAL_BUFFER
+                                          : CBOR_BUFFER_GROWTH * capacity;
+      unsigned char* new_buffer =
+          _cbor_safe_to_multiply(CBOR_BUFFER_GROWTH, capacity)
+              ? _cbor_realloc(buffer, new_capacity)
+              : NULL;
+      if (new_buffer == NULL) {
+        code = CBOR_ERR_MEMERROR;
+        break;
+      }
+      buffer = new_buffer;
+      capacity = new_capacity;
+    }
+    size_t read = fread(buffer + size, 1, capacity - size, stream);
+    if (read == 0) {
+      if (ferror(stream)) code = CBOR_ERR_FILE;
+      break;
+    }
+    size += read;
+  }
+  fclose(stream);
+  if (code != CBOR_ERR_NONE || size == 0) {
+    _cbor_free(buffer);
+    buffer = NULL;
+  }
+  *file = (cbor_file_t){.data = buffer,
+                        .size = code == CBOR_ERR_NONE ? size : 0,
+                        .mapped = false};
+  return code;
+}
+
+// Like cbor_file_open, but tells apart allocation failures
+static cbor_error_code _cbor_file_open(cbor_file_t* file, const char* path,
+                                       cbor_file_access access) {
+#ifndef _WIN32
+  int descriptor = open(path, O_RDONLY);
+  if (descriptor < 0) return CBOR_ERR_FILE;
+  struct stat info;
+  if (fstat(descriptor, &info) == 0 && S_ISREG(info.st_mode) &&
+      info.st_size > 0 && (uintmax_t)info.st_size <= SIZE_MAX) {
+    size_t size = (size_t)info.st_size;
+    void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if (data != MAP_FAILED) {
+      close(descriptor);
+      // Only a hint, failures do not matter
+      (void)posix_madvise(data, size,
+                          access == CBOR_FILE_SEQUENTIAL
+                              ? POSIX_MADV_SEQUENTIAL
+                              : POSIX_MADV_WILLNEED);
+      *file = (cbor_file_t){.data = data, .size = size, .mapped = true};
+      return CBOR_ERR_NONE;
+    }
+  }
+  close(descriptor);
+#else
+  (void)access;
+#endif
+  return _cbor_file_read(file, path);
+}
+
+bool cbor_file_open(cbor_file_t* file, const char* path,
+                    cbor_file_access access) {
+  cbor_error_code code = _cbor_file_open(file, path, access);
+  // Custom allocators need not set errno
+  if (code == CBOR_ERR_MEMERROR) errno = ENOMEM;
+  return code == CBOR_ERR_NONE;
+}
+
+void cbor_file_close(cbor_file_t* file) {
+#ifndef _WIN32
+  if (file->mapped) {
+    munmap((void*)file->data, file->size);
+  } else {
+    _cbor_free((void*)file->data);
+  }
+#else
+  _cbor_free((void*)file->data);
+#endif
+  *file = (cbor_file_t){.data = NULL, .size = 0, .mapped = false};
+}
+
+bool cbor_view_open_file(const char* path, cbor_file_t* file,
+                         cbor_view_t* view) {
+  if (!cbor_file_open(file, path, CBOR_FILE_RANDOM)) return false;
+  *view = cbor_view_init(file->data, file->size);
+  return true;
+}
+
+cbor_item_t* cbor_load_file(const char* path, cbor_file_access access,
+                            struct cbor_load_result* result) {
+  cbor_file_t file;
+  cbor_error_code code = _cbor_file_open(&file, path, access);
+  if (code != CBOR_ERR_NONE) {
+    *result = (struct cbor_load_result){.read = 0,
+                                        .error = {.code = code, .position = 0}};
+    return NULL;
+  }
+  cbor_item_t* item = cbor_load(file.data, file.size, result);
+  cbor_file_close(&file);
+  return item;
+}
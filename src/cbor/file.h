@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#ifndef LIBCBOR_FILE_H
+#define LIBCBOR_FILE_H
+
+#include "cbor/cbor_export.h"
+#include "cbor/common.h"
+#include "cbor/view.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * ============================================================================
+ * Memory-mapped files
+ * ============================================================================
+ */
+
+/** How the contents of a file are going to be accessed
+ *
+ * Passed to the operating system as a hint for paging the file in.
+ */
+typedef enum {
+  /** Read once from start to end, e.g. by #cbor_load */
+  CBOR_FILE_SEQUENTIAL,
+  /** Read in no particular order, e.g. through views */
+  CBOR_FILE_RANDOM
+} cbor_file_access;
+
+/** The contents of a file, mapped into memory where possible */
+typedef struct cbor_file {
+  /** The contents of the file, `NULL` if it is empty */
+  cbor_data data;
+  size_t size;
+  /** Whether #data is mapped rather than allocated. Private. */
+  bool mapped;
+} cbor_file_t;
+
+/** Map a file into memory
+ *
+ * Regular files are mapped read-only, so that no copy is made and only the
+ * pages that are accessed are read from the disk. The \p access mode is passed
+ * on as a `posix_madvise` hint. Where mapping is not available (e.g. on
+ * Windows, or for pipes), the file is read into a buffer allocated using the
+ * routines set by #cbor_set_allocs instead.
+ *
+ * The contents can be decoded with #cbor_load. To avoid copying the strings
+ * as well, decode them with #cbor_load_borrowed and keep the file open for
+ * as long as the item is used.
+ *
+ * @param[out] file The contents of the file
+ * @param path Path to the file
+ * @param access How the contents are going to be accessed
+ * @return Whether the file was opened. If not, `errno` describes the
+ * failure. It is `ENOMEM` if the buffer could not be allocated.
+ */
+_CBOR_NODISCARD CBOR_EXPORT bool cbor_file_open(cbor_file_t* file,
+                                                const char* path,
+                                                cbor_file_access access);
+
+/** Release the contents of a file opened by #cbor_file_open
+ *
+ * Any items loaded with #cbor_load_borrowed and views of the contents are
+ * invalidated.
+ *
+ * @param file An open file
+ */
+CBOR_EXPORT void cbor_file_close(cbor_file_t* file);
+
+/** Create a view of the first item in a file
+ *
+ * Opens the file using #cbor_file_open with #CBOR_FILE_RANDOM access. The
+ * view is valid until \p file is closed using #cbor_file_close.
+ *
+ * @param path Path to the file
+ * @param[out] file The contents of the file
+ * @param[out] view View of the first item
+ * @return Whether the file was opened. If not, `errno` describes the
+ * failure.
+ */
+_CBOR_NODISCARD CBOR_EXPORT bool cbor_view_open_file(const char* path,
+                                                     cbor_file_t* file,
+                                                     cbor_view_t* view);
+
+/** Loads a data item from a file
+ *
+ * Equivalent to calling #cbor_load on the contents of the file opened with
+ * #cbor_file_open, without reading the whole file into an intermediate
+ * buffer first. The file is closed before returning.
+ *
+ * @param path Path to the file
+ * @param access How the file is read. #CBOR_FILE_SEQUENTIAL suits most
+ * documents.
+ * @param[out] result Result indicator. #CBOR_ERR_NONE on success.
+ * #CBOR_ERR_FILE if the file could not be opened or read, in which case
+ * `errno` describes the failure. #CBOR_ERR_MEMERROR if the file has to be
+ * read and the buffer could not be allocated.
+ * @return Decoded CBOR item. The item's reference count is initialized to one.
+ * @return `NULL` on failure. In that case, \p result contains the location and
+ * description of the error.
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_load_file(
+    const char* path, cbor_file_access access,
+    struct cbor_load_result* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // LIBCBOR_FILE_H
@@ -8,6 +8,21 @@
 #include "floats_ctrls.h"
 #include <math.h>
 #include "assert.h"
+#include "internal/memory_utils.h"
+
+#define _CBOR_SIMPLE_VALUE(value)                               \
+  {                                                             \
+    .metadata = {.float_ctrl_metadata = {.width = CBOR_FLOAT_0, \
+                                         .ctrl = value}},       \
+    .refcount = SIZE_MAX, .type = CBOR_TYPE_FLOAT_CTRL,         \
+    .flags = _CBOR_ITEM_IMMORTAL,                               \
+  }
+
+/* false, true, null, and undefined, shared between all their uses (see
+ * _CBOR_ITEM_IMMORTAL) */
+static const cbor_item_t _cbor_simple_values[] = {
+    _CBOR_SIMPLE_VALUE(CBOR_CTRL_FALSE), _CBOR_SIMPLE_VALUE(CBOR_CTRL_TRUE),
+    _CBOR_SIMPLE_VALUE(CBOR_CTRL_NULL), _CBOR_SIMPLE_VALUE(CBOR_CTRL_UNDEF)};
 
 cbor_float_width cbor_float_get_width(const cbor_item_t* item) {
   CBOR_ASSERT(cbor_isa_float_ctrl(item));
@@ -87,18 +102,20 @@ void cbor_set_float8(cbor_item_t* item, double value) {
 
 void cbor_set_ctrl(cbor_item_t* item, uint8_t value) {
   CBOR_ASSERT(cbor_isa_float_ctrl(item));
+  CBOR_ASSERT(!(item->flags & _CBOR_ITEM_IMMORTAL));
   CBOR_ASSERT(cbor_float_get_width(item) == CBOR_FLOAT_0);
   item->metadata.float_ctrl_metadata.ctrl = value;
 }
 
 void cbor_set_bool(cbor_item_t* item, bool value) {
   CBOR_ASSERT(cbor_is_bool(item));
+  CBOR_ASSERT(!(item->flags & _CBOR_ITEM_IMMORTAL));
   item->metadata.float_ctrl_metadata.ctrl =
       value ? CBOR_CTRL_TRUE : CBOR_CTRL_FALSE;
 }
 
-cbor_item_t* cbor_new_ctrl(void) {
-  cbor_item_t* item = _cbor_malloc(sizeof(cbor_item_t));
+cbor_item_t* cbor_new_ctrl_with(const struct cbor_allocator* allocator) {
+  cbor_item_t* item = _cbor_alloc_with(allocator, sizeof(cbor_item_t));
   _CBOR_NOTNULL(item);
 
   *item = (cbor_item_t){
@@ -106,88 +123,134 @@ cbor_item_t* cbor_new_ctrl(void) {
       .data = NULL,
       .refcount = 1,
       .metadata = {.float_ctrl_metadata = {.width = CBOR_FLOAT_0,
-                                           .ctrl = CBOR_CTRL_NONE}}};
+                                           .ctrl = CBOR_CTRL_NONE}},
+      .allocator = allocator};
   return item;
 }
 
-cbor_item_t* cbor_new_float2(void) {
-  cbor_item_t* item = _cbor_malloc(sizeof(cbor_item_t) + 4);
+cbor_item_t* cbor_new_ctrl(void) { return cbor_new_ctrl_with(NULL); }
+
+cbor_item_t* cbor_new_float2_with(const struct cbor_allocator* allocator) {
+  cbor_item_t* item = _cbor_alloc_with(allocator, sizeof(cbor_item_t) + 4);
   _CBOR_NOTNULL(item);
 
   *item = (cbor_item_t){
       .type = CBOR_TYPE_FLOAT_CTRL,
       .data = (unsigned char*)item + sizeof(cbor_item_t),
       .refcount = 1,
-      .metadata = {.float_ctrl_metadata = {.width = CBOR_FLOAT_16}}};
+      .metadata = {.float_ctrl_metadata = {.width = CBOR_FLOAT_16}},
+      .allocator = allocator};
   return item;
 }
 
-cbor_item_t* cbor_new_float4(void) {
-  cbor_item_t* item = _cbor_malloc(sizeof(cbor_item_t) + 4);
+cbor_item_t* cbor_new_float2(void) { return cbor_new_float2_with(NULL); }
+
+cbor_item_t* cbor_new_float4_with(const struct cbor_allocator* allocator) {
+  cbor_item_t* item = _cbor_alloc_with(allocator, sizeof(cbor_item_t) + 4);
   _CBOR_NOTNULL(item);
 
   *item = (cbor_item_t){
       .type = CBOR_TYPE_FLOAT_CTRL,
       .data = (unsigned char*)item + sizeof(cbor_item_t),
       .refcount = 1,
-      .metadata = {.float_ctrl_metadata = {.width = CBOR_FLOAT_32}}};
+      .metadata = {.float_ctrl_metadata = {.width = CBOR_FLOAT_32}},
+      .allocator = allocator};
   return item;
 }
 
-cbor_item_t* cbor_new_float8(void) {
-  cbor_item_t* item = _cbor_malloc(sizeof(cbor_item_t) + 8);
+cbor_item_t* cbor_new_float4(void) { return cbor_new_float4_with(NULL); }
+
+cbor_item_t* cbor_new_float8_with(const struct cbor_allocator* allocator) {
+  cbor_item_t* item = _cbor_alloc_with(allocator, sizeof(cbor_item_t) + 8);
   _CBOR_NOTNULL(item);
 
   *item = (cbor_item_t){
       .type = CBOR_TYPE_FLOAT_CTRL,
       .data = (unsigned char*)item + sizeof(cbor_item_t),
       .refcount = 1,
-      .metadata = {.float_ctrl_metadata = {.width = CBOR_FLOAT_64}}};
+      .metadata = {.float_ctrl_metadata = {.width = CBOR_FLOAT_64}},
+      .allocator = allocator};
   return item;
 }
 
-cbor_item_t* cbor_new_null(void) {
-  cbor_item_t* item = cbor_new_ctrl();
+cbor_item_t* cbor_new_float8(void) { return cbor_new_float8_with(NULL); }
+
+cbor_item_t* cbor_new_null_with(const struct cbor_allocator* allocator) {
+  cbor_item_t* item = cbor_new_ctrl_with(allocator);
   _CBOR_NOTNULL(item);
   cbor_set_ctrl(item, CBOR_CTRL_NULL);
   return item;
 }
 
-cbor_item_t* cbor_new_undef(void) {
-  cbor_item_t* item = cbor_new_ctrl();
+cbor_item_t* cbor_new_null(void) { return cbor_new_null_with(NULL); }
+
+cbor_item_t* cbor_new_undef_with(const struct cbor_allocator* allocator) {
+  cbor_item_t* item = cbor_new_ctrl_with(allocator);
   _CBOR_NOTNULL(item);
   cbor_set_ctrl(item, CBOR_CTRL_UNDEF);
   return item;
 }
 
+cbor_item_t* cbor_new_undef(void) { return cbor_new_undef_with(NULL); }
+
+cbor_item_t* cbor_build_bool_with(const struct cbor_allocator* allocator,
+                                  bool value) {
+  return cbor_build_ctrl_with(allocator,
+                              value ? CBOR_CTRL_TRUE : CBOR_CTRL_FALSE);
+}
+
 cbor_item_t* cbor_build_bool(bool value) {
-  return cbor_build_ctrl(value ? CBOR_CTRL_TRUE : CBOR_CTRL_FALSE);
+  return cbor_build_bool_with(NULL, value);
 }
 
-cbor_item_t* cbor_build_float2(float value) {
-  cbor_item_t* item = cbor_new_float2();
+cbor_item_t* cbor_build_float2_with(const struct cbor_allocator* allocator,
+                                    float value) {
+  cbor_item_t* item = cbor_new_float2_with(allocator);
   _CBOR_NOTNULL(item);
   cbor_set_float2(item, value);
   return item;
 }
 
-cbor_item_t* cbor_build_float4(float value) {
-  cbor_item_t* item = cbor_new_float4();
+cbor_item_t* cbor_build_float2(float value) {
+  return cbor_build_float2_with(NULL, value);
+}
+
+cbor_item_t* cbor_build_float4_with(const struct cbor_allocator* allocator,
+                                    float value) {
+  cbor_item_t* item = cbor_new_float4_with(allocator);
   _CBOR_NOTNULL(item);
   cbor_set_float4(item, value);
   return item;
 }
 
-cbor_item_t* cbor_build_float8(double value) {
-  cbor_item_t* item = cbor_new_float8();
+cbor_item_t* cbor_build_float4(float value) {
+  return cbor_build_float4_with(NULL, value);
+}
+
+cbor_item_t* cbor_build_float8_with(const struct cbor_allocator* allocator,
+                                    double value) {
+  cbor_item_t* item = cbor_new_float8_with(allocator);
   _CBOR_NOTNULL(item);
   cbor_set_float8(item, value);
   return item;
 }
 
-cbor_item_t* cbor_build_ctrl(uint8_t value) {
-  cbor_item_t* item = cbor_new_ctrl();
+cbor_item_t* cbor_build_float8(double value) {
+  return cbor_build_float8_with(NULL, value);
+}
+
+cbor_item_t* cbor_build_ctrl_with(const struct cbor_allocator* allocator,
+                                  uint8_t value) {
+  if (value >= CBOR_CTRL_FALSE && value <= CBOR_CTRL_UNDEF) {
+    // Never written to, see _CBOR_ITEM_IMMORTAL
+    return (cbor_item_t*)&_cbor_simple_values[value - CBOR_CTRL_FALSE];
+  }
+  cbor_item_t* item = cbor_new_ctrl_with(allocator);
   _CBOR_NOTNULL(item);
   cbor_set_ctrl(item, value);
   return item;
 }
+
+cbor_item_t* cbor_build_ctrl(uint8_t value) {
+  return cbor_build_ctrl_with(NULL, value);
+}
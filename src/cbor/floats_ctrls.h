@@ -94,6 +94,17 @@ _CBOR_NODISCARD CBOR_EXPORT bool cbor_get_bool(const cbor_item_t* item);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_ctrl(void);
 
+/** Like #cbor_new_ctrl, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @return Reference to the new ctrl item. The item's reference count is
+ * initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_ctrl_with(
+    const struct cbor_allocator* allocator);
+
 /** Constructs a new float item
  *
  * The width cannot be changed once the item is created
@@ -104,6 +115,17 @@ _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_ctrl(void);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_float2(void);
 
+/** Like #cbor_new_float2, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @return Reference to the new float item. The item's reference count is
+ * initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_float2_with(
+    const struct cbor_allocator* allocator);
+
 /** Constructs a new float item
  *
  * The width cannot be changed once the item is created
@@ -114,6 +136,17 @@ _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_float2(void);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_float4(void);
 
+/** Like #cbor_new_float4, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @return Reference to the new float item. The item's reference count is
+ * initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_float4_with(
+    const struct cbor_allocator* allocator);
+
 /** Constructs a new float item
  *
  * The width cannot be changed once the item is created
@@ -124,6 +157,17 @@ _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_float4(void);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_float8(void);
 
+/** Like #cbor_new_float8, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @return Reference to the new float item. The item's reference count is
+ * initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_float8_with(
+    const struct cbor_allocator* allocator);
+
 /** Constructs new null ctrl item
  *
  * @return Reference to the new null item. The item's reference count is
@@ -132,6 +176,17 @@ _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_float8(void);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_null(void);
 
+/** Like #cbor_new_null, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @return Reference to the new null item. The item's reference count is
+ * initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_null_with(
+    const struct cbor_allocator* allocator);
+
 /** Constructs new undef ctrl item
  *
  * @return Reference to the new undef item. The item's reference count is
@@ -140,15 +195,40 @@ _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_null(void);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_undef(void);
 
+/** Like #cbor_new_undef, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @return Reference to the new undef item. The item's reference count is
+ * initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_undef_with(
+    const struct cbor_allocator* allocator);
+
 /** Constructs new boolean ctrl item
+ *
+ * The result is a shared read-only item, see #cbor_build_ctrl.
  *
  * @param value The value to use
- * @return Reference to the new boolean item. The item's reference count is
- * initialized to one.
+ * @return Reference to the boolean item, possibly shared. The reference count
+ * of items that are not shared is initialized to one.
  * @return `NULL` if memory allocation fails
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_bool(bool value);
 
+/** Like #cbor_build_bool, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @param value The value to use
+ * @return Reference to the boolean item, possibly shared. The reference count
+ * of items that are not shared is initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_bool_with(
+    const struct cbor_allocator* allocator, bool value);
+
 /** Assign a control value
  *
  * \rst
@@ -207,6 +287,18 @@ _CBOR_NODISCARD CBOR_EXPORT uint8_t cbor_ctrl_value(const cbor_item_t* item);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_float2(float value);
 
+/** Like #cbor_build_float2, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @param value the value to use
+ * @return Reference to the new float item. The item's reference count is
+ * initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_float2_with(
+    const struct cbor_allocator* allocator, float value);
+
 /** Constructs a new float
  *
  * @param value the value to use
@@ -216,6 +308,18 @@ _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_float2(float value);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_float4(float value);
 
+/** Like #cbor_build_float4, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @param value the value to use
+ * @return Reference to the new float item. The item's reference count is
+ * initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_float4_with(
+    const struct cbor_allocator* allocator, float value);
+
 /** Constructs a new float
  *
  * @param value the value to use
@@ -225,15 +329,43 @@ _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_float4(float value);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_float8(double value);
 
-/** Constructs a ctrl item
+/** Like #cbor_build_float8, but allocates from \p allocator
  *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
  * @param value the value to use
- * @return Reference to the new ctrl item. The item's reference count is
+ * @return Reference to the new float item. The item's reference count is
  * initialized to one.
  * @return `NULL` if memory allocation fails
  */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_float8_with(
+    const struct cbor_allocator* allocator, double value);
+
+/** Constructs a ctrl item
+ *
+ * `false`, `true`, `null`, and `undefined` are not allocated. All their uses
+ * share a single read-only item whose reference count is not tracked. Use
+ * #cbor_new_ctrl and #cbor_set_ctrl to obtain an item that can be modified.
+ *
+ * @param value the value to use
+ * @return Reference to the ctrl item, possibly shared. The reference count
+ * of items that are not shared is initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_ctrl(uint8_t value);
 
+/** Like #cbor_build_ctrl, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @param value the value to use
+ * @return Reference to the ctrl item, possibly shared. The reference count
+ * of items that are not shared is initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_ctrl_with(
+    const struct cbor_allocator* allocator, uint8_t value);
+
 #ifdef __cplusplus
 }
 #endif
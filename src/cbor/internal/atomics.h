@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#ifndef LIBCBOR_ATOMICS_H
+#define LIBCBOR_ATOMICS_H
+
+#include <stddef.h>
+
+#include "cbor/configuration.h"
+
+/*
+ * Counters that may be updated by several threads when CBOR_ATOMIC_REFCOUNT
+ * is enabled: the reference counts and lazily computed metadata of items.
+ * Otherwise these are plain loads and stores.
+ *
+ * The increment is relaxed, as a new reference can only be created from an
+ * existing one. The decrement is acquire-release, so that the thread that
+ * drops the last reference sees all the writes made through the others before
+ * freeing the item (the C11 memory model, implemented by the GCC and Clang
+ * __atomic builtins or the MSVC interlocked intrinsics).
+ */
+
+#if CBOR_ATOMIC_REFCOUNT && defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+static inline void _cbor_atomic_increment(size_t* value) {
+#if !CBOR_ATOMIC_REFCOUNT
+  (*value)++;
+#elif defined(_MSC_VER) && !defined(__clang__) && defined(_WIN64)
+  _InterlockedIncrement64((volatile __int64*)value);
+#elif defined(_MSC_VER) && !defined(__clang__)
+  _InterlockedIncrement((volatile long*)value);
+#else
+  __atomic_add_fetch(value, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+/** @return The value after the decrement */
+static inline size_t _cbor_atomic_decrement(size_t* value) {
+#if !CBOR_ATOMIC_REFCOUNT
+  return --(*value);
+#elif defined(_MSC_VER) && !defined(__clang__) && defined(_WIN64)
+  return (size_t)_InterlockedDecrement64((volatile __int64*)value);
+#elif defined(_MSC_VER) && !defined(__clang__)
+  return (size_t)_InterlockedDecrement((volatile long*)value);
+#else
+  return __atomic_sub_fetch(value, 1, __ATOMIC_ACQ_REL);
+#endif
+}
+
+/* Cached values are recomputed identically by every thread, so relaxed
+ * ordering is enough, the accesses just must not tear */
+
+static inline size_t _cbor_atomic_load(const size_t* value) {
+#if !CBOR_ATOMIC_REFCOUNT
+  return *value;
+#elif defined(_MSC_VER) && !defined(__clang__)
+  // Aligned word-sized accesses are atomic on all MSVC targets
+  return *(const volatile size_t*)value;
+#else
+  return __atomic_load_n(value, __ATOMIC_RELAXED);
+#endif
+}
+
+static inline void _cbor_atomic_store(size_t* value, size_t new_value) {
+#if !CBOR_ATOMIC_REFCOUNT
+  *value = new_value;
+#elif defined(_MSC_VER) && !defined(__clang__)
+  *(volatile size_t*)value = new_value;
+#else
+  __atomic_store_n(value, new_value, __ATOMIC_RELAXED);
+#endif
+}
+
+#endif  // LIBCBOR_ATOMICS_H
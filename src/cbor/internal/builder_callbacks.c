@@ -17,6 +17,7 @@
 #include "../maps.h"
 #include "../strings.h"
 #include "../tags.h"
+#include "memory_utils.h"
 #include "unicode.h"
 
 // `_cbor_builder_append` takes ownership of `item`. If adding the item to
@@ -143,16 +144,14 @@ void _cbor_builder_append(cbor_item_t* item,
 
 void cbor_builder_uint8_callback(void* context, uint8_t value) {
   struct _cbor_decoder_context* ctx = context;
-  cbor_item_t* res = cbor_new_int8();
+  cbor_item_t* res = cbor_build_uint8_with(ctx->allocator, value);
   CHECK_RES(ctx, res);
-  cbor_mark_uint(res);
-  cbor_set_uint8(res, value);
   _cbor_builder_append(res, ctx);
 }
 
 void cbor_builder_uint16_callback(void* context, uint16_t value) {
   struct _cbor_decoder_context* ctx = context;
-  cbor_item_t* res = cbor_new_int16();
+  cbor_item_t* res = cbor_new_int16_with(ctx->allocator);
   CHECK_RES(ctx, res);
   cbor_mark_uint(res);
   cbor_set_uint16(res, value);
@@ -161,7 +160,7 @@ void cbor_builder_uint16_callback(void* context, uint16_t value) {
 
 void cbor_builder_uint32_callback(void* context, uint32_t value) {
   struct _cbor_decoder_context* ctx = context;
-  cbor_item_t* res = cbor_new_int32();
+  cbor_item_t* res = cbor_new_int32_with(ctx->allocator);
   CHECK_RES(ctx, res);
   cbor_mark_uint(res);
   cbor_set_uint32(res, value);
@@ -170,7 +169,7 @@ void cbor_builder_uint32_callback(void* context, uint32_t value) {
 
 void cbor_builder_uint64_callback(void* context, uint64_t value) {
   struct _cbor_decoder_context* ctx = context;
-  cbor_item_t* res = cbor_new_int64();
+  cbor_item_t* res = cbor_new_int64_with(ctx->allocator);
   CHECK_RES(ctx, res);
   cbor_mark_uint(res);
   cbor_set_uint64(res, value);
@@ -179,16 +178,14 @@ void cbor_builder_uint64_callback(void* context, uint64_t value) {
 
 void cbor_builder_negint8_callback(void* context, uint8_t value) {
   struct _cbor_decoder_context* ctx = context;
-  cbor_item_t* res = cbor_new_int8();
+  cbor_item_t* res = cbor_build_negint8_with(ctx->allocator, value);
   CHECK_RES(ctx, res);
-  cbor_mark_negint(res);
-  cbor_set_uint8(res, value);
   _cbor_builder_append(res, ctx);
 }
 
 void cbor_builder_negint16_callback(void* context, uint16_t value) {
   struct _cbor_decoder_context* ctx = context;
-  cbor_item_t* res = cbor_new_int16();
+  cbor_item_t* res = cbor_new_int16_with(ctx->allocator);
   CHECK_RES(ctx, res);
   cbor_mark_negint(res);
   cbor_set_uint16(res, value);
@@ -197,7 +194,7 @@ void cbor_builder_negint16_callback(void* context, uint16_t value) {
 
 void cbor_builder_negint32_callback(void* context, uint32_t value) {
   struct _cbor_decoder_context* ctx = context;
-  cbor_item_t* res = cbor_new_int32();
+  cbor_item_t* res = cbor_new_int32_with(ctx->allocator);
   CHECK_RES(ctx, res);
   cbor_mark_negint(res);
   cbor_set_uint32(res, value);
@@ -206,33 +203,47 @@ void cbor_builder_negint32_callback(void* context, uint32_t value) {
 
 void cbor_builder_negint64_callback(void* context, uint64_t value) {
   struct _cbor_decoder_context* ctx = context;
-  cbor_item_t* res = cbor_new_int64();
+  cbor_item_t* res = cbor_new_int64_with(ctx->allocator);
   CHECK_RES(ctx, res);
   cbor_mark_negint(res);
   cbor_set_uint64(res, value);
   _cbor_builder_append(res, ctx);
 }
 
+// Either a copy of the string data, or the data itself when borrowing.
+static unsigned char* _cbor_builder_string_data(
+    struct _cbor_decoder_context* ctx, cbor_data data, size_t length) {
+  if (ctx->borrow_strings) return (unsigned char*)data;
+  unsigned char* handle = _cbor_alloc_with(ctx->allocator, length);
+  if (handle != NULL) memcpy(handle, data, length);
+  return handle;
+}
+
+static void _cbor_builder_release_string_data(
+    struct _cbor_decoder_context* ctx, unsigned char* handle) {
+  if (!ctx->borrow_strings) _cbor_free_with(ctx->allocator, handle);
+}
+
 void cbor_builder_byte_string_callback(void* context, cbor_data data,
                                        uint64_t length) {
   struct _cbor_decoder_context* ctx = context;
   CHECK_LENGTH(ctx, length);
-  unsigned char* new_handle = _cbor_malloc(length);
+  unsigned char* new_handle = _cbor_builder_string_data(ctx, data, length);
   if (new_handle == NULL) {
     ctx->creation_failed = true;
     return;
   }
 
-  memcpy(new_handle, data, length);
-  cbor_item_t* new_chunk = cbor_new_definite_bytestring();
+  cbor_item_t* new_chunk = cbor_new_definite_bytestring_with(ctx->allocator);
 
   if (new_chunk == NULL) {
-    _cbor_free(new_handle);
+    _cbor_builder_release_string_data(ctx, new_handle);
     ctx->creation_failed = true;
     return;
   }
 
   cbor_bytestring_set_handle(new_chunk, new_handle, length);
+  if (ctx->borrow_strings) new_chunk->flags |= _CBOR_ITEM_BORROWED;
 
   // If an indef bytestring is on the stack, extend it (if it were closed, it
   // would have been popped). Handle any syntax errors upstream.
@@ -249,7 +260,7 @@ void cbor_builder_byte_string_callback(void* context, cbor_data data,
 
 void cbor_builder_byte_string_start_callback(void* context) {
   struct _cbor_decoder_context* ctx = context;
-  cbor_item_t* res = cbor_new_indefinite_bytestring();
+  cbor_item_t* res = cbor_new_indefinite_bytestring_with(ctx->allocator);
   CHECK_RES(ctx, res);
   PUSH_CTX_STACK(ctx, res, 0);
 }
@@ -259,20 +270,25 @@ void cbor_builder_string_callback(void* context, cbor_data data,
   struct _cbor_decoder_context* ctx = context;
   CHECK_LENGTH(ctx, length);
 
-  unsigned char* new_handle = _cbor_malloc(length);
+  unsigned char* new_handle = _cbor_builder_string_data(ctx, data, length);
   if (new_handle == NULL) {
     ctx->creation_failed = true;
     return;
   }
 
-  memcpy(new_handle, data, length);
-  cbor_item_t* new_chunk = cbor_new_definite_string();
+  cbor_item_t* new_chunk = cbor_new_definite_string_with(ctx->allocator);
   if (new_chunk == NULL) {
-    _cbor_free(new_handle);
+    _cbor_builder_release_string_data(ctx, new_handle);
     ctx->creation_failed = true;
     return;
   }
   cbor_string_set_handle(new_chunk, new_handle, length);
+  if (ctx->borrow_strings) new_chunk->flags |= _CBOR_ITEM_BORROWED;
+  if (ctx->validate_strings && !_cbor_string_validate(new_chunk)) {
+    ctx->invalid_string = true;
+    cbor_decref(&new_chunk);
+    return;
+  }
 
   // If an indef string is on the stack, extend it (if it were closed, it would
   // have been popped). Handle any syntax errors upstream.
@@ -289,7 +305,7 @@ void cbor_builder_string_callback(void* context, cbor_data data,
 
 void cbor_builder_string_start_callback(void* context) {
   struct _cbor_decoder_context* ctx = context;
-  cbor_item_t* res = cbor_new_indefinite_string();
+  cbor_item_t* res = cbor_new_indefinite_string_with(ctx->allocator);
   CHECK_RES(ctx, res);
   PUSH_CTX_STACK(ctx, res, 0);
 }
@@ -297,7 +313,7 @@ void cbor_builder_string_start_callback(void* context) {
 void cbor_builder_array_start_callback(void* context, uint64_t size) {
   struct _cbor_decoder_context* ctx = context;
   CHECK_LENGTH(ctx, size);
-  cbor_item_t* res = cbor_new_definite_array(size);
+  cbor_item_t* res = cbor_new_definite_array_with(ctx->allocator, size);
   CHECK_RES(ctx, res);
   if (size > 0) {
     PUSH_CTX_STACK(ctx, res, size);
@@ -308,14 +324,14 @@ void cbor_builder_array_start_callback(void* context, uint64_t size) {
 
 void cbor_builder_indef_array_start_callback(void* context) {
   struct _cbor_decoder_context* ctx = context;
-  cbor_item_t* res = cbor_new_indefinite_array();
+  cbor_item_t* res = cbor_new_indefinite_array_with(ctx->allocator);
   CHECK_RES(ctx, res);
   PUSH_CTX_STACK(ctx, res, 0);
 }
 
 void cbor_builder_indef_map_start_callback(void* context) {
   struct _cbor_decoder_context* ctx = context;
-  cbor_item_t* res = cbor_new_indefinite_map();
+  cbor_item_t* res = cbor_new_indefinite_map_with(ctx->allocator);
   CHECK_RES(ctx, res);
   PUSH_CTX_STACK(ctx, res, 0);
 }
@@ -329,7 +345,7 @@ void cbor_builder_map_start_callback(void* context, uint64_t size) {
     ctx->creation_failed = true;
     return;
   }
-  cbor_item_t* res = cbor_new_definite_map(size);
+  cbor_item_t* res = cbor_new_definite_map_with(ctx->allocator, size);
   CHECK_RES(ctx, res);
   if (size > 0) {
     PUSH_CTX_STACK(ctx, res, size * 2);
@@ -379,7 +395,7 @@ void cbor_builder_indef_break_callback(void* context) {
 
 void cbor_builder_float2_callback(void* context, float value) {
   struct _cbor_decoder_context* ctx = context;
-  cbor_item_t* res = cbor_new_float2();
+  cbor_item_t* res = cbor_new_float2_with(ctx->allocator);
   CHECK_RES(ctx, res);
   cbor_set_float2(res, value);
   _cbor_builder_append(res, ctx);
@@ -387,7 +403,7 @@ void cbor_builder_float2_callback(void* context, float value) {
 
 void cbor_builder_float4_callback(void* context, float value) {
   struct _cbor_decoder_context* ctx = context;
-  cbor_item_t* res = cbor_new_float4();
+  cbor_item_t* res = cbor_new_float4_with(ctx->allocator);
   CHECK_RES(ctx, res);
   cbor_set_float4(res, value);
   _cbor_builder_append(res, ctx);
@@ -395,7 +411,7 @@ void cbor_builder_float4_callback(void* context, float value) {
 
 void cbor_builder_float8_callback(void* context, double value) {
   struct _cbor_decoder_context* ctx = context;
-  cbor_item_t* res = cbor_new_float8();
+  cbor_item_t* res = cbor_new_float8_with(ctx->allocator);
   CHECK_RES(ctx, res);
   cbor_set_float8(res, value);
   _cbor_builder_append(res, ctx);
@@ -403,28 +419,61 @@ void cbor_builder_float8_callback(void* context, double value) {
 
 void cbor_builder_null_callback(void* context) {
   struct _cbor_decoder_context* ctx = context;
-  cbor_item_t* res = cbor_new_null();
+  cbor_item_t* res = cbor_build_ctrl_with(ctx->allocator, CBOR_CTRL_NULL);
   CHECK_RES(ctx, res);
   _cbor_builder_append(res, ctx);
 }
 
 void cbor_builder_undefined_callback(void* context) {
   struct _cbor_decoder_context* ctx = context;
-  cbor_item_t* res = cbor_new_undef();
+  cbor_item_t* res = cbor_build_ctrl_with(ctx->allocator, CBOR_CTRL_UNDEF);
   CHECK_RES(ctx, res);
   _cbor_builder_append(res, ctx);
 }
 
 void cbor_builder_boolean_callback(void* context, bool value) {
   struct _cbor_decoder_context* ctx = context;
-  cbor_item_t* res = cbor_build_bool(value);
+  cbor_item_t* res = cbor_build_bool_with(ctx->allocator, value);
   CHECK_RES(ctx, res);
   _cbor_builder_append(res, ctx);
 }
 
 void cbor_builder_tag_callback(void* context, uint64_t value) {
   struct _cbor_decoder_context* ctx = context;
-  cbor_item_t* res = cbor_new_tag(value);
+  cbor_item_t* res = cbor_new_tag_with(ctx->allocator, value);
   CHECK_RES(ctx, res);
   PUSH_CTX_STACK(ctx, res, 1);
 }
+
+const struct cbor_callbacks _cbor_builder_callbacks = {
+    .uint8 = &cbor_builder_uint8_callback,
+    .uint16 = &cbor_builder_uint16_callback,
+    .uint32 = &cbor_builder_uint32_callback,
+    .uint64 = &cbor_builder_uint64_callback,
+
+    .negint8 = &cbor_builder_negint8_callback,
+    .negint16 = &cbor_builder_negint16_callback,
+    .negint32 = &cbor_builder_negint32_callback,
+    .negint64 = &cbor_builder_negint64_callback,
+
+    .byte_string = &cbor_builder_byte_string_callback,
+    .byte_string_start = &cbor_builder_byte_string_start_callback,
+
+    .string = &cbor_builder_string_callback,
+    .string_start = &cbor_builder_string_start_callback,
+
+    .array_start = &cbor_builder_array_start_callback,
+    .indef_array_start = &cbor_builder_indef_array_start_callback,
+
+    .map_start = &cbor_builder_map_start_callback,
+    .indef_map_start = &cbor_builder_indef_map_start_callback,
+
+    .tag = &cbor_builder_tag_callback,
+
+    .null = &cbor_builder_null_callback,
+    .undefined = &cbor_builder_undefined_callback,
+    .boolean = &cbor_builder_boolean_callback,
+    .float2 = &cbor_builder_float2_callback,
+    .float4 = &cbor_builder_float4_callback,
+    .float8 = &cbor_builder_float8_callback,
+    .indef_break = &cbor_builder_indef_break_callback};
@@ -24,6 +24,14 @@ struct _cbor_decoder_context {
   bool syntax_error;
   cbor_item_t* root;
   struct _cbor_stack* stack;
+  /** Where the decoded items are allocated, `NULL` for the global allocator */
+  const struct cbor_allocator* allocator;
+  /** Point definite strings into the source buffer instead of copying */
+  bool borrow_strings;
+  /** Reject text strings that are not valid UTF-8 */
+  bool validate_strings;
+  /** A text string was rejected by `validate_strings` */
+  bool invalid_string;
 };
 
 /** Internal helper: Append item to the top of the stack while handling errors.
@@ -78,6 +86,9 @@ void cbor_builder_boolean_callback(void*, bool);
 
 void cbor_builder_indef_break_callback(void*);
 
+/** Callbacks building the items into a `struct _cbor_decoder_context` */
+extern const struct cbor_callbacks _cbor_builder_callbacks;
+
 #ifdef __cplusplus
 }
 #endif
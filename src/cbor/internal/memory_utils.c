@@ -55,3 +55,44 @@ void* _cbor_realloc_multiple(void* pointer, size_t item_size,
     return NULL;
   }
 }
+
+void* _cbor_alloc_with(const struct cbor_allocator* allocator, size_t size) {
+  if (allocator == NULL) return _cbor_malloc(size);
+  return allocator->allocate(allocator->context, size);
+}
+
+void* _cbor_realloc_with(const struct cbor_allocator* allocator, void* pointer,
+                         size_t old_size, size_t new_size) {
+  if (allocator == NULL) return _cbor_realloc(pointer, new_size);
+  return allocator->reallocate(allocator->context, pointer, old_size,
+                               new_size);
+}
+
+void _cbor_free_with(const struct cbor_allocator* allocator, void* pointer) {
+  if (allocator == NULL) {
+    _cbor_free(pointer);
+  } else {
+    allocator->deallocate(allocator->context, pointer);
+  }
+}
+
+void* _cbor_alloc_multiple_with(const struct cbor_allocator* allocator,
+                                size_t item_size, size_t item_count) {
+  if (_cbor_safe_to_multiply(item_size, item_count)) {
+    return _cbor_alloc_with(allocator, item_size * item_count);
+  } else {
+    return NULL;
+  }
+}
+
+void* _cbor_realloc_multiple_with(const struct cbor_allocator* allocator,
+                                  void* pointer, size_t item_size,
+                                  size_t old_count, size_t new_count) {
+  if (_cbor_safe_to_multiply(item_size, new_count)) {
+    // old_count * item_size has been allocated before, so it cannot overflow
+    return _cbor_realloc_with(allocator, pointer, item_size * old_count,
+                              item_size * new_count);
+  } else {
+    return NULL;
+  }
+}
@@ -47,4 +47,31 @@ void* _cbor_alloc_multiple(size_t item_size, size_t item_count);
 void* _cbor_realloc_multiple(void* pointer, size_t item_size,
                              size_t item_count);
 
+/** Allocate \p size bytes using \p allocator, or the global `_cbor_malloc`
+ * if it is `NULL` */
+void* _cbor_alloc_with(const struct cbor_allocator* allocator, size_t size);
+
+/** Resize a block of \p old_size bytes obtained from #_cbor_alloc_with */
+void* _cbor_realloc_with(const struct cbor_allocator* allocator, void* pointer,
+                         size_t old_size, size_t new_size);
+
+/** Release a block obtained from #_cbor_alloc_with */
+void _cbor_free_with(const struct cbor_allocator* allocator, void* pointer);
+
+/** Overflow-proof contiguous array allocation from \p allocator
+ *
+ * See #_cbor_alloc_multiple
+ */
+void* _cbor_alloc_multiple_with(const struct cbor_allocator* allocator,
+                                size_t item_size, size_t item_count);
+
+/** Overflow-proof contiguous array reallocation within \p allocator
+ *
+ * See #_cbor_realloc_multiple. \p old_count is only used by allocators that
+ * need the old size (e.g. #cbor_arena).
+ */
+void* _cbor_realloc_multiple_with(const struct cbor_allocator* allocator,
+                                  void* pointer, size_t item_size,
+                                  size_t old_count, size_t new_count);
+
 #endif  // LIBCBOR_MEMORY_UTILS_H
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#ifndef LIBCBOR_SIMD_H
+#define LIBCBOR_SIMD_H
+
+#include <stddef.h>
+
+/*
+ * Vector instructions for the byte scanning fast paths. SSE2 and NEON are part
+ * of the x86-64 and AArch64 baselines. AVX2 code is compiled using the target
+ * attribute and only called if the CPU supports it, see _CBOR_SIMD_DISPATCH.
+ */
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#define _CBOR_SIMD_SSE2 1
+#if defined(__GNUC__) || defined(__clang__)
+#include <immintrin.h>
+#define _CBOR_SIMD_AVX2 1
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define _CBOR_SIMD_NEON 1
+#endif
+
+#ifdef _CBOR_SIMD_AVX2
+/** Define a scan `name(data, length)` that calls \p avx2 if the CPU supports
+ * AVX2 and \p fallback otherwise
+ *
+ * The choice is made on the first call and kept in a static function pointer.
+ * Threads that race to make it store the same function, so the accesses only
+ * need to be atomic.
+ */
+#define _CBOR_SIMD_DISPATCH(name, avx2, fallback)                        \
+  static size_t name(const unsigned char* data, size_t length) {         \
+    static size_t (*resolved)(const unsigned char*, size_t);             \
+    size_t (*function)(const unsigned char*, size_t) =                   \
+        __atomic_load_n(&resolved, __ATOMIC_RELAXED);                    \
+    if (function == NULL) {                                              \
+      __builtin_cpu_init();                                              \
+      function = __builtin_cpu_supports("avx2") ? avx2 : fallback;       \
+      __atomic_store_n(&resolved, function, __ATOMIC_RELAXED);           \
+    }                                                                    \
+    return function(data, length);                                       \
+  }
+#endif
+
+#endif  // LIBCBOR_SIMD_H
@@ -7,26 +7,56 @@
 
 #include "stack.h"
 
+#include "memory_utils.h"
+
+/** Number of records allocated for a new stack */
+#define _CBOR_STACK_INITIAL_CAPACITY 8
+
 struct _cbor_stack _cbor_stack_init(void) {
-  return (struct _cbor_stack){.top = NULL, .size = 0};
+  return (struct _cbor_stack){
+      .top = NULL, .size = 0, .records = NULL, .capacity = 0};
 }
 
 void _cbor_stack_pop(struct _cbor_stack* stack) {
-  struct _cbor_stack_record* top = stack->top;
-  stack->top = stack->top->lower;
-  _cbor_free(top);
   stack->size--;
+  stack->top = stack->size > 0 ? stack->top - 1 : NULL;
+}
+
+void _cbor_stack_release(struct _cbor_stack* stack) {
+  CBOR_ASSERT(stack->size == 0);
+  _cbor_free(stack->records);
+  *stack = _cbor_stack_init();
+}
+
+static bool _cbor_stack_grow(struct _cbor_stack* stack) {
+  size_t new_capacity = _CBOR_STACK_INITIAL_CAPACITY;
+  if (stack->capacity > 0) {
+    new_capacity = stack->capacity > CBOR_MAX_STACK_SIZE / CBOR_BUFFER_GROWTH
+                       ? CBOR_MAX_STACK_SIZE
+                       : CBOR_BUFFER_GROWTH * stack->capacity;
+  }
+  if (new_capacity > CBOR_MAX_STACK_SIZE) new_capacity = CBOR_MAX_STACK_SIZE;
+  struct _cbor_stack_record* records =
+      stack->records == NULL
+          ? _cbor_alloc_multiple(sizeof(struct _cbor_stack_record),
+                                 new_capacity)
+          : _cbor_realloc_multiple(stack->records,
+                                   sizeof(struct _cbor_stack_record),
+                                   new_capacity);
+  if (records == NULL) return false;
+  stack->records = records;
+  stack->capacity = new_capacity;
+  return true;
 }
 
 struct _cbor_stack_record* _cbor_stack_push(struct _cbor_stack* stack,
                                             cbor_item_t* item,
                                             size_t subitems) {
   if (stack->size == CBOR_MAX_STACK_SIZE) return NULL;
-  struct _cbor_stack_record* new_top =
-      _cbor_malloc(sizeof(struct _cbor_stack_record));
-  if (new_top == NULL) return NULL;
+  if (stack->size == stack->capacity && !_cbor_stack_grow(stack)) return NULL;
 
-  *new_top = (struct _cbor_stack_record){stack->top, item, subitems};
+  struct _cbor_stack_record* new_top = stack->records + stack->size;
+  *new_top = (struct _cbor_stack_record){item, subitems};
   stack->top = new_top;
   stack->size++;
   return new_top;
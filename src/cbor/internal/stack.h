@@ -16,8 +16,6 @@ extern "C" {
 
 /** Simple stack record for the parser */
 struct _cbor_stack_record {
-  /** Pointer to the parent stack frame */
-  struct _cbor_stack_record* lower;
   /** Item under construction */
   cbor_item_t* item;
   /**
@@ -31,10 +29,18 @@ struct _cbor_stack_record {
   size_t subitems;
 };
 
-/** Stack handle - contents and size */
+/** Stack handle - contents and size
+ *
+ * The records are stored in a single array that grows as needed and is kept
+ * when the stack is popped, so that a stack can be reused without allocating.
+ */
 struct _cbor_stack {
+  /** The topmost record, `NULL` if the stack is empty */
   struct _cbor_stack_record* top;
   size_t size;
+  /** Storage for `capacity` records, bottom first */
+  struct _cbor_stack_record* records;
+  size_t capacity;
 };
 
 _CBOR_NODISCARD
@@ -42,6 +48,9 @@ struct _cbor_stack _cbor_stack_init(void);
 
 void _cbor_stack_pop(struct _cbor_stack*);
 
+/** Release the storage of an empty stack */
+void _cbor_stack_release(struct _cbor_stack*);
+
 _CBOR_NODISCARD
 struct _cbor_stack_record* _cbor_stack_push(struct _cbor_stack*, cbor_item_t*,
                                             size_t);
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include "threads.h"
+
+#include "memory_utils.h"
+
+#if CBOR_PARALLEL
+
+#ifdef _WIN32
+#include <windows.h>
+
+typedef HANDLE _cbor_thread_t;
+typedef CRITICAL_SECTION _cbor_mutex_t;
+#define _cbor_mutex_init(mutex) InitializeCriticalSection(mutex)
+#define _cbor_mutex_lock(mutex) EnterCriticalSection(mutex)
+#define _cbor_mutex_unlock(mutex) LeaveCriticalSection(mutex)
+#define _cbor_mutex_destroy(mutex) DeleteCriticalSection(mutex)
+#else
+#include <pthread.h>
+#include <unistd.h>
+
+typedef pthread_t _cbor_thread_t;
+typedef pthread_mutex_t _cbor_mutex_t;
+#define _cbor_mutex_init(mutex) pthread_mutex_init(mutex, NULL)
+#define _cbor_mutex_lock(mutex) pthread_mutex_lock(mutex)
+#define _cbor_mutex_unlock(mutex) pthread_mutex_unlock(mutex)
+#define _cbor_mutex_destroy(mutex) pthread_mutex_destroy(mutex)
+#endif
+
+struct _cbor_parallel_job {
+  _cbor_task_t task;
+  void* context;
+  size_t task_count;
+  /** Index of the next task to hand out, guarded by `lock` */
+  size_t next;
+  _cbor_mutex_t lock;
+};
+
+static bool _cbor_job_take(struct _cbor_parallel_job* job, size_t* task) {
+  _cbor_mutex_lock(&job->lock);
+  bool taken = job->next < job->task_count;
+  if (taken) *task = job->next++;
+  _cbor_mutex_unlock(&job->lock);
+  return taken;
+}
+
+static void _cbor_job_run(struct _cbor_parallel_job* job) {
+  size_t task;
+  while (_cbor_job_take(job, &task)) job->task(job->context, task);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI _cbor_worker(LPVOID job) {
+  _cbor_job_run(job);
+  return 0;
+}
+
+static bool _cbor_thread_start(_cbor_thread_t* thread,
+                               struct _cbor_parallel_job* job) {
+  *thread = CreateThread(NULL, 0, _cbor_worker, job, 0, NULL);
+  return *thread != NULL;
+}
+
+static void _cbor_thread_join(_cbor_thread_t thread) {
+  WaitForSingleObject(thread, INFINITE);
+  CloseHandle(thread);
+}
+#else
+static void* _cbor_worker(void* job) {
+  _cbor_job_run(job);
+  return NULL;
+}
+
+static bool _cbor_thread_start(_cbor_thread_t* thread,
+                               struct _cbor_parallel_job* job) {
+  return pthread_create(thread, NULL, _cbor_worker, job) == 0;
+}
+
+static void _cbor_thread_join(_cbor_thread_t thread) {
+  pthread_join(thread, NULL);
+}
+#endif
+
+/* Run the job on the calling thread and up to `threads - 1` workers. Returns
+ * false without running anything if the workers cannot be set up. */
+static bool _cbor_job_run_parallel(struct _cbor_parallel_job* job,
+                                   size_t threads) {
+  _cbor_thread_t* workers =
+      _cbor_alloc_multiple(sizeof(_cbor_thread_t), threads - 1);
+  if (workers == NULL) return false;
+  _cbor_mutex_init(&job->lock);
+  size_t started = 0;
+  while (started < threads - 1 &&
+         _cbor_thread_start(&workers[started], job)) {
+    started++;
+  }
+  _cbor_job_run(job);
+  for (size_t i = 0; i < started; i++) _cbor_thread_join(workers[i]);
+  _cbor_mutex_destroy(&job->lock);
+  _cbor_free(workers);
+  return true;
+}
+
+#endif  // CBOR_PARALLEL
+
+size_t _cbor_thread_count(size_t threads) {
+  if (threads > 0) return threads;
+#if CBOR_PARALLEL && defined(_WIN32)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  if (info.dwNumberOfProcessors > 0) return info.dwNumberOfProcessors;
+#elif CBOR_PARALLEL && defined(_SC_NPROCESSORS_ONLN)
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (cpus > 0) return (size_t)cpus;
+#endif
+  return 1;
+}
+
+void _cbor_parallel_for(size_t threads, size_t task_count, _cbor_task_t task,
+                        void* context) {
+  threads = _cbor_thread_count(threads);
+  if (threads > task_count) threads = task_count;
+#if CBOR_PARALLEL
+  if (threads > 1) {
+    struct _cbor_parallel_job job = {
+        .task = task, .context = context, .task_count = task_count, .next = 0};
+    if (_cbor_job_run_parallel(&job, threads)) return;
+  }
+#endif
+  // Nothing to synchronize with
+  for (size_t i = 0; i < task_count; i++) task(context, i);
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#ifndef LIBCBOR_THREADS_H
+#define LIBCBOR_THREADS_H
+
+#include "cbor/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** A unit of work, called with the context and the index of the task */
+typedef void (*_cbor_task_t)(void* context, size_t task);
+
+/** Run \p task_count tasks on up to \p threads threads
+ *
+ * The calling thread takes part, so at most `threads - 1` threads are
+ * started. Tasks are handed out in order, one at a time, as the threads
+ * become free. If a thread cannot be started, the remaining threads do its
+ * share, so all tasks are always run. Returns once all tasks have finished.
+ *
+ * Without `CBOR_PARALLEL`, all tasks run on the calling thread.
+ *
+ * @param threads Maximum number of threads, 0 for one per online CPU
+ * @param task_count Number of tasks
+ * @param task The task routine
+ * @param context Passed to \p task
+ */
+void _cbor_parallel_for(size_t threads, size_t task_count, _cbor_task_t task,
+                        void* context);
+
+/** Resolve 0 to the number of online CPUs, at least 1 */
+_CBOR_NODISCARD
+size_t _cbor_thread_count(size_t threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // LIBCBOR_THREADS_H
@@ -7,6 +7,8 @@
 
 #include "unicode.h"
 #include <stdint.h>
+#include <string.h>
+#include "simd.h"
 
 #define UTF8_ACCEPT 0
 #define UTF8_REJECT 1
@@ -66,6 +68,79 @@ uint32_t _cbor_unicode_decode(uint32_t* state, uint32_t* codep, uint32_t byte) {
   return *state;
 }
 
+/*
+ * ASCII fast path. Each variant returns the length of a prefix of `source`
+ * consisting only of ASCII bytes. The prefix is a whole number of blocks and
+ * may be shorter than the actual run of ASCII bytes.
+ */
+
+#ifdef _CBOR_SIMD_SSE2
+static size_t _cbor_unicode_ascii_prefix_sse2(cbor_data source,
+                                              size_t length) {
+  size_t pos = 0;
+  for (; length - pos >= 16; pos += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i*)(source + pos));
+    if (_mm_movemask_epi8(block) != 0) break;
+  }
+  return pos;
+}
+#endif
+
+#ifdef _CBOR_SIMD_AVX2
+__attribute__((target("avx2"))) static size_t _cbor_unicode_ascii_prefix_avx2(
+    cbor_data source, size_t length) {
+  size_t pos = 0;
+  for (; length - pos >= 32; pos += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i*)(source + pos));
+    if (_mm256_movemask_epi8(block) != 0) break;
+  }
+  return pos + _cbor_unicode_ascii_prefix_sse2(source + pos, length - pos);
+}
+
+_CBOR_SIMD_DISPATCH(_cbor_unicode_ascii_prefix_x86,
+                    _cbor_unicode_ascii_prefix_avx2,
+                    _cbor_unicode_ascii_prefix_sse2)
+#endif
+
+#ifdef _CBOR_SIMD_NEON
+static size_t _cbor_unicode_ascii_prefix_neon(cbor_data source,
+                                              size_t length) {
+  size_t pos = 0;
+  for (; length - pos >= 16; pos += 16) {
+    if (vmaxvq_u8(vld1q_u8(source + pos)) >= 0x80) break;
+  }
+  return pos;
+}
+#endif
+
+static size_t _cbor_unicode_ascii_prefix_swar(cbor_data source,
+                                              size_t length) {
+  size_t pos = 0;
+  for (; length - pos >= 8; pos += 8) {
+    uint64_t block;
+    memcpy(&block, source + pos, 8);
+    if ((block & 0x8080808080808080ULL) != 0) break;
+  }
+  return pos;
+}
+
+static size_t _cbor_unicode_ascii_prefix(cbor_data source, size_t length) {
+#if defined(_CBOR_SIMD_AVX2)
+  size_t pos = _cbor_unicode_ascii_prefix_x86(source, length);
+#elif defined(_CBOR_SIMD_SSE2)
+  size_t pos = _cbor_unicode_ascii_prefix_sse2(source, length);
+#elif defined(_CBOR_SIMD_NEON)
+  size_t pos = _cbor_unicode_ascii_prefix_neon(source, length);
+#else
+  size_t pos = 0;
+#endif
+  /* Also covers the tail shorter than a vector */
+  return pos + _cbor_unicode_ascii_prefix_swar(source + pos, length - pos);
+}
+
+/* Bytes decoded by the DFA before trying the fast path again */
+#define _CBOR_UNICODE_SCALAR_RUN 16
+
 size_t _cbor_unicode_codepoint_count(cbor_data source, size_t source_length,
                                      struct _cbor_unicode_status* status) {
   *status =
@@ -73,13 +148,27 @@ size_t _cbor_unicode_codepoint_count(cbor_data source, size_t source_length,
   uint32_t codepoint, state = UTF8_ACCEPT, res;
   size_t pos = 0, count = 0;
 
-  for (; pos < source_length; pos++) {
-    res = _cbor_unicode_decode(&state, &codepoint, source[pos]);
+  while (pos < source_length) {
+    /* ASCII bytes outside of a multibyte sequence are accepted by the DFA
+     * one codepoint each, so skipping them keeps the result identical */
+    if (state == UTF8_ACCEPT) {
+      size_t ascii =
+          _cbor_unicode_ascii_prefix(source + pos, source_length - pos);
+      pos += ascii;
+      count += ascii;
+    }
+
+    size_t run_end = source_length - pos > _CBOR_UNICODE_SCALAR_RUN
+                         ? pos + _CBOR_UNICODE_SCALAR_RUN
+                         : source_length;
+    for (; pos < run_end; pos++) {
+      res = _cbor_unicode_decode(&state, &codepoint, source[pos]);
 
-    if (res == UTF8_ACCEPT) {
-      count++;
-    } else if (res == UTF8_REJECT) {
-      goto error;
+      if (res == UTF8_ACCEPT) {
+        count++;
+      } else if (res == UTF8_REJECT) {
+        goto error;
+      }
     }
   }
 
@@ -26,6 +26,10 @@ _CBOR_NODISCARD
 size_t _cbor_unicode_codepoint_count(cbor_data source, size_t source_length,
                                      struct _cbor_unicode_status* status);
 
+/** Check that a definite string is valid UTF-8 and cache its codepoint count
+ * (zero if it is not valid) */
+bool _cbor_string_validate(cbor_item_t* item);
+
 #ifdef __cplusplus
 }
 #endif
@@ -6,6 +6,44 @@
  */
 
 #include "ints.h"
+#include "internal/memory_utils.h"
+
+/* Integers up to this value are encoded in the initial byte and shared between
+ * all their uses, see _CBOR_ITEM_IMMORTAL */
+#define _CBOR_SMALL_INT_COUNT 24
+
+static const uint8_t _cbor_small_int_values[_CBOR_SMALL_INT_COUNT] = {
+    0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11,
+    12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23};
+
+#define _CBOR_SMALL_INT(item_type, value)                   \
+  {                                                         \
+    .metadata = {.int_metadata = {.width = CBOR_INT_8}},    \
+    .refcount = SIZE_MAX, .type = item_type,                \
+    .flags = _CBOR_ITEM_IMMORTAL,                           \
+    .data = (unsigned char*)&_cbor_small_int_values[value], \
+  }
+
+#define _CBOR_SMALL_INTS(item_type)                                     \
+  {                                                                     \
+    _CBOR_SMALL_INT(item_type, 0), _CBOR_SMALL_INT(item_type, 1),       \
+        _CBOR_SMALL_INT(item_type, 2), _CBOR_SMALL_INT(item_type, 3),   \
+        _CBOR_SMALL_INT(item_type, 4), _CBOR_SMALL_INT(item_type, 5),   \
+        _CBOR_SMALL_INT(item_type, 6), _CBOR_SMALL_INT(item_type, 7),   \
+        _CBOR_SMALL_INT(item_type, 8), _CBOR_SMALL_INT(item_type, 9),   \
+        _CBOR_SMALL_INT(item_type, 10), _CBOR_SMALL_INT(item_type, 11), \
+        _CBOR_SMALL_INT(item_type, 12), _CBOR_SMALL_INT(item_type, 13), \
+        _CBOR_SMALL_INT(item_type, 14), _CBOR_SMALL_INT(item_type, 15), \
+        _CBOR_SMALL_INT(item_type, 16), _CBOR_SMALL_INT(item_type, 17), \
+        _CBOR_SMALL_INT(item_type, 18), _CBOR_SMALL_INT(item_type, 19), \
+        _CBOR_SMALL_INT(item_type, 20), _CBOR_SMALL_INT(item_type, 21), \
+        _CBOR_SMALL_INT(item_type, 22), _CBOR_SMALL_INT(item_type, 23)  \
+  }
+
+static const cbor_item_t _cbor_small_uints[_CBOR_SMALL_INT_COUNT] =
+    _CBOR_SMALL_INTS(CBOR_TYPE_UINT);
+static const cbor_item_t _cbor_small_negints[_CBOR_SMALL_INT_COUNT] =
+    _CBOR_SMALL_INTS(CBOR_TYPE_NEGINT);
 
 cbor_int_width cbor_int_get_width(const cbor_item_t* item) {
   CBOR_ASSERT(cbor_is_int(item));
@@ -57,138 +95,203 @@ uint64_t cbor_get_int(const cbor_item_t* item) {
 
 void cbor_set_uint8(cbor_item_t* item, uint8_t value) {
   CBOR_ASSERT(cbor_is_int(item));
+  CBOR_ASSERT(!(item->flags & _CBOR_ITEM_IMMORTAL));
   CBOR_ASSERT(cbor_int_get_width(item) == CBOR_INT_8);
   *item->data = value;
 }
 
 void cbor_set_uint16(cbor_item_t* item, uint16_t value) {
   CBOR_ASSERT(cbor_is_int(item));
+  CBOR_ASSERT(!(item->flags & _CBOR_ITEM_IMMORTAL));
   CBOR_ASSERT(cbor_int_get_width(item) == CBOR_INT_16);
   *(uint16_t*)item->data = value;
 }
 
 void cbor_set_uint32(cbor_item_t* item, uint32_t value) {
   CBOR_ASSERT(cbor_is_int(item));
+  CBOR_ASSERT(!(item->flags & _CBOR_ITEM_IMMORTAL));
   CBOR_ASSERT(cbor_int_get_width(item) == CBOR_INT_32);
   *(uint32_t*)item->data = value;
 }
 
 void cbor_set_uint64(cbor_item_t* item, uint64_t value) {
   CBOR_ASSERT(cbor_is_int(item));
+  CBOR_ASSERT(!(item->flags & _CBOR_ITEM_IMMORTAL));
   CBOR_ASSERT(cbor_int_get_width(item) == CBOR_INT_64);
   *(uint64_t*)item->data = value;
 }
 
 void cbor_mark_uint(cbor_item_t* item) {
   CBOR_ASSERT(cbor_is_int(item));
+  CBOR_ASSERT(!(item->flags & _CBOR_ITEM_IMMORTAL));
   item->type = CBOR_TYPE_UINT;
 }
 
 void cbor_mark_negint(cbor_item_t* item) {
   CBOR_ASSERT(cbor_is_int(item));
+  CBOR_ASSERT(!(item->flags & _CBOR_ITEM_IMMORTAL));
   item->type = CBOR_TYPE_NEGINT;
 }
 
-cbor_item_t* cbor_new_int8(void) {
-  cbor_item_t* item = _cbor_malloc(sizeof(cbor_item_t) + 1);
+cbor_item_t* cbor_new_int8_with(const struct cbor_allocator* allocator) {
+  cbor_item_t* item = _cbor_alloc_with(allocator, sizeof(cbor_item_t) + 1);
   _CBOR_NOTNULL(item);
   *item = (cbor_item_t){.data = (unsigned char*)item + sizeof(cbor_item_t),
                         .refcount = 1,
                         .metadata = {.int_metadata = {.width = CBOR_INT_8}},
-                        .type = CBOR_TYPE_UINT};
+                        .type = CBOR_TYPE_UINT,
+                        .allocator = allocator};
   return item;
 }
 
-cbor_item_t* cbor_new_int16(void) {
-  cbor_item_t* item = _cbor_malloc(sizeof(cbor_item_t) + 2);
+cbor_item_t* cbor_new_int8(void) { return cbor_new_int8_with(NULL); }
+
+cbor_item_t* cbor_new_int16_with(const struct cbor_allocator* allocator) {
+  cbor_item_t* item = _cbor_alloc_with(allocator, sizeof(cbor_item_t) + 2);
   _CBOR_NOTNULL(item);
   *item = (cbor_item_t){.data = (unsigned char*)item + sizeof(cbor_item_t),
                         .refcount = 1,
                         .metadata = {.int_metadata = {.width = CBOR_INT_16}},
-                        .type = CBOR_TYPE_UINT};
+                        .type = CBOR_TYPE_UINT,
+                        .allocator = allocator};
   return item;
 }
 
-cbor_item_t* cbor_new_int32(void) {
-  cbor_item_t* item = _cbor_malloc(sizeof(cbor_item_t) + 4);
+cbor_item_t* cbor_new_int16(void) { return cbor_new_int16_with(NULL); }
+
+cbor_item_t* cbor_new_int32_with(const struct cbor_allocator* allocator) {
+  cbor_item_t* item = _cbor_alloc_with(allocator, sizeof(cbor_item_t) + 4);
   _CBOR_NOTNULL(item);
   *item = (cbor_item_t){.data = (unsigned char*)item + sizeof(cbor_item_t),
                         .refcount = 1,
                         .metadata = {.int_metadata = {.width = CBOR_INT_32}},
-                        .type = CBOR_TYPE_UINT};
+                        .type = CBOR_TYPE_UINT,
+                        .allocator = allocator};
   return item;
 }
 
-cbor_item_t* cbor_new_int64(void) {
-  cbor_item_t* item = _cbor_malloc(sizeof(cbor_item_t) + 8);
+cbor_item_t* cbor_new_int32(void) { return cbor_new_int32_with(NULL); }
+
+cbor_item_t* cbor_new_int64_with(const struct cbor_allocator* allocator) {
+  cbor_item_t* item = _cbor_alloc_with(allocator, sizeof(cbor_item_t) + 8);
   _CBOR_NOTNULL(item);
   *item = (cbor_item_t){.data = (unsigned char*)item + sizeof(cbor_item_t),
                         .refcount = 1,
                         .metadata = {.int_metadata = {.width = CBOR_INT_64}},
-                        .type = CBOR_TYPE_UINT};
+                        .type = CBOR_TYPE_UINT,
+                        .allocator = allocator};
   return item;
 }
 
-cbor_item_t* cbor_build_uint8(uint8_t value) {
-  cbor_item_t* item = cbor_new_int8();
+cbor_item_t* cbor_new_int64(void) { return cbor_new_int64_with(NULL); }
+
+cbor_item_t* cbor_build_uint8_with(const struct cbor_allocator* allocator,
+                                   uint8_t value) {
+  if (value < _CBOR_SMALL_INT_COUNT) {
+    // Never written to, see _CBOR_ITEM_IMMORTAL
+    return (cbor_item_t*)&_cbor_small_uints[value];
+  }
+  cbor_item_t* item = cbor_new_int8_with(allocator);
   _CBOR_NOTNULL(item);
   cbor_set_uint8(item, value);
   cbor_mark_uint(item);
   return item;
 }
 
-cbor_item_t* cbor_build_uint16(uint16_t value) {
-  cbor_item_t* item = cbor_new_int16();
+cbor_item_t* cbor_build_uint8(uint8_t value) {
+  return cbor_build_uint8_with(NULL, value);
+}
+
+cbor_item_t* cbor_build_uint16_with(const struct cbor_allocator* allocator,
+                                    uint16_t value) {
+  cbor_item_t* item = cbor_new_int16_with(allocator);
   _CBOR_NOTNULL(item);
   cbor_set_uint16(item, value);
   cbor_mark_uint(item);
   return item;
 }
 
-cbor_item_t* cbor_build_uint32(uint32_t value) {
-  cbor_item_t* item = cbor_new_int32();
+cbor_item_t* cbor_build_uint16(uint16_t value) {
+  return cbor_build_uint16_with(NULL, value);
+}
+
+cbor_item_t* cbor_build_uint32_with(const struct cbor_allocator* allocator,
+                                    uint32_t value) {
+  cbor_item_t* item = cbor_new_int32_with(allocator);
   _CBOR_NOTNULL(item);
   cbor_set_uint32(item, value);
   cbor_mark_uint(item);
   return item;
 }
 
-cbor_item_t* cbor_build_uint64(uint64_t value) {
-  cbor_item_t* item = cbor_new_int64();
+cbor_item_t* cbor_build_uint32(uint32_t value) {
+  return cbor_build_uint32_with(NULL, value);
+}
+
+cbor_item_t* cbor_build_uint64_with(const struct cbor_allocator* allocator,
+                                    uint64_t value) {
+  cbor_item_t* item = cbor_new_int64_with(allocator);
   _CBOR_NOTNULL(item);
   cbor_set_uint64(item, value);
   cbor_mark_uint(item);
   return item;
 }
 
-cbor_item_t* cbor_build_negint8(uint8_t value) {
-  cbor_item_t* item = cbor_new_int8();
+cbor_item_t* cbor_build_uint64(uint64_t value) {
+  return cbor_build_uint64_with(NULL, value);
+}
+
+cbor_item_t* cbor_build_negint8_with(const struct cbor_allocator* allocator,
+                                     uint8_t value) {
+  if (value < _CBOR_SMALL_INT_COUNT) {
+    return (cbor_item_t*)&_cbor_small_negints[value];
+  }
+  cbor_item_t* item = cbor_new_int8_with(allocator);
   _CBOR_NOTNULL(item);
   cbor_set_uint8(item, value);
   cbor_mark_negint(item);
   return item;
 }
 
-cbor_item_t* cbor_build_negint16(uint16_t value) {
-  cbor_item_t* item = cbor_new_int16();
+cbor_item_t* cbor_build_negint8(uint8_t value) {
+  return cbor_build_negint8_with(NULL, value);
+}
+
+cbor_item_t* cbor_build_negint16_with(const struct cbor_allocator* allocator,
+                                      uint16_t value) {
+  cbor_item_t* item = cbor_new_int16_with(allocator);
   _CBOR_NOTNULL(item);
   cbor_set_uint16(item, value);
   cbor_mark_negint(item);
   return item;
 }
 
-cbor_item_t* cbor_build_negint32(uint32_t value) {
-  cbor_item_t* item = cbor_new_int32();
+cbor_item_t* cbor_build_negint16(uint16_t value) {
+  return cbor_build_negint16_with(NULL, value);
+}
+
+cbor_item_t* cbor_build_negint32_with(const struct cbor_allocator* allocator,
+                                      uint32_t value) {
+  cbor_item_t* item = cbor_new_int32_with(allocator);
   _CBOR_NOTNULL(item);
   cbor_set_uint32(item, value);
   cbor_mark_negint(item);
   return item;
 }
 
-cbor_item_t* cbor_build_negint64(uint64_t value) {
-  cbor_item_t* item = cbor_new_int64();
+cbor_item_t* cbor_build_negint32(uint32_t value) {
+  return cbor_build_negint32_with(NULL, value);
+}
+
+cbor_item_t* cbor_build_negint64_with(const struct cbor_allocator* allocator,
+                                      uint64_t value) {
+  cbor_item_t* item = cbor_new_int64_with(allocator);
   _CBOR_NOTNULL(item);
   cbor_set_uint64(item, value);
   cbor_mark_negint(item);
   return item;
 }
+
+cbor_item_t* cbor_build_negint64(uint64_t value) {
+  return cbor_build_negint64_with(NULL, value);
+}
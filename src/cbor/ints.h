@@ -121,6 +121,16 @@ CBOR_EXPORT void cbor_mark_negint(cbor_item_t* item);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_int8(void);
 
+/** Like #cbor_new_int8, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @return **new** positive integer or `NULL` on memory allocation failure. The
+ * value is not initialized
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_int8_with(
+    const struct cbor_allocator* allocator);
+
 /** Allocates new integer with 2B width
  *
  * The width cannot be changed once allocated
@@ -130,6 +140,16 @@ _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_int8(void);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_int16(void);
 
+/** Like #cbor_new_int16, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @return **new** positive integer or `NULL` on memory allocation failure. The
+ * value is not initialized
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_int16_with(
+    const struct cbor_allocator* allocator);
+
 /** Allocates new integer with 4B width
  *
  * The width cannot be changed once allocated
@@ -139,6 +159,16 @@ _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_int16(void);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_int32(void);
 
+/** Like #cbor_new_int32, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @return **new** positive integer or `NULL` on memory allocation failure. The
+ * value is not initialized
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_int32_with(
+    const struct cbor_allocator* allocator);
+
 /** Allocates new integer with 8B width
  *
  * The width cannot be changed once allocated
@@ -148,13 +178,39 @@ _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_int32(void);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_int64(void);
 
+/** Like #cbor_new_int64, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @return **new** positive integer or `NULL` on memory allocation failure. The
+ * value is not initialized
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_int64_with(
+    const struct cbor_allocator* allocator);
+
 /** Constructs a new positive integer
+ *
+ * Values 0 through 23 are not allocated. All their uses share a single
+ * read-only item whose reference count is not tracked. Use #cbor_new_int8 and
+ * #cbor_set_uint8 to obtain an item that can be modified.
  *
  * @param value the value to use
- * @return **new** positive integer or `NULL` on memory allocation failure
+ * @return Positive integer, possibly shared, or `NULL` on memory allocation
+ * failure
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_uint8(uint8_t value);
 
+/** Like #cbor_build_uint8, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @param value the value to use
+ * @return Positive integer, possibly shared, or `NULL` on memory allocation
+ * failure
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_uint8_with(
+    const struct cbor_allocator* allocator, uint8_t value);
+
 /** Constructs a new positive integer
  *
  * @param value the value to use
@@ -162,6 +218,16 @@ _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_uint8(uint8_t value);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_uint16(uint16_t value);
 
+/** Like #cbor_build_uint16, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @param value the value to use
+ * @return **new** positive integer or `NULL` on memory allocation failure
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_uint16_with(
+    const struct cbor_allocator* allocator, uint16_t value);
+
 /** Constructs a new positive integer
  *
  * @param value the value to use
@@ -169,6 +235,16 @@ _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_uint16(uint16_t value);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_uint32(uint32_t value);
 
+/** Like #cbor_build_uint32, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @param value the value to use
+ * @return **new** positive integer or `NULL` on memory allocation failure
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_uint32_with(
+    const struct cbor_allocator* allocator, uint32_t value);
+
 /** Constructs a new positive integer
  *
  * @param value the value to use
@@ -176,13 +252,38 @@ _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_uint32(uint32_t value);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_uint64(uint64_t value);
 
+/** Like #cbor_build_uint64, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @param value the value to use
+ * @return **new** positive integer or `NULL` on memory allocation failure
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_uint64_with(
+    const struct cbor_allocator* allocator, uint64_t value);
+
 /** Constructs a new negative integer
+ *
+ * Like #cbor_build_uint8, values 0 through 23 (-1 through -24) return a shared
+ * read-only item.
  *
  * @param value the value to use
- * @return **new** negative integer or `NULL` on memory allocation failure
+ * @return Negative integer, possibly shared, or `NULL` on memory allocation
+ * failure
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_negint8(uint8_t value);
 
+/** Like #cbor_build_negint8, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @param value the value to use
+ * @return Negative integer, possibly shared, or `NULL` on memory allocation
+ * failure
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_negint8_with(
+    const struct cbor_allocator* allocator, uint8_t value);
+
 /** Constructs a new negative integer
  *
  * @param value the value to use
@@ -190,6 +291,16 @@ _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_negint8(uint8_t value);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_negint16(uint16_t value);
 
+/** Like #cbor_build_negint16, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @param value the value to use
+ * @return **new** negative integer or `NULL` on memory allocation failure
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_negint16_with(
+    const struct cbor_allocator* allocator, uint16_t value);
+
 /** Constructs a new negative integer
  *
  * @param value the value to use
@@ -197,6 +308,16 @@ _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_negint16(uint16_t value);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_negint32(uint32_t value);
 
+/** Like #cbor_build_negint32, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @param value the value to use
+ * @return **new** negative integer or `NULL` on memory allocation failure
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_negint32_with(
+    const struct cbor_allocator* allocator, uint32_t value);
+
 /** Constructs a new negative integer
  *
  * @param value the value to use
@@ -204,6 +325,16 @@ _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_negint32(uint32_t value);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_negint64(uint64_t value);
 
+/** Like #cbor_build_negint64, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @param value the value to use
+ * @return **new** negative integer or `NULL` on memory allocation failure
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_negint64_with(
+    const struct cbor_allocator* allocator, uint64_t value);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,720 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include "json.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "internal/memory_utils.h"
+#include "internal/simd.h"
+#include "streaming.h"
+
+/** Number of frames allocated for the first container */
+#define _CBOR_JSON_INITIAL_DEPTH 8
+
+/** An open container or indefinite string */
+struct _cbor_json_frame {
+  cbor_type type;
+  bool indefinite;
+  /** Number of elements (arrays) or pairs (maps) of a definite container */
+  uint64_t size;
+  /** Number of items completed so far, keys and values count separately */
+  uint64_t count;
+  /** Where the JSON text of the container starts in the key buffer if the
+   * container is a map key, `SIZE_MAX` otherwise */
+  size_t key_offset;
+};
+
+struct _cbor_json_context {
+  /** Where the output currently goes, the user's writer or the key buffer */
+  cbor_writer* out;
+  cbor_writer* writer;
+  /** JSON text of the containers used as map keys, escaped once complete */
+  cbor_writer keys;
+  size_t key_depth;
+  struct _cbor_json_frame* frames;
+  size_t depth;
+  size_t capacity;
+  /** Whether the current item is a map key */
+  bool in_key;
+  /** Bytes of an indefinite byte string that did not fill a base64 group */
+  unsigned char carry[2];
+  size_t carry_length;
+  /** Whether the root item is complete */
+  bool done;
+  cbor_error_code error;
+};
+
+/*
+ * ============================================================================
+ * Output
+ * ============================================================================
+ */
+
+static void _cbor_json_bytes(struct _cbor_json_context* context,
+                             const void* data, size_t length) {
+  cbor_writer_bytes(context->out, data, length);
+}
+
+static void _cbor_json_byte(struct _cbor_json_context* context,
+                            unsigned char value) {
+  cbor_writer* out = context->out;
+  if (!out->failed && out->length < out->capacity) {
+    out->buffer[out->length++] = value;
+  } else {
+    cbor_writer_bytes(out, &value, 1);
+  }
+}
+
+// The character to write after a backslash, 'u' for a \u00XX escape, or 0
+// if the byte is written as is
+static const char _cbor_json_escapes[256] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    'u', 'u', 'u', 'u', ['"'] = '"', ['\\'] = '\\'};
+
+static const char _cbor_json_hex[] = "0123456789abcdef";
+
+#define _CBOR_JSON_ONES UINT64_C(0x0101010101010101)
+#define _CBOR_JSON_HIGH UINT64_C(0x8080808080808080)
+
+// Whether any of the 8 bytes is a control character, a quote, or a
+// backslash. Checks all of them at once using the borrow out of each byte
+// when subtracting, so the common case of plain text takes a few
+// instructions per 8 bytes instead of a table lookup per byte.
+static bool _cbor_json_word_needs_escape(uint64_t word) {
+  uint64_t quote = word ^ (_CBOR_JSON_ONES * '"');
+  uint64_t backslash = word ^ (_CBOR_JSON_ONES * '\\');
+  return (((word - _CBOR_JSON_ONES * 0x20) & ~word) |
+          ((quote - _CBOR_JSON_ONES) & ~quote) |
+          ((backslash - _CBOR_JSON_ONES) & ~backslash)) &
+         _CBOR_JSON_HIGH;
+}
+
+/*
+ * Each variant returns the length of a prefix of `data` with no bytes that
+ * need escaping. The prefix is a whole number of blocks and may be shorter
+ * than the actual run of such bytes. Uses the same dispatch as the ASCII scan
+ * of the UTF-8 validation.
+ */
+
+#ifdef _CBOR_SIMD_SSE2
+static size_t _cbor_json_plain_prefix_sse2(const unsigned char* data,
+                                           size_t length) {
+  const __m128i control = _mm_set1_epi8(0x1F);
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  size_t pos = 0;
+  for (; length - pos >= 16; pos += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i*)(data + pos));
+    // Unsigned block <= 0x1F
+    __m128i escape = _mm_cmpeq_epi8(_mm_min_epu8(block, control), block);
+    escape = _mm_or_si128(escape, _mm_cmpeq_epi8(block, quote));
+    escape = _mm_or_si128(escape, _mm_cmpeq_epi8(block, backslash));
+    if (_mm_movemask_epi8(escape) != 0) break;
+  }
+  return pos;
+}
+#endif
+
+#ifdef _CBOR_SIMD_AVX2
+__attribute__((target("avx2"))) static size_t _cbor_json_plain_prefix_avx2(
+    const unsigned char* data, size_t length) {
+  const __m256i control = _mm256_set1_epi8(0x1F);
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  size_t pos = 0;
+  for (; length - pos >= 32; pos += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i*)(data + pos));
+    __m256i escape =
+        _mm256_cmpeq_epi8(_mm256_min_epu8(block, control), block);
+    escape = _mm256_or_si256(escape, _mm256_cmpeq_epi8(block, quote));
+    escape = _mm256_or_si256(escape, _mm256_cmpeq_epi8(block, backslash));
+    if (_mm256_movemask_epi8(escape) != 0) break;
+  }
+  return pos + _cbor_json_plain_prefix_sse2(data + pos, length - pos);
+}
+
+_CBOR_SIMD_DISPATCH(_cbor_json_plain_prefix_x86, _cbor_json_plain_prefix_avx2,
+                    _cbor_json_plain_prefix_sse2)
+#endif
+
+#ifdef _CBOR_SIMD_NEON
+static size_t _cbor_json_plain_prefix_neon(const unsigned char* data,
+                                           size_t length) {
+  size_t pos = 0;
+  for (; length - pos >= 16; pos += 16) {
+    uint8x16_t block = vld1q_u8(data + pos);
+    uint8x16_t escape = vorrq_u8(vcltq_u8(block, vdupq_n_u8(0x20)),
+                                 vceqq_u8(block, vdupq_n_u8('"')));
+    escape = vorrq_u8(escape, vceqq_u8(block, vdupq_n_u8('\\')));
+    if (vmaxvq_u8(escape) != 0) break;
+  }
+  return pos;
+}
+#endif
+
+static size_t _cbor_json_plain_prefix(const unsigned char* data,
+                                      size_t length) {
+#if defined(_CBOR_SIMD_AVX2)
+  size_t pos = _cbor_json_plain_prefix_x86(data, length);
+#elif defined(_CBOR_SIMD_SSE2)
+  size_t pos = _cbor_json_plain_prefix_sse2(data, length);
+#elif defined(_CBOR_SIMD_NEON)
+  size_t pos = _cbor_json_plain_prefix_neon(data, length);
+#else
+  size_t pos = 0;
+#endif
+  // Also covers the tail shorter than a vector
+  for (; length - pos >= 8; pos += 8) {
+    uint64_t word;
+    memcpy(&word, data + pos, 8);
+    if (_cbor_json_word_needs_escape(word)) break;
+  }
+  return pos;
+}
+
+// Write the contents of a string, escaped. Runs of bytes that need no
+// escaping are written in one piece.
+static void _cbor_json_escaped(struct _cbor_json_context* context,
+                               const unsigned char* data, size_t length) {
+  size_t start = 0, i = 0;
+  while (i < length) {
+    i += _cbor_json_plain_prefix(data + i, length - i);
+    if (i == length) break;
+    char escape = _cbor_json_escapes[data[i]];
+    if (escape == 0) {
+      i++;
+      continue;
+    }
+    _cbor_json_bytes(context, data + start, i - start);
+    if (escape == 'u') {
+      char sequence[6] = {'\\', 'u', '0', '0', _cbor_json_hex[data[i] >> 4],
+                          _cbor_json_hex[data[i] & 0x0F]};
+      _cbor_json_bytes(context, sequence, sizeof(sequence));
+    } else {
+      char sequence[2] = {'\\', escape};
+      _cbor_json_bytes(context, sequence, sizeof(sequence));
+    }
+    start = ++i;
+  }
+  _cbor_json_bytes(context, data + start, length - start);
+}
+
+static void _cbor_json_string(struct _cbor_json_context* context,
+                              const unsigned char* data, size_t length) {
+  _cbor_json_byte(context, '"');
+  _cbor_json_escaped(context, data, length);
+  _cbor_json_byte(context, '"');
+}
+
+static const char _cbor_json_base64url[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// Encode a group of up to three bytes, without padding. Returns the number of
+// characters written.
+static size_t _cbor_json_base64_group(const unsigned char* data, size_t length,
+                                      char* output) {
+  uint32_t group = (uint32_t)data[0] << 16;
+  if (length > 1) group |= (uint32_t)data[1] << 8;
+  if (length > 2) group |= data[2];
+  output[0] = _cbor_json_base64url[group >> 18];
+  output[1] = _cbor_json_base64url[(group >> 12) & 0x3F];
+  if (length == 1) return 2;
+  output[2] = _cbor_json_base64url[(group >> 6) & 0x3F];
+  if (length == 2) return 3;
+  output[3] = _cbor_json_base64url[group & 0x3F];
+  return 4;
+}
+
+// Encode a part of a byte string. Bytes that do not fill a group are kept in
+// the context until the next part, or until _cbor_json_base64_end.
+static void _cbor_json_base64(struct _cbor_json_context* context,
+                              const unsigned char* data, size_t length) {
+  char block[256];
+  size_t block_length = 0;
+  if (context->carry_length > 0) {
+    while (context->carry_length < 2 && length > 0) {
+      context->carry[context->carry_length++] = *data++;
+      length--;
+    }
+    if (length == 0) return;
+    unsigned char group[3] = {context->carry[0], context->carry[1], *data++};
+    length--;
+    block_length += _cbor_json_base64_group(group, 3, block);
+    context->carry_length = 0;
+  }
+  while (length >= 3) {
+    if (block_length > sizeof(block) - 4) {
+      _cbor_json_bytes(context, block, block_length);
+      block_length = 0;
+    }
+    block_length += _cbor_json_base64_group(data, 3, block + block_length);
+    data += 3;
+    length -= 3;
+  }
+  _cbor_json_bytes(context, block, block_length);
+  memcpy(context->carry, data, length);
+  context->carry_length = length;
+}
+
+static void _cbor_json_base64_end(struct _cbor_json_context* context) {
+  if (context->carry_length == 0) return;
+  char group[4];
+  _cbor_json_bytes(context, group,
+                   _cbor_json_base64_group(context->carry,
+                                           context->carry_length, group));
+  context->carry_length = 0;
+}
+
+/*
+ * ============================================================================
+ * Structure
+ * ============================================================================
+ */
+
+static void _cbor_json_fail(struct _cbor_json_context* context,
+                            cbor_error_code error) {
+  if (context->error == CBOR_ERR_NONE) context->error = error;
+}
+
+static struct _cbor_json_frame* _cbor_json_top(
+    struct _cbor_json_context* context) {
+  return context->depth > 0 ? context->frames + context->depth - 1 : NULL;
+}
+
+// Write the separator before an item and determine whether it is a map key.
+// Returns false if no item can follow.
+static bool _cbor_json_item_start(struct _cbor_json_context* context) {
+  if (context->error != CBOR_ERR_NONE) return false;
+  struct _cbor_json_frame* top = _cbor_json_top(context);
+  context->in_key = false;
+  if (top == NULL) return true;
+  if (top->type == CBOR_TYPE_BYTESTRING || top->type == CBOR_TYPE_STRING) {
+    // Only chunks of the same type can be nested in an indefinite string
+    _cbor_json_fail(context, CBOR_ERR_SYNTAXERROR);
+    return false;
+  }
+  bool map = top->type == CBOR_TYPE_MAP;
+  if (top->count > 0) {
+    _cbor_json_byte(context, map && top->count % 2 == 1 ? ':' : ',');
+  }
+  context->in_key = map && top->count % 2 == 0;
+  return true;
+}
+
+static void _cbor_json_container_end(struct _cbor_json_context* context);
+
+// Account for a completed item and close the containers it completes
+static void _cbor_json_item_end(struct _cbor_json_context* context) {
+  struct _cbor_json_frame* top = _cbor_json_top(context);
+  if (top == NULL) {
+    context->done = true;
+    return;
+  }
+  top->count++;
+  if (top->indefinite) return;
+  if ((top->type == CBOR_TYPE_ARRAY && top->count == top->size) ||
+      (top->type == CBOR_TYPE_MAP && top->count % 2 == 0 &&
+       top->count / 2 == top->size)) {
+    _cbor_json_container_end(context);
+  }
+}
+
+static void _cbor_json_container_start(struct _cbor_json_context* context,
+                                       cbor_type type, bool indefinite,
+                                       uint64_t size) {
+  if (!_cbor_json_item_start(context)) return;
+  if (context->depth == CBOR_MAX_STACK_SIZE) {
+    _cbor_json_fail(context, CBOR_ERR_MEMERROR);
+    return;
+  }
+  if (context->depth == context->capacity) {
+    size_t capacity = context->capacity == 0
+                          ? _CBOR_JSON_INITIAL_DEPTH
+                          : CBOR_BUFFER_GROWTH * context->capacity;
+    struct _cbor_json_frame* frames = _cbor_realloc_multiple(
+        context->frames, sizeof(struct _cbor_json_frame), capacity);
+    if (frames == NULL) {
+      _cbor_json_fail(context, CBOR_ERR_MEMERROR);
+      return;
+    }
+    context->frames = frames;
+    context->capacity = capacity;
+  }
+
+  size_t key_offset = SIZE_MAX;
+  if (context->in_key &&
+      (type == CBOR_TYPE_ARRAY || type == CBOR_TYPE_MAP)) {
+    // Collect the JSON text of the key, it is escaped once complete
+    key_offset = context->keys.length;
+    context->key_depth++;
+    context->out = &context->keys;
+  }
+  context->frames[context->depth++] =
+      (struct _cbor_json_frame){.type = type,
+                                .indefinite = indefinite,
+                                .size = size,
+                                .count = 0,
+                                .key_offset = key_offset};
+  switch (type) {
+    case CBOR_TYPE_ARRAY:
+      _cbor_json_byte(context, '[');
+      break;
+    case CBOR_TYPE_MAP:
+      _cbor_json_byte(context, '{');
+      break;
+    default:
+      _cbor_json_byte(context, '"');
+      break;
+  }
+  if (!indefinite && size == 0) _cbor_json_container_end(context);
+}
+
+// Write the JSON text of a container key as a string
+static void _cbor_json_key_end(struct _cbor_json_context* context,
+                               size_t key_offset) {
+  cbor_writer* keys = &context->keys;
+  size_t length = keys->length - key_offset;
+  unsigned char* text = _cbor_malloc(length);
+  context->key_depth--;
+  if (context->key_depth == 0) context->out = context->writer;
+  if (keys->failed || text == NULL) {
+    _cbor_json_fail(context, CBOR_ERR_MEMERROR);
+    _cbor_free(text);
+    return;
+  }
+  memcpy(text, keys->buffer + key_offset, length);
+  keys->length = key_offset;
+  _cbor_json_string(context, text, length);
+  _cbor_free(text);
+}
+
+static void _cbor_json_container_end(struct _cbor_json_context* context) {
+  struct _cbor_json_frame frame = context->frames[--context->depth];
+  switch (frame.type) {
+    case CBOR_TYPE_ARRAY:
+      _cbor_json_byte(context, ']');
+      break;
+    case CBOR_TYPE_MAP:
+      _cbor_json_byte(context, '}');
+      break;
+    case CBOR_TYPE_BYTESTRING:
+      _cbor_json_base64_end(context);
+      _cbor_json_byte(context, '"');
+      break;
+    default:
+      _cbor_json_byte(context, '"');
+      break;
+  }
+  if (frame.key_offset != SIZE_MAX) {
+    _cbor_json_key_end(context, frame.key_offset);
+  }
+  _cbor_json_item_end(context);
+}
+
+// Write a number or a literal. Map keys are quoted.
+static void _cbor_json_scalar(struct _cbor_json_context* context,
+                              const char* text, size_t length) {
+  if (!_cbor_json_item_start(context)) return;
+  if (context->in_key) _cbor_json_byte(context, '"');
+  _cbor_json_bytes(context, text, length);
+  if (context->in_key) _cbor_json_byte(context, '"');
+  _cbor_json_item_end(context);
+}
+
+/*
+ * ============================================================================
+ * Callbacks
+ * ============================================================================
+ */
+
+// Longest decimal representation of an integer or a double, with a sign
+#define _CBOR_JSON_NUMBER_SIZE 32
+
+// Write the digits of `value` to the end of `buffer`. Returns where they
+// start.
+static char* _cbor_json_format_uint(uint64_t value,
+                                    char buffer[_CBOR_JSON_NUMBER_SIZE]) {
+  char* start = buffer + _CBOR_JSON_NUMBER_SIZE;
+  do {
+    *--start = (char)('0' + value % 10);
+    value /= 10;
+  } while (value > 0);
+  return start;
+}
+
+static void _cbor_json_uint(void* context, uint64_t value) {
+  char buffer[_CBOR_JSON_NUMBER_SIZE];
+  char* start = _cbor_json_format_uint(value, buffer);
+  _cbor_json_scalar(context, start,
+                    (size_t)(buffer + _CBOR_JSON_NUMBER_SIZE - start));
+}
+
+static void _cbor_json_uint8(void* context, uint8_t value) {
+  _cbor_json_uint(context, value);
+}
+
+static void _cbor_json_uint16(void* context, uint16_t value) {
+  _cbor_json_uint(context, value);
+}
+
+static void _cbor_json_uint32(void* context, uint32_t value) {
+  _cbor_json_uint(context, value);
+}
+
+static void _cbor_json_negint(void* context, uint64_t value) {
+  char buffer[_CBOR_JSON_NUMBER_SIZE];
+  char* start;
+  if (value == UINT64_MAX) {
+    // -2^64 does not fit the argument
+    static const char minimum[] = "18446744073709551616";
+    start = buffer + _CBOR_JSON_NUMBER_SIZE - (sizeof(minimum) - 1);
+    memcpy(start, minimum, sizeof(minimum) - 1);
+  } else {
+    start = _cbor_json_format_uint(value + 1, buffer);
+  }
+  *--start = '-';
+  _cbor_json_scalar(context, start,
+                    (size_t)(buffer + _CBOR_JSON_NUMBER_SIZE - start));
+}
+
+static void _cbor_json_negint8(void* context, uint8_t value) {
+  _cbor_json_negint(context, value);
+}
+
+static void _cbor_json_negint16(void* context, uint16_t value) {
+  _cbor_json_negint(context, value);
+}
+
+static void _cbor_json_negint32(void* context, uint32_t value) {
+  _cbor_json_negint(context, value);
+}
+
+static void _cbor_json_null(void* context) {
+  _cbor_json_scalar(context, "null", 4);
+}
+
+static void _cbor_json_boolean(void* context, bool value) {
+  if (value) {
+    _cbor_json_scalar(context, "true", 4);
+  } else {
+    _cbor_json_scalar(context, "false", 5);
+  }
+}
+
+// snprintf and strtod use the decimal separator of the current locale, which
+// may be a comma or even several bytes. Apart from it, %g only produces
+// digits, signs, and the exponent, so whatever else is found is the separator.
+static size_t _cbor_json_decimal_point(char* number, size_t length) {
+  size_t out = 0;
+  for (size_t i = 0; i < length; i++) {
+    char c = number[i];
+    if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == 'e') {
+      number[out++] = c;
+    } else if (out == 0 || number[out - 1] != '.') {
+      number[out++] = '.';
+    }
+  }
+  return out;
+}
+
+// Write a float using the fewest significant digits that read back as the
+// same value. Integral values are written like integers, without the search.
+static void _cbor_json_float(struct _cbor_json_context* context, double value,
+                             bool single) {
+  if (isnan(value) || isinf(value)) {
+    _cbor_json_null(context);
+    return;
+  }
+  // 2^53, all the integers below are exact in a double
+  const double exact = 9007199254740992.0;
+  if (fabs(value) < exact && value == (double)(int64_t)value) {
+    if (value > 0 || (value == 0 && !signbit(value))) {
+      _cbor_json_uint(context, (uint64_t)value);
+      return;
+    }
+    if (value < 0) {
+      _cbor_json_negint(context, (uint64_t)-value - 1);
+      return;
+    }
+  }
+  char buffer[_CBOR_JSON_NUMBER_SIZE];
+  int length = 0;
+  for (int precision = single ? 6 : 15; precision <= (single ? 9 : 17);
+       precision++) {
+    length = snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+    if (single ? strtof(buffer, NULL) == (float)value
+               : strtod(buffer, NULL) == value) {
+      break;
+    }
+  }
+  _cbor_json_scalar(context, buffer,
+                    _cbor_json_decimal_point(buffer, (size_t)length));
+}
+
+static void _cbor_json_float4(void* context, float value) {
+  _cbor_json_float(context, value, true);
+}
+
+static void _cbor_json_float8(void* context, double value) {
+  _cbor_json_float(context, value, false);
+}
+
+static void _cbor_json_byte_string(void* context, cbor_data data,
+                                   uint64_t length) {
+  struct _cbor_json_context* json = context;
+  struct _cbor_json_frame* top = _cbor_json_top(json);
+  if (top != NULL && top->type == CBOR_TYPE_BYTESTRING) {
+    // A chunk of an indefinite byte string
+    _cbor_json_base64(json, data, (size_t)length);
+    return;
+  }
+  if (!_cbor_json_item_start(json)) return;
+  _cbor_json_byte(json, '"');
+  _cbor_json_base64(json, data, (size_t)length);
+  _cbor_json_base64_end(json);
+  _cbor_json_byte(json, '"');
+  _cbor_json_item_end(json);
+}
+
+static void _cbor_json_text_string(void* context, cbor_data data,
+                                   uint64_t length) {
+  struct _cbor_json_context* json = context;
+  struct _cbor_json_frame* top = _cbor_json_top(json);
+  if (top != NULL && top->type == CBOR_TYPE_STRING) {
+    // A chunk of an indefinite string
+    _cbor_json_escaped(json, data, (size_t)length);
+    return;
+  }
+  if (!_cbor_json_item_start(json)) return;
+  _cbor_json_string(json, data, (size_t)length);
+  _cbor_json_item_end(json);
+}
+
+static void _cbor_json_byte_string_start(void* context) {
+  _cbor_json_container_start(context, CBOR_TYPE_BYTESTRING, true, 0);
+}
+
+static void _cbor_json_string_start(void* context) {
+  _cbor_json_container_start(context, CBOR_TYPE_STRING, true, 0);
+}
+
+static void _cbor_json_array_start(void* context, uint64_t size) {
+  _cbor_json_container_start(context, CBOR_TYPE_ARRAY, false, size);
+}
+
+static void _cbor_json_indef_array_start(void* context) {
+  _cbor_json_container_start(context, CBOR_TYPE_ARRAY, true, 0);
+}
+
+static void _cbor_json_map_start(void* context, uint64_t size) {
+  _cbor_json_container_start(context, CBOR_TYPE_MAP, false, size);
+}
+
+static void _cbor_json_indef_map_start(void* context) {
+  _cbor_json_container_start(context, CBOR_TYPE_MAP, true, 0);
+}
+
+static void _cbor_json_indef_break(void* context) {
+  struct _cbor_json_context* json = context;
+  struct _cbor_json_frame* top = _cbor_json_top(json);
+  if (top == NULL || !top->indefinite ||
+      (top->type == CBOR_TYPE_MAP && top->count % 2 == 1)) {
+    _cbor_json_fail(json, CBOR_ERR_SYNTAXERROR);
+    return;
+  }
+  _cbor_json_container_end(json);
+}
+
+static void _cbor_json_tag(void* context _CBOR_UNUSED,
+                           uint64_t value _CBOR_UNUSED) {
+  // The tagged item takes the place of the tag
+}
+
+static const struct cbor_callbacks _cbor_json_callbacks = {
+    .uint8 = _cbor_json_uint8,
+    .uint16 = _cbor_json_uint16,
+    .uint32 = _cbor_json_uint32,
+    .uint64 = _cbor_json_uint,
+    .negint8 = _cbor_json_negint8,
+    .negint16 = _cbor_json_negint16,
+    .negint32 = _cbor_json_negint32,
+    .negint64 = _cbor_json_negint,
+    .byte_string_start = _cbor_json_byte_string_start,
+    .byte_string = _cbor_json_byte_string,
+    .string = _cbor_json_text_string,
+    .string_start = _cbor_json_string_start,
+    .indef_array_start = _cbor_json_indef_array_start,
+    .array_start = _cbor_json_array_start,
+    .indef_map_start = _cbor_json_indef_map_start,
+    .map_start = _cbor_json_map_start,
+    .tag = _cbor_json_tag,
+    .float2 = _cbor_json_float4,
+    .float4 = _cbor_json_float4,
+    .float8 = _cbor_json_float8,
+    .undefined = _cbor_json_null,
+    .null = _cbor_json_null,
+    .boolean = _cbor_json_boolean,
+    .indef_break = _cbor_json_indef_break,
+};
+
+bool cbor_to_json(cbor_data source, size_t source_size, cbor_writer* writer,
+                  struct cbor_load_result* result) {
+  *result =
+      (struct cbor_load_result){.read = 0, .error = {.code = CBOR_ERR_NONE}};
+  if (source_size == 0) {
+    result->error.code = CBOR_ERR_NODATA;
+    return false;
+  }
+  struct _cbor_json_context context = {.out = writer,
+                                       .writer = writer,
+                                       .key_depth = 0,
+                                       .frames = NULL,
+                                       .depth = 0,
+                                       .capacity = 0,
+                                       .in_key = false,
+                                       .carry_length = 0,
+                                       .done = false,
+                                       .error = CBOR_ERR_NONE};
+  cbor_writer_init_growable(&context.keys);
+
+  while (!context.done && context.error == CBOR_ERR_NONE) {
+    if (result->read == source_size) {
+      context.error = CBOR_ERR_NOTENOUGHDATA;
+      break;
+    }
+    struct cbor_decoder_result decode_result =
+        cbor_stream_decode(source + result->read, source_size - result->read,
+                           &_cbor_json_callbacks, &context);
+    switch (decode_result.status) {
+      case CBOR_DECODER_FINISHED:
+        result->read += decode_result.read;
+        break;
+      case CBOR_DECODER_NEDATA:
+        _cbor_json_fail(&context, CBOR_ERR_NOTENOUGHDATA);
+        break;
+      case CBOR_DECODER_ERROR:
+        _cbor_json_fail(&context, CBOR_ERR_MALFORMATED);
+        break;
+    }
+    if (writer->failed || context.keys.failed) {
+      _cbor_json_fail(&context, CBOR_ERR_MEMERROR);
+    }
+  }
+
+  if (context.error != CBOR_ERR_NONE) {
+    result->error =
+        (struct cbor_error){.code = context.error, .position = result->read};
+  }
+  _cbor_free(context.frames);
+  cbor_writer_release(&context.keys);
+  return context.error == CBOR_ERR_NONE;
+}
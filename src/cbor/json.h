@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#ifndef LIBCBOR_JSON_H
+#define LIBCBOR_JSON_H
+
+#include "cbor/cbor_export.h"
+#include "cbor/common.h"
+#include "cbor/writer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * ============================================================================
+ * JSON conversion
+ * ============================================================================
+ */
+
+/** Convert an encoded item to JSON
+ *
+ * The item is transcoded in a single pass over \p source, driven by
+ * #cbor_stream_decode, and the JSON text is written to \p writer as it is
+ * produced. No items are built, so the memory use does not depend on the size
+ * of the input, only on its nesting depth.
+ *
+ * The conversion follows RFC 8949, section 6.1:
+ *  - Integers become numbers, with all their digits
+ *  - Floats become numbers in the shortest form that reads back as the same
+ *    value. NaN and infinities become `null`.
+ *  - Text strings are escaped and emitted as strings. Their UTF-8 encoding is
+ *    not checked.
+ *  - Byte strings become base64url encoded strings without padding
+ *  - Indefinite strings are concatenated
+ *  - Tags are dropped, the tagged item is emitted in their place
+ *  - `false`, `true`, and `null` map to their JSON counterparts, `undefined`
+ *    becomes `null`
+ *  - Map keys that are not strings are converted to JSON first and the text
+ *    is used as the key, e.g. `{1: 2}` becomes `{"1":2}`
+ *
+ * The output contains no whitespace. Duplicate keys are emitted as is.
+ *
+ * @param source The buffer
+ * @param source_size
+ * @param writer Destination of the JSON text. For sink writers, the caller
+ * needs to call #cbor_writer_flush afterwards.
+ * @param[out] result Result indicator. #CBOR_ERR_NONE on success.
+ * #CBOR_ERR_MEMERROR if \p writer has failed or the nesting state could not
+ * be allocated. Other error codes have the same meaning as for #cbor_load.
+ * @return Whether the whole item has been converted. On failure, the output
+ * written so far is incomplete.
+ */
+_CBOR_NODISCARD CBOR_EXPORT bool cbor_to_json(
+    cbor_data source, size_t source_size, cbor_writer* writer,
+    struct cbor_load_result* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // LIBCBOR_JSON_H
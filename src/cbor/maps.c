@@ -6,7 +6,51 @@
  */
 
 #include "maps.h"
+#include <string.h>
+#include "bytestrings.h"
 #include "internal/memory_utils.h"
+#include "ints.h"
+#include "strings.h"
+
+/** Open addressing hash index of map keys
+ *
+ * Slots hold the position of a pair plus one, zero marks an empty slot. Only
+ * the first of several equal keys is indexed, so that lookups agree with
+ * #cbor_map_get.
+ */
+struct _cbor_map_index {
+  /** Number of slots, a power of two */
+  size_t capacity;
+  /** Number of occupied slots */
+  size_t count;
+  size_t slots[];
+};
+
+/** Storage of the pairs
+ *
+ * The index pointer is kept in front of the pairs rather than in the item
+ * metadata, so that the index does not make every item larger.
+ */
+struct _cbor_map_storage {
+  /** Built by #cbor_map_get_indexed, `NULL` until first used */
+  struct _cbor_map_index* index;
+  struct cbor_pair pairs[];
+};
+
+#define _CBOR_MAP_INDEX_MIN_CAPACITY 16
+
+// Size of the storage for `count` pairs, or zero on overflow
+static size_t _cbor_map_storage_size(size_t count) {
+  if (!_cbor_safe_to_multiply(sizeof(struct cbor_pair), count) ||
+      !_cbor_safe_to_add(sizeof(struct _cbor_map_storage),
+                         sizeof(struct cbor_pair) * count))
+    return 0;
+  return sizeof(struct _cbor_map_storage) + sizeof(struct cbor_pair) * count;
+}
+
+static struct _cbor_map_storage* _cbor_map_storage(const cbor_item_t* item) {
+  return (struct _cbor_map_storage*)item->data;
+}
 
 size_t cbor_map_size(const cbor_item_t* item) {
   CBOR_ASSERT(cbor_isa_map(item));
@@ -18,8 +62,9 @@ size_t cbor_map_allocated(const cbor_item_t* item) {
   return item->metadata.map_metadata.allocated;
 }
 
-cbor_item_t* cbor_new_definite_map(size_t size) {
-  cbor_item_t* item = _cbor_malloc(sizeof(cbor_item_t));
+cbor_item_t* cbor_new_definite_map_with(
+    const struct cbor_allocator* allocator, size_t size) {
+  cbor_item_t* item = _cbor_alloc_with(allocator, sizeof(cbor_item_t));
   _CBOR_NOTNULL(item);
 
   *item = (cbor_item_t){
@@ -28,14 +73,26 @@ cbor_item_t* cbor_new_definite_map(size_t size) {
       .metadata = {.map_metadata = {.allocated = size,
                                     .type = _CBOR_METADATA_DEFINITE,
                                     .end_ptr = 0}},
-      .data = _cbor_alloc_multiple(sizeof(struct cbor_pair), size)};
-  _CBOR_DEPENDENT_NOTNULL(item, item->data);
+      .data = NULL,
+      .allocator = allocator};
+  size_t storage_size = _cbor_map_storage_size(size);
+  if (storage_size == 0 ||
+      (item->data = _cbor_alloc_with(allocator, storage_size)) == NULL) {
+    _cbor_free_with(allocator, item);
+    return NULL;
+  }
+  _cbor_map_storage(item)->index = NULL;
 
   return item;
 }
 
-cbor_item_t* cbor_new_indefinite_map(void) {
-  cbor_item_t* item = _cbor_malloc(sizeof(cbor_item_t));
+cbor_item_t* cbor_new_definite_map(size_t size) {
+  return cbor_new_definite_map_with(NULL, size);
+}
+
+cbor_item_t* cbor_new_indefinite_map_with(
+    const struct cbor_allocator* allocator) {
+  cbor_item_t* item = _cbor_alloc_with(allocator, sizeof(cbor_item_t));
   _CBOR_NOTNULL(item);
 
   *item = (cbor_item_t){
@@ -44,11 +101,177 @@ cbor_item_t* cbor_new_indefinite_map(void) {
       .metadata = {.map_metadata = {.allocated = 0,
                                     .type = _CBOR_METADATA_INDEFINITE,
                                     .end_ptr = 0}},
-      .data = NULL};
+      .data = NULL,
+      .allocator = allocator};
 
   return item;
 }
 
+cbor_item_t* cbor_new_indefinite_map(void) {
+  return cbor_new_indefinite_map_with(NULL);
+}
+
+static bool _cbor_map_is_indexable_key(const cbor_item_t* key) {
+  switch (cbor_typeof(key)) {
+    case CBOR_TYPE_UINT:
+    case CBOR_TYPE_NEGINT:
+      return true;
+    case CBOR_TYPE_BYTESTRING:
+      return cbor_bytestring_is_definite(key);
+    case CBOR_TYPE_STRING:
+      return cbor_string_is_definite(key);
+    default:
+      return false;
+  }
+}
+
+// FNV-1a
+static uint64_t _cbor_map_hash_bytes(uint64_t hash, const unsigned char* data,
+                                     size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    hash ^= data[i];
+    hash *= 0x100000001B3ULL;
+  }
+  return hash;
+}
+
+static size_t _cbor_map_key_hash(const cbor_item_t* key) {
+  uint64_t hash = 0xCBF29CE484222325ULL ^ (uint64_t)cbor_typeof(key);
+  switch (cbor_typeof(key)) {
+    case CBOR_TYPE_UINT:
+    case CBOR_TYPE_NEGINT: {
+      // Independent of the encoding width and of the host byte order
+      uint64_t value = cbor_get_int(key);
+      unsigned char bytes[8];
+      for (size_t i = 0; i < 8; i++) bytes[i] = (unsigned char)(value >> 8 * i);
+      hash = _cbor_map_hash_bytes(hash, bytes, sizeof(bytes));
+      break;
+    }
+    case CBOR_TYPE_BYTESTRING:
+      hash = _cbor_map_hash_bytes(hash, cbor_bytestring_handle(key),
+                                  cbor_bytestring_length(key));
+      break;
+    case CBOR_TYPE_STRING:
+      hash = _cbor_map_hash_bytes(hash, cbor_string_handle(key),
+                                  cbor_string_length(key));
+      break;
+    default:
+      CBOR_ASSERT(false);
+  }
+  // The slot is taken from the low bits, fold the better mixed high ones in
+  return (size_t)(hash ^ (hash >> 32));
+}
+
+static bool _cbor_map_data_equal(const unsigned char* a, size_t a_length,
+                                 const unsigned char* b, size_t b_length) {
+  return a_length == b_length && (a_length == 0 || memcmp(a, b, a_length) == 0);
+}
+
+// Compare two indexable keys by value. Integers of different widths are
+// equal as long as their values are.
+static bool _cbor_map_keys_equal(const cbor_item_t* a, const cbor_item_t* b) {
+  if (cbor_typeof(a) != cbor_typeof(b)) return false;
+  switch (cbor_typeof(a)) {
+    case CBOR_TYPE_UINT:
+    case CBOR_TYPE_NEGINT:
+      return cbor_get_int(a) == cbor_get_int(b);
+    case CBOR_TYPE_BYTESTRING:
+      return _cbor_map_data_equal(
+          cbor_bytestring_handle(a), cbor_bytestring_length(a),
+          cbor_bytestring_handle(b), cbor_bytestring_length(b));
+    case CBOR_TYPE_STRING:
+      return _cbor_map_data_equal(cbor_string_handle(a), cbor_string_length(a),
+                                  cbor_string_handle(b), cbor_string_length(b));
+    default:
+      return false;
+  }
+}
+
+static struct _cbor_map_index* _cbor_map_index_new(
+    const struct cbor_allocator* allocator, size_t capacity) {
+  if (!_cbor_safe_to_multiply(capacity, sizeof(size_t)) ||
+      !_cbor_safe_to_add(sizeof(struct _cbor_map_index),
+                         capacity * sizeof(size_t))) {
+    return NULL;
+  }
+  struct _cbor_map_index* index = _cbor_alloc_with(
+      allocator, sizeof(struct _cbor_map_index) + capacity * sizeof(size_t));
+  _CBOR_NOTNULL(index);
+  index->capacity = capacity;
+  index->count = 0;
+  memset(index->slots, 0, capacity * sizeof(size_t));
+  return index;
+}
+
+// Find the slot of the key equal to `key`, or the empty slot where it belongs
+static size_t* _cbor_map_index_slot(struct _cbor_map_index* index,
+                                    const struct cbor_pair* pairs,
+                                    const cbor_item_t* key) {
+  size_t mask = index->capacity - 1;
+  for (size_t i = _cbor_map_key_hash(key) & mask;; i = (i + 1) & mask) {
+    size_t* slot = &index->slots[i];
+    if (*slot == 0 || _cbor_map_keys_equal(pairs[*slot - 1].key, key)) {
+      return slot;
+    }
+  }
+}
+
+void _cbor_map_drop_index(cbor_item_t* item) {
+  CBOR_ASSERT(cbor_isa_map(item));
+  if (item->data == NULL) return;
+  _cbor_free_with(item->allocator, _cbor_map_storage(item)->index);
+  _cbor_map_storage(item)->index = NULL;
+}
+
+// Add the key of the pair at `position` to the index, growing it as needed.
+// Keys that cannot be indexed are ignored.
+static bool _cbor_map_index_add(cbor_item_t* item, size_t position) {
+  struct _cbor_map_index* index = _cbor_map_storage(item)->index;
+  const struct cbor_pair* pairs = cbor_map_handle(item);
+  if (!_cbor_map_is_indexable_key(pairs[position].key)) return true;
+
+  // Keep at least half of the slots empty
+  if (2 * (index->count + 1) > index->capacity) {
+    if (!_cbor_safe_to_multiply(2, index->capacity)) return false;
+    struct _cbor_map_index* grown =
+        _cbor_map_index_new(item->allocator, 2 * index->capacity);
+    if (grown == NULL) return false;
+    for (size_t i = 0; i < index->capacity; i++) {
+      if (index->slots[i] == 0) continue;
+      *_cbor_map_index_slot(grown, pairs, pairs[index->slots[i] - 1].key) =
+          index->slots[i];
+    }
+    grown->count = index->count;
+    _cbor_map_drop_index(item);
+    _cbor_map_storage(item)->index = index = grown;
+  }
+
+  size_t* slot = _cbor_map_index_slot(index, pairs, pairs[position].key);
+  if (*slot == 0) {
+    *slot = position + 1;
+    index->count++;
+  }
+  return true;
+}
+
+static bool _cbor_map_build_index(cbor_item_t* item) {
+  size_t capacity = _CBOR_MAP_INDEX_MIN_CAPACITY;
+  while (capacity / 2 < cbor_map_size(item)) {
+    if (!_cbor_safe_to_multiply(2, capacity)) return false;
+    capacity *= 2;
+  }
+  struct _cbor_map_storage* storage = _cbor_map_storage(item);
+  storage->index = _cbor_map_index_new(item->allocator, capacity);
+  if (storage->index == NULL) return false;
+  for (size_t i = 0; i < cbor_map_size(item); i++) {
+    if (!_cbor_map_index_add(item, i)) {
+      _cbor_map_drop_index(item);
+      return false;
+    }
+  }
+  return true;
+}
+
 bool _cbor_map_add_key(cbor_item_t* item, cbor_item_t* key) {
   CBOR_ASSERT(cbor_isa_map(item));
   struct _cbor_map_metadata* metadata =
@@ -74,13 +297,21 @@ bool _cbor_map_add_key(cbor_item_t* item, cbor_item_t* key) {
                                   ? 1
                                   : CBOR_BUFFER_GROWTH * metadata->allocated;
 
-      unsigned char* new_data = _cbor_realloc_multiple(
-          item->data, sizeof(struct cbor_pair), new_allocation);
+      size_t new_size = _cbor_map_storage_size(new_allocation);
+      if (new_size == 0) return false;
+      // The old size cannot overflow, it has been allocated before
+      unsigned char* new_data = _cbor_realloc_with(
+          item->allocator, item->data,
+          item->data == NULL ? 0 : _cbor_map_storage_size(metadata->allocated),
+          new_size);
 
       if (new_data == NULL) {
         return false;
       }
 
+      if (item->data == NULL) {
+        ((struct _cbor_map_storage*)new_data)->index = NULL;
+      }
       item->data = new_data;
       metadata->allocated = new_allocation;
     }
@@ -88,6 +319,11 @@ bool _cbor_map_add_key(cbor_item_t* item, cbor_item_t* key) {
     data[metadata->end_ptr].key = key;
     data[metadata->end_ptr++].value = NULL;
   }
+  if (_cbor_map_storage(item)->index != NULL &&
+      !_cbor_map_index_add(item, metadata->end_ptr - 1)) {
+    // The index will be rebuilt by the next lookup
+    _cbor_map_drop_index(item);
+  }
   cbor_incref(key);
   return true;
 }
@@ -121,7 +357,8 @@ bool cbor_map_is_indefinite(const cbor_item_t* item) {
 
 struct cbor_pair* cbor_map_handle(const cbor_item_t* item) {
   CBOR_ASSERT(cbor_isa_map(item));
-  return (struct cbor_pair*)item->data;
+  if (item->data == NULL) return NULL;
+  return _cbor_map_storage(item)->pairs;
 }
 
 cbor_item_t* cbor_map_get(const cbor_item_t* map, const cbor_item_t* key,
@@ -137,3 +374,24 @@ cbor_item_t* cbor_map_get(const cbor_item_t* map, const cbor_item_t* key,
   }
   return NULL;
 }
+
+cbor_item_t* cbor_map_get_indexed(cbor_item_t* map, const cbor_item_t* key) {
+  CBOR_ASSERT(cbor_isa_map(map));
+  CBOR_ASSERT(key != NULL);
+  if (!_cbor_map_is_indexable_key(key) || cbor_map_size(map) == 0) return NULL;
+  struct cbor_pair* pairs = cbor_map_handle(map);
+  if (_cbor_map_storage(map)->index == NULL && !_cbor_map_build_index(map)) {
+    // Out of memory, fall back to a linear scan
+    for (size_t i = 0; i < cbor_map_size(map); i++) {
+      if (_cbor_map_is_indexable_key(pairs[i].key) &&
+          _cbor_map_keys_equal(pairs[i].key, key)) {
+        return pairs[i].value == NULL ? NULL : cbor_incref(pairs[i].value);
+      }
+    }
+    return NULL;
+  }
+  struct _cbor_map_index* index = _cbor_map_storage(map)->index;
+  size_t slot = *_cbor_map_index_slot(index, pairs, key);
+  if (slot == 0 || pairs[slot - 1].value == NULL) return NULL;
+  return cbor_incref(pairs[slot - 1].value);
+}
@@ -44,6 +44,18 @@ _CBOR_NODISCARD CBOR_EXPORT size_t cbor_map_allocated(const cbor_item_t* item);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_definite_map(size_t size);
 
+/** Like #cbor_new_definite_map, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @param size The number of slots to preallocate
+ * @return Reference to the new map item. The item's reference count is
+ * initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_definite_map_with(
+    const struct cbor_allocator* allocator, size_t size);
+
 /** Create a new indefinite map
  *
  * @return Reference to the new map item. The item's reference count is
@@ -52,6 +64,17 @@ _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_definite_map(size_t size);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_indefinite_map(void);
 
+/** Like #cbor_new_indefinite_map, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @return Reference to the new map item. The item's reference count is
+ * initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_indefinite_map_with(
+    const struct cbor_allocator* allocator);
+
 /** Add a pair to the map
  *
  * For definite maps, items can only be added to the preallocated space. For
@@ -90,6 +113,14 @@ _CBOR_NODISCARD CBOR_EXPORT bool _cbor_map_add_key(cbor_item_t* item,
 _CBOR_NODISCARD CBOR_EXPORT bool _cbor_map_add_value(cbor_item_t* item,
                                                      cbor_item_t* value);
 
+/** Free the key index of the map, if it has been built
+ *
+ * Internal API, used when the map is freed.
+ *
+ * @param item A map
+ */
+void _cbor_map_drop_index(cbor_item_t* item);
+
 /** Is this map definite?
  *
  * @param item A map
@@ -154,6 +185,46 @@ _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_map_get(
     const cbor_item_t* map, const cbor_item_t* key,
     bool (*eq)(const cbor_item_t*, const cbor_item_t*));
 
+/** Look up a value in a map by an integer or a string key using a hash index
+ *
+ * The first call builds a hash index of the keys, which is then kept up to
+ * date by #cbor_map_add and freed together with the map. Subsequent lookups
+ * take expected constant time, which makes repeated lookups in large maps
+ * much cheaper than with #cbor_map_get.
+ *
+ * Keys are compared by value: integers (#CBOR_TYPE_UINT and
+ * #CBOR_TYPE_NEGINT) regardless of their encoding width, definite strings
+ * and byte strings by their content. Pairs with keys of any other type,
+ * including indefinite strings, are not indexed and are never returned.
+ *
+ * The index refers to keys by their position. Keys must not be replaced or
+ * modified via #cbor_map_handle once the index has been built.
+ *
+ * Building the index modifies the map. When sharing the map between threads
+ * (see `CBOR_ATOMIC_REFCOUNT`), call this function once before sharing it.
+ *
+ * \rst
+ * .. code-block:: c
+ *
+ *    cbor_item_t *key = cbor_build_string("alg");
+ *    cbor_item_t *value = cbor_map_get_indexed(map, key);
+ *    if (value != NULL) {
+ *        // use value ...
+ *        cbor_decref(&value);
+ *    }
+ *    cbor_decref(&key);
+ * \endrst
+ *
+ * @param map A map item; must not be `NULL`
+ * @param key The key to search for; must not be `NULL`
+ * @return The first matching value with its reference count incremented by
+ *         one, or `NULL` if no key matched or \p key is neither an integer
+ *         nor a definite string or byte string. The caller is responsible for
+ *         releasing the returned item with #cbor_decref.
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_map_get_indexed(
+    cbor_item_t* map, const cbor_item_t* key);
+
 #ifdef __cplusplus
 }
 #endif
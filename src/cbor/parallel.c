@@ -0,0 +1,431 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include "parallel.h"
+
+#include <string.h>
+
+#include "cbor.h"
+#include "internal/memory_utils.h"
+#include "internal/threads.h"
+
+/* Tasks per thread. More, smaller tasks balance items of uneven size. */
+#define _CBOR_TASKS_PER_THREAD 8
+
+/** Items found by a boundary scan */
+struct _cbor_item_ranges {
+  /** Item `i` spans `[offsets[i], offsets[i + 1])` */
+  size_t* offsets;
+  size_t count;
+};
+
+/* Find the boundaries of up to `max_items` consecutive items in `source`,
+ * starting at `offset`. On a malformed or truncated item, `*error_offset` is
+ * set to its start. */
+static bool _cbor_scan_items(cbor_data source, size_t source_size,
+                             size_t offset, size_t max_items,
+                             struct _cbor_item_ranges* ranges,
+                             size_t* error_offset) {
+  size_t capacity = 16;
+  ranges->offsets = _cbor_alloc_multiple(sizeof(size_t), capacity);
+  ranges->count = 0;
+  *error_offset = SIZE_MAX;
+  if (ranges->offsets == NULL) return false;
+  ranges->offsets[0] = offset;
+  while (offset < source_size && ranges->count < max_items) {
+    size_t length;
+    if (cbor_skip_item(source + offset, source_size - offset, &length) !=
+        CBOR_DECODER_FINISHED) {
+      *error_offset = offset;
+      return false;
+    }
+    if (ranges->count + 2 > capacity) {
+      size_t* grown = _cbor_realloc_multiple(
+          ranges->offsets, sizeof(size_t), CBOR_BUFFER_GROWTH * capacity);
+      if (grown == NULL) return false;
+      ranges->offsets = grown;
+      capacity *= CBOR_BUFFER_GROWTH;
+    }
+    offset += length;
+    ranges->offsets[++ranges->count] = offset;
+  }
+  return true;
+}
+
+struct _cbor_load_job {
+  cbor_data source;
+  const struct _cbor_item_ranges* ranges;
+  size_t task_count;
+  /** Decoded items, `ranges->count` slots */
+  cbor_item_t** items;
+  /** Index of the first item that failed to decode in each task, or
+   * `ranges->count` */
+  size_t* failed;
+  /** The error of that item, relative to the start of the item */
+  struct cbor_load_result* errors;
+};
+
+static void _cbor_load_task(void* context, size_t task) {
+  struct _cbor_load_job* job = context;
+  size_t begin = job->ranges->count * task / job->task_count;
+  size_t end = job->ranges->count * (task + 1) / job->task_count;
+  job->failed[task] = job->ranges->count;
+  for (size_t i = begin; i < end; i++) {
+    size_t offset = job->ranges->offsets[i];
+    job->items[i] =
+        cbor_load(job->source + offset, job->ranges->offsets[i + 1] - offset,
+                  &job->errors[task]);
+    if (job->items[i] == NULL) {
+      job->failed[task] = i;
+      return;
+    }
+  }
+}
+
+/* Decode the items into `items`. On failure, `result` is set to the error of
+ * the first failing item and the items that were decoded are released. */
+static bool _cbor_load_items_parallel(cbor_data source,
+                                      const struct _cbor_item_ranges* ranges,
+                                      size_t threads, cbor_item_t** items,
+                                      struct cbor_load_result* result) {
+  size_t task_count = _cbor_thread_count(threads);
+  if (_cbor_safe_to_multiply(task_count, _CBOR_TASKS_PER_THREAD)) {
+    task_count *= _CBOR_TASKS_PER_THREAD;
+  }
+  if (task_count > ranges->count) task_count = ranges->count;
+  if (task_count == 0) return true;
+
+  struct _cbor_load_job job = {
+      .source = source,
+      .ranges = ranges,
+      .task_count = task_count,
+      .items = items,
+      .failed = _cbor_alloc_multiple(sizeof(size_t), task_count),
+      .errors =
+          _cbor_alloc_multiple(sizeof(struct cbor_load_result), task_count)};
+  if (job.failed == NULL || job.errors == NULL) {
+    _cbor_free(job.failed);
+    _cbor_free(job.errors);
+    result->error.code = CBOR_ERR_MEMERROR;
+    return false;
+  }
+  _cbor_parallel_for(threads, task_count, _cbor_load_task, &job);
+
+  // Tasks cover consecutive ranges, so the first failure is in the first task
+  // that failed
+  bool success = true;
+  for (size_t task = 0; task < task_count && success; task++) {
+    size_t failed = job.failed[task];
+    if (failed == ranges->count) continue;
+    *result = job.errors[task];
+    result->error.position += ranges->offsets[failed];
+    success = false;
+  }
+  if (!success) {
+    // Each task has set the slots up to its failure
+    for (size_t task = 0; task < task_count; task++) {
+      size_t begin = ranges->count * task / task_count;
+      size_t end = job.failed[task] < ranges->count
+                       ? job.failed[task]
+                       : ranges->count * (task + 1) / task_count;
+      for (size_t i = begin; i < end; i++) cbor_decref(&items[i]);
+    }
+  }
+  _cbor_free(job.failed);
+  _cbor_free(job.errors);
+  return success;
+}
+
+cbor_item_t* cbor_load_sequence_parallel(cbor_data source, size_t source_size,
+                                         size_t threads,
+                                         struct cbor_load_result* result) {
+  *result = (struct cbor_load_result){.error = {.code = CBOR_ERR_NONE}};
+  struct _cbor_item_ranges ranges;
+  size_t error_offset;
+  if (!_cbor_scan_items(source, source_size, 0, SIZE_MAX, &ranges,
+                        &error_offset)) {
+    _cbor_free(ranges.offsets);
+    if (error_offset == SIZE_MAX) {
+      result->error.code = CBOR_ERR_MEMERROR;
+      return NULL;
+    }
+    // Let the decoder describe the problem
+    cbor_item_t* item = cbor_load(source + error_offset,
+                                  source_size - error_offset, result);
+    if (item != NULL) {
+      // Decodable, but beyond the limits of the scan
+      cbor_decref(&item);
+      result->error.code = CBOR_ERR_SYNTAXERROR;
+      result->error.position = 0;
+    }
+    result->error.position += error_offset;
+    return NULL;
+  }
+
+  cbor_item_t* sequence = cbor_new_definite_array(ranges.count);
+  if (sequence == NULL) {
+    _cbor_free(ranges.offsets);
+    result->error.code = CBOR_ERR_MEMERROR;
+    return NULL;
+  }
+  bool success = _cbor_load_items_parallel(
+      source, &ranges, threads, cbor_array_handle(sequence), result);
+  _cbor_free(ranges.offsets);
+  if (!success) {
+    cbor_decref(&sequence);
+    return NULL;
+  }
+  sequence->metadata.array_metadata.end_ptr = ranges.count;
+  result->read = source_size;
+  return sequence;
+}
+
+struct _cbor_container_header {
+  cbor_type type;
+  uint64_t size;
+};
+
+static void _cbor_header_array(void* context, uint64_t size) {
+  *(struct _cbor_container_header*)context =
+      (struct _cbor_container_header){.type = CBOR_TYPE_ARRAY, .size = size};
+}
+
+static void _cbor_header_map(void* context, uint64_t size) {
+  *(struct _cbor_container_header*)context =
+      (struct _cbor_container_header){.type = CBOR_TYPE_MAP, .size = size};
+}
+
+/* Decode the elements of a definite array or map that starts at the beginning
+ * of `source` and whose header is `header_size` bytes long. Returns `NULL`
+ * if the elements cannot be split, the caller then falls back to #cbor_load.
+ */
+static cbor_item_t* _cbor_load_container_parallel(
+    cbor_data source, size_t source_size, size_t threads,
+    const struct _cbor_container_header* header, size_t header_size,
+    struct cbor_load_result* result) {
+  size_t count;
+  if (header->type == CBOR_TYPE_ARRAY) {
+    count = header->size;
+  } else if (_cbor_safe_to_multiply(2, header->size)) {
+    count = 2 * header->size;
+  } else {
+    return NULL;
+  }
+  // Malformed or truncated elements are reported by the fallback
+  struct _cbor_item_ranges ranges;
+  size_t error_offset;
+  if (!_cbor_scan_items(source, source_size, header_size, count, &ranges,
+                        &error_offset) ||
+      ranges.count < count) {
+    _cbor_free(ranges.offsets);
+    return NULL;
+  }
+
+  cbor_item_t* container = header->type == CBOR_TYPE_ARRAY
+                               ? cbor_new_definite_array(header->size)
+                               : cbor_new_definite_map(header->size);
+  // Map elements are decoded into a flat array of keys and values first
+  cbor_item_t** elements =
+      header->type == CBOR_TYPE_ARRAY
+          ? (container ? cbor_array_handle(container) : NULL)
+          : _cbor_alloc_multiple(sizeof(cbor_item_t*), count);
+  if (container == NULL || elements == NULL) {
+    if (container != NULL) cbor_decref(&container);
+    if (header->type == CBOR_TYPE_MAP) _cbor_free(elements);
+    _cbor_free(ranges.offsets);
+    result->error.code = CBOR_ERR_MEMERROR;
+    return NULL;
+  }
+  bool success =
+      _cbor_load_items_parallel(source, &ranges, threads, elements, result);
+  size_t read = ranges.offsets[count];
+  _cbor_free(ranges.offsets);
+  if (success) {
+    result->read = read;
+    if (header->type == CBOR_TYPE_ARRAY) {
+      container->metadata.array_metadata.end_ptr = count;
+    } else {
+      struct cbor_pair* pairs = cbor_map_handle(container);
+      for (size_t i = 0; i < header->size; i++) {
+        pairs[i] = (struct cbor_pair){.key = elements[2 * i],
+                                      .value = elements[2 * i + 1]};
+      }
+      container->metadata.map_metadata.end_ptr = header->size;
+    }
+  } else {
+    cbor_decref(&container);
+  }
+  if (header->type == CBOR_TYPE_MAP) _cbor_free(elements);
+  return container;
+}
+
+cbor_item_t* cbor_load_parallel(cbor_data source, size_t source_size,
+                                size_t threads,
+                                struct cbor_load_result* result) {
+  if (_cbor_thread_count(threads) > 1) {
+    struct cbor_callbacks callbacks = cbor_empty_callbacks;
+    callbacks.array_start = _cbor_header_array;
+    callbacks.map_start = _cbor_header_map;
+    struct _cbor_container_header header = {.type = CBOR_TYPE_UINT};
+    struct cbor_decoder_result decode_result =
+        cbor_stream_decode(source, source_size, &callbacks, &header);
+    // Splitting a container with a single element gains nothing
+    if (decode_result.status == CBOR_DECODER_FINISHED &&
+        header.type != CBOR_TYPE_UINT && header.size > 1) {
+      *result = (struct cbor_load_result){.error = {.code = CBOR_ERR_NONE}};
+      cbor_item_t* item =
+          _cbor_load_container_parallel(source, source_size, threads, &header,
+                                        decode_result.read, result);
+      if (item != NULL || result->error.code != CBOR_ERR_NONE) return item;
+    }
+  }
+  return cbor_load(source, source_size, result);
+}
+
+/** Elements of a container to serialize, map pairs are flattened into keys and
+ * values */
+struct _cbor_serialize_job {
+  const cbor_item_t* container;
+  size_t element_count;
+  size_t task_count;
+  /** Serialized size of the elements of each task, `SIZE_MAX` if it overflows.
+   * Becomes the offset of the task in `buffer` after the size pass. */
+  size_t* task_sizes;
+  unsigned char* buffer;
+};
+
+static const cbor_item_t* _cbor_element(const cbor_item_t* container,
+                                        size_t index) {
+  if (cbor_isa_array(container)) return cbor_array_handle(container)[index];
+  struct cbor_pair* pair = &cbor_map_handle(container)[index / 2];
+  return index % 2 == 0 ? pair->key : pair->value;
+}
+
+static size_t _cbor_task_begin(const struct _cbor_serialize_job* job,
+                               size_t task) {
+  return job->element_count * task / job->task_count;
+}
+
+static void _cbor_size_task(void* context, size_t task) {
+  struct _cbor_serialize_job* job = context;
+  size_t size = 0;
+  for (size_t i = _cbor_task_begin(job, task);
+       i < _cbor_task_begin(job, task + 1); i++) {
+    size_t element_size =
+        cbor_serialized_size(_cbor_element(job->container, i));
+    if (element_size == 0 || !_cbor_safe_to_add(size, element_size)) {
+      size = SIZE_MAX;
+      break;
+    }
+    size += element_size;
+  }
+  job->task_sizes[task] = size;
+}
+
+static void _cbor_serialize_task(void* context, size_t task) {
+  struct _cbor_serialize_job* job = context;
+  size_t offset = job->task_sizes[task];
+  size_t end = job->task_sizes[task + 1];
+  for (size_t i = _cbor_task_begin(job, task);
+       i < _cbor_task_begin(job, task + 1); i++) {
+    size_t written = cbor_serialize(_cbor_element(job->container, i),
+                                    job->buffer + offset, end - offset);
+    CBOR_ASSERT(written > 0);
+    offset += written;
+  }
+  CBOR_ASSERT(offset == end);
+}
+
+/* Serialize a definite or indefinite array or map with the elements split
+ * between the threads. Returns false if the container is too large to be
+ * serialized or on memory allocation failure. */
+static bool _cbor_serialize_container_parallel(const cbor_item_t* item,
+                                               size_t threads,
+                                               unsigned char** buffer,
+                                               size_t* buffer_size) {
+  struct _cbor_serialize_job job = {.container = item};
+  bool definite;
+  unsigned char header[9];
+  size_t header_size;
+  if (cbor_isa_array(item)) {
+    job.element_count = cbor_array_size(item);
+    definite = cbor_array_is_definite(item);
+    header_size = definite ? cbor_encode_array_start(job.element_count, header,
+                                                     sizeof(header))
+                           : cbor_encode_indef_array_start(header,
+                                                           sizeof(header));
+  } else {
+    job.element_count = 2 * cbor_map_size(item);
+    definite = cbor_map_is_definite(item);
+    header_size = definite ? cbor_encode_map_start(cbor_map_size(item), header,
+                                                   sizeof(header))
+                           : cbor_encode_indef_map_start(header,
+                                                         sizeof(header));
+  }
+
+  job.task_count = _cbor_thread_count(threads);
+  if (_cbor_safe_to_multiply(job.task_count, _CBOR_TASKS_PER_THREAD)) {
+    job.task_count *= _CBOR_TASKS_PER_THREAD;
+  }
+  if (job.task_count > job.element_count) job.task_count = job.element_count;
+  // One extra slot for the end of the last task
+  job.task_sizes = _cbor_alloc_multiple(sizeof(size_t), job.task_count + 1);
+  if (job.task_sizes == NULL) return false;
+  _cbor_parallel_for(threads, job.task_count, _cbor_size_task, &job);
+
+  // Turn the sizes into offsets. The header is not empty, so an overflowing
+  // task makes the sum overflow as well.
+  size_t offset = header_size;
+  bool overflow = false;
+  for (size_t task = 0; task < job.task_count && !overflow; task++) {
+    size_t task_size = job.task_sizes[task];
+    job.task_sizes[task] = offset;
+    overflow = !_cbor_safe_to_add(offset, task_size);
+    offset += task_size;
+  }
+  job.task_sizes[job.task_count] = offset;
+  size_t size = offset + (definite ? 0 : 1);
+  if (overflow || size < offset) {
+    _cbor_free(job.task_sizes);
+    return false;
+  }
+
+  job.buffer = _cbor_malloc(size);
+  if (job.buffer == NULL) {
+    _cbor_free(job.task_sizes);
+    return false;
+  }
+  memcpy(job.buffer, header, header_size);
+  _cbor_parallel_for(threads, job.task_count, _cbor_serialize_task, &job);
+  if (!definite) job.buffer[size - 1] = 0xFF;
+  _cbor_free(job.task_sizes);
+  *buffer = job.buffer;
+  *buffer_size = size;
+  return true;
+}
+
+size_t cbor_serialize_alloc_parallel(const cbor_item_t* item, size_t threads,
+                                     unsigned char** buffer,
+                                     size_t* buffer_size) {
+  if ((cbor_isa_array(item) || cbor_isa_map(item)) &&
+      _cbor_thread_count(threads) > 1) {
+    size_t size = cbor_isa_array(item) ? cbor_array_size(item)
+                                       : cbor_map_size(item);
+    // Splitting a container with a single element gains nothing
+    if (size > 1) {
+      size_t serialized_size;
+      if (!_cbor_serialize_container_parallel(item, threads, buffer,
+                                              &serialized_size)) {
+        *buffer = NULL;
+        serialized_size = 0;
+      }
+      if (buffer_size != NULL) *buffer_size = serialized_size;
+      return serialized_size;
+    }
+  }
+  return cbor_serialize_alloc(item, buffer, buffer_size);
+}
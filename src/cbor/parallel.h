@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#ifndef LIBCBOR_PARALLEL_H
+#define LIBCBOR_PARALLEL_H
+
+#include "cbor/cbor_export.h"
+#include "cbor/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * ============================================================================
+ * Multi-threaded decoding and serialization
+ * ============================================================================
+ */
+
+/** Loads all items of a CBOR sequence (RFC 8742) using several threads
+ *
+ * The item boundaries are found first by a sequential scan with
+ * #cbor_skip_item, which does not allocate and is much faster than decoding.
+ * The items are then decoded with #cbor_load by up to \p threads threads,
+ * including the calling one.
+ *
+ * The memory allocation routines set by #cbor_set_allocs are called from
+ * all the threads and must be thread-safe. The standard ones are.
+ *
+ * When *libcbor* is built without `CBOR_PARALLEL`, all items are decoded on
+ * the calling thread.
+ *
+ * @param source The buffer
+ * @param source_size
+ * @param threads Maximum number of threads, 0 for one per online CPU
+ * @param[out] result Result indicator. #CBOR_ERR_NONE on success
+ * @return A definite array of the decoded items, in order. An empty
+ * \p source is an empty sequence. The array's reference count is initialized
+ * to one.
+ * @return `NULL` on failure. In that case, \p result contains the error of
+ * the first item that failed to decode, with the position relative to the
+ * start of \p source.
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_load_sequence_parallel(
+    cbor_data source, size_t source_size, size_t threads,
+    struct cbor_load_result* result);
+
+/** Loads a data item from a buffer, decoding the elements of a large
+ * top-level array or map on several threads
+ *
+ * Behaves like #cbor_load. If the item is a definite array or map, the
+ * boundaries of its elements are found first by a sequential scan with
+ * #cbor_skip_item. The elements are then decoded with #cbor_load by up to
+ * \p threads threads, including the calling one, directly into the storage
+ * of the container. Any other item, and a container that is malformed, is
+ * decoded by #cbor_load on the calling thread.
+ *
+ * This pays off for documents like a large array of independent records.
+ * Nested containers are not split. The nesting limit of `CBOR_MAX_STACK_SIZE`
+ * applies to each element separately.
+ *
+ * The memory allocation routines set by #cbor_set_allocs must be
+ * thread-safe, see #cbor_load_sequence_parallel.
+ *
+ * @param source The buffer
+ * @param source_size
+ * @param threads Maximum number of threads, 0 for one per online CPU
+ * @param[out] result Result indicator. #CBOR_ERR_NONE on success
+ * @return Decoded CBOR item. The item's reference count is initialized to one.
+ * @return `NULL` on failure. In that case, \p result contains the location and
+ * description of the error.
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_load_parallel(
+    cbor_data source, size_t source_size, size_t threads,
+    struct cbor_load_result* result);
+
+/** Serialize an item, allocating the buffer, using several threads for the
+ * elements of a large top-level array or map
+ *
+ * Produces the same output as #cbor_serialize_alloc. If \p item is an array
+ * or a map, its elements are split into consecutive ranges. The serialized
+ * size of each range is computed by up to \p threads threads, including the
+ * calling one, and the sizes are summed into the offsets of the ranges in the
+ * output. The threads then serialize the ranges into their disjoint parts of
+ * the buffer. Any other item is serialized on the calling thread.
+ *
+ * The item must not be modified while it is being serialized. Serialization
+ * only reads the items, so elements may share subtrees.
+ *
+ * \rst
+ * .. warning::
+ *   It is the caller's responsibility to free the buffer using an appropriate
+ *   ``free`` implementation.
+ * \endrst
+ *
+ * @param item A data item
+ * @param threads Maximum number of threads, 0 for one per online CPU
+ * @param[out] buffer Buffer containing the result
+ * @param[out] buffer_size Size of the \p buffer, or 0 on failure
+ * @return Length of the result in bytes
+ * @return 0 on memory allocation failure or if the length overflows `size_t`,
+ * in which case \p buffer is `NULL`.
+ */
+CBOR_EXPORT size_t cbor_serialize_alloc_parallel(const cbor_item_t* item,
+                                                 size_t threads,
+                                                 unsigned char** buffer,
+                                                 size_t* buffer_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // LIBCBOR_PARALLEL_H
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include "parser.h"
+
+#include <string.h>
+
+#include "internal/builder_callbacks.h"
+#include "internal/memory_utils.h"
+#include "internal/stack.h"
+#include "streaming.h"
+
+void cbor_parser_init(cbor_parser_t* parser) {
+  *parser = (cbor_parser_t){.stack = NULL,
+                            .stack_size = 0,
+                            .stack_capacity = 0,
+                            .pending = NULL,
+                            .pending_length = 0,
+                            .pending_capacity = 0,
+                            .read = 0};
+}
+
+// Append `length` bytes to the pending item, which is `required` bytes long
+// once complete. The buffer only grows with the received data, so that a
+// forged length cannot make the parser allocate ahead of it.
+static bool _cbor_parser_buffer(cbor_parser_t* parser, cbor_data data,
+                                size_t length, size_t required) {
+  size_t needed = parser->pending_length + length;
+  if (needed > parser->pending_capacity) {
+    size_t capacity = CBOR_BUFFER_GROWTH * parser->pending_capacity;
+    if (capacity > required) capacity = required;
+    if (capacity < needed) capacity = needed;
+    unsigned char* pending = _cbor_realloc(parser->pending, capacity);
+    if (pending == NULL) return false;
+    parser->pending = pending;
+    parser->pending_capacity = capacity;
+  }
+  memcpy(parser->pending + parser->pending_length, data, length);
+  parser->pending_length = needed;
+  return true;
+}
+
+// The builder stack kept between the calls
+static struct _cbor_stack _cbor_parser_stack(const cbor_parser_t* parser) {
+  return (struct _cbor_stack){
+      .top = parser->stack_size > 0 ? parser->stack + parser->stack_size - 1
+                                    : NULL,
+      .size = parser->stack_size,
+      .records = parser->stack,
+      .capacity = parser->stack_capacity};
+}
+
+// Drop the partially built item
+static void _cbor_parser_reset(cbor_parser_t* parser,
+                               struct _cbor_stack* stack) {
+  while (stack->size > 0) {
+    cbor_decref(&stack->top->item);
+    _cbor_stack_pop(stack);
+  }
+  parser->pending_length = 0;
+  parser->read = 0;
+}
+
+cbor_item_t* cbor_parser_feed(cbor_parser_t* parser, cbor_data chunk,
+                              size_t chunk_size,
+                              struct cbor_load_result* result) {
+  struct _cbor_stack stack = _cbor_parser_stack(parser);
+  struct _cbor_decoder_context context = {.stack = &stack,
+                                          .creation_failed = false,
+                                          .syntax_error = false,
+                                          .root = NULL,
+                                          .allocator = NULL,
+                                          .borrow_strings = false,
+                                          .validate_strings = false,
+                                          .invalid_string = false};
+  *result =
+      (struct cbor_load_result){.read = 0, .error = {.code = CBOR_ERR_NONE}};
+  cbor_item_t* root = NULL;
+
+  while (root == NULL && result->error.code == CBOR_ERR_NONE) {
+    // A pending item is completed from the chunk first
+    bool from_pending = parser->pending_length > 0;
+    cbor_data source = from_pending ? parser->pending : chunk + result->read;
+    size_t source_size =
+        from_pending ? parser->pending_length : chunk_size - result->read;
+    if (source_size == 0) {
+      result->error.code = CBOR_ERR_NOTENOUGHDATA;
+      break;
+    }
+    struct cbor_decoder_result decode_result = cbor_stream_decode(
+        source, source_size, &_cbor_builder_callbacks, &context);
+
+    switch (decode_result.status) {
+      case CBOR_DECODER_FINISHED:
+        if (from_pending) {
+          CBOR_ASSERT(decode_result.read == parser->pending_length);
+          parser->pending_length = 0;
+        } else {
+          result->read += decode_result.read;
+        }
+        if (context.creation_failed) {
+          result->error.code = CBOR_ERR_MEMERROR;
+        } else if (context.syntax_error) {
+          result->error.code = CBOR_ERR_SYNTAXERROR;
+        } else if (context.invalid_string) {
+          result->error.code = CBOR_ERR_INVALID_UTF8;
+        } else if (stack.size == 0) {
+          root = context.root;
+          parser->read = 0;
+        } else {
+          parser->read += decode_result.read;
+        }
+        break;
+      case CBOR_DECODER_NEDATA: {
+        // Keep at most the rest of the item, the next item starts afterwards
+        size_t length = decode_result.required - parser->pending_length;
+        if (length > chunk_size - result->read) {
+          length = chunk_size - result->read;
+        }
+        if (length == 0) {
+          result->error.code = CBOR_ERR_NOTENOUGHDATA;
+        } else if (!_cbor_parser_buffer(parser, chunk + result->read, length,
+                                        decode_result.required)) {
+          result->error.code = CBOR_ERR_MEMERROR;
+        } else {
+          result->read += length;
+        }
+        break;
+      }
+      case CBOR_DECODER_ERROR:
+        result->error.code = CBOR_ERR_MALFORMATED;
+        break;
+    }
+  }
+
+  if (root == NULL && result->error.code != CBOR_ERR_NOTENOUGHDATA) {
+    result->error.position = parser->read;
+    _cbor_parser_reset(parser, &stack);
+  }
+  parser->stack = stack.records;
+  parser->stack_size = stack.size;
+  parser->stack_capacity = stack.capacity;
+  return root;
+}
+
+void cbor_parser_release(cbor_parser_t* parser) {
+  struct _cbor_stack stack = _cbor_parser_stack(parser);
+  _cbor_parser_reset(parser, &stack);
+  _cbor_stack_release(&stack);
+  _cbor_free(parser->pending);
+  cbor_parser_init(parser);
+}
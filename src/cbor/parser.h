@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#ifndef LIBCBOR_PARSER_H
+#define LIBCBOR_PARSER_H
+
+#include "cbor/cbor_export.h"
+#include "cbor/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * ============================================================================
+ * Incremental decoding
+ * ============================================================================
+ */
+
+struct _cbor_stack_record;
+
+/** State of an item that is received in several chunks
+ *
+ * #cbor_load needs the whole item in one buffer. A parser accepts the input
+ * in chunks of any size, e.g. as it arrives from a socket, and builds the item
+ * as it goes. Each byte is decoded once, regardless of how the input is split.
+ *
+ * A parser is not thread-safe. All members are private.
+ */
+typedef struct cbor_parser {
+  /** Builder stack storage, `stack_size` out of `stack_capacity` records */
+  struct _cbor_stack_record* stack;
+  size_t stack_size;
+  size_t stack_capacity;
+  /** Start of an item that has not been received completely */
+  unsigned char* pending;
+  size_t pending_length;
+  size_t pending_capacity;
+  /** Bytes of the current root item decoded so far */
+  size_t read;
+} cbor_parser_t;
+
+/** Initialize a parser
+ *
+ * No memory is allocated until the first chunk is fed.
+ *
+ * @param parser The parser to initialize
+ */
+CBOR_EXPORT void cbor_parser_init(cbor_parser_t* parser);
+
+/** Decode the next chunk of the input
+ *
+ * Consumes bytes from \p chunk until the root item is complete or the chunk
+ * runs out. Items whose header or definite-length string payload is split
+ * between chunks are buffered by the parser until they are complete. Strings
+ * are always copied, the chunk can be reused as soon as the call returns.
+ *
+ * Once an item is returned, the parser is ready for the next one. Any bytes
+ * after the item are not consumed and should be fed again, which makes it
+ * possible to decode CBOR sequences (RFC 8742) the same way.
+ *
+ * \rst
+ * .. code-block:: c
+ *
+ *    cbor_parser_t parser;
+ *    cbor_parser_init(&parser);
+ *    while ((length = recv(socket, chunk, sizeof(chunk), 0)) > 0) {
+ *      size_t offset = 0;
+ *      do {
+ *        struct cbor_load_result result;
+ *        cbor_item_t* item = cbor_parser_feed(&parser, chunk + offset,
+ *                                             length - offset, &result);
+ *        offset += result.read;
+ *        if (item != NULL) process(item);
+ *        else if (result.error.code != CBOR_ERR_NOTENOUGHDATA) fail();
+ *      } while (offset < length);
+ *    }
+ *    cbor_parser_release(&parser);
+ * \endrst
+ *
+ * @param parser An initialized parser
+ * @param chunk The next bytes of the input
+ * @param chunk_size
+ * @param[out] result Result indicator. `result.read` is the number of bytes
+ * of \p chunk consumed. #CBOR_ERR_NOTENOUGHDATA means that the whole chunk
+ * was consumed and more input is needed.
+ * @return The decoded root item. Its reference count is initialized to one.
+ * @return `NULL` if the item is incomplete or on failure. After a failure,
+ * `result.error.position` is the offset of the offending item from the start
+ * of the root item, and the parser is reset.
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_parser_feed(
+    cbor_parser_t* parser, cbor_data chunk, size_t chunk_size,
+    struct cbor_load_result* result);
+
+/** Discard an incomplete item and release the memory held by a parser
+ *
+ * The parser can be reused afterwards as if it was freshly initialized.
+ *
+ * @param parser An initialized parser
+ */
+CBOR_EXPORT void cbor_parser_release(cbor_parser_t* parser);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // LIBCBOR_PARSER_H
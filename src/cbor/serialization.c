@@ -17,6 +17,14 @@
 #include "encoding.h"
 #include "internal/memory_utils.h"
 
+/* The tagged item, without the reference #cbor_tag_item takes. Serialization
+ * does not write to the items, so that several threads can serialize a shared
+ * tree (see #cbor_serialize_alloc_parallel). */
+static cbor_item_t* _cbor_tagged_item(const cbor_item_t* item) {
+  CBOR_ASSERT(cbor_isa_tag(item));
+  return item->metadata.tag_metadata.tagged_item;
+}
+
 size_t cbor_serialize(const cbor_item_t* item, unsigned char* buffer,
                       size_t buffer_size) {
   CBOR_ASSERT_VALID_TYPE(cbor_typeof(item));
@@ -141,11 +149,11 @@ size_t cbor_serialized_size(const cbor_item_t* item) {
       return map_size;
     }
     case CBOR_TYPE_TAG: {
-      cbor_item_t* tagged = cbor_tag_item(item);
+      cbor_item_t* tagged = _cbor_tagged_item(item);
       if (tagged == NULL) return 0;
       return _cbor_safe_signaling_add(
           _cbor_encoded_header_size(cbor_tag_value(item)),
-          cbor_serialized_size(cbor_move(tagged)));
+          cbor_serialized_size(tagged));
     }
     case CBOR_TYPE_FLOAT_CTRL:
       CBOR_ASSERT(cbor_float_get_width(item) >= CBOR_FLOAT_0 &&
@@ -169,24 +177,635 @@ size_t cbor_serialized_size(const cbor_item_t* item) {
   }
 }
 
+struct _cbor_size_cache_entry {
+  /** `NULL` marks an empty slot */
+  const cbor_item_t* item;
+  size_t size;
+};
+
+#define _CBOR_SIZE_CACHE_MIN_CAPACITY 64
+
+void cbor_size_cache_init(cbor_size_cache* cache) {
+  *cache = (cbor_size_cache){.entries = NULL, .capacity = 0, .count = 0};
+}
+
+void cbor_size_cache_release(cbor_size_cache* cache) {
+  _cbor_free(cache->entries);
+  cbor_size_cache_init(cache);
+}
+
+static size_t _cbor_size_cache_hash(const cbor_item_t* item) {
+  // Items are at least pointer-aligned, drop the bits that are always zero
+  uint64_t hash = (uint64_t)((uintptr_t)item >> 3) * 0x9E3779B97F4A7C15ULL;
+  return (size_t)(hash ^ (hash >> 32));
+}
+
+// Find the slot of `item`, or the empty slot where it belongs
+static struct _cbor_size_cache_entry* _cbor_size_cache_slot(
+    struct _cbor_size_cache_entry* entries, size_t capacity,
+    const cbor_item_t* item) {
+  size_t mask = capacity - 1;
+  for (size_t i = _cbor_size_cache_hash(item) & mask;; i = (i + 1) & mask) {
+    if (entries[i].item == NULL || entries[i].item == item) return &entries[i];
+  }
+}
+
+static void _cbor_size_cache_add(cbor_size_cache* cache,
+                                 const cbor_item_t* item, size_t size) {
+  // Keep at least half of the slots empty
+  if (2 * (cache->count + 1) > cache->capacity) {
+    size_t capacity = cache->capacity == 0 ? _CBOR_SIZE_CACHE_MIN_CAPACITY
+                                           : 2 * cache->capacity;
+    if (capacity < cache->capacity) return;
+    struct _cbor_size_cache_entry* entries =
+        _cbor_alloc_multiple(sizeof(struct _cbor_size_cache_entry), capacity);
+    if (entries == NULL) return;
+    memset(entries, 0, capacity * sizeof(struct _cbor_size_cache_entry));
+    for (size_t i = 0; i < cache->capacity; i++) {
+      if (cache->entries[i].item == NULL) continue;
+      *_cbor_size_cache_slot(entries, capacity, cache->entries[i].item) =
+          cache->entries[i];
+    }
+    _cbor_free(cache->entries);
+    cache->entries = entries;
+    cache->capacity = capacity;
+  }
+  *_cbor_size_cache_slot(cache->entries, cache->capacity, item) =
+      (struct _cbor_size_cache_entry){.item = item, .size = size};
+  cache->count++;
+}
+
+size_t cbor_serialized_size_cached(cbor_size_cache* cache,
+                                   const cbor_item_t* item) {
+  // Sizes of the other items take constant time
+  size_t size;
+  switch (cbor_typeof(item)) {
+    case CBOR_TYPE_BYTESTRING:
+      if (cbor_bytestring_is_definite(item)) return cbor_serialized_size(item);
+      break;
+    case CBOR_TYPE_STRING:
+      if (cbor_string_is_definite(item)) return cbor_serialized_size(item);
+      break;
+    case CBOR_TYPE_ARRAY:
+    case CBOR_TYPE_MAP:
+    case CBOR_TYPE_TAG:
+      break;
+    default:
+      return cbor_serialized_size(item);
+  }
+  if (cache->count > 0) {
+    struct _cbor_size_cache_entry* entry =
+        _cbor_size_cache_slot(cache->entries, cache->capacity, item);
+    if (entry->item != NULL) return entry->size;
+  }
+
+  switch (cbor_typeof(item)) {
+    case CBOR_TYPE_BYTESTRING:
+    case CBOR_TYPE_STRING: {
+      bool bytestring = cbor_isa_bytestring(item);
+      cbor_item_t** chunks = bytestring ? cbor_bytestring_chunks_handle(item)
+                                        : cbor_string_chunks_handle(item);
+      size_t chunk_count = bytestring ? cbor_bytestring_chunk_count(item)
+                                      : cbor_string_chunk_count(item);
+      size = 2;  // Leading byte + break
+      for (size_t i = 0; i < chunk_count; i++) {
+        size = _cbor_safe_signaling_add(size, cbor_serialized_size(chunks[i]));
+      }
+      break;
+    }
+    case CBOR_TYPE_ARRAY: {
+      size = cbor_array_is_definite(item)
+                 ? _cbor_encoded_header_size(cbor_array_size(item))
+                 : 2;  // Leading byte + break
+      cbor_item_t** items = cbor_array_handle(item);
+      for (size_t i = 0; i < cbor_array_size(item); i++) {
+        size = _cbor_safe_signaling_add(
+            size, cbor_serialized_size_cached(cache, items[i]));
+      }
+      break;
+    }
+    case CBOR_TYPE_MAP: {
+      size = cbor_map_is_definite(item)
+                 ? _cbor_encoded_header_size(cbor_map_size(item))
+                 : 2;  // Leading byte + break
+      struct cbor_pair* pairs = cbor_map_handle(item);
+      for (size_t i = 0; i < cbor_map_size(item); i++) {
+        size = _cbor_safe_signaling_add(
+            size, _cbor_safe_signaling_add(
+                      cbor_serialized_size_cached(cache, pairs[i].key),
+                      cbor_serialized_size_cached(cache, pairs[i].value)));
+      }
+      break;
+    }
+    default: {
+      CBOR_ASSERT(cbor_isa_tag(item));
+      cbor_item_t* tagged = _cbor_tagged_item(item);
+      if (tagged == NULL) return 0;
+      size = _cbor_safe_signaling_add(
+          _cbor_encoded_header_size(cbor_tag_value(item)),
+          cbor_serialized_size_cached(cache, tagged));
+      break;
+    }
+  }
+  _cbor_size_cache_add(cache, item, size);
+  return size;
+}
+
+/** Size of the stack buffer that small items are serialized to before the
+ * result is allocated */
+#define _CBOR_SERIALIZE_LOCAL_SIZE 256
+
+/** Output of #cbor_serialize_alloc_with, grown as needed */
+struct _cbor_output {
+  const struct cbor_allocator* allocator;
+  /** Either `local`, a heap block from `allocator`, or the caller's buffer */
+  unsigned char* data;
+  size_t capacity;
+  size_t length;
+  /** Whether `data` is the caller's buffer, which cannot grow */
+  bool fixed;
+  unsigned char local[_CBOR_SERIALIZE_LOCAL_SIZE];
+};
+
+static void _cbor_output_init(struct _cbor_output* output,
+                              const struct cbor_allocator* allocator) {
+  output->allocator = allocator;
+  output->data = output->local;
+  output->capacity = _CBOR_SERIALIZE_LOCAL_SIZE;
+  output->length = 0;
+  output->fixed = false;
+}
+
+// Make room for `size` more bytes
+static bool _cbor_output_reserve(struct _cbor_output* output, size_t size) {
+  if (output->capacity - output->length >= size) return true;
+  if (output->fixed || !_cbor_safe_to_add(output->length, size)) return false;
+  size_t capacity = output->capacity;
+  while (capacity < output->length + size) {
+    if (!_cbor_safe_to_multiply(CBOR_BUFFER_GROWTH, capacity)) {
+      capacity = output->length + size;
+      break;
+    }
+    capacity *= CBOR_BUFFER_GROWTH;
+  }
+  unsigned char* data;
+  if (output->data == output->local) {
+    data = _cbor_alloc_with(output->allocator, capacity);
+    if (data != NULL) memcpy(data, output->local, output->length);
+  } else {
+    data = _cbor_realloc_with(output->allocator, output->data,
+                              output->capacity, capacity);
+  }
+  if (data == NULL) return false;
+  output->data = data;
+  output->capacity = capacity;
+  return true;
+}
+
+// Append the output of `encoder`, which takes at most 9 bytes. The encoders
+// write nothing if the room is too small, retry after making enough.
+#define _CBOR_OUTPUT_HEADER(output, encoder, ...)                         \
+  do {                                                                    \
+    size_t _written = encoder(__VA_ARGS__, output->data + output->length, \
+                              output->capacity - output->length);        \
+    if (_written == 0) {                                                  \
+      if (!_cbor_output_reserve(output, 9)) return false;                 \
+      _written = encoder(__VA_ARGS__, output->data + output->length,      \
+                         output->capacity - output->length);             \
+    }                                                                     \
+    output->length += _written;                                           \
+  } while (0)
+
+static bool _cbor_output_byte(struct _cbor_output* output,
+                              unsigned char value) {
+  if (!_cbor_output_reserve(output, 1)) return false;
+  output->data[output->length++] = value;
+  return true;
+}
+
+// Append a definite string with the header encoded by `encoder`
+static bool _cbor_output_string(struct _cbor_output* output,
+                                size_t (*encoder)(size_t, unsigned char*,
+                                                  size_t),
+                                cbor_data data, size_t length) {
+  size_t header_size = _cbor_encoded_header_size(length);
+  if (!_cbor_safe_to_add(length, header_size) ||
+      !_cbor_output_reserve(output, length + header_size)) {
+    return false;
+  }
+  size_t written =
+      encoder(length, output->data + output->length, header_size);
+  if (length > 0) memcpy(output->data + output->length + written, data, length);
+  output->length += written + length;
+  return true;
+}
+
+// Serialize `item` in a single traversal, growing the output as needed
+static bool _cbor_serialize_to_output(const cbor_item_t* item,
+                                      struct _cbor_output* output) {
+  switch (cbor_typeof(item)) {
+    case CBOR_TYPE_UINT:
+      _CBOR_OUTPUT_HEADER(output, cbor_serialize_uint, item);
+      return true;
+    case CBOR_TYPE_NEGINT:
+      _CBOR_OUTPUT_HEADER(output, cbor_serialize_negint, item);
+      return true;
+    case CBOR_TYPE_BYTESTRING: {
+      if (cbor_bytestring_is_definite(item)) {
+        return _cbor_output_string(output, cbor_encode_bytestring_start,
+                                   cbor_bytestring_handle(item),
+                                   cbor_bytestring_length(item));
+      }
+      if (!_cbor_output_byte(output, 0x5F)) return false;
+      cbor_item_t** chunks = cbor_bytestring_chunks_handle(item);
+      for (size_t i = 0; i < cbor_bytestring_chunk_count(item); i++) {
+        if (!_cbor_serialize_to_output(chunks[i], output)) return false;
+      }
+      return _cbor_output_byte(output, 0xFF);
+    }
+    case CBOR_TYPE_STRING: {
+      if (cbor_string_is_definite(item)) {
+        return _cbor_output_string(output, cbor_encode_string_start,
+                                   cbor_string_handle(item),
+                                   cbor_string_length(item));
+      }
+      if (!_cbor_output_byte(output, 0x7F)) return false;
+      cbor_item_t** chunks = cbor_string_chunks_handle(item);
+      for (size_t i = 0; i < cbor_string_chunk_count(item); i++) {
+        if (!_cbor_serialize_to_output(chunks[i], output)) return false;
+      }
+      return _cbor_output_byte(output, 0xFF);
+    }
+    case CBOR_TYPE_ARRAY: {
+      if (cbor_array_is_definite(item)) {
+        _CBOR_OUTPUT_HEADER(output, cbor_encode_array_start,
+                            cbor_array_size(item));
+      } else if (!_cbor_output_byte(output, 0x9F)) {
+        return false;
+      }
+      cbor_item_t** items = cbor_array_handle(item);
+      for (size_t i = 0; i < cbor_array_size(item); i++) {
+        if (!_cbor_serialize_to_output(items[i], output)) return false;
+      }
+      return cbor_array_is_definite(item) || _cbor_output_byte(output, 0xFF);
+    }
+    case CBOR_TYPE_MAP: {
+      if (cbor_map_is_definite(item)) {
+        _CBOR_OUTPUT_HEADER(output, cbor_encode_map_start,
+                            cbor_map_size(item));
+      } else if (!_cbor_output_byte(output, 0xBF)) {
+        return false;
+      }
+      struct cbor_pair* pairs = cbor_map_handle(item);
+      for (size_t i = 0; i < cbor_map_size(item); i++) {
+        if (!_cbor_serialize_to_output(pairs[i].key, output) ||
+            !_cbor_serialize_to_output(pairs[i].value, output)) {
+          return false;
+        }
+      }
+      return cbor_map_is_definite(item) || _cbor_output_byte(output, 0xFF);
+    }
+    case CBOR_TYPE_TAG: {
+      cbor_item_t* tagged = _cbor_tagged_item(item);
+      if (tagged == NULL) return false;
+      _CBOR_OUTPUT_HEADER(output, cbor_encode_tag, cbor_tag_value(item));
+      return _cbor_serialize_to_output(tagged, output);
+    }
+    case CBOR_TYPE_FLOAT_CTRL:
+      _CBOR_OUTPUT_HEADER(output, cbor_serialize_float_ctrl, item);
+      return true;
+    default:  // LCOV_EXCL_START
+      _CBOR_UNREACHABLE;
+      return false;  // LCOV_EXCL_STOP
+  }
+}
+
 size_t cbor_serialize_alloc(const cbor_item_t* item, unsigned char** buffer,
                             size_t* buffer_size) {
-  *buffer = NULL;
-  size_t serialized_size = cbor_serialized_size(item);
-  if (serialized_size == 0) {
-    if (buffer_size != NULL) *buffer_size = 0;
-    return 0;
+  return cbor_serialize_alloc_with(item, NULL, buffer, buffer_size);
+}
+
+// Hand the result over to the caller as a heap block of the exact size, or
+// release it if the serialization has failed
+static size_t _cbor_output_take(struct _cbor_output* output, bool success,
+                                unsigned char** buffer, size_t* buffer_size) {
+  if (success && output->data == output->local) {
+    // Small enough to be allocated at the exact size
+    *buffer = _cbor_alloc_with(output->allocator, output->length);
+    if (*buffer != NULL) memcpy(*buffer, output->local, output->length);
+    success = *buffer != NULL;
+  } else if (success) {
+    // Give back the unused part of the last growth step
+    *buffer = _cbor_realloc_with(output->allocator, output->data,
+                                 output->capacity, output->length);
+    if (*buffer == NULL) *buffer = output->data;
+  } else {
+    if (output->data != output->local) {
+      _cbor_free_with(output->allocator, output->data);
+    }
+    *buffer = NULL;
+  }
+  size_t serialized_size = success ? output->length : 0;
+  if (buffer_size != NULL) *buffer_size = serialized_size;
+  return serialized_size;
+}
+
+size_t cbor_serialize_alloc_with(const cbor_item_t* item,
+                                 const struct cbor_allocator* allocator,
+                                 unsigned char** buffer, size_t* buffer_size) {
+  struct _cbor_output output;
+  _cbor_output_init(&output, allocator);
+  bool success = _cbor_serialize_to_output(item, &output);
+  return _cbor_output_take(&output, success, buffer, buffer_size);
+}
+
+/*
+ * ============================================================================
+ * Deterministic encoding
+ * ============================================================================
+ */
+
+// Append the shortest of half, single, and double precision that represents
+// `value` exactly
+static bool _cbor_output_float(struct _cbor_output* output, double value) {
+  unsigned char encoded[9];
+  size_t length = cbor_encode_preferred_float(value, encoded, sizeof(encoded));
+  if (!_cbor_output_reserve(output, length)) return false;
+  memcpy(output->data + output->length, encoded, length);
+  output->length += length;
+  return true;
+}
+
+// Append the concatenated chunks of an indefinite string as a definite one
+static bool _cbor_output_chunks(struct _cbor_output* output,
+                                const cbor_item_t* item) {
+  bool bytestring = cbor_isa_bytestring(item);
+  cbor_item_t** chunks = bytestring ? cbor_bytestring_chunks_handle(item)
+                                    : cbor_string_chunks_handle(item);
+  size_t chunk_count = bytestring ? cbor_bytestring_chunk_count(item)
+                                  : cbor_string_chunk_count(item);
+  size_t (*chunk_length)(const cbor_item_t*) =
+      bytestring ? cbor_bytestring_length : cbor_string_length;
+  size_t length = 0;
+  for (size_t i = 0; i < chunk_count; i++) {
+    if (!_cbor_safe_to_add(length, chunk_length(chunks[i]))) return false;
+    length += chunk_length(chunks[i]);
+  }
+  size_t header_size = _cbor_encoded_header_size(length);
+  if (!_cbor_safe_to_add(length, header_size) ||
+      !_cbor_output_reserve(output, length + header_size)) {
+    return false;
+  }
+  output->length +=
+      (bytestring ? cbor_encode_bytestring_start : cbor_encode_string_start)(
+          length, output->data + output->length, header_size);
+  for (size_t i = 0; i < chunk_count; i++) {
+    if (chunk_length(chunks[i]) == 0) continue;
+    memcpy(output->data + output->length,
+           bytestring ? cbor_bytestring_handle(chunks[i])
+                      : cbor_string_handle(chunks[i]),
+           chunk_length(chunks[i]));
+    output->length += chunk_length(chunks[i]);
+  }
+  return true;
+}
+
+/** A serialized map entry, while the entries are being sorted */
+struct _cbor_canonical_entry {
+  /** The encoded key, followed by the encoded value */
+  const unsigned char* data;
+  size_t key_length;
+  size_t length;
+};
+
+// Bytewise lexicographic order of the encoded keys
+static int _cbor_canonical_entry_compare(const void* a, const void* b) {
+  const struct _cbor_canonical_entry* left = a;
+  const struct _cbor_canonical_entry* right = b;
+  size_t common = left->key_length < right->key_length ? left->key_length
+                                                       : right->key_length;
+  int order = memcmp(left->data, right->data, common);
+  if (order != 0) return order;
+  if (left->key_length == right->key_length) return 0;
+  return left->key_length < right->key_length ? -1 : 1;
+}
+
+static bool _cbor_serialize_preferred_to_output(const cbor_item_t* item,
+                                                struct _cbor_output* output,
+                                                bool deterministic);
+
+// Write the entries of `item` and reorder them by their encoded keys. Each
+// key is encoded once, the sort only moves the encoded bytes.
+static bool _cbor_serialize_canonical_map(const cbor_item_t* item,
+                                          struct _cbor_output* output) {
+  size_t size = cbor_map_size(item);
+  _CBOR_OUTPUT_HEADER(output, cbor_encode_map_start, size);
+  if (size == 0) return true;
+  struct _cbor_canonical_entry* entries = _cbor_alloc_multiple_with(
+      item->allocator, sizeof(struct _cbor_canonical_entry), size);
+  if (entries == NULL) return false;
+
+  // The output might move while the entries are written, record offsets
+  size_t start = output->length;
+  struct cbor_pair* pairs = cbor_map_handle(item);
+  for (size_t i = 0; i < size; i++) {
+    size_t offset = output->length;
+    if (!_cbor_serialize_preferred_to_output(pairs[i].key, output, true)) {
+      _cbor_free_with(item->allocator, entries);
+      return false;
+    }
+    entries[i].key_length = output->length - offset;
+    if (!_cbor_serialize_preferred_to_output(pairs[i].value, output, true)) {
+      _cbor_free_with(item->allocator, entries);
+      return false;
+    }
+    entries[i].length = output->length - offset;
+  }
+  for (size_t i = 0, offset = start; i < size; offset += entries[i++].length) {
+    entries[i].data = output->data + offset;
   }
-  *buffer = _cbor_malloc(serialized_size);
-  if (*buffer == NULL) {
-    if (buffer_size != NULL) *buffer_size = 0;
+
+  bool sorted = true;
+  for (size_t i = 1; i < size && sorted; i++) {
+    sorted = _cbor_canonical_entry_compare(&entries[i - 1], &entries[i]) < 0;
+  }
+  bool success = true;
+  if (!sorted) {
+    qsort(entries, size, sizeof(struct _cbor_canonical_entry),
+          _cbor_canonical_entry_compare);
+    // Duplicate keys have no deterministic order
+    for (size_t i = 1; i < size && success; i++) {
+      success =
+          _cbor_canonical_entry_compare(&entries[i - 1], &entries[i]) != 0;
+    }
+  }
+  if (success && !sorted) {
+    unsigned char* reordered =
+        _cbor_alloc_with(item->allocator, output->length - start);
+    success = reordered != NULL;
+    if (success) {
+      size_t length = 0;
+      for (size_t i = 0; i < size; i++) {
+        memcpy(reordered + length, entries[i].data, entries[i].length);
+        length += entries[i].length;
+      }
+      memcpy(output->data + start, reordered, length);
+      _cbor_free_with(item->allocator, reordered);
+    }
+  }
+  _cbor_free_with(item->allocator, entries);
+  return success;
+}
+
+// Append the chunks of an indefinite string as they are
+static bool _cbor_output_indefinite_string(struct _cbor_output* output,
+                                           const cbor_item_t* item) {
+  bool bytestring = cbor_isa_bytestring(item);
+  cbor_item_t** chunks = bytestring ? cbor_bytestring_chunks_handle(item)
+                                    : cbor_string_chunks_handle(item);
+  size_t chunk_count = bytestring ? cbor_bytestring_chunk_count(item)
+                                  : cbor_string_chunk_count(item);
+  if (!_cbor_output_byte(output, bytestring ? 0x5F : 0x7F)) return false;
+  for (size_t i = 0; i < chunk_count; i++) {
+    if (!_cbor_serialize_preferred_to_output(chunks[i], output, false)) {
+      return false;
+    }
+  }
+  return _cbor_output_byte(output, 0xFF);
+}
+
+// Append the pairs of `item` in their order
+static bool _cbor_serialize_preferred_map(const cbor_item_t* item,
+                                          struct _cbor_output* output) {
+  if (cbor_map_is_definite(item)) {
+    _CBOR_OUTPUT_HEADER(output, cbor_encode_map_start, cbor_map_size(item));
+  } else if (!_cbor_output_byte(output, 0xBF)) {
+    return false;
+  }
+  struct cbor_pair* pairs = cbor_map_handle(item);
+  for (size_t i = 0; i < cbor_map_size(item); i++) {
+    if (!_cbor_serialize_preferred_to_output(pairs[i].key, output, false) ||
+        !_cbor_serialize_preferred_to_output(pairs[i].value, output, false)) {
+      return false;
+    }
+  }
+  return cbor_map_is_definite(item) || _cbor_output_byte(output, 0xFF);
+}
+
+// Serialize `item` with the shortest heads and floats. With `deterministic`,
+// also follow the rest of the core deterministic encoding requirements.
+static bool _cbor_serialize_preferred_to_output(const cbor_item_t* item,
+                                                struct _cbor_output* output,
+                                                bool deterministic) {
+  switch (cbor_typeof(item)) {
+    case CBOR_TYPE_UINT:
+      _CBOR_OUTPUT_HEADER(output, cbor_encode_uint, cbor_get_int(item));
+      return true;
+    case CBOR_TYPE_NEGINT:
+      _CBOR_OUTPUT_HEADER(output, cbor_encode_negint, cbor_get_int(item));
+      return true;
+    case CBOR_TYPE_BYTESTRING:
+      if (cbor_bytestring_is_definite(item)) {
+        return _cbor_output_string(output, cbor_encode_bytestring_start,
+                                   cbor_bytestring_handle(item),
+                                   cbor_bytestring_length(item));
+      }
+      return deterministic ? _cbor_output_chunks(output, item)
+                           : _cbor_output_indefinite_string(output, item);
+    case CBOR_TYPE_STRING:
+      if (cbor_string_is_definite(item)) {
+        return _cbor_output_string(output, cbor_encode_string_start,
+                                   cbor_string_handle(item),
+                                   cbor_string_length(item));
+      }
+      return deterministic ? _cbor_output_chunks(output, item)
+                           : _cbor_output_indefinite_string(output, item);
+    case CBOR_TYPE_ARRAY: {
+      bool indefinite = !deterministic && cbor_array_is_indefinite(item);
+      if (!indefinite) {
+        _CBOR_OUTPUT_HEADER(output, cbor_encode_array_start,
+                            cbor_array_size(item));
+      } else if (!_cbor_output_byte(output, 0x9F)) {
+        return false;
+      }
+      cbor_item_t** items = cbor_array_handle(item);
+      for (size_t i = 0; i < cbor_array_size(item); i++) {
+        if (!_cbor_serialize_preferred_to_output(items[i], output,
+                                                 deterministic)) {
+          return false;
+        }
+      }
+      return !indefinite || _cbor_output_byte(output, 0xFF);
+    }
+    case CBOR_TYPE_MAP:
+      return deterministic ? _cbor_serialize_canonical_map(item, output)
+                           : _cbor_serialize_preferred_map(item, output);
+    case CBOR_TYPE_TAG: {
+      cbor_item_t* tagged = _cbor_tagged_item(item);
+      if (tagged == NULL) return false;
+      _CBOR_OUTPUT_HEADER(output, cbor_encode_tag, cbor_tag_value(item));
+      return _cbor_serialize_preferred_to_output(tagged, output,
+                                                 deterministic);
+    }
+    case CBOR_TYPE_FLOAT_CTRL:
+      if (cbor_float_ctrl_is_ctrl(item)) {
+        _CBOR_OUTPUT_HEADER(output, cbor_encode_ctrl, cbor_ctrl_value(item));
+        return true;
+      }
+      return _cbor_output_float(output, cbor_float_get_float(item));
+    default:  // LCOV_EXCL_START
+      _CBOR_UNREACHABLE;
+      return false;  // LCOV_EXCL_STOP
+  }
+}
+
+// Serialize into the caller's buffer, which cannot grow
+static size_t _cbor_serialize_preferred_fixed(const cbor_item_t* item,
+                                              unsigned char* buffer,
+                                              size_t buffer_size,
+                                              bool deterministic) {
+  struct _cbor_output output;
+  _cbor_output_init(&output, NULL);
+  output.data = buffer;
+  output.capacity = buffer_size;
+  output.fixed = true;
+  if (!_cbor_serialize_preferred_to_output(item, &output, deterministic)) {
     return 0;
   }
+  return output.length;
+}
 
-  size_t written = cbor_serialize(item, *buffer, serialized_size);
-  CBOR_ASSERT(written == serialized_size);
-  if (buffer_size != NULL) *buffer_size = serialized_size;
-  return written;
+static size_t _cbor_serialize_preferred_alloc(const cbor_item_t* item,
+                                              unsigned char** buffer,
+                                              size_t* buffer_size,
+                                              bool deterministic) {
+  struct _cbor_output output;
+  _cbor_output_init(&output, NULL);
+  bool success =
+      _cbor_serialize_preferred_to_output(item, &output, deterministic);
+  return _cbor_output_take(&output, success, buffer, buffer_size);
+}
+
+size_t cbor_serialize_preferred(const cbor_item_t* item, unsigned char* buffer,
+                                size_t buffer_size) {
+  return _cbor_serialize_preferred_fixed(item, buffer, buffer_size, false);
+}
+
+size_t cbor_serialize_preferred_alloc(const cbor_item_t* item,
+                                      unsigned char** buffer,
+                                      size_t* buffer_size) {
+  return _cbor_serialize_preferred_alloc(item, buffer, buffer_size, false);
+}
+
+size_t cbor_serialize_canonical(const cbor_item_t* item, unsigned char* buffer,
+                                size_t buffer_size) {
+  return _cbor_serialize_preferred_fixed(item, buffer, buffer_size, true);
+}
+
+size_t cbor_serialize_canonical_alloc(const cbor_item_t* item,
+                                      unsigned char** buffer,
+                                      size_t* buffer_size) {
+  return _cbor_serialize_preferred_alloc(item, buffer, buffer_size, true);
 }
 
 size_t cbor_serialize_uint(const cbor_item_t* item, unsigned char* buffer,
@@ -370,9 +989,9 @@ size_t cbor_serialize_tag(const cbor_item_t* item, unsigned char* buffer,
   size_t written = cbor_encode_tag(cbor_tag_value(item), buffer, buffer_size);
   if (written == 0) return 0;
 
-  cbor_item_t* tagged = cbor_tag_item(item);
+  cbor_item_t* tagged = _cbor_tagged_item(item);
   if (tagged == NULL) return 0;
-  size_t item_written = cbor_serialize(cbor_move(tagged), buffer + written,
+  size_t item_written = cbor_serialize(tagged, buffer + written,
                                        buffer_size - written);
   if (item_written == 0) return 0;
   return written + item_written;
@@ -401,3 +1020,229 @@ size_t cbor_serialize_float_ctrl(const cbor_item_t* item, unsigned char* buffer,
       return 0;  // LCOV_EXCL_STOP
   }
 }
+
+/** A container whose header has been written */
+struct _cbor_serializer_frame {
+  const cbor_item_t* item;
+  /** Number of subitems visited so far (keys and values count separately) */
+  size_t index;
+};
+
+void cbor_serializer_init(cbor_serializer* serializer,
+                          const cbor_item_t* item) {
+  *serializer = (cbor_serializer){.root = item};
+}
+
+void cbor_serializer_release(cbor_serializer* serializer) {
+  _cbor_free(serializer->frames);
+  serializer->frames = NULL;
+  serializer->depth = serializer->capacity = 0;
+}
+
+static bool _cbor_serializer_push(cbor_serializer* serializer,
+                                  const cbor_item_t* item) {
+  if (serializer->depth == serializer->capacity) {
+    if (!_cbor_safe_to_multiply(CBOR_BUFFER_GROWTH, serializer->capacity)) {
+      return false;
+    }
+    size_t new_capacity = serializer->capacity == 0
+                              ? 8
+                              : CBOR_BUFFER_GROWTH * serializer->capacity;
+    struct _cbor_serializer_frame* frames = _cbor_realloc_multiple(
+        serializer->frames, sizeof(struct _cbor_serializer_frame),
+        new_capacity);
+    if (frames == NULL) return false;
+    serializer->frames = frames;
+    serializer->capacity = new_capacity;
+  }
+  serializer->frames[serializer->depth++] =
+      (struct _cbor_serializer_frame){.item = item, .index = 0};
+  return true;
+}
+
+// Encode the header of `item` into the pending buffer. Containers are pushed
+// onto the stack, the data of definite strings becomes the payload.
+static bool _cbor_serializer_begin(cbor_serializer* serializer,
+                                   const cbor_item_t* item) {
+  if (item == NULL) return false;
+  unsigned char* pending = serializer->pending;
+  size_t size = sizeof(serializer->pending);
+  size_t written = 0;
+  bool container = false;
+  switch (cbor_typeof(item)) {
+    case CBOR_TYPE_UINT:
+    case CBOR_TYPE_NEGINT:
+    case CBOR_TYPE_FLOAT_CTRL:
+      written = cbor_serialize(item, pending, size);
+      break;
+    case CBOR_TYPE_BYTESTRING:
+      if (cbor_bytestring_is_definite(item)) {
+        written = cbor_encode_bytestring_start(cbor_bytestring_length(item),
+                                               pending, size);
+        serializer->payload = cbor_bytestring_handle(item);
+        serializer->payload_length = cbor_bytestring_length(item);
+      } else {
+        written = cbor_encode_indef_bytestring_start(pending, size);
+        container = true;
+      }
+      break;
+    case CBOR_TYPE_STRING:
+      if (cbor_string_is_definite(item)) {
+        written =
+            cbor_encode_string_start(cbor_string_length(item), pending, size);
+        serializer->payload = cbor_string_handle(item);
+        serializer->payload_length = cbor_string_length(item);
+      } else {
+        written = cbor_encode_indef_string_start(pending, size);
+        container = true;
+      }
+      break;
+    case CBOR_TYPE_ARRAY:
+      written = cbor_array_is_definite(item)
+                    ? cbor_encode_array_start(cbor_array_size(item), pending,
+                                              size)
+                    : cbor_encode_indef_array_start(pending, size);
+      container = true;
+      break;
+    case CBOR_TYPE_MAP:
+      written = cbor_map_is_definite(item)
+                    ? cbor_encode_map_start(cbor_map_size(item), pending, size)
+                    : cbor_encode_indef_map_start(pending, size);
+      container = true;
+      break;
+    case CBOR_TYPE_TAG:
+      written = cbor_encode_tag(cbor_tag_value(item), pending, size);
+      container = true;
+      break;
+    default:  // LCOV_EXCL_START
+      _CBOR_UNREACHABLE;
+      return false;  // LCOV_EXCL_STOP
+  }
+  CBOR_ASSERT(written > 0);
+  serializer->pending_offset = 0;
+  serializer->pending_length = written;
+  return !container || _cbor_serializer_push(serializer, item);
+}
+
+// Get the next subitem of the container, or `NULL` when it has been
+// exhausted. Tags without a tagged item are reported via `missing`.
+static const cbor_item_t* _cbor_serializer_next(
+    struct _cbor_serializer_frame* frame, bool* missing) {
+  const cbor_item_t* item = frame->item;
+  size_t index = frame->index;
+  switch (cbor_typeof(item)) {
+    case CBOR_TYPE_BYTESTRING:
+      if (index == cbor_bytestring_chunk_count(item)) return NULL;
+      frame->index++;
+      return cbor_bytestring_chunks_handle(item)[index];
+    case CBOR_TYPE_STRING:
+      if (index == cbor_string_chunk_count(item)) return NULL;
+      frame->index++;
+      return cbor_string_chunks_handle(item)[index];
+    case CBOR_TYPE_ARRAY:
+      if (index == cbor_array_size(item)) return NULL;
+      frame->index++;
+      return cbor_array_handle(item)[index];
+    case CBOR_TYPE_MAP: {
+      if (index == 2 * cbor_map_size(item)) return NULL;
+      frame->index++;
+      struct cbor_pair* pair = &cbor_map_handle(item)[index / 2];
+      return index % 2 == 0 ? pair->key : pair->value;
+    }
+    case CBOR_TYPE_TAG: {
+      if (index == 1) return NULL;
+      frame->index++;
+      cbor_item_t* tagged = _cbor_tagged_item(item);
+      if (tagged == NULL) *missing = true;
+      return tagged;
+    }
+    default:  // LCOV_EXCL_START
+      _CBOR_UNREACHABLE;
+      return NULL;  // LCOV_EXCL_STOP
+  }
+}
+
+static bool _cbor_serializer_is_indefinite(const cbor_item_t* item) {
+  switch (cbor_typeof(item)) {
+    case CBOR_TYPE_BYTESTRING:
+    case CBOR_TYPE_STRING:
+      // Only indefinite strings are containers
+      return true;
+    case CBOR_TYPE_ARRAY:
+      return cbor_array_is_indefinite(item);
+    case CBOR_TYPE_MAP:
+      return cbor_map_is_indefinite(item);
+    default:
+      return false;
+  }
+}
+
+// Copy as much of `*source` as fits, advancing both sides
+static bool _cbor_serializer_flush(cbor_data* source, size_t* source_length,
+                                   unsigned char* buffer, size_t buffer_size,
+                                   size_t* position) {
+  size_t length = *source_length < buffer_size - *position
+                      ? *source_length
+                      : buffer_size - *position;
+  if (length > 0) {
+    memcpy(buffer + *position, *source, length);
+    *source += length;
+    *source_length -= length;
+    *position += length;
+  }
+  return *source_length == 0;
+}
+
+enum cbor_serializer_status cbor_serializer_write(cbor_serializer* serializer,
+                                                  unsigned char* buffer,
+                                                  size_t buffer_size,
+                                                  size_t* written) {
+  size_t position = 0;
+  enum cbor_serializer_status status = CBOR_SERIALIZER_ERROR;
+  while (!serializer->failed) {
+    cbor_data pending = serializer->pending + serializer->pending_offset;
+    size_t pending_length =
+        serializer->pending_length - serializer->pending_offset;
+    bool flushed = _cbor_serializer_flush(&pending, &pending_length, buffer,
+                                          buffer_size, &position);
+    serializer->pending_offset = serializer->pending_length - pending_length;
+    flushed = flushed &&
+              _cbor_serializer_flush(&serializer->payload,
+                                     &serializer->payload_length, buffer,
+                                     buffer_size, &position);
+    if (!flushed) {
+      status = CBOR_SERIALIZER_BUFFER_FULL;
+      break;
+    }
+
+    const cbor_item_t* next = NULL;
+    if (serializer->root != NULL) {
+      next = serializer->root;
+      serializer->root = NULL;
+    } else if (serializer->depth == 0) {
+      status = CBOR_SERIALIZER_FINISHED;
+      break;
+    } else {
+      struct _cbor_serializer_frame* frame =
+          &serializer->frames[serializer->depth - 1];
+      bool missing = false;
+      next = _cbor_serializer_next(frame, &missing);
+      if (missing) {
+        serializer->failed = true;
+        break;
+      }
+      if (next == NULL) {
+        serializer->depth--;
+        if (_cbor_serializer_is_indefinite(frame->item)) {
+          serializer->pending_offset = 0;
+          serializer->pending_length = cbor_encode_break(
+              serializer->pending, sizeof(serializer->pending));
+        }
+        continue;
+      }
+    }
+    if (!_cbor_serializer_begin(serializer, next)) serializer->failed = true;
+  }
+  *written = position;
+  return status;
+}
@@ -44,12 +44,70 @@ _CBOR_NODISCARD CBOR_EXPORT size_t cbor_serialize(const cbor_item_t* item,
 _CBOR_NODISCARD CBOR_EXPORT size_t
 cbor_serialized_size(const cbor_item_t* item);
 
+struct _cbor_size_cache_entry;
+
+/** Serialized sizes of the containers of an item, see
+ * #cbor_serialized_size_cached
+ *
+ * The cache is keyed by the addresses of the items. Every item whose size is
+ * cached must stay alive and unmodified while the cache is in use. If an item
+ * were freed and another one allocated at the same address, the cache would
+ * return the old size and the item would be framed with a wrong length. After
+ * modifying or releasing any of the items, reset the cache with
+ * #cbor_size_cache_release followed by #cbor_size_cache_init.
+ *
+ * All members are private.
+ */
+typedef struct cbor_size_cache {
+  /** Open addressing table keyed by the item */
+  struct _cbor_size_cache_entry* entries;
+  /** Number of slots, zero or a power of two */
+  size_t capacity;
+  /** Number of occupied slots */
+  size_t count;
+} cbor_size_cache;
+
+/** Prepare an empty cache
+ *
+ * No memory is allocated until the first #cbor_serialized_size_cached.
+ *
+ * @param cache The cache to initialize
+ */
+CBOR_EXPORT void cbor_size_cache_init(cbor_size_cache* cache);
+
+/** Like #cbor_serialized_size, but remembers the size of every array, map,
+ * tag, and indefinite string in \p item
+ *
+ * The sizes of \p item and of all the containers nested in it are recorded in
+ * \p cache as they are computed. Asking for the size of any of them later,
+ * e.g. to frame a sub-document, returns the recorded size without walking the
+ * subtree again. Containers shared by several parents are only walked once.
+ *
+ * If the cache cannot grow, the sizes are still computed, just not recorded.
+ *
+ * @param cache An initialized cache
+ * @param item A data item
+ * @return Length (>= 1) of the item when serialized. 0 if the length overflows
+ * `size_t`.
+ */
+_CBOR_NODISCARD CBOR_EXPORT size_t
+cbor_serialized_size_cached(cbor_size_cache* cache, const cbor_item_t* item);
+
+/** Release the memory held by a cache
+ *
+ * @param cache An initialized cache
+ */
+CBOR_EXPORT void cbor_size_cache_release(cbor_size_cache* cache);
+
 /** Serialize the given item, allocating buffers as needed
  *
  * Since libcbor v0.10, the return value is always the same as `buffer_size` (if
  * provided, see https://github.com/PJK/libcbor/pull/251/). New clients should
  * ignore the return value.
  *
+ * The item is traversed once. The output is written to a buffer that grows
+ * geometrically and is trimmed to the size of the result at the end.
+ *
  * \rst
  * .. warning::
  *   It is the caller's responsibility to free the buffer using an appropriate
@@ -67,6 +125,101 @@ CBOR_EXPORT size_t cbor_serialize_alloc(const cbor_item_t* item,
                                         unsigned char** buffer,
                                         size_t* buffer_size);
 
+/** Like #cbor_serialize_alloc, but allocates the buffer from \p allocator
+ *
+ * The caller releases the buffer using `allocator->deallocate`.
+ *
+ * @param item A data item
+ * @param allocator Where the buffer is allocated. `NULL` stands for the global
+ * routines set by #cbor_set_allocs.
+ * @param[out] buffer Buffer containing the result
+ * @param[out] buffer_size Size of the \p buffer, or 0 on memory allocation
+ * failure.
+ * @return Length of the result in bytes
+ * @return 0 on memory allocation failure, in which case \p buffer is `NULL`.
+ */
+CBOR_EXPORT size_t cbor_serialize_alloc_with(
+    const cbor_item_t* item, const struct cbor_allocator* allocator,
+    unsigned char** buffer, size_t* buffer_size);
+
+/** Serialize the given item using the preferred serialization
+ *
+ * Follows RFC 8949, section 4.1: integers, lengths, tags, and simple values
+ * use the shortest head, and floats use the shortest precision that
+ * represents the value exactly (see #cbor_encode_preferred_float). Unlike
+ * #cbor_serialize_canonical, indefinite-length items stay indefinite and map
+ * entries keep their order, so any item can be serialized.
+ *
+ * @param item A data item
+ * @param buffer Buffer to serialize to
+ * @param buffer_size Size of the \p buffer
+ * @return Length of the result. 0 if the \p buffer_size doesn't fit the
+ * result.
+ */
+_CBOR_NODISCARD CBOR_EXPORT size_t cbor_serialize_preferred(
+    const cbor_item_t* item, cbor_mutable_data buffer, size_t buffer_size);
+
+/** Like #cbor_serialize_preferred, but allocates the buffer as needed
+ *
+ * \rst
+ * .. warning::
+ *   It is the caller's responsibility to free the buffer using an appropriate
+ *   ``free`` implementation.
+ * \endrst
+ *
+ * @param item A data item
+ * @param[out] buffer Buffer containing the result
+ * @param[out] buffer_size Size of the \p buffer, or 0 on failure
+ * @return Length of the result in bytes
+ * @return 0 on memory allocation failure, in which case \p buffer is `NULL`.
+ */
+CBOR_EXPORT size_t cbor_serialize_preferred_alloc(const cbor_item_t* item,
+                                                  unsigned char** buffer,
+                                                  size_t* buffer_size);
+
+/** Serialize the given item using the core deterministic encoding
+ *
+ * Follows the requirements of RFC 8949, section 4.2.1:
+ *  - Integers, lengths, tags, and simple values use the shortest head
+ *  - Floats use the shortest of half, single, and double precision that
+ *    represents the value exactly, see #cbor_encode_preferred_float
+ *  - Indefinite strings, arrays, and maps are written with definite lengths
+ *  - Map entries are sorted by the bytewise lexicographic order of their
+ *    encoded keys
+ *
+ * Each key is encoded once. The entries of a map are written in their
+ * original order and then reordered in the output if needed. Equal items
+ * always produce the same bytes, regardless of how they were built or decoded.
+ *
+ * @param item A data item
+ * @param buffer Buffer to serialize to
+ * @param buffer_size Size of the \p buffer
+ * @return Length of the result. 0 if the \p buffer_size doesn't fit the
+ * result, a map contains two keys with the same encoding, or on memory
+ * allocation failure.
+ */
+_CBOR_NODISCARD CBOR_EXPORT size_t cbor_serialize_canonical(
+    const cbor_item_t* item, cbor_mutable_data buffer, size_t buffer_size);
+
+/** Like #cbor_serialize_canonical, but allocates the buffer as needed
+ *
+ * \rst
+ * .. warning::
+ *   It is the caller's responsibility to free the buffer using an appropriate
+ *   ``free`` implementation.
+ * \endrst
+ *
+ * @param item A data item
+ * @param[out] buffer Buffer containing the result
+ * @param[out] buffer_size Size of the \p buffer, or 0 on failure
+ * @return Length of the result in bytes
+ * @return 0 if a map contains two keys with the same encoding or on memory
+ * allocation failure, in which case \p buffer is `NULL`.
+ */
+CBOR_EXPORT size_t cbor_serialize_canonical_alloc(const cbor_item_t* item,
+                                                  unsigned char** buffer,
+                                                  size_t* buffer_size);
+
 /** Serialize an uint
  *
  * @param item A uint
@@ -162,6 +315,97 @@ _CBOR_NODISCARD CBOR_EXPORT size_t cbor_serialize_tag(const cbor_item_t* item,
 _CBOR_NODISCARD CBOR_EXPORT size_t cbor_serialize_float_ctrl(
     const cbor_item_t* item, cbor_mutable_data buffer, size_t buffer_size);
 
+/*
+ * ============================================================================
+ * Resumable serialization
+ * ============================================================================
+ */
+
+/** Outcome of #cbor_serializer_write */
+enum cbor_serializer_status {
+  /** The whole item has been written */
+  CBOR_SERIALIZER_FINISHED,
+  /** The buffer is full, call #cbor_serializer_write again with more room */
+  CBOR_SERIALIZER_BUFFER_FULL,
+  /** The item cannot be serialized (e.g. a tag without a tagged item) or
+   * memory allocation failed */
+  CBOR_SERIALIZER_ERROR
+};
+
+struct _cbor_serializer_frame;
+
+/** State of an item being serialized in pieces
+ *
+ * The serializer walks the item using a heap-allocated stack, so the native
+ * stack use does not depend on the nesting depth. The item must not be
+ * modified or released until the serialization is done. All members are
+ * private.
+ */
+typedef struct cbor_serializer {
+  /** The item, until it is first visited */
+  const cbor_item_t* root;
+  /** Containers being serialized, innermost last */
+  struct _cbor_serializer_frame* frames;
+  size_t depth;
+  size_t capacity;
+  /** Encoded header that did not fit the buffer yet */
+  unsigned char pending[9];
+  size_t pending_offset;
+  size_t pending_length;
+  /** Definite string data that did not fit the buffer yet */
+  cbor_data payload;
+  size_t payload_length;
+  bool failed;
+} cbor_serializer;
+
+/** Prepare serializing \p item
+ *
+ * No memory is allocated until the first #cbor_serializer_write.
+ *
+ * @param serializer The serializer to initialize
+ * @param item A data item
+ */
+CBOR_EXPORT void cbor_serializer_init(cbor_serializer* serializer,
+                                      const cbor_item_t* item);
+
+/** Write the next part of the serialized item
+ *
+ * Fills \p buffer as far as possible. The concatenation of the outputs of
+ * all calls is the same as the output of #cbor_serialize.
+ *
+ * \rst
+ * .. code-block:: c
+ *
+ *    cbor_serializer serializer;
+ *    cbor_serializer_init(&serializer, item);
+ *    enum cbor_serializer_status status;
+ *    do {
+ *      size_t written;
+ *      status = cbor_serializer_write(&serializer, buffer, sizeof(buffer),
+ *                                     &written);
+ *      send(socket, buffer, written, 0);
+ *    } while (status == CBOR_SERIALIZER_BUFFER_FULL);
+ *    cbor_serializer_release(&serializer);
+ * \endrst
+ *
+ * @param serializer An initialized serializer
+ * @param buffer Buffer to serialize to
+ * @param buffer_size Size of the \p buffer
+ * @param[out] written Number of bytes written to \p buffer
+ * @return #CBOR_SERIALIZER_BUFFER_FULL if there is more to write
+ */
+_CBOR_NODISCARD CBOR_EXPORT enum cbor_serializer_status cbor_serializer_write(
+    cbor_serializer* serializer, cbor_mutable_data buffer, size_t buffer_size,
+    size_t* written);
+
+/** Release the memory held by a serializer
+ *
+ * May be called at any point, e.g. to abandon an unfinished serialization.
+ *
+ * @param serializer An initialized serializer
+ */
+CBOR_EXPORT void cbor_serializer_release(cbor_serializer* serializer);
+
 #ifdef __cplusplus
 }
 #endif
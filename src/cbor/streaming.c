@@ -6,6 +6,7 @@
  */
 
 #include "streaming.h"
+#include <string.h>
 #include "internal/loaders.h"
 
 // Increment the number of bytes read in the `result` by `required` if there are
@@ -605,3 +606,270 @@ struct cbor_decoder_result cbor_stream_decode(
       return result;  // LCOV_EXCL_STOP
   }
 }
+
+// Skips the next `pending` items (including their subitems) or, for the
+// contents of an indefinite item of the given `type`, all items up to and
+// including the break. Definite nesting only increases `pending`; recursion
+// is limited to indefinite items.
+static enum cbor_decoder_status _cbor_skip_items(cbor_data source,
+                                                 size_t source_size,
+                                                 size_t* position,
+                                                 uint64_t pending,
+                                                 bool indefinite,
+                                                 cbor_type type, size_t depth) {
+  bool expecting_value = false;
+  size_t pos = *position;
+  while (indefinite || pending > 0) {
+    if (pos >= source_size || pending > source_size - pos) {
+      return CBOR_DECODER_NEDATA;
+    }
+    uint8_t initial_byte = source[pos];
+    if (pending == 0) {
+      // Direct child of the indefinite item
+      if (initial_byte == 0xFF) {
+        if (expecting_value) return CBOR_DECODER_ERROR;
+        *position = pos + 1;
+        return CBOR_DECODER_FINISHED;
+      }
+      if (type == CBOR_TYPE_BYTESTRING || type == CBOR_TYPE_STRING) {
+        // Chunks must be definite strings of the same type
+        if ((cbor_type)(initial_byte >> 5) != type ||
+            (initial_byte & 0x1F) == 0x1F) {
+          return CBOR_DECODER_ERROR;
+        }
+      } else if (type == CBOR_TYPE_MAP) {
+        expecting_value = !expecting_value;
+      }
+    } else {
+      pending--;
+    }
+    pos++;
+
+    uint8_t additional_info = initial_byte & 0x1F;
+    uint64_t argument;
+    if (additional_info < 24) {
+      argument = additional_info;
+    } else if (additional_info < 28) {
+      size_t argument_size = (size_t)1 << (additional_info - 24);
+      if (source_size - pos < argument_size) return CBOR_DECODER_NEDATA;
+      switch (argument_size) {
+        case 1:
+          argument = _cbor_load_uint8(source + pos);
+          break;
+        case 2:
+          argument = _cbor_load_uint16(source + pos);
+          break;
+        case 4:
+          argument = _cbor_load_uint32(source + pos);
+          break;
+        default:
+          argument = _cbor_load_uint64(source + pos);
+          break;
+      }
+      pos += argument_size;
+    } else if (additional_info < 31) {
+      // Reserved
+      return CBOR_DECODER_ERROR;
+    } else {
+      // Indefinite length
+      switch ((cbor_type)(initial_byte >> 5)) {
+        case CBOR_TYPE_BYTESTRING:
+        case CBOR_TYPE_STRING:
+        case CBOR_TYPE_ARRAY:
+        case CBOR_TYPE_MAP: {
+          // Same nesting limit as cbor_load
+          if (depth >= CBOR_MAX_STACK_SIZE) return CBOR_DECODER_ERROR;
+          enum cbor_decoder_status status =
+              _cbor_skip_items(source, source_size, &pos, 0, true,
+                               (cbor_type)(initial_byte >> 5), depth + 1);
+          if (status != CBOR_DECODER_FINISHED) return status;
+          continue;
+        }
+        default:
+          // Unexpected break or reserved
+          return CBOR_DECODER_ERROR;
+      }
+    }
+
+    // Every item takes at least one byte, so the remaining input bounds the
+    // number of items that can still follow. This also prevents `pending`
+    // from overflowing.
+    size_t remaining = source_size - pos;
+    if (pending > remaining) return CBOR_DECODER_NEDATA;
+    switch ((cbor_type)(initial_byte >> 5)) {
+      case CBOR_TYPE_UINT:
+      case CBOR_TYPE_NEGINT:
+        break;
+      case CBOR_TYPE_BYTESTRING:
+      case CBOR_TYPE_STRING:
+        if (argument > remaining) return CBOR_DECODER_NEDATA;
+        pos += (size_t)argument;
+        break;
+      case CBOR_TYPE_ARRAY:
+        if (argument > remaining - pending) return CBOR_DECODER_NEDATA;
+        pending += argument;
+        break;
+      case CBOR_TYPE_MAP:
+        if (argument > (remaining - pending) / 2) return CBOR_DECODER_NEDATA;
+        pending += 2 * argument;
+        break;
+      case CBOR_TYPE_TAG:
+        pending++;
+        break;
+      case CBOR_TYPE_FLOAT_CTRL:
+        // Unassigned simple values are rejected by the decoder
+        if (additional_info < 20 || additional_info == 24) {
+          return CBOR_DECODER_ERROR;
+        }
+        break;
+    }
+  }
+  *position = pos;
+  return CBOR_DECODER_FINISHED;
+}
+
+enum cbor_decoder_status cbor_skip_item(cbor_data source, size_t source_size,
+                                        size_t* end) {
+  size_t position = 0;
+  enum cbor_decoder_status status =
+      _cbor_skip_items(source, source_size, &position, 1, false,
+                       CBOR_TYPE_UINT, 0);
+  if (status == CBOR_DECODER_FINISHED) *end = position;
+  return status;
+}
+
+void cbor_stream_decoder_init(cbor_stream_decoder_t* decoder,
+                              const struct cbor_callbacks* callbacks,
+                              cbor_string_part_callback byte_string_part,
+                              cbor_string_part_callback string_part,
+                              void* context) {
+  *decoder = (cbor_stream_decoder_t){.callbacks = callbacks,
+                                     .byte_string_part = byte_string_part,
+                                     .string_part = string_part,
+                                     .context = context,
+                                     .header_length = 0,
+                                     .string_remaining = 0,
+                                     .text_string = false};
+}
+
+// Size of the header starting with `initial_byte`, including the argument
+static size_t _cbor_header_size(uint8_t initial_byte) {
+  uint8_t additional_info = initial_byte & 0x1Fu;
+  if (additional_info < 24 || additional_info > 27) return 1;
+  return 1 + ((size_t)1 << (additional_info - 24));
+}
+
+// Get the payload length if `header` is the complete header of a definite
+// string
+static bool _cbor_definite_string_length(cbor_data header, uint64_t* length) {
+  cbor_type type = (cbor_type)(header[0] >> 5);
+  uint8_t additional_info = header[0] & 0x1Fu;
+  if ((type != CBOR_TYPE_BYTESTRING && type != CBOR_TYPE_STRING) ||
+      additional_info > 27) {
+    return false;
+  }
+  switch (_cbor_header_size(header[0])) {
+    case 1:
+      *length = additional_info;
+      break;
+    case 2:
+      *length = _cbor_load_uint8(header + 1);
+      break;
+    case 3:
+      *length = _cbor_load_uint16(header + 1);
+      break;
+    case 5:
+      *length = _cbor_load_uint32(header + 1);
+      break;
+    default:
+      *length = _cbor_load_uint64(header + 1);
+      break;
+  }
+  return true;
+}
+
+struct cbor_decoder_result cbor_stream_decoder_feed(
+    cbor_stream_decoder_t* decoder, cbor_data chunk, size_t chunk_size) {
+  size_t read = 0;
+  while (true) {
+    size_t available = chunk_size - read;
+    if (decoder->string_remaining > 0) {
+      if (available == 0) break;
+      size_t length = decoder->string_remaining < available
+                          ? (size_t)decoder->string_remaining
+                          : available;
+      decoder->string_remaining -= length;
+      (decoder->text_string ? decoder->string_part : decoder->byte_string_part)(
+          decoder->context, chunk + read, length, decoder->string_remaining);
+      read += length;
+    } else if (decoder->header_length > 0) {
+      // Complete the header received so far
+      size_t length =
+          _cbor_header_size(decoder->header[0]) - decoder->header_length;
+      if (length > available) length = available;
+      memcpy(decoder->header + decoder->header_length, chunk + read, length);
+      decoder->header_length += length;
+      read += length;
+      if (decoder->header_length < _cbor_header_size(decoder->header[0])) {
+        break;
+      }
+      decoder->header_length = 0;
+      uint64_t string_length;
+      if (_cbor_definite_string_length(decoder->header, &string_length) &&
+          string_length > 0) {
+        decoder->string_remaining = string_length;
+        decoder->text_string = (decoder->header[0] >> 5) == CBOR_TYPE_STRING;
+        continue;
+      }
+      struct cbor_decoder_result result =
+          cbor_stream_decode(decoder->header,
+                             _cbor_header_size(decoder->header[0]),
+                             decoder->callbacks, decoder->context);
+      if (result.status == CBOR_DECODER_ERROR) {
+        // The item started in a previous chunk
+        return (struct cbor_decoder_result){.read = 0,
+                                            .status = CBOR_DECODER_ERROR};
+      }
+    } else {
+      if (available == 0) break;
+      size_t header_size = _cbor_header_size(chunk[read]);
+      if (header_size > available) {
+        memcpy(decoder->header, chunk + read, available);
+        decoder->header_length = available;
+        read = chunk_size;
+        break;
+      }
+      uint64_t string_length;
+      if (_cbor_definite_string_length(chunk + read, &string_length) &&
+          string_length > available - header_size) {
+        decoder->string_remaining = string_length;
+        decoder->text_string = (chunk[read] >> 5) == CBOR_TYPE_STRING;
+        read += header_size;
+        continue;
+      }
+      struct cbor_decoder_result result = cbor_stream_decode(
+          chunk + read, available, decoder->callbacks, decoder->context);
+      if (result.status == CBOR_DECODER_ERROR) {
+        return (struct cbor_decoder_result){.read = read,
+                                            .status = CBOR_DECODER_ERROR};
+      }
+      // Only the payload of a definite string could be missing
+      CBOR_ASSERT(result.status == CBOR_DECODER_FINISHED);
+      read += result.read;
+    }
+  }
+
+  struct cbor_decoder_result result = {.read = read,
+                                       .status = CBOR_DECODER_FINISHED};
+  if (decoder->header_length > 0) {
+    result.status = CBOR_DECODER_NEDATA;
+    result.required =
+        _cbor_header_size(decoder->header[0]) - decoder->header_length;
+  } else if (decoder->string_remaining > 0) {
+    result.status = CBOR_DECODER_NEDATA;
+    result.required = decoder->string_remaining > SIZE_MAX
+                          ? SIZE_MAX
+                          : (size_t)decoder->string_remaining;
+  }
+  return result;
+}
@@ -30,6 +30,88 @@ _CBOR_NODISCARD CBOR_EXPORT struct cbor_decoder_result cbor_stream_decode(
     cbor_data source, size_t source_size,
     const struct cbor_callbacks* callbacks, void* context);
 
+/** Find the end of the next item
+ *
+ * Scans the complete item at the start of \p source, including all nested
+ * items, without invoking any callbacks or allocating memory. Useful e.g. for
+ * splitting CBOR sequences (RFC 8742) into items.
+ *
+ * The input is validated to the same extent as by #cbor_load, except that
+ * only the nesting of indefinite items counts towards the
+ * `CBOR_MAX_STACK_SIZE` limit. The UTF-8 encoding of strings is not checked.
+ *
+ * @param source Input buffer
+ * @param source_size Length of the buffer
+ * @param[out] end The encoded length of the item. Only set on
+ * #CBOR_DECODER_FINISHED.
+ * @return #CBOR_DECODER_FINISHED if a complete item has been found,
+ * #CBOR_DECODER_NEDATA if the buffer ends before the item does, and
+ * #CBOR_DECODER_ERROR if the item is malformed
+ */
+_CBOR_NODISCARD CBOR_EXPORT enum cbor_decoder_status cbor_skip_item(
+    cbor_data source, size_t source_size, size_t* end);
+
+/** State of #cbor_stream_decoder_feed between chunks of the input
+ *
+ * All members are private.
+ */
+typedef struct cbor_stream_decoder {
+  const struct cbor_callbacks* callbacks;
+  cbor_string_part_callback byte_string_part;
+  cbor_string_part_callback string_part;
+  void* context;
+  /** The start of a header that has not been received completely */
+  unsigned char header[9];
+  size_t header_length;
+  /** Bytes of the current definite string that are yet to be delivered */
+  uint64_t string_remaining;
+  /** Whether the current definite string is a text string */
+  bool text_string;
+} cbor_stream_decoder_t;
+
+/** Initialize a resumable streaming decoder
+ *
+ * @param decoder The decoder to initialize
+ * @param callbacks The callback bundle
+ * @param byte_string_part Invoked for the parts of definite byte strings that
+ * span several chunks
+ * @param string_part Invoked for the parts of definite text strings that span
+ * several chunks. The parts may end in the middle of a UTF-8 code point.
+ * @param context An arbitrary pointer passed to all the callbacks
+ */
+CBOR_EXPORT void cbor_stream_decoder_init(
+    cbor_stream_decoder_t* decoder, const struct cbor_callbacks* callbacks,
+    cbor_string_part_callback byte_string_part,
+    cbor_string_part_callback string_part, void* context);
+
+/** Decode the next chunk of the input, resuming where the previous one ended
+ *
+ * Invokes the callbacks for all the items in \p chunk, like repeated calls to
+ * #cbor_stream_decode would. A header that is split between chunks is kept
+ * by the decoder and completed from the next chunk. A definite string whose
+ * payload does not end in the same chunk as its header is delivered through
+ * the part callbacks instead of the string callbacks, one part per chunk, as
+ * the payload arrives. Strings are never buffered, so arbitrarily large
+ * strings are decoded in constant memory.
+ *
+ * Like #cbor_stream_decode, the decoder does not track the nesting of the
+ * items.
+ *
+ * @param decoder An initialized decoder
+ * @param chunk The next bytes of the input
+ * @param chunk_size
+ * @return #CBOR_DECODER_FINISHED if the whole chunk has been decoded and it
+ * ends between two items.
+ * @return #CBOR_DECODER_NEDATA if the whole chunk has been decoded and it ends
+ * inside an item. `required` is the number of bytes missing from the header
+ * or the string payload.
+ * @return #CBOR_DECODER_ERROR if an item is malformed. `read` is its offset
+ * in \p chunk, or 0 if it started in a previous chunk. The decoder must be
+ * initialized again before it is reused.
+ */
+_CBOR_NODISCARD CBOR_EXPORT struct cbor_decoder_result cbor_stream_decoder_feed(
+    cbor_stream_decoder_t* decoder, cbor_data chunk, size_t chunk_size);
+
 #ifdef __cplusplus
 }
 #endif
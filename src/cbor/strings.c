@@ -7,31 +7,48 @@
 
 #include "strings.h"
 #include <string.h>
+#include "internal/atomics.h"
 #include "internal/memory_utils.h"
 #include "internal/unicode.h"
 
-cbor_item_t* cbor_new_definite_string(void) {
-  cbor_item_t* item = _cbor_malloc(sizeof(cbor_item_t));
+/* The codepoint count has not been computed yet. No string can actually have
+ * this many codepoints. */
+#define _CBOR_CODEPOINT_COUNT_UNKNOWN SIZE_MAX
+
+cbor_item_t* cbor_new_definite_string_with(
+    const struct cbor_allocator* allocator) {
+  cbor_item_t* item = _cbor_alloc_with(allocator, sizeof(cbor_item_t));
   _CBOR_NOTNULL(item);
   *item = (cbor_item_t){
       .refcount = 1,
       .type = CBOR_TYPE_STRING,
       .metadata = {.string_metadata = {.type = _CBOR_METADATA_DEFINITE,
                                        .codepoint_count = 0,
-                                       .length = 0}}};
+                                       .length = 0}},
+      .allocator = allocator};
   return item;
 }
 
-cbor_item_t* cbor_new_indefinite_string(void) {
-  cbor_item_t* item = _cbor_malloc(sizeof(cbor_item_t));
+cbor_item_t* cbor_new_definite_string(void) {
+  return cbor_new_definite_string_with(NULL);
+}
+
+cbor_item_t* cbor_new_indefinite_string_with(
+    const struct cbor_allocator* allocator) {
+  cbor_item_t* item = _cbor_alloc_with(allocator, sizeof(cbor_item_t));
   _CBOR_NOTNULL(item);
   *item = (cbor_item_t){
       .refcount = 1,
       .type = CBOR_TYPE_STRING,
       .metadata = {.string_metadata = {.type = _CBOR_METADATA_INDEFINITE,
                                        .length = 0}},
-      .data = _cbor_malloc(sizeof(struct cbor_indefinite_string_data))};
-  _CBOR_DEPENDENT_NOTNULL(item, item->data);
+      .data = _cbor_alloc_with(allocator,
+                               sizeof(struct cbor_indefinite_string_data)),
+      .allocator = allocator};
+  if (item->data == NULL) {
+    _cbor_free_with(allocator, item);
+    return NULL;
+  }
   *((struct cbor_indefinite_string_data*)item->data) =
       (struct cbor_indefinite_string_data){
           .chunk_count = 0,
@@ -41,43 +58,62 @@ cbor_item_t* cbor_new_indefinite_string(void) {
   return item;
 }
 
+cbor_item_t* cbor_new_indefinite_string(void) {
+  return cbor_new_indefinite_string_with(NULL);
+}
+
+cbor_item_t* cbor_build_string_with(const struct cbor_allocator* allocator,
+                                    const char* val) {
+  return cbor_build_stringn_with(allocator, val, strlen(val));
+}
+
 cbor_item_t* cbor_build_string(const char* val) {
-  cbor_item_t* item = cbor_new_definite_string();
-  _CBOR_NOTNULL(item);
-  size_t len = strlen(val);
-  unsigned char* handle = _cbor_malloc(len);
-  _CBOR_DEPENDENT_NOTNULL(item, handle);
-  memcpy(handle, val, len);
-  cbor_string_set_handle(item, handle, len);
-  return item;
+  return cbor_build_string_with(NULL, val);
 }
 
-cbor_item_t* cbor_build_stringn(const char* val, size_t length) {
-  cbor_item_t* item = cbor_new_definite_string();
+cbor_item_t* cbor_build_stringn_with(const struct cbor_allocator* allocator,
+                                     const char* val, size_t length) {
+  cbor_item_t* item = cbor_new_definite_string_with(allocator);
   _CBOR_NOTNULL(item);
-  unsigned char* handle = _cbor_malloc(length);
-  _CBOR_DEPENDENT_NOTNULL(item, handle);
+  unsigned char* handle = _cbor_alloc_with(allocator, length);
+  if (handle == NULL) {
+    _cbor_free_with(allocator, item);
+    return NULL;
+  }
   memcpy(handle, val, length);
   cbor_string_set_handle(item, handle, length);
   return item;
 }
 
+cbor_item_t* cbor_build_stringn(const char* val, size_t length) {
+  return cbor_build_stringn_with(NULL, val, length);
+}
+
 void cbor_string_set_handle(cbor_item_t* item,
                             cbor_mutable_data CBOR_RESTRICT_POINTER data,
                             size_t length) {
   CBOR_ASSERT(cbor_isa_string(item));
   CBOR_ASSERT(cbor_string_is_definite(item));
   item->data = data;
+  item->flags &= (uint8_t)~_CBOR_ITEM_BORROWED;
   item->metadata.string_metadata.length = length;
+  // Counting the codepoints takes a pass over the data, most strings are never
+  // asked for it
+  item->metadata.string_metadata.codepoint_count =
+      _CBOR_CODEPOINT_COUNT_UNKNOWN;
+}
+
+bool _cbor_string_validate(cbor_item_t* item) {
+  CBOR_ASSERT(cbor_isa_string(item));
+  CBOR_ASSERT(cbor_string_is_definite(item));
   struct _cbor_unicode_status unicode_status;
-  size_t codepoint_count =
-      _cbor_unicode_codepoint_count(data, length, &unicode_status);
-  CBOR_ASSERT(codepoint_count <= length);
-  if (unicode_status.status == _CBOR_UNICODE_OK) {
-    item->metadata.string_metadata.codepoint_count = codepoint_count;
-  } else {
-    item->metadata.string_metadata.codepoint_count = 0;
-  }
+  size_t codepoint_count = _cbor_unicode_codepoint_count(
+      item->data, item->metadata.string_metadata.length, &unicode_status);
+  CBOR_ASSERT(codepoint_count <= item->metadata.string_metadata.length);
+  bool valid = unicode_status.status == _CBOR_UNICODE_OK;
+  _cbor_atomic_store(&item->metadata.string_metadata.codepoint_count,
+                     valid ? codepoint_count : 0);
+  return valid;
 }
 
 cbor_item_t** cbor_string_chunks_handle(const cbor_item_t* item) {
@@ -105,8 +141,9 @@ bool cbor_string_add_chunk(cbor_item_t* item, cbor_item_t* chunk) {
     size_t new_chunk_capacity =
         data->chunk_capacity == 0 ? 1
                                   : CBOR_BUFFER_GROWTH * (data->chunk_capacity);
-    cbor_item_t** new_chunks_data = _cbor_realloc_multiple(
-        data->chunks, sizeof(cbor_item_t*), new_chunk_capacity);
+    cbor_item_t** new_chunks_data = _cbor_realloc_multiple_with(
+        item->allocator, data->chunks, sizeof(cbor_item_t*),
+        data->chunk_capacity, new_chunk_capacity);
 
     if (new_chunks_data == NULL) {
       return false;
@@ -131,7 +168,14 @@ unsigned char* cbor_string_handle(const cbor_item_t* item) {
 
 size_t cbor_string_codepoint_count(const cbor_item_t* item) {
   CBOR_ASSERT(cbor_isa_string(item));
-  return item->metadata.string_metadata.codepoint_count;
+  size_t* codepoint_count =
+      (size_t*)&item->metadata.string_metadata.codepoint_count;
+  if (_cbor_atomic_load(codepoint_count) == _CBOR_CODEPOINT_COUNT_UNKNOWN) {
+    // The cached count is not part of the logical value of the item. Threads
+    // sharing the item may race to compute it, but they store the same value.
+    _cbor_string_validate((cbor_item_t*)item);
+  }
+  return _cbor_atomic_load(codepoint_count);
 }
 
 bool cbor_string_is_definite(const cbor_item_t* item) {
@@ -142,3 +186,8 @@ bool cbor_string_is_definite(const cbor_item_t* item) {
 bool cbor_string_is_indefinite(const cbor_item_t* item) {
   return !cbor_string_is_definite(item);
 }
+
+bool cbor_string_is_borrowed(const cbor_item_t* item) {
+  CBOR_ASSERT(cbor_isa_string(item));
+  return item->flags & _CBOR_ITEM_BORROWED;
+}
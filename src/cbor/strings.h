@@ -34,7 +34,11 @@ _CBOR_NODISCARD CBOR_EXPORT size_t cbor_string_length(const cbor_item_t* item);
 /** The number of codepoints in this string
  *
  * Might differ from `cbor_string_length` if there are multibyte codepoints.
- * If the string data is not valid UTF-8, returns 0.
+ * If the string data is not valid UTF-8, returns 0. Always 0 for indefinite
+ * strings.
+ *
+ * The count is computed on the first call and cached in the item, so the
+ * first call takes time linear in the length of the string.
  *
  * @param item A string
  * @return The number of codepoints in this string
@@ -58,10 +62,22 @@ _CBOR_NODISCARD CBOR_EXPORT bool cbor_string_is_definite(
 _CBOR_NODISCARD CBOR_EXPORT bool cbor_string_is_indefinite(
     const cbor_item_t* item);
 
+/** Does the string point into a buffer it does not own?
+ *
+ * Strings loaded by #cbor_load_borrowed reference the input buffer. Their
+ * data must not be modified and is valid only as long as the buffer.
+ *
+ * @param item a string
+ * @return Is the string data borrowed?
+ */
+_CBOR_NODISCARD CBOR_EXPORT bool cbor_string_is_borrowed(
+    const cbor_item_t* item);
+
 /** Get the handle to the underlying string
  *
- * Definite items only. Modifying the data is allowed. In that case, the caller
- * takes responsibility for the effect on items this item might be a part of
+ * Definite items only. Borrowed data (see #cbor_string_is_borrowed) must not be
+ * modified. Other data can be modified, in which case the caller takes
+ * responsibility for the effect on items this item might be a part of
  *
  * @param item A definite string
  * @return The address of the underlying string.
@@ -72,8 +88,9 @@ cbor_string_handle(const cbor_item_t* item);
 
 /** Set the handle to the underlying string
  *
- * The data is assumed to be a valid UTF-8 string. If the string is non-empty
- * and invalid, `cbor_string_codepoint_count` will return 0.
+ * The data is assumed to be a valid UTF-8 string, but it is not checked. If
+ * the string is non-empty and invalid, `cbor_string_codepoint_count` will
+ * return 0.
  *
  * \rst
  * .. warning::
@@ -136,6 +153,17 @@ _CBOR_NODISCARD CBOR_EXPORT bool cbor_string_add_chunk(cbor_item_t* item,
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_definite_string(void);
 
+/** Like #cbor_new_definite_string, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @return Reference to the new string item. The item's reference count is
+ * initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_definite_string_with(
+    const struct cbor_allocator* allocator);
+
 /** Creates a new indefinite string
  *
  * The chunks array is initialized to `NULL` and chunkcount to 0
@@ -146,6 +174,17 @@ _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_definite_string(void);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_indefinite_string(void);
 
+/** Like #cbor_new_indefinite_string, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @return Reference to the new string item. The item's reference count is
+ * initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_indefinite_string_with(
+    const struct cbor_allocator* allocator);
+
 /** Creates a new string and initializes it
  *
  * The data from `val` will be copied to a newly allocated memory block.
@@ -161,6 +200,18 @@ _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_indefinite_string(void);
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_string(const char* val);
 
+/** Like #cbor_build_string, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @param val A null-terminated UTF-8 string
+ * @return Reference to the new string item. The item's reference count is
+ * initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_string_with(
+    const struct cbor_allocator* allocator, const char* val);
+
 /** Creates a new string and initializes it
  *
  * The data from `handle` will be copied to a newly allocated memory block.
@@ -177,6 +228,19 @@ _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_string(const char* val);
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_stringn(const char* val,
                                                             size_t length);
 
+/** Like #cbor_build_stringn, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @param val A UTF-8 string, at least @p `length` bytes long
+ * @param length Length (in bytes) of the string passed in @p `val`.
+ * @return Reference to the new string item. The item's reference count is
+ * initialized to one.
+ * @return `NULL` if memory allocation fails
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_stringn_with(
+    const struct cbor_allocator* allocator, const char* val, size_t length);
+
 #ifdef __cplusplus
 }
 #endif
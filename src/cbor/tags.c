@@ -6,20 +6,26 @@
  */
 
 #include "tags.h"
+#include "internal/memory_utils.h"
 
-cbor_item_t* cbor_new_tag(uint64_t value) {
-  cbor_item_t* item = _cbor_malloc(sizeof(cbor_item_t));
+cbor_item_t* cbor_new_tag_with(const struct cbor_allocator* allocator,
+                               uint64_t value) {
+  cbor_item_t* item = _cbor_alloc_with(allocator, sizeof(cbor_item_t));
   _CBOR_NOTNULL(item);
 
   *item = (cbor_item_t){
       .refcount = 1,
       .type = CBOR_TYPE_TAG,
       .metadata = {.tag_metadata = {.value = value, .tagged_item = NULL}},
-      .data = NULL /* Never used */
-  };
+      .data = NULL, /* Never used */
+      .allocator = allocator};
   return item;
 }
 
+cbor_item_t* cbor_new_tag(uint64_t value) {
+  return cbor_new_tag_with(NULL, value);
+}
+
 cbor_item_t* cbor_tag_item(const cbor_item_t* tag) {
   CBOR_ASSERT(cbor_isa_tag(tag));
   if (tag->metadata.tag_metadata.tagged_item == NULL) {
@@ -42,11 +48,16 @@ void cbor_tag_set_item(cbor_item_t* tag, cbor_item_t* tagged_item) {
   tag->metadata.tag_metadata.tagged_item = tagged_item;
 }
 
-cbor_item_t* cbor_build_tag(uint64_t value, cbor_item_t* item) {
-  cbor_item_t* res = cbor_new_tag(value);
+cbor_item_t* cbor_build_tag_with(const struct cbor_allocator* allocator,
+                                 uint64_t value, cbor_item_t* item) {
+  cbor_item_t* res = cbor_new_tag_with(allocator, value);
   if (res == NULL) {
     return NULL;
   }
   cbor_tag_set_item(res, item);
   return res;
 }
+
+cbor_item_t* cbor_build_tag(uint64_t value, cbor_item_t* item) {
+  return cbor_build_tag_with(NULL, value, item);
+}
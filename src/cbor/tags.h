@@ -30,6 +30,18 @@ extern "C" {
  */
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_tag(uint64_t value);
 
+/** Like #cbor_new_tag, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @param value The tag value (number).
+ * @return Reference to the new tag. Its reference count is initialized to one
+ * and it points to a `NULL` item.
+ * @return `NULL` if memory allocation fails.
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_new_tag_with(
+    const struct cbor_allocator* allocator, uint64_t value);
+
 /** Get the tagged item (what the tag points to).
  *
  * @param tag A #CBOR_TYPE_TAG tag.
@@ -71,6 +83,20 @@ CBOR_EXPORT void cbor_tag_set_item(cbor_item_t* tag, cbor_item_t* tagged_item);
 _CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_tag(uint64_t value,
                                                         cbor_item_t* item);
 
+/** Like #cbor_build_tag, but allocates from \p allocator
+ *
+ * @param allocator Where the item and its data are allocated. `NULL` stands
+ * for the global routines set by #cbor_set_allocs. Must outlive the item.
+ * @param item The item to tag. Its reference count will be increased by
+ * one.
+ * @param value The tag value (number).
+ * @return Reference to the new tag item. The item's reference count is
+ * initialized to one.
+ * @return `NULL` if memory allocation fails.
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_build_tag_with(
+    const struct cbor_allocator* allocator, uint64_t value, cbor_item_t* item);
+
 #ifdef __cplusplus
 }
 #endif
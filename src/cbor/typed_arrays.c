@@ -0,0 +1,392 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include "typed_arrays.h"
+#include <string.h>
+#include "internal/loaders.h"
+
+#ifdef IS_BIG_ENDIAN
+#define _CBOR_HOST_LITTLE_ENDIAN false
+#else
+#define _CBOR_HOST_LITTLE_ENDIAN true
+#endif
+
+static const cbor_typed_array_type _cbor_typed_array_uint_types[] = {
+    CBOR_TYPED_ARRAY_UINT8, CBOR_TYPED_ARRAY_UINT16, CBOR_TYPED_ARRAY_UINT32,
+    CBOR_TYPED_ARRAY_UINT64};
+
+static const cbor_typed_array_type _cbor_typed_array_sint_types[] = {
+    CBOR_TYPED_ARRAY_SINT8, CBOR_TYPED_ARRAY_SINT16, CBOR_TYPED_ARRAY_SINT32,
+    CBOR_TYPED_ARRAY_SINT64};
+
+static const cbor_typed_array_type _cbor_typed_array_float_types[] = {
+    CBOR_TYPED_ARRAY_FLOAT16, CBOR_TYPED_ARRAY_FLOAT32,
+    CBOR_TYPED_ARRAY_FLOAT64, CBOR_TYPED_ARRAY_FLOAT128};
+
+static bool _cbor_typed_array_is_float(const struct cbor_typed_array* array) {
+  return array->type >= CBOR_TYPED_ARRAY_FLOAT16;
+}
+
+static bool _cbor_typed_array_is_signed(const struct cbor_typed_array* array) {
+  return array->type >= CBOR_TYPED_ARRAY_SINT8 &&
+         array->type <= CBOR_TYPED_ARRAY_SINT64;
+}
+
+static void _cbor_set_error(struct cbor_load_result* result,
+                            cbor_error_code code, size_t position) {
+  result->error.code = code;
+  result->error.position = position;
+}
+
+// Read the initial byte and the argument of the header at `*position`. The
+// argument is not set for indefinite length items and the break code.
+static cbor_error_code _cbor_read_head(cbor_data source, size_t source_size,
+                                       size_t* position, uint8_t* initial_byte,
+                                       uint64_t* argument) {
+  if (*position >= source_size) return CBOR_ERR_NOTENOUGHDATA;
+  *initial_byte = source[(*position)++];
+  uint8_t additional_info = *initial_byte & 0x1F;
+  if (additional_info < 24) {
+    *argument = additional_info;
+    return CBOR_ERR_NONE;
+  }
+  if (additional_info == 31) return CBOR_ERR_NONE;
+  if (additional_info > 27) return CBOR_ERR_MALFORMATED;
+
+  size_t argument_size = (size_t)1 << (additional_info - 24);
+  if (source_size - *position < argument_size) return CBOR_ERR_NOTENOUGHDATA;
+  switch (argument_size) {
+    case 1:
+      *argument = _cbor_load_uint8(source + *position);
+      break;
+    case 2:
+      *argument = _cbor_load_uint16(source + *position);
+      break;
+    case 4:
+      *argument = _cbor_load_uint32(source + *position);
+      break;
+    default:
+      *argument = _cbor_load_uint64(source + *position);
+      break;
+  }
+  *position += argument_size;
+  return CBOR_ERR_NONE;
+}
+
+// Decode the tag of a typed array. The payload is filled in by the caller.
+static bool _cbor_typed_array_from_tag(uint64_t tag,
+                                       struct cbor_typed_array* array) {
+  if (tag < 64 || tag > 87 || tag == 76) return false;
+  // RFC 8746, Section 2.1: 0b010_f_s_e_ll
+  unsigned bits = (unsigned)(tag - 64);
+  unsigned ll = bits & 0x03;
+  array->little_endian = (bits & 0x04) != 0;
+  if (bits & 0x10) {
+    array->type = _cbor_typed_array_float_types[ll];
+    array->element_size = (size_t)2 << ll;
+  } else if (bits & 0x08) {
+    array->type = _cbor_typed_array_sint_types[ll];
+    array->element_size = (size_t)1 << ll;
+  } else {
+    array->type = tag == 68 ? CBOR_TYPED_ARRAY_UINT8_CLAMPED
+                            : _cbor_typed_array_uint_types[ll];
+    array->element_size = (size_t)1 << ll;
+  }
+  // The endianness bit distinguishes the clamped array for single bytes
+  if (array->element_size == 1) array->little_endian = false;
+  return true;
+}
+
+bool cbor_typed_array_parse(cbor_data source, size_t source_size,
+                            struct cbor_typed_array* array,
+                            struct cbor_load_result* result) {
+  *result = (struct cbor_load_result){.error = {.code = CBOR_ERR_NONE}};
+  if (source_size == 0) {
+    _cbor_set_error(result, CBOR_ERR_NODATA, 0);
+    return false;
+  }
+
+  size_t position = 0;
+  uint8_t initial_byte;
+  uint64_t argument = 0;
+  cbor_error_code code = _cbor_read_head(source, source_size, &position,
+                                         &initial_byte, &argument);
+  if (code != CBOR_ERR_NONE) {
+    _cbor_set_error(result, code, position);
+    return false;
+  }
+  if ((cbor_type)(initial_byte >> 5) != CBOR_TYPE_TAG ||
+      (initial_byte & 0x1F) == 31 ||
+      !_cbor_typed_array_from_tag(argument, array)) {
+    _cbor_set_error(result, CBOR_ERR_SYNTAXERROR, 0);
+    return false;
+  }
+
+  size_t payload_start = position;
+  code = _cbor_read_head(source, source_size, &position, &initial_byte,
+                         &argument);
+  if (code != CBOR_ERR_NONE) {
+    _cbor_set_error(result, code, position);
+    return false;
+  }
+  if ((cbor_type)(initial_byte >> 5) != CBOR_TYPE_BYTESTRING ||
+      (initial_byte & 0x1F) == 31) {
+    _cbor_set_error(result, CBOR_ERR_SYNTAXERROR, payload_start);
+    return false;
+  }
+  if (argument > source_size - position) {
+    _cbor_set_error(result, CBOR_ERR_NOTENOUGHDATA, source_size);
+    return false;
+  }
+  if (argument % array->element_size != 0) {
+    _cbor_set_error(result, CBOR_ERR_SYNTAXERROR, payload_start);
+    return false;
+  }
+
+  array->data = source + position;
+  array->length = (size_t)argument / array->element_size;
+  result->read = position + (size_t)argument;
+  return true;
+}
+
+const void* cbor_typed_array_native(const struct cbor_typed_array* array,
+                                    void* buffer) {
+  size_t size = array->element_size;
+  bool swap = size > 1 && array->little_endian != _CBOR_HOST_LITTLE_ENDIAN;
+  if (!swap && (uintptr_t)array->data % size == 0) return array->data;
+  if (buffer == NULL) return NULL;
+
+  if (!swap) {
+    memcpy(buffer, array->data, array->length * size);
+    return buffer;
+  }
+  unsigned char* target = buffer;
+  for (size_t i = 0; i < array->length; i++) {
+    for (size_t j = 0; j < size; j++) {
+      target[i * size + j] = array->data[i * size + size - 1 - j];
+    }
+  }
+  return buffer;
+}
+
+// Load the element bits, most significant byte first
+static uint64_t _cbor_typed_array_bits(const struct cbor_typed_array* array,
+                                       size_t index) {
+  cbor_data element = array->data + index * array->element_size;
+  uint64_t bits = 0;
+  for (size_t i = 0; i < array->element_size; i++) {
+    bits = (bits << 8) |
+           element[array->little_endian ? array->element_size - 1 - i : i];
+  }
+  return bits;
+}
+
+// Interpret the low `size` bytes of `bits` as a two's complement number
+static int64_t _cbor_sign_extend(uint64_t bits, size_t size) {
+  uint64_t sign = (uint64_t)1 << (8 * size - 1);
+  if ((bits & sign) == 0) return (int64_t)bits;
+  return -1 - (int64_t)(~bits & (sign - 1));
+}
+
+static bool _cbor_typed_array_to_int64(const struct cbor_typed_array* array,
+                                       int64_t* buffer) {
+  if (array->type == CBOR_TYPED_ARRAY_SINT64 &&
+      array->little_endian == _CBOR_HOST_LITTLE_ENDIAN) {
+    memcpy(buffer, array->data, array->length * sizeof(int64_t));
+    return true;
+  }
+  for (size_t i = 0; i < array->length; i++) {
+    uint64_t bits = _cbor_typed_array_bits(array, i);
+    if (_cbor_typed_array_is_signed(array)) {
+      buffer[i] = _cbor_sign_extend(bits, array->element_size);
+    } else {
+      if (bits > INT64_MAX) return false;
+      buffer[i] = (int64_t)bits;
+    }
+  }
+  return true;
+}
+
+static void _cbor_typed_array_to_double(const struct cbor_typed_array* array,
+                                        double* buffer) {
+  if (array->type == CBOR_TYPED_ARRAY_FLOAT64 &&
+      array->little_endian == _CBOR_HOST_LITTLE_ENDIAN) {
+    memcpy(buffer, array->data, array->length * sizeof(double));
+    return;
+  }
+  for (size_t i = 0; i < array->length; i++) {
+    uint64_t bits = _cbor_typed_array_bits(array, i);
+    switch (array->type) {
+      case CBOR_TYPED_ARRAY_FLOAT16: {
+        unsigned char half[2] = {(unsigned char)(bits >> 8),
+                                 (unsigned char)bits};
+        buffer[i] = _cbor_load_half(half);
+        break;
+      }
+      case CBOR_TYPED_ARRAY_FLOAT32: {
+        union _cbor_float_helper helper = {.as_uint = (uint32_t)bits};
+        buffer[i] = helper.as_float;
+        break;
+      }
+      default: {
+        union _cbor_double_helper helper = {.as_uint = bits};
+        buffer[i] = helper.as_double;
+        break;
+      }
+    }
+  }
+}
+
+// Typed array variant of _cbor_load_numeric_array
+static size_t _cbor_load_typed_array(cbor_data source, size_t source_size,
+                                     bool floats, int64_t* int_buffer,
+                                     double* float_buffer, size_t buffer_size,
+                                     struct cbor_load_result* result) {
+  struct cbor_typed_array array;
+  if (!cbor_typed_array_parse(source, source_size, &array, result)) return 0;
+  if (_cbor_typed_array_is_float(&array) != floats ||
+      array.type == CBOR_TYPED_ARRAY_FLOAT128) {
+    _cbor_set_error(result, CBOR_ERR_SYNTAXERROR, 0);
+    return 0;
+  }
+  if (array.length > buffer_size) {
+    _cbor_set_error(result, CBOR_ERR_BUFFER_TOO_SMALL, 0);
+    return array.length;
+  }
+  if (array.length == 0) return 0;
+  if (floats) {
+    _cbor_typed_array_to_double(&array, float_buffer);
+  } else if (!_cbor_typed_array_to_int64(&array, int_buffer)) {
+    _cbor_set_error(result, CBOR_ERR_SYNTAXERROR, 0);
+    return 0;
+  }
+  return array.length;
+}
+
+// Decode one element of a plain array
+static cbor_error_code _cbor_load_number(cbor_data source, size_t source_size,
+                                         size_t* position, bool floats,
+                                         int64_t* int_value,
+                                         double* float_value) {
+  uint8_t initial_byte;
+  uint64_t argument = 0;
+  cbor_error_code code = _cbor_read_head(source, source_size, position,
+                                         &initial_byte, &argument);
+  if (code != CBOR_ERR_NONE) return code;
+
+  if (floats) {
+    switch (initial_byte) {
+      case 0xF9:
+        *float_value = _cbor_load_half(source + *position - 2);
+        return CBOR_ERR_NONE;
+      case 0xFA: {
+        union _cbor_float_helper helper = {.as_uint = (uint32_t)argument};
+        *float_value = helper.as_float;
+        return CBOR_ERR_NONE;
+      }
+      case 0xFB: {
+        union _cbor_double_helper helper = {.as_uint = argument};
+        *float_value = helper.as_double;
+        return CBOR_ERR_NONE;
+      }
+      default:
+        return CBOR_ERR_SYNTAXERROR;
+    }
+  }
+
+  if ((initial_byte & 0x1F) == 31 || argument > INT64_MAX) {
+    return CBOR_ERR_SYNTAXERROR;
+  }
+  switch ((cbor_type)(initial_byte >> 5)) {
+    case CBOR_TYPE_UINT:
+      *int_value = (int64_t)argument;
+      return CBOR_ERR_NONE;
+    case CBOR_TYPE_NEGINT:
+      *int_value = -1 - (int64_t)argument;
+      return CBOR_ERR_NONE;
+    default:
+      return CBOR_ERR_SYNTAXERROR;
+  }
+}
+
+static size_t _cbor_load_numeric_array(cbor_data source, size_t source_size,
+                                       bool floats, int64_t* int_buffer,
+                                       double* float_buffer, size_t buffer_size,
+                                       struct cbor_load_result* result) {
+  *result = (struct cbor_load_result){.error = {.code = CBOR_ERR_NONE}};
+  if (source_size == 0) {
+    _cbor_set_error(result, CBOR_ERR_NODATA, 0);
+    return 0;
+  }
+  if ((cbor_type)(source[0] >> 5) == CBOR_TYPE_TAG) {
+    return _cbor_load_typed_array(source, source_size, floats, int_buffer,
+                                  float_buffer, buffer_size, result);
+  }
+
+  size_t position = 0;
+  uint8_t initial_byte;
+  uint64_t length = 0;
+  cbor_error_code code = _cbor_read_head(source, source_size, &position,
+                                         &initial_byte, &length);
+  if (code != CBOR_ERR_NONE) {
+    _cbor_set_error(result, code, position);
+    return 0;
+  }
+  if ((cbor_type)(initial_byte >> 5) != CBOR_TYPE_ARRAY) {
+    _cbor_set_error(result, CBOR_ERR_SYNTAXERROR, 0);
+    return 0;
+  }
+  bool indefinite = (initial_byte & 0x1F) == 31;
+  // Every element takes at least one byte
+  if (!indefinite && length > source_size - position) {
+    _cbor_set_error(result, CBOR_ERR_NOTENOUGHDATA, source_size);
+    return 0;
+  }
+
+  size_t count = 0;
+  int64_t int_value = 0;
+  double float_value = 0;
+  while (indefinite || count < length) {
+    if (indefinite && position < source_size && source[position] == 0xFF) {
+      position++;
+      break;
+    }
+    size_t element_start = position;
+    code = _cbor_load_number(source, source_size, &position, floats,
+                             &int_value, &float_value);
+    if (code != CBOR_ERR_NONE) {
+      _cbor_set_error(result, code, element_start);
+      return 0;
+    }
+    if (count < buffer_size) {
+      if (floats) {
+        float_buffer[count] = float_value;
+      } else {
+        int_buffer[count] = int_value;
+      }
+    }
+    count++;
+  }
+
+  result->read = position;
+  if (count > buffer_size) _cbor_set_error(result, CBOR_ERR_BUFFER_TOO_SMALL, 0);
+  return count;
+}
+
+size_t cbor_load_int64_array(cbor_data source, size_t source_size,
+                             int64_t* buffer, size_t buffer_size,
+                             struct cbor_load_result* result) {
+  return _cbor_load_numeric_array(source, source_size, false, buffer, NULL,
+                                  buffer_size, result);
+}
+
+size_t cbor_load_double_array(cbor_data source, size_t source_size,
+                              double* buffer, size_t buffer_size,
+                              struct cbor_load_result* result) {
+  return _cbor_load_numeric_array(source, source_size, true, NULL, buffer,
+                                  buffer_size, result);
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#ifndef LIBCBOR_TYPED_ARRAYS_H
+#define LIBCBOR_TYPED_ARRAYS_H
+
+#include "cbor/cbor_export.h"
+#include "cbor/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * ============================================================================
+ * Bulk decoding of numeric arrays
+ * ============================================================================
+ */
+
+/** Element types of RFC 8746 typed arrays */
+typedef enum {
+  CBOR_TYPED_ARRAY_UINT8 /** Tag 64 */
+  ,
+  CBOR_TYPED_ARRAY_UINT8_CLAMPED /** Tag 68 */
+  ,
+  CBOR_TYPED_ARRAY_UINT16 /** Tags 65 and 69 */
+  ,
+  CBOR_TYPED_ARRAY_UINT32 /** Tags 66 and 70 */
+  ,
+  CBOR_TYPED_ARRAY_UINT64 /** Tags 67 and 71 */
+  ,
+  CBOR_TYPED_ARRAY_SINT8 /** Tag 72 */
+  ,
+  CBOR_TYPED_ARRAY_SINT16 /** Tags 73 and 77 */
+  ,
+  CBOR_TYPED_ARRAY_SINT32 /** Tags 74 and 78 */
+  ,
+  CBOR_TYPED_ARRAY_SINT64 /** Tags 75 and 79 */
+  ,
+  CBOR_TYPED_ARRAY_FLOAT16 /** Tags 80 and 84 */
+  ,
+  CBOR_TYPED_ARRAY_FLOAT32 /** Tags 81 and 85 */
+  ,
+  CBOR_TYPED_ARRAY_FLOAT64 /** Tags 82 and 86 */
+  ,
+  CBOR_TYPED_ARRAY_FLOAT128 /** Tags 83 and 87 */
+} cbor_typed_array_type;
+
+/** An RFC 8746 typed array located in an encoded buffer */
+struct cbor_typed_array {
+  /** Type of the elements */
+  cbor_typed_array_type type;
+  /** Whether the elements are stored in little endian byte order */
+  bool little_endian;
+  /** Size of a single element in bytes */
+  size_t element_size;
+  /** Number of elements */
+  size_t length;
+  /** The payload, `length * element_size` bytes within the buffer */
+  cbor_data data;
+};
+
+/** Locate a typed array
+ *
+ * Recognizes a tag 64 through 87 (except for the reserved tag 76) holding a
+ * definite byte string. Nothing is copied, the payload stays in \p source.
+ *
+ * @param source The buffer
+ * @param source_size
+ * @param[out] array The typed array, only valid on success
+ * @param[out] result Result indicator. #CBOR_ERR_SYNTAXERROR if the item is
+ * well-formed but not a typed array, or the length of the payload is not a
+ * multiple of the element size.
+ * @return Whether a typed array has been found
+ */
+_CBOR_NODISCARD CBOR_EXPORT bool cbor_typed_array_parse(
+    cbor_data source, size_t source_size, struct cbor_typed_array* array,
+    struct cbor_load_result* result);
+
+/** Get the elements of a typed array in the host byte order
+ *
+ * When the byte order of the payload matches the host and the payload is
+ * suitably aligned, a pointer into the payload is returned and nothing is
+ * copied. Otherwise, the elements are copied to \p buffer and their byte order
+ * is converted.
+ *
+ * @param array A typed array
+ * @param buffer Storage for `array->length * array->element_size` bytes. May
+ * be `NULL` if the caller only wants to use the payload in place.
+ * @return Pointer to `array->length` elements, either into the payload or to
+ * \p buffer. `NULL` if a conversion is needed and \p buffer is `NULL`.
+ */
+_CBOR_NODISCARD CBOR_EXPORT const void* cbor_typed_array_native(
+    const struct cbor_typed_array* array, void* buffer);
+
+/** Decode an array of integers into a buffer
+ *
+ * Accepts a definite or indefinite array of unsigned and negative integers
+ * or an integer typed array (see #cbor_typed_array_parse). No items are
+ * created.
+ *
+ * If the array has more than \p buffer_size elements, the array is still
+ * validated, #CBOR_ERR_BUFFER_TOO_SMALL is reported, and the number of elements is
+ * returned so that the call can be retried with a large enough buffer.
+ *
+ * @param source The buffer
+ * @param source_size
+ * @param buffer Storage for the elements
+ * @param buffer_size Capacity of \p buffer in elements
+ * @param[out] result Result indicator. #CBOR_ERR_SYNTAXERROR if the item is
+ * well-formed but not an array of integers or an element does not fit an
+ * `int64_t`.
+ * @return The number of elements
+ */
+_CBOR_NODISCARD CBOR_EXPORT size_t cbor_load_int64_array(
+    cbor_data source, size_t source_size, int64_t* buffer, size_t buffer_size,
+    struct cbor_load_result* result);
+
+/** Decode an array of floats into a buffer
+ *
+ * Accepts a definite or indefinite array of half, single, and double
+ * precision floats or a float typed array (see #cbor_typed_array_parse)
+ * other than binary128. No items are created.
+ *
+ * If the array has more than \p buffer_size elements, the array is still
+ * validated, #CBOR_ERR_BUFFER_TOO_SMALL is reported, and the number of elements is
+ * returned so that the call can be retried with a large enough buffer.
+ *
+ * @param source The buffer
+ * @param source_size
+ * @param buffer Storage for the elements
+ * @param buffer_size Capacity of \p buffer in elements
+ * @param[out] result Result indicator. #CBOR_ERR_SYNTAXERROR if the item is
+ * well-formed but not an array of floats.
+ * @return The number of elements
+ */
+_CBOR_NODISCARD CBOR_EXPORT size_t cbor_load_double_array(
+    cbor_data source, size_t source_size, double* buffer, size_t buffer_size,
+    struct cbor_load_result* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // LIBCBOR_TYPED_ARRAYS_H
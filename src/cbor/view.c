@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include "view.h"
+#include <string.h>
+#include "streaming.h"
+
+/** What a single #cbor_stream_decode step has seen */
+enum _cbor_view_head_kind {
+  /** An item without subitems, e.g. an integer or a definite string */
+  _CBOR_VIEW_HEAD_LEAF,
+  /** Definite array, map, or a tag, followed by `count` subitems */
+  _CBOR_VIEW_HEAD_DEFINITE,
+  /** Indefinite container or string, followed by subitems and a break */
+  _CBOR_VIEW_HEAD_INDEFINITE,
+  /** The "break" stop code */
+  _CBOR_VIEW_HEAD_BREAK,
+};
+
+struct _cbor_view_head {
+  enum _cbor_view_head_kind kind;
+  /** Number of subitems of #_CBOR_VIEW_HEAD_DEFINITE */
+  uint64_t count;
+  /** Value of an unsigned integer or the length of a definite string */
+  uint64_t value;
+  /** Data of a definite string */
+  cbor_data string;
+  /** Bytes taken by the head (and data of definite strings) */
+  size_t read;
+};
+
+static void _cbor_view_leaf(void* context) {
+  ((struct _cbor_view_head*)context)->kind = _CBOR_VIEW_HEAD_LEAF;
+}
+
+static void _cbor_view_uint8(void* context, uint8_t value) {
+  _cbor_view_leaf(context);
+  ((struct _cbor_view_head*)context)->value = value;
+}
+
+static void _cbor_view_uint16(void* context, uint16_t value) {
+  _cbor_view_leaf(context);
+  ((struct _cbor_view_head*)context)->value = value;
+}
+
+static void _cbor_view_uint32(void* context, uint32_t value) {
+  _cbor_view_leaf(context);
+  ((struct _cbor_view_head*)context)->value = value;
+}
+
+static void _cbor_view_uint64(void* context, uint64_t value) {
+  _cbor_view_leaf(context);
+  ((struct _cbor_view_head*)context)->value = value;
+}
+
+static void _cbor_view_negint8(void* context, uint8_t value _CBOR_UNUSED) {
+  _cbor_view_leaf(context);
+}
+
+static void _cbor_view_negint16(void* context, uint16_t value _CBOR_UNUSED) {
+  _cbor_view_leaf(context);
+}
+
+static void _cbor_view_negint32(void* context, uint32_t value _CBOR_UNUSED) {
+  _cbor_view_leaf(context);
+}
+
+static void _cbor_view_negint64(void* context, uint64_t value _CBOR_UNUSED) {
+  _cbor_view_leaf(context);
+}
+
+static void _cbor_view_string(void* context, cbor_data data, uint64_t length) {
+  struct _cbor_view_head* head = context;
+  head->kind = _CBOR_VIEW_HEAD_LEAF;
+  head->string = data;
+  head->value = length;
+}
+
+static void _cbor_view_indefinite(void* context) {
+  ((struct _cbor_view_head*)context)->kind = _CBOR_VIEW_HEAD_INDEFINITE;
+}
+
+static void _cbor_view_array(void* context, uint64_t size) {
+  struct _cbor_view_head* head = context;
+  head->kind = _CBOR_VIEW_HEAD_DEFINITE;
+  head->count = size;
+}
+
+static void _cbor_view_map(void* context, uint64_t size) {
+  struct _cbor_view_head* head = context;
+  head->kind = _CBOR_VIEW_HEAD_DEFINITE;
+  // Number of pairs, the keys and values are skipped separately
+  head->count = size;
+}
+
+static void _cbor_view_tag(void* context, uint64_t value) {
+  struct _cbor_view_head* head = context;
+  head->kind = _CBOR_VIEW_HEAD_DEFINITE;
+  head->count = 1;
+  head->value = value;
+}
+
+static void _cbor_view_float(void* context, float value _CBOR_UNUSED) {
+  _cbor_view_leaf(context);
+}
+
+static void _cbor_view_double(void* context, double value _CBOR_UNUSED) {
+  _cbor_view_leaf(context);
+}
+
+static void _cbor_view_bool(void* context, bool value _CBOR_UNUSED) {
+  _cbor_view_leaf(context);
+}
+
+static void _cbor_view_break(void* context) {
+  ((struct _cbor_view_head*)context)->kind = _CBOR_VIEW_HEAD_BREAK;
+}
+
+static const struct cbor_callbacks _cbor_view_callbacks = {
+    .uint8 = _cbor_view_uint8,
+    .uint16 = _cbor_view_uint16,
+    .uint32 = _cbor_view_uint32,
+    .uint64 = _cbor_view_uint64,
+
+    .negint8 = _cbor_view_negint8,
+    .negint16 = _cbor_view_negint16,
+    .negint32 = _cbor_view_negint32,
+    .negint64 = _cbor_view_negint64,
+
+    .byte_string_start = _cbor_view_indefinite,
+    .byte_string = _cbor_view_string,
+
+    .string_start = _cbor_view_indefinite,
+    .string = _cbor_view_string,
+
+    .indef_array_start = _cbor_view_indefinite,
+    .array_start = _cbor_view_array,
+
+    .indef_map_start = _cbor_view_indefinite,
+    .map_start = _cbor_view_map,
+
+    .tag = _cbor_view_tag,
+
+    .float2 = _cbor_view_float,
+    .float4 = _cbor_view_float,
+    .float8 = _cbor_view_double,
+    .undefined = _cbor_view_leaf,
+    .null = _cbor_view_leaf,
+    .boolean = _cbor_view_bool,
+
+    .indef_break = _cbor_view_break,
+};
+
+static cbor_type _cbor_view_major_type(cbor_view_t view) {
+  return (cbor_type)(*view.data >> 5);
+}
+
+static cbor_view_t _cbor_view_advance(cbor_view_t view, size_t offset) {
+  return (cbor_view_t){.data = view.data + offset, .size = view.size - offset};
+}
+
+static bool _cbor_view_decode_head(cbor_view_t view,
+                                   struct _cbor_view_head* head) {
+  *head = (struct _cbor_view_head){.kind = _CBOR_VIEW_HEAD_LEAF};
+  struct cbor_decoder_result result =
+      cbor_stream_decode(view.data, view.size, &_cbor_view_callbacks, head);
+  head->read = result.read;
+  return result.status == CBOR_DECODER_FINISHED;
+}
+
+cbor_view_t cbor_view_init(cbor_data source, size_t source_size) {
+  return (cbor_view_t){.data = source, .size = source_size};
+}
+
+bool cbor_view_type(cbor_view_t view, cbor_type* type) {
+  struct _cbor_view_head head;
+  if (!_cbor_view_decode_head(view, &head) ||
+      head.kind == _CBOR_VIEW_HEAD_BREAK) {
+    return false;
+  }
+  *type = _cbor_view_major_type(view);
+  return true;
+}
+
+bool cbor_view_skip(cbor_view_t view, cbor_view_t* next) {
+  size_t length;
+  if (cbor_skip_item(view.data, view.size, &length) != CBOR_DECODER_FINISHED) {
+    return false;
+  }
+  *next = _cbor_view_advance(view, length);
+  return true;
+}
+
+// Position `first` at the first subitem of a container of the given `type`
+// and get the number of subitems (pairs for maps) of definite ones.
+static bool _cbor_view_enter(cbor_view_t view, cbor_type type,
+                             bool* indefinite, uint64_t* count,
+                             cbor_view_t* first) {
+  struct _cbor_view_head head;
+  if (!_cbor_view_decode_head(view, &head) ||
+      _cbor_view_major_type(view) != type ||
+      head.kind == _CBOR_VIEW_HEAD_LEAF) {
+    return false;
+  }
+  *indefinite = head.kind == _CBOR_VIEW_HEAD_INDEFINITE;
+  *count = head.count;
+  *first = _cbor_view_advance(view, head.read);
+  return true;
+}
+
+// Is `view` positioned at the break terminating an indefinite container?
+static bool _cbor_view_at_break(cbor_view_t view) {
+  return view.size > 0 && *view.data == 0xFF;
+}
+
+bool cbor_view_array_at(cbor_view_t view, size_t index, cbor_view_t* element) {
+  bool indefinite;
+  uint64_t count;
+  cbor_view_t current;
+  if (!_cbor_view_enter(view, CBOR_TYPE_ARRAY, &indefinite, &count,
+                        &current)) {
+    return false;
+  }
+  if (!indefinite && index >= count) return false;
+  for (size_t i = 0; i < index; i++) {
+    if (indefinite && _cbor_view_at_break(current)) return false;
+    if (!cbor_view_skip(current, &current)) return false;
+  }
+  if (indefinite && _cbor_view_at_break(current)) return false;
+  *element = current;
+  return true;
+}
+
+// Compare a (possibly indefinite) text string key with `key`. Non-string keys
+// never match.
+static bool _cbor_view_key_equals(cbor_view_t view, const char* key,
+                                  size_t key_length) {
+  struct _cbor_view_head head;
+  if (!_cbor_view_decode_head(view, &head) ||
+      _cbor_view_major_type(view) != CBOR_TYPE_STRING) {
+    return false;
+  }
+  if (head.kind == _CBOR_VIEW_HEAD_LEAF) {
+    return head.value == key_length &&
+           memcmp(head.string, key, key_length) == 0;
+  }
+  size_t matched = 0;
+  cbor_view_t chunk = _cbor_view_advance(view, head.read);
+  while (!_cbor_view_at_break(chunk)) {
+    if (!_cbor_view_decode_head(chunk, &head) ||
+        head.kind != _CBOR_VIEW_HEAD_LEAF ||
+        head.value > key_length - matched ||
+        memcmp(head.string, key + matched, head.value) != 0) {
+      return false;
+    }
+    matched += head.value;
+    chunk = _cbor_view_advance(chunk, head.read);
+  }
+  return matched == key_length;
+}
+
+bool cbor_view_map_find(cbor_view_t view, const char* key, size_t key_length,
+                        cbor_view_t* value) {
+  bool indefinite;
+  uint64_t count;
+  cbor_view_t current;
+  if (!_cbor_view_enter(view, CBOR_TYPE_MAP, &indefinite, &count, &current)) {
+    return false;
+  }
+  for (uint64_t i = 0; indefinite || i < count; i++) {
+    if (indefinite && _cbor_view_at_break(current)) return false;
+    cbor_view_t map_value;
+    if (!cbor_view_skip(current, &map_value)) return false;
+    if (_cbor_view_key_equals(current, key, key_length)) {
+      *value = map_value;
+      return true;
+    }
+    if (!cbor_view_skip(map_value, &current)) return false;
+  }
+  return false;
+}
+
+bool cbor_view_string(cbor_view_t view, cbor_data* data, size_t* length) {
+  struct _cbor_view_head head;
+  if (!_cbor_view_decode_head(view, &head) ||
+      head.kind != _CBOR_VIEW_HEAD_LEAF ||
+      (_cbor_view_major_type(view) != CBOR_TYPE_BYTESTRING &&
+       _cbor_view_major_type(view) != CBOR_TYPE_STRING)) {
+    return false;
+  }
+  *data = head.string;
+  *length = (size_t)head.value;
+  return true;
+}
+
+bool cbor_view_get_uint(cbor_view_t view, uint64_t* value) {
+  struct _cbor_view_head head;
+  if (!_cbor_view_decode_head(view, &head) ||
+      _cbor_view_major_type(view) != CBOR_TYPE_UINT) {
+    return false;
+  }
+  *value = head.value;
+  return true;
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#ifndef LIBCBOR_VIEW_H
+#define LIBCBOR_VIEW_H
+
+#include "cbor/cbor_export.h"
+#include "cbor/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * ============================================================================
+ * Read-only views of encoded items
+ * ============================================================================
+ */
+
+/** Read-only reference to an encoded item
+ *
+ * Views navigate the encoded data in place. No memory is allocated and only
+ * the parts of the input that are needed to reach the requested item are
+ * decoded. The underlying buffer must outlive the view.
+ *
+ * Views are plain values and can be freely copied.
+ */
+typedef struct cbor_view {
+  /** Start of the encoded item */
+  cbor_data data;
+  /** Number of bytes available at #data. The item itself may be shorter. */
+  size_t size;
+} cbor_view_t;
+
+/** Create a view of the first item in a buffer
+ *
+ * The data is not inspected until the view is used.
+ *
+ * @param source The buffer
+ * @param source_size
+ * @return View of the item at the start of \p source
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_view_t cbor_view_init(cbor_data source,
+                                                       size_t source_size);
+
+/** Get the type of the viewed item
+ *
+ * @param view A view
+ * @param[out] type The major type of the item
+ * @return `false` if the view is empty or starts with a reserved or malformed
+ * header
+ */
+_CBOR_NODISCARD CBOR_EXPORT bool cbor_view_type(cbor_view_t view,
+                                                cbor_type* type);
+
+/** Skip over the viewed item
+ *
+ * Validates the structure of the item (including all nested items) without
+ * decoding it.
+ *
+ * @param view A view
+ * @param[out] next View of the remainder of the buffer following the item.
+ * The encoded length of the item is `next->data - view.data`.
+ * @return `false` if the item is malformed or truncated
+ */
+_CBOR_NODISCARD CBOR_EXPORT bool cbor_view_skip(cbor_view_t view,
+                                                cbor_view_t* next);
+
+/** Get an element of the viewed array
+ *
+ * Takes linear time in \p index, preceding elements are skipped over.
+ *
+ * @param view A view of a definite or indefinite array
+ * @param index The index of the element
+ * @param[out] element View of the element
+ * @return `false` if \p view is not an array, \p index is out of bounds, or
+ * the data is malformed
+ */
+_CBOR_NODISCARD CBOR_EXPORT bool cbor_view_array_at(cbor_view_t view,
+                                                    size_t index,
+                                                    cbor_view_t* element);
+
+/** Find a value by a text string key in the viewed map
+ *
+ * Takes linear time in the size of the map, the values preceding the match
+ * are skipped over. Returns the first match. Keys of other types are skipped.
+ *
+ * @param view A view of a definite or indefinite map
+ * @param key The UTF-8 key to look for
+ * @param key_length Length of \p key in bytes
+ * @param[out] value View of the value
+ * @return `false` if \p view is not a map, the key has not been found, or the
+ * data is malformed
+ */
+_CBOR_NODISCARD CBOR_EXPORT bool cbor_view_map_find(cbor_view_t view,
+                                                    const char* key,
+                                                    size_t key_length,
+                                                    cbor_view_t* value);
+
+/** Get the data of the viewed definite string or byte string
+ *
+ * @param view A view of a definite string or byte string
+ * @param[out] data The address of the string data within the buffer
+ * @param[out] length Length of the string data in bytes
+ * @return `false` if \p view is not a definite string or byte string, or the
+ * data is truncated
+ */
+_CBOR_NODISCARD CBOR_EXPORT bool cbor_view_string(cbor_view_t view,
+                                                  cbor_data* data,
+                                                  size_t* length);
+
+/** Get the value of the viewed unsigned integer
+ *
+ * @param view A view of an unsigned integer
+ * @param[out] value The value
+ * @return `false` if \p view is not an unsigned integer or the data is
+ * truncated
+ */
+_CBOR_NODISCARD CBOR_EXPORT bool cbor_view_get_uint(cbor_view_t view,
+                                                    uint64_t* value);
+
+/** Decode the viewed item
+ *
+ * Equivalent to calling #cbor_load on the view.
+ *
+ * @param view A view
+ * @param[out] result Result indicator. #CBOR_ERR_NONE on success
+ * @return Decoded CBOR item. The item's reference count is initialized to one.
+ * @return `NULL` on failure. In that case, \p result contains the location and
+ * description of the error.
+ */
+_CBOR_NODISCARD CBOR_EXPORT cbor_item_t* cbor_view_load(
+    cbor_view_t view, struct cbor_load_result* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // LIBCBOR_VIEW_H
@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include "writer.h"
+
+#include <string.h>
+
+#include "encoding.h"
+#include "internal/encoders.h"
+#include "internal/memory_utils.h"
+#include "serialization.h"
+
+// Longest encoding of a header or a float
+#define _CBOR_WRITER_MAX_HEADER 9
+// Initial size of the buffer of a growable writer
+#define _CBOR_WRITER_INITIAL_CAPACITY 64
+
+void cbor_writer_init_buffer(cbor_writer* writer, unsigned char* buffer,
+                             size_t buffer_size) {
+  *writer = (cbor_writer){.buffer = buffer, .capacity = buffer_size};
+}
+
+void cbor_writer_init_growable(cbor_writer* writer) {
+  *writer = (cbor_writer){.growable = true};
+}
+
+void cbor_writer_init_sink(cbor_writer* writer, cbor_writer_sink sink,
+                           void* context, unsigned char* buffer,
+                           size_t buffer_size) {
+  *writer = (cbor_writer){.buffer = buffer,
+                          .capacity = buffer_size,
+                          .sink = sink,
+                          .sink_context = context};
+}
+
+static bool _cbor_writer_file_sink(void* context, cbor_data data,
+                                   size_t size) {
+  return fwrite(data, 1, size, (FILE*)context) == size;
+}
+
+void cbor_writer_init_file(cbor_writer* writer, FILE* file,
+                           unsigned char* buffer, size_t buffer_size) {
+  cbor_writer_init_sink(writer, _cbor_writer_file_sink, file, buffer,
+                        buffer_size);
+}
+
+static bool _cbor_writer_fail(cbor_writer* writer) {
+  writer->failed = true;
+  return false;
+}
+
+// Pass `size` bytes to the sink
+static bool _cbor_writer_pass(cbor_writer* writer, cbor_data data,
+                              size_t size) {
+  if (size == 0) return true;
+  if (!writer->sink(writer->sink_context, data, size)) {
+    return _cbor_writer_fail(writer);
+  }
+  writer->flushed += size;
+  return true;
+}
+
+static bool _cbor_writer_drain(cbor_writer* writer) {
+  size_t length = writer->length;
+  writer->length = 0;
+  return _cbor_writer_pass(writer, writer->buffer, length);
+}
+
+// Grow the buffer of a growable writer to fit `size` more bytes
+static bool _cbor_writer_grow(cbor_writer* writer, size_t size) {
+  if (!_cbor_safe_to_add(writer->length, size) ||
+      !_cbor_safe_to_multiply(CBOR_BUFFER_GROWTH, writer->capacity)) {
+    return _cbor_writer_fail(writer);
+  }
+  size_t new_capacity = writer->capacity == 0
+                            ? _CBOR_WRITER_INITIAL_CAPACITY
+                            : CBOR_BUFFER_GROWTH * writer->capacity;
+  if (new_capacity < writer->length + size) {
+    new_capacity = writer->length + size;
+  }
+  unsigned char* buffer = _cbor_realloc(writer->buffer, new_capacity);
+  if (buffer == NULL) return _cbor_writer_fail(writer);
+  writer->buffer = buffer;
+  writer->capacity = new_capacity;
+  return true;
+}
+
+// Make room for `size` more bytes in the buffer, if possible for the kind of
+// the writer. Sink writers might not have the room even after draining.
+static bool _cbor_writer_make_room(cbor_writer* writer, size_t size) {
+  if (writer->growable) return _cbor_writer_grow(writer, size);
+  if (writer->sink != NULL) return _cbor_writer_drain(writer);
+  return _cbor_writer_fail(writer);
+}
+
+bool cbor_writer_bytes(cbor_writer* writer, cbor_data data, size_t length) {
+  if (writer->failed) return false;
+  if (length == 0) return true;
+  if (writer->capacity - writer->length < length) {
+    if (!_cbor_writer_make_room(writer, length)) return false;
+    if (writer->capacity - writer->length < length) {
+      // Too large for the staging buffer, which is now empty
+      return _cbor_writer_pass(writer, data, length);
+    }
+  }
+  memcpy(writer->buffer + writer->length, data, length);
+  writer->length += length;
+  return true;
+}
+
+static bool _cbor_writer_byte(cbor_writer* writer, unsigned char value) {
+  if (!writer->failed && writer->length < writer->capacity) {
+    writer->buffer[writer->length++] = value;
+    return true;
+  }
+  return cbor_writer_bytes(writer, &value, 1);
+}
+
+static bool _cbor_writer_header(cbor_writer* writer, uint64_t value,
+                                uint8_t offset) {
+  if (writer->failed) return false;
+  if (writer->capacity - writer->length >= _CBOR_WRITER_MAX_HEADER) {
+    writer->length +=
+        _cbor_encode_uint(value, writer->buffer + writer->length,
+                          _CBOR_WRITER_MAX_HEADER, offset);
+    return true;
+  }
+  unsigned char header[_CBOR_WRITER_MAX_HEADER];
+  return cbor_writer_bytes(
+      writer, header, _cbor_encode_uint(value, header, sizeof(header), offset));
+}
+
+bool cbor_writer_flush(cbor_writer* writer) {
+  if (writer->failed) return false;
+  if (writer->sink != NULL) return _cbor_writer_drain(writer);
+  return true;
+}
+
+size_t cbor_writer_length(const cbor_writer* writer) {
+  return writer->flushed + writer->length;
+}
+
+unsigned char* cbor_writer_take_buffer(cbor_writer* writer, size_t* length) {
+  if (!writer->growable || writer->failed || writer->buffer == NULL) {
+    return NULL;
+  }
+  unsigned char* buffer = writer->buffer;
+  *length = writer->length;
+  writer->buffer = NULL;
+  writer->capacity = 0;
+  writer->length = 0;
+  return buffer;
+}
+
+void cbor_writer_release(cbor_writer* writer) {
+  if (writer->growable) {
+    _cbor_free(writer->buffer);
+    writer->buffer = NULL;
+    writer->capacity = 0;
+    writer->length = 0;
+  }
+}
+
+bool cbor_writer_item(cbor_writer* writer, const cbor_item_t* item) {
+  if (writer->failed) return false;
+  cbor_serializer serializer;
+  cbor_serializer_init(&serializer, item);
+  enum cbor_serializer_status status = CBOR_SERIALIZER_ERROR;
+  do {
+    size_t written;
+    if (writer->capacity == 0 && writer->sink != NULL) {
+      // No staging buffer, pass the output on in small blocks
+      unsigned char block[64];
+      status =
+          cbor_serializer_write(&serializer, block, sizeof(block), &written);
+      if (!_cbor_writer_pass(writer, block, written)) break;
+    } else {
+      if (writer->length == writer->capacity &&
+          !_cbor_writer_make_room(writer, 1)) {
+        break;
+      }
+      status = cbor_serializer_write(&serializer,
+                                     writer->buffer + writer->length,
+                                     writer->capacity - writer->length,
+                                     &written);
+      writer->length += written;
+    }
+  } while (status == CBOR_SERIALIZER_BUFFER_FULL);
+  cbor_serializer_release(&serializer);
+  if (!writer->failed && status == CBOR_SERIALIZER_ERROR) {
+    _cbor_writer_fail(writer);
+  }
+  return !writer->failed;
+}
+
+bool cbor_writer_uint(cbor_writer* writer, uint64_t value) {
+  return _cbor_writer_header(writer, value, 0x00);
+}
+
+bool cbor_writer_negint(cbor_writer* writer, uint64_t value) {
+  return _cbor_writer_header(writer, value, 0x20);
+}
+
+bool cbor_writer_bytestring_start(cbor_writer* writer, size_t length) {
+  return _cbor_writer_header(writer, length, 0x40);
+}
+
+bool cbor_writer_indef_bytestring_start(cbor_writer* writer) {
+  return _cbor_writer_byte(writer, 0x5F);
+}
+
+bool cbor_writer_string_start(cbor_writer* writer, size_t length) {
+  return _cbor_writer_header(writer, length, 0x60);
+}
+
+bool cbor_writer_indef_string_start(cbor_writer* writer) {
+  return _cbor_writer_byte(writer, 0x7F);
+}
+
+bool cbor_writer_array_start(cbor_writer* writer, size_t length) {
+  return _cbor_writer_header(writer, length, 0x80);
+}
+
+bool cbor_writer_indef_array_start(cbor_writer* writer) {
+  return _cbor_writer_byte(writer, 0x9F);
+}
+
+bool cbor_writer_map_start(cbor_writer* writer, size_t length) {
+  return _cbor_writer_header(writer, length, 0xA0);
+}
+
+bool cbor_writer_indef_map_start(cbor_writer* writer) {
+  return _cbor_writer_byte(writer, 0xBF);
+}
+
+bool cbor_writer_tag(cbor_writer* writer, uint64_t value) {
+  return _cbor_writer_header(writer, value, 0xC0);
+}
+
+bool cbor_writer_bool(cbor_writer* writer, bool value) {
+  return _cbor_writer_byte(writer, value ? 0xF5 : 0xF4);
+}
+
+bool cbor_writer_null(cbor_writer* writer) {
+  return _cbor_writer_byte(writer, 0xF6);
+}
+
+bool cbor_writer_undef(cbor_writer* writer) {
+  return _cbor_writer_byte(writer, 0xF7);
+}
+
+bool cbor_writer_half(cbor_writer* writer, float value) {
+  unsigned char encoded[_CBOR_WRITER_MAX_HEADER];
+  return cbor_writer_bytes(writer, encoded,
+                           cbor_encode_half(value, encoded, sizeof(encoded)));
+}
+
+bool cbor_writer_single(cbor_writer* writer, float value) {
+  unsigned char encoded[_CBOR_WRITER_MAX_HEADER];
+  return cbor_writer_bytes(
+      writer, encoded, cbor_encode_single(value, encoded, sizeof(encoded)));
+}
+
+bool cbor_writer_double(cbor_writer* writer, double value) {
+  unsigned char encoded[_CBOR_WRITER_MAX_HEADER];
+  return cbor_writer_bytes(
+      writer, encoded, cbor_encode_double(value, encoded, sizeof(encoded)));
+}
+
+bool cbor_writer_preferred_float(cbor_writer* writer, double value) {
+  unsigned char encoded[_CBOR_WRITER_MAX_HEADER];
+  return cbor_writer_bytes(
+      writer, encoded,
+      cbor_encode_preferred_float(value, encoded, sizeof(encoded)));
+}
+
+bool cbor_writer_break(cbor_writer* writer) {
+  return _cbor_writer_byte(writer, 0xFF);
+}
+
+bool cbor_writer_ctrl(cbor_writer* writer, uint8_t value) {
+  return _cbor_writer_header(writer, value, 0xE0);
+}
+
+bool cbor_writer_bytestring(cbor_writer* writer, cbor_data data,
+                            size_t length) {
+  return cbor_writer_bytestring_start(writer, length) &&
+         cbor_writer_bytes(writer, data, length);
+}
+
+bool cbor_writer_string(cbor_writer* writer, const char* data, size_t length) {
+  return cbor_writer_string_start(writer, length) &&
+         cbor_writer_bytes(writer, (cbor_data)data, length);
+}
@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#ifndef LIBCBOR_WRITER_H
+#define LIBCBOR_WRITER_H
+
+#include <stdio.h>
+
+#include "cbor/cbor_export.h"
+#include "cbor/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * ============================================================================
+ * Buffered encoding
+ * ============================================================================
+ */
+
+/** Destination of the bytes produced by a #cbor_writer
+ *
+ * @param context The context passed to #cbor_writer_init_sink
+ * @param data Bytes to write
+ * @param size Number of bytes in \p data, always at least 1
+ * @return Whether all the bytes have been written. Once a sink fails, the
+ * writer will not call it again.
+ */
+typedef bool (*cbor_writer_sink)(void* context, cbor_data data, size_t size);
+
+/** Encoder that batches small writes
+ *
+ * The writer accumulates the encoded bytes in a buffer and hands them to its
+ * destination in large blocks, so that encoding many small items does not
+ * require a bounds check and a flush per item on the caller side.
+ *
+ * There are three kinds of writers:
+ *  - Fixed buffer writers (#cbor_writer_init_buffer) write to a caller
+ *    provided buffer and fail once it is full
+ *  - Growable writers (#cbor_writer_init_growable) write to a heap buffer
+ *    that grows as needed
+ *  - Sink writers (#cbor_writer_init_sink, #cbor_writer_init_file) collect
+ *    the output in a caller provided staging buffer and pass it on to a sink
+ *    whenever it fills up
+ *
+ * Errors are sticky: once a write fails, all subsequent writes fail as well
+ * and no more output is produced. This makes it possible to issue a series of
+ * writes and only check the result of #cbor_writer_flush. All members are
+ * private.
+ */
+typedef struct cbor_writer {
+  /** Output (fixed, growable) or staging (sink) buffer */
+  unsigned char* buffer;
+  size_t capacity;
+  /** Number of bytes in the buffer */
+  size_t length;
+  /** Number of bytes handed to the sink so far */
+  size_t flushed;
+  /** Whether the buffer is heap-allocated and grows as needed */
+  bool growable;
+  cbor_writer_sink sink;
+  void* sink_context;
+  bool failed;
+} cbor_writer;
+
+/** Initialize a writer that writes to \p buffer
+ *
+ * @param writer The writer to initialize
+ * @param buffer The output buffer
+ * @param buffer_size Size of \p buffer
+ */
+CBOR_EXPORT void cbor_writer_init_buffer(cbor_writer* writer,
+                                         unsigned char* buffer,
+                                         size_t buffer_size);
+
+/** Initialize a writer that writes to a heap buffer that grows as needed
+ *
+ * The buffer is allocated on the first write. Use #cbor_writer_take_buffer
+ * to obtain it, or #cbor_writer_release to discard it.
+ *
+ * @param writer The writer to initialize
+ */
+CBOR_EXPORT void cbor_writer_init_growable(cbor_writer* writer);
+
+/** Initialize a writer that passes its output to a sink
+ *
+ * The output is collected in \p buffer and handed to \p sink whenever the
+ * buffer fills up or #cbor_writer_flush is called. Bytes that do not fit the
+ * buffer, e.g. long strings, are passed to \p sink directly.
+ *
+ * \rst
+ * .. code-block:: c
+ *
+ *    bool fd_sink(void* context, cbor_data data, size_t size) {
+ *      int fd = *(int*)context;
+ *      while (size > 0) {
+ *        ssize_t written = write(fd, data, size);
+ *        if (written < 0) {
+ *          if (errno == EINTR) continue;
+ *          return false;
+ *        }
+ *        data += written;
+ *        size -= (size_t)written;
+ *      }
+ *      return true;
+ *    }
+ * \endrst
+ *
+ * @param writer The writer to initialize
+ * @param sink The destination
+ * @param context Passed to \p sink
+ * @param buffer The staging buffer. Can be `NULL` if \p buffer_size is 0, in
+ * which case each write is passed to \p sink immediately.
+ * @param buffer_size Size of \p buffer
+ */
+CBOR_EXPORT void cbor_writer_init_sink(cbor_writer* writer,
+                                       cbor_writer_sink sink, void* context,
+                                       unsigned char* buffer,
+                                       size_t buffer_size);
+
+/** Initialize a writer that writes to a file
+ *
+ * A sink writer (see #cbor_writer_init_sink) that uses `fwrite`.
+ * #cbor_writer_flush does not flush the `FILE` itself.
+ *
+ * @param writer The writer to initialize
+ * @param file The output file
+ * @param buffer The staging buffer
+ * @param buffer_size Size of \p buffer
+ */
+CBOR_EXPORT void cbor_writer_init_file(cbor_writer* writer, FILE* file,
+                                       unsigned char* buffer,
+                                       size_t buffer_size);
+
+/** Pass the buffered output to the sink
+ *
+ * Has no effect on fixed buffer and growable writers other than reporting
+ * the status.
+ *
+ * @param writer An initialized writer
+ * @return Whether all writes so far have succeeded
+ */
+_CBOR_NODISCARD CBOR_EXPORT bool cbor_writer_flush(cbor_writer* writer);
+
+/** Get the number of bytes written so far
+ *
+ * Includes both the buffered bytes and the bytes passed to the sink.
+ *
+ * @param writer An initialized writer
+ * @return The number of bytes
+ */
+_CBOR_NODISCARD CBOR_EXPORT size_t
+cbor_writer_length(const cbor_writer* writer);
+
+/** Take ownership of the buffer of a growable writer
+ *
+ * The writer is left empty and can be reused.
+ *
+ * \rst
+ * .. warning::
+ *   It is the caller's responsibility to free the buffer using an appropriate
+ *   ``free`` implementation.
+ * \endrst
+ *
+ * @param writer A growable writer
+ * @param[out] length The number of bytes in the buffer
+ * @return The buffer. `NULL` if a write has failed or nothing has been
+ * written, or if \p writer is not a growable writer.
+ */
+_CBOR_NODISCARD CBOR_EXPORT unsigned char* cbor_writer_take_buffer(
+    cbor_writer* writer, size_t* length);
+
+/** Release the memory held by a writer
+ *
+ * Does not flush the output.
+ *
+ * @param writer An initialized writer
+ */
+CBOR_EXPORT void cbor_writer_release(cbor_writer* writer);
+
+/** Write pre-encoded bytes
+ *
+ * Can be used to write the payload of a string started with
+ * #cbor_writer_string_start.
+ *
+ * @param writer An initialized writer
+ * @param data The bytes
+ * @param length Number of bytes in \p data
+ * @return Whether the write succeeded
+ */
+CBOR_EXPORT bool cbor_writer_bytes(cbor_writer* writer, cbor_data data,
+                                   size_t length);
+
+/** Write a data item
+ *
+ * The output is the same as the output of #cbor_serialize.
+ *
+ * @param writer An initialized writer
+ * @param item A data item
+ * @return Whether the write succeeded. `false` also if the item cannot be
+ * serialized.
+ */
+CBOR_EXPORT bool cbor_writer_item(cbor_writer* writer,
+                                  const cbor_item_t* item);
+
+/*
+ * The following functions write the same bytes as the corresponding
+ * cbor_encode_* functions and return whether the write succeeded.
+ */
+
+CBOR_EXPORT bool cbor_writer_uint(cbor_writer* writer, uint64_t value);
+
+CBOR_EXPORT bool cbor_writer_negint(cbor_writer* writer, uint64_t value);
+
+CBOR_EXPORT bool cbor_writer_bytestring_start(cbor_writer* writer,
+                                              size_t length);
+
+CBOR_EXPORT bool cbor_writer_indef_bytestring_start(cbor_writer* writer);
+
+CBOR_EXPORT bool cbor_writer_string_start(cbor_writer* writer, size_t length);
+
+CBOR_EXPORT bool cbor_writer_indef_string_start(cbor_writer* writer);
+
+CBOR_EXPORT bool cbor_writer_array_start(cbor_writer* writer, size_t length);
+
+CBOR_EXPORT bool cbor_writer_indef_array_start(cbor_writer* writer);
+
+CBOR_EXPORT bool cbor_writer_map_start(cbor_writer* writer, size_t length);
+
+CBOR_EXPORT bool cbor_writer_indef_map_start(cbor_writer* writer);
+
+CBOR_EXPORT bool cbor_writer_tag(cbor_writer* writer, uint64_t value);
+
+CBOR_EXPORT bool cbor_writer_bool(cbor_writer* writer, bool value);
+
+CBOR_EXPORT bool cbor_writer_null(cbor_writer* writer);
+
+CBOR_EXPORT bool cbor_writer_undef(cbor_writer* writer);
+
+CBOR_EXPORT bool cbor_writer_half(cbor_writer* writer, float value);
+
+CBOR_EXPORT bool cbor_writer_single(cbor_writer* writer, float value);
+
+CBOR_EXPORT bool cbor_writer_double(cbor_writer* writer, double value);
+
+/** Write a float in the shortest precision that represents it exactly
+ *
+ * See #cbor_encode_preferred_float.
+ *
+ * @param writer An initialized writer
+ * @param value The value
+ * @return Whether the write succeeded
+ */
+CBOR_EXPORT bool cbor_writer_preferred_float(cbor_writer* writer,
+                                             double value);
+
+CBOR_EXPORT bool cbor_writer_break(cbor_writer* writer);
+
+CBOR_EXPORT bool cbor_writer_ctrl(cbor_writer* writer, uint8_t value);
+
+/** Write a definite byte string
+ *
+ * @param writer An initialized writer
+ * @param data The bytes
+ * @param length Number of bytes in \p data
+ * @return Whether the write succeeded
+ */
+CBOR_EXPORT bool cbor_writer_bytestring(cbor_writer* writer, cbor_data data,
+                                        size_t length);
+
+/** Write a definite string
+ *
+ * The data is not validated.
+ *
+ * @param writer An initialized writer
+ * @param data The UTF-8 encoded string
+ * @param length Number of bytes in \p data
+ * @return Whether the write succeeded
+ */
+CBOR_EXPORT bool cbor_writer_string(cbor_writer* writer, const char* data,
+                                    size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // LIBCBOR_WRITER_H
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "assertions.h"
+#include "cbor.h"
+#include "test_allocator.h"
+
+struct cbor_load_result res;
+
+// {"a": [1, -2, 3.5, null, true], "b": h'0102', 0: 1(undefined)}
+unsigned char nested_data[] = {0xA3, 0x61, 0x61, 0x85, 0x01, 0x21, 0xFB,
+                               0x40, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00,
+                               0x00, 0xF6, 0xF5, 0x61, 0x62, 0x42, 0x01,
+                               0x02, 0x00, 0xC1, 0xF7};
+
+// [_ "ab", (_ "c" "d"), (_ h'01' h'02'), {_ 1: 2, 3: 4}, [_ 0, 1, 2, 3, 4]]
+unsigned char indefinite_data[] = {
+    0x9F, 0x62, 0x61, 0x62, 0x7F, 0x61, 0x63, 0x61, 0x64, 0xFF,
+    0x5F, 0x41, 0x01, 0x41, 0x02, 0xFF, 0xBF, 0x01, 0x02, 0x03,
+    0x04, 0xFF, 0x9F, 0x00, 0x01, 0x02, 0x03, 0x04, 0xFF, 0xFF};
+
+static void assert_same_as_heap_load(cbor_data data, size_t length,
+                                     cbor_arena* arena) {
+  cbor_item_t* expected = cbor_load(data, length, &res);
+  assert_non_null(expected);
+  cbor_item_t* item = cbor_load_arena(data, length, arena, &res);
+  assert_non_null(item);
+  assert_size_equal(res.read, length);
+  assert_true(cbor_structurally_equal(item, expected));
+  cbor_decref(&expected);
+}
+
+static void test_load_nested(void** _state _CBOR_UNUSED) {
+  cbor_arena arena;
+  cbor_arena_init(&arena, 0);
+  assert_same_as_heap_load(nested_data, sizeof(nested_data), &arena);
+  assert_size_equal(cbor_arena_capacity(&arena),
+                    CBOR_ARENA_DEFAULT_BLOCK_SIZE);
+  cbor_arena_release(&arena);
+  assert_size_equal(cbor_arena_capacity(&arena), 0);
+}
+
+static void test_load_indefinite(void** _state _CBOR_UNUSED) {
+  cbor_arena arena;
+  // Small blocks force the containers to spill over to new blocks as they
+  // grow
+  cbor_arena_init(&arena, 64);
+  assert_same_as_heap_load(indefinite_data, sizeof(indefinite_data), &arena);
+  assert_true(cbor_arena_capacity(&arena) > 64);
+  cbor_arena_release(&arena);
+}
+
+static void test_oversized_string(void** _state _CBOR_UNUSED) {
+  unsigned char data[3 + 300];
+  data[0] = 0x79;  // Text string, 2B length
+  data[1] = 0x01;
+  data[2] = 0x2C;
+  memset(data + 3, 'x', 300);
+
+  cbor_arena arena;
+  cbor_arena_init(&arena, 64);
+  assert_same_as_heap_load(data, sizeof(data), &arena);
+  cbor_arena_release(&arena);
+}
+
+static void test_decref(void** _state _CBOR_UNUSED) {
+  cbor_arena arena;
+  cbor_arena_init(&arena, 0);
+  cbor_item_t* item =
+      cbor_load_arena(nested_data, sizeof(nested_data), &arena, &res);
+  assert_non_null(item);
+  // Releasing references is allowed but does not return memory to the arena
+  cbor_decref(&item);
+  assert_null(item);
+  assert_size_equal(cbor_arena_capacity(&arena),
+                    CBOR_ARENA_DEFAULT_BLOCK_SIZE);
+  cbor_arena_release(&arena);
+}
+
+static void test_modify_loaded_items(void** _state _CBOR_UNUSED) {
+  cbor_arena arena;
+  cbor_arena_init(&arena, 64);
+  cbor_item_t* item =
+      cbor_load_arena(indefinite_data, sizeof(indefinite_data), &arena, &res);
+  assert_non_null(item);
+  // Growing an arena container keeps allocating from the arena; the pushed
+  // heap item is only referenced
+  cbor_item_t* pushee = cbor_build_uint8(42);
+  for (size_t i = 0; i < 64; i++) {
+    assert_true(cbor_array_push(item, pushee));
+  }
+  assert_size_equal(cbor_array_size(item), 69);
+  assert_size_equal(cbor_refcount(pushee), 65);
+  cbor_decref(&item);
+  assert_size_equal(cbor_refcount(pushee), 1);
+  cbor_decref(&pushee);
+  cbor_arena_release(&arena);
+}
+
+static void test_reset_reuses_memory(void** _state _CBOR_UNUSED) {
+  cbor_arena arena;
+  cbor_arena_init(&arena, 64);
+  cbor_item_t* item =
+      cbor_load_arena(indefinite_data, sizeof(indefinite_data), &arena, &res);
+  assert_non_null(item);
+  size_t capacity = cbor_arena_capacity(&arena);
+
+  cbor_arena_reset(&arena);
+  // Blocks were merged into one
+  assert_size_equal(cbor_arena_capacity(&arena), capacity);
+
+  // Only the decoder stack is allocated on the heap
+  WITH_MOCK_MALLOC(
+      {
+        item = cbor_load_arena(indefinite_data, sizeof(indefinite_data),
+                               &arena, &res);
+        assert_non_null(item);
+      },
+      1, MALLOC);
+  assert_size_equal(cbor_arena_capacity(&arena), capacity);
+
+  cbor_arena_reset(&arena);
+  WITH_MOCK_MALLOC(
+      {
+        item = cbor_load_arena((cbor_data) "\x63" "abc", 4, &arena, &res);
+        assert_non_null(item);
+        assert_true(cbor_isa_string(item));
+        assert_size_equal(cbor_string_length(item), 3);
+      },
+      0, MALLOC);
+  cbor_arena_release(&arena);
+}
+
+static void test_malformed_input(void** _state _CBOR_UNUSED) {
+  cbor_arena arena;
+  cbor_arena_init(&arena, 0);
+  // Truncated map
+  assert_null(cbor_load_arena(nested_data, sizeof(nested_data) - 1, &arena,
+                              &res));
+  assert_true(res.error.code == CBOR_ERR_NOTENOUGHDATA);
+  cbor_arena_reset(&arena);
+  assert_same_as_heap_load(nested_data, sizeof(nested_data), &arena);
+  cbor_arena_release(&arena);
+}
+
+static void test_block_allocation_failure(void** _state _CBOR_UNUSED) {
+  cbor_arena arena;
+  cbor_arena_init(&arena, 0);
+  WITH_FAILING_MALLOC({
+    assert_null(cbor_load_arena((cbor_data) "\x18\x2A", 2, &arena, &res));
+    assert_true(res.error.code == CBOR_ERR_MEMERROR);
+  });
+  assert_size_equal(cbor_arena_capacity(&arena), 0);
+  cbor_arena_release(&arena);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_load_nested),
+      cmocka_unit_test(test_load_indefinite),
+      cmocka_unit_test(test_oversized_string),
+      cmocka_unit_test(test_decref),
+      cmocka_unit_test(test_modify_loaded_items),
+      cmocka_unit_test(test_reset_reuses_memory),
+      cmocka_unit_test(test_malformed_input),
+      cmocka_unit_test(test_block_allocation_failure),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
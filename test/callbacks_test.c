@@ -69,6 +69,7 @@ static void test_builder_byte_string_callback_append(
 
   cbor_decref(&bytestring);
   _cbor_stack_pop(&stack);
+  _cbor_stack_release(&stack);
 }
 
 static void test_builder_byte_string_callback_append_alloc_failure(
@@ -102,6 +103,7 @@ static void test_builder_byte_string_callback_append_alloc_failure(
 
   cbor_decref(&bytestring);
   _cbor_stack_pop(&stack);
+  _cbor_stack_release(&stack);
 }
 
 static void test_builder_byte_string_callback_append_item_alloc_failure(
@@ -137,6 +139,7 @@ static void test_builder_byte_string_callback_append_item_alloc_failure(
 
   cbor_decref(&bytestring);
   _cbor_stack_pop(&stack);
+  _cbor_stack_release(&stack);
 }
 
 static void test_builder_byte_string_callback_append_parent_alloc_failure(
@@ -172,6 +175,7 @@ static void test_builder_byte_string_callback_append_parent_alloc_failure(
 
   cbor_decref(&bytestring);
   _cbor_stack_pop(&stack);
+  _cbor_stack_release(&stack);
 }
 
 unsigned char string_data[] = {0x61, 0x62, 0x63};
@@ -211,6 +215,7 @@ static void test_builder_string_callback_append(void** _state _CBOR_UNUSED) {
 
   cbor_decref(&string);
   _cbor_stack_pop(&stack);
+  _cbor_stack_release(&stack);
 }
 
 static void test_builder_string_callback_append_alloc_failure(
@@ -244,6 +249,7 @@ static void test_builder_string_callback_append_alloc_failure(
 
   cbor_decref(&string);
   _cbor_stack_pop(&stack);
+  _cbor_stack_release(&stack);
 }
 
 static void test_builder_string_callback_append_item_alloc_failure(
@@ -278,6 +284,7 @@ static void test_builder_string_callback_append_item_alloc_failure(
 
   cbor_decref(&string);
   _cbor_stack_pop(&stack);
+  _cbor_stack_release(&stack);
 }
 
 static void test_builder_string_callback_append_parent_alloc_failure(
@@ -312,6 +319,7 @@ static void test_builder_string_callback_append_parent_alloc_failure(
 
   cbor_decref(&string);
   _cbor_stack_pop(&stack);
+  _cbor_stack_release(&stack);
 }
 
 static void test_append_array_failure(void** _state _CBOR_UNUSED) {
@@ -343,6 +351,7 @@ static void test_append_array_failure(void** _state _CBOR_UNUSED) {
   // item free'd by _cbor_builder_append
   cbor_decref(&array);
   _cbor_stack_pop(&stack);
+  _cbor_stack_release(&stack);
 }
 
 static void test_append_map_failure(void** _state _CBOR_UNUSED) {
@@ -373,6 +382,7 @@ static void test_append_map_failure(void** _state _CBOR_UNUSED) {
   // item free'd by _cbor_builder_append
   cbor_decref(&map);
   _cbor_stack_pop(&stack);
+  _cbor_stack_release(&stack);
 }
 
 // Size 1 array start, but we get an indef break
@@ -410,6 +420,7 @@ static void test_invalid_state_indef_break(void** _state _CBOR_UNUSED) {
 
   cbor_decref(&small_int);
   _cbor_stack_pop(&stack);
+  _cbor_stack_release(&stack);
 }
 
 int main(void) {
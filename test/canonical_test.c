@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <math.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "assertions.h"
+#include "cbor.h"
+#include "test_allocator.h"
+
+unsigned char buffer[512];
+
+// Serialize `item` with both variants, check the output, and release `item`
+static void assert_canonical(cbor_item_t* item, cbor_data expected,
+                             size_t expected_size) {
+  assert_size_equal(cbor_serialize_canonical(item, buffer, sizeof(buffer)),
+                    expected_size);
+  assert_memory_equal(buffer, expected, expected_size);
+
+  unsigned char* output;
+  size_t output_size;
+  assert_size_equal(cbor_serialize_canonical_alloc(item, &output, &output_size),
+                    expected_size);
+  assert_size_equal(output_size, expected_size);
+  assert_memory_equal(output, expected, expected_size);
+  _cbor_free(output);
+  cbor_decref(&item);
+}
+
+static void map_add(cbor_item_t* map, cbor_item_t* key, cbor_item_t* value) {
+  assert_true(cbor_map_add(map, (struct cbor_pair){.key = cbor_move(key),
+                                                   .value = cbor_move(value)}));
+}
+
+static void test_shortest_heads(void** _state _CBOR_UNUSED) {
+  assert_canonical(cbor_build_uint64(1), (cbor_data) "\x01", 1);
+  assert_canonical(cbor_build_uint32(500), (cbor_data) "\x19\x01\xF4", 3);
+  assert_canonical(cbor_build_negint16(0), (cbor_data) "\x20", 1);
+  assert_canonical(cbor_build_negint64(1000), (cbor_data) "\x39\x03\xE8", 3);
+  assert_canonical(cbor_build_ctrl(CBOR_CTRL_NULL), (cbor_data) "\xF6", 1);
+  assert_canonical(cbor_build_ctrl(32), (cbor_data) "\xF8\x20", 2);
+  assert_canonical(cbor_build_tag(1, cbor_move(cbor_build_uint16(2))),
+                   (cbor_data) "\xC1\x02", 2);
+  assert_canonical(cbor_build_tag(300, cbor_move(cbor_build_uint8(2))),
+                   (cbor_data) "\xD9\x01\x2C\x02", 4);
+}
+
+static void test_floats(void** _state _CBOR_UNUSED) {
+  assert_canonical(cbor_build_float8(1.5), (cbor_data) "\xF9\x3E\x00", 3);
+  assert_canonical(cbor_build_float4(-0.0f), (cbor_data) "\xF9\x80\x00", 3);
+  assert_canonical(cbor_build_float8(INFINITY), (cbor_data) "\xF9\x7C\x00", 3);
+  assert_canonical(cbor_build_float8(NAN), (cbor_data) "\xF9\x7E\x00", 3);
+  // Smallest half-precision subnormal
+  assert_canonical(cbor_build_float8(5.960464477539063e-8),
+                   (cbor_data) "\xF9\x00\x01", 3);
+  assert_canonical(cbor_build_float8(100000.0),
+                   (cbor_data) "\xFA\x47\xC3\x50\x00", 5);
+  assert_canonical(cbor_build_float2(65504.0f),
+                   (cbor_data) "\xF9\x7B\xFF", 3);
+  assert_canonical(cbor_build_float8(1.1),
+                   (cbor_data) "\xFB\x3F\xF1\x99\x99\x99\x99\x99\x9A", 9);
+}
+
+static void test_definite_lengths(void** _state _CBOR_UNUSED) {
+  cbor_item_t* string = cbor_new_indefinite_string();
+  assert_true(
+      cbor_string_add_chunk(string, cbor_move(cbor_build_string("ab"))));
+  assert_true(cbor_string_add_chunk(string, cbor_move(cbor_build_string(""))));
+  assert_true(cbor_string_add_chunk(string, cbor_move(cbor_build_string("c"))));
+  assert_canonical(string, (cbor_data) "\x63" "abc", 4);
+
+  cbor_item_t* bytes = cbor_new_indefinite_bytestring();
+  assert_canonical(bytes, (cbor_data) "\x40", 1);
+
+  cbor_item_t* array = cbor_new_indefinite_array();
+  assert_true(cbor_array_push(array, cbor_move(cbor_build_uint8(1))));
+  assert_true(cbor_array_push(array, cbor_move(cbor_new_indefinite_map())));
+  assert_canonical(array, (cbor_data) "\x82\x01\xA0", 3);
+}
+
+static void test_sorted_keys(void** _state _CBOR_UNUSED) {
+  cbor_item_t* map = cbor_new_indefinite_map();
+  map_add(map, cbor_build_string("b"), cbor_build_uint8(1));
+  map_add(map, cbor_new_definite_array(0), cbor_build_uint8(2));
+  map_add(map, cbor_build_string("aa"), cbor_build_uint8(3));
+  map_add(map, cbor_build_uint64(10), cbor_build_uint8(4));
+  map_add(map, cbor_build_string("a"), cbor_build_uint8(5));
+  map_add(map, cbor_build_negint8(0), cbor_build_uint8(6));
+  // {10: 4, -1: 6, "a": 5, "b": 1, "aa": 3, []: 2}
+  assert_canonical(map,
+                   (cbor_data) "\xA6\x0A\x04\x20\x06\x61"
+                               "a\x05\x61"
+                               "b\x01\x62"
+                               "aa\x03\x80\x02",
+                   17);
+}
+
+static void test_nested_maps(void** _state _CBOR_UNUSED) {
+  cbor_item_t* inner = cbor_new_definite_map(2);
+  map_add(inner, cbor_build_uint8(2), cbor_build_string("x"));
+  map_add(inner, cbor_build_uint8(1), cbor_build_string("y"));
+  cbor_item_t* map = cbor_new_definite_map(2);
+  map_add(map, cbor_build_uint8(1), inner);
+  map_add(map, cbor_build_uint8(0), cbor_build_bool(true));
+  // {0: true, 1: {1: "y", 2: "x"}}
+  assert_canonical(map,
+                   (cbor_data) "\xA2\x00\xF5\x01\xA2\x01\x61"
+                               "y\x02\x61"
+                               "x",
+                   11);
+}
+
+static void test_duplicate_keys(void** _state _CBOR_UNUSED) {
+  cbor_item_t* map = cbor_new_definite_map(3);
+  map_add(map, cbor_build_uint8(1), cbor_build_uint8(1));
+  map_add(map, cbor_build_uint8(0), cbor_build_uint8(2));
+  // Equal once encoded
+  map_add(map, cbor_build_uint64(1), cbor_build_uint8(3));
+  assert_size_equal(cbor_serialize_canonical(map, buffer, sizeof(buffer)), 0);
+  unsigned char* output;
+  size_t output_size;
+  assert_size_equal(cbor_serialize_canonical_alloc(map, &output, &output_size),
+                    0);
+  assert_null(output);
+  assert_size_equal(output_size, 0);
+  cbor_decref(&map);
+}
+
+static void test_large_map(void** _state _CBOR_UNUSED) {
+  // Larger than the initial stack buffer, keys in reverse order
+  cbor_item_t* map = cbor_new_definite_map(300);
+  for (size_t i = 300; i > 0; i--) {
+    map_add(map, cbor_build_uint16(i), cbor_build_string("value"));
+  }
+  unsigned char* output;
+  size_t output_size;
+  assert_size_equal(cbor_serialize_canonical_alloc(map, &output, &output_size),
+                    cbor_serialized_size(map) - 23 * 2 - 232);
+  struct cbor_load_result result;
+  cbor_item_t* loaded = cbor_load(output, output_size, &result);
+  assert_non_null(loaded);
+  for (size_t i = 0; i < 300; i++) {
+    assert_true(cbor_get_int(cbor_map_handle(loaded)[i].key) == i + 1);
+  }
+  cbor_decref(&loaded);
+  _cbor_free(output);
+  cbor_decref(&map);
+}
+
+static void test_buffer_too_small(void** _state _CBOR_UNUSED) {
+  cbor_item_t* item = cbor_build_string("Hello");
+  assert_size_equal(cbor_serialize_canonical(item, buffer, 5), 0);
+  assert_size_equal(cbor_serialize_canonical(item, buffer, 6), 6);
+  cbor_decref(&item);
+}
+
+static void test_tag_no_item(void** _state _CBOR_UNUSED) {
+  cbor_item_t* item = cbor_new_tag(21);
+  assert_size_equal(cbor_serialize_canonical(item, buffer, sizeof(buffer)), 0);
+  cbor_decref(&item);
+}
+
+static void assert_preferred(cbor_item_t* item, cbor_data expected,
+                             size_t expected_size) {
+  assert_size_equal(cbor_serialize_preferred(item, buffer, sizeof(buffer)),
+                    expected_size);
+  assert_memory_equal(buffer, expected, expected_size);
+  assert_size_equal(cbor_serialize_preferred(item, buffer, expected_size - 1),
+                    0);
+
+  unsigned char* output;
+  size_t output_size;
+  assert_size_equal(cbor_serialize_preferred_alloc(item, &output, &output_size),
+                    expected_size);
+  assert_memory_equal(output, expected, expected_size);
+  _cbor_free(output);
+  cbor_decref(&item);
+}
+
+static void test_preferred(void** _state _CBOR_UNUSED) {
+  assert_preferred(cbor_build_uint64(500), (cbor_data) "\x19\x01\xF4", 3);
+  assert_preferred(cbor_build_float8(-4.0), (cbor_data) "\xF9\xC4\x00", 3);
+  assert_preferred(cbor_build_float8(0.1),
+                   (cbor_data) "\xFB\x3F\xB9\x99\x99\x99\x99\x99\x9A", 9);
+
+  // Indefinite lengths and the order of the keys are kept
+  cbor_item_t* string = cbor_new_indefinite_string();
+  assert_true(
+      cbor_string_add_chunk(string, cbor_move(cbor_build_string("ab"))));
+  cbor_item_t* map = cbor_new_indefinite_map();
+  map_add(map, cbor_build_string("b"), string);
+  map_add(map, cbor_build_uint32(1), cbor_build_float4(0.5f));
+  cbor_item_t* array = cbor_new_indefinite_array();
+  assert_true(cbor_array_push(array, cbor_move(map)));
+  assert_true(
+      cbor_array_push(array, cbor_move(cbor_new_indefinite_bytestring())));
+  assert_preferred(array,
+                   (cbor_data) "\x9F\xBF\x61"
+                               "b\x7F\x62"
+                               "ab\xFF\x01\xF9\x38\x00\xFF\x5F\xFF\xFF",
+                   17);
+
+  // Duplicate keys are fine
+  map = cbor_new_definite_map(2);
+  map_add(map, cbor_build_uint8(1), cbor_build_uint8(1));
+  map_add(map, cbor_build_uint64(1), cbor_build_uint8(2));
+  assert_preferred(map, (cbor_data) "\xA2\x01\x01\x01\x02", 5);
+}
+
+static void test_allocation_failure(void** _state _CBOR_UNUSED) {
+  cbor_item_t* map = cbor_new_definite_map(2);
+  map_add(map, cbor_build_uint8(1), cbor_build_uint8(1));
+  map_add(map, cbor_build_uint8(0), cbor_build_uint8(2));
+  unsigned char* output;
+  size_t output_size;
+
+  // The result
+  WITH_MOCK_MALLOC(
+      {
+        assert_size_equal(
+            cbor_serialize_canonical_alloc(map, &output, &output_size), 0);
+      },
+      3, MALLOC, MALLOC, MALLOC_FAIL);
+  assert_null(output);
+  assert_size_equal(output_size, 0);
+
+  // The entries of the map
+  WITH_FAILING_MALLOC({
+    assert_size_equal(
+        cbor_serialize_canonical_alloc(map, &output, &output_size), 0);
+  });
+  assert_null(output);
+
+  // The scratch space for reordering the entries
+  WITH_MOCK_MALLOC(
+      {
+        assert_size_equal(
+            cbor_serialize_canonical_alloc(map, &output, &output_size), 0);
+      },
+      2, MALLOC, MALLOC_FAIL);
+  assert_null(output);
+  cbor_decref(&map);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_shortest_heads),
+      cmocka_unit_test(test_floats),
+      cmocka_unit_test(test_definite_lengths),
+      cmocka_unit_test(test_sorted_keys),
+      cmocka_unit_test(test_nested_maps),
+      cmocka_unit_test(test_duplicate_keys),
+      cmocka_unit_test(test_large_map),
+      cmocka_unit_test(test_buffer_too_small),
+      cmocka_unit_test(test_tag_no_item),
+      cmocka_unit_test(test_allocation_failure),
+      cmocka_unit_test(test_preferred),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
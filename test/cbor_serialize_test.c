@@ -13,6 +13,7 @@
 #include <stdarg.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <cmocka.h>
@@ -712,6 +713,169 @@ static void test_auto_serialize_zero_len_indef_map(void** _state _CBOR_UNUSED) {
   _cbor_free(output);
 }
 
+// [_ "Hello, world!" x count, (_ "a", "b"), 1("c"), {_ -1: 2.0}]
+static cbor_item_t* build_mixed_array(size_t count) {
+  cbor_item_t* item = cbor_new_indefinite_array();
+  for (size_t i = 0; i < count; i++) {
+    assert_true(
+        cbor_array_push(item, cbor_move(cbor_build_string("Hello, world!"))));
+  }
+  cbor_item_t* chunked = cbor_new_indefinite_string();
+  assert_true(
+      cbor_string_add_chunk(chunked, cbor_move(cbor_build_string("a"))));
+  assert_true(
+      cbor_string_add_chunk(chunked, cbor_move(cbor_build_string("b"))));
+  assert_true(cbor_array_push(item, cbor_move(chunked)));
+  assert_true(cbor_array_push(
+      item, cbor_move(cbor_build_tag(1, cbor_move(cbor_build_string("c"))))));
+  cbor_item_t* map = cbor_new_indefinite_map();
+  assert_true(cbor_map_add(
+      map, (struct cbor_pair){.key = cbor_move(cbor_build_negint8(0)),
+                              .value = cbor_move(cbor_build_float4(2.0f))}));
+  assert_true(cbor_array_push(item, cbor_move(map)));
+  return item;
+}
+
+static void test_auto_serialize_grows(void** _state _CBOR_UNUSED) {
+  // Larger than the initial stack buffer
+  cbor_item_t* item = build_mixed_array(100);
+  size_t size = cbor_serialized_size(item);
+  assert_size_equal(size, 1 + 100 * 14 + 6 + 3 + 8 + 1);
+  unsigned char* expected = malloc(size);
+  assert_size_equal(cbor_serialize(item, expected, size), size);
+
+  unsigned char* output;
+  size_t output_size;
+  // The buffer moves to the heap, grows twice, then gets trimmed
+  WITH_MOCK_MALLOC(
+      {
+        assert_size_equal(cbor_serialize_alloc(item, &output, &output_size),
+                          size);
+      },
+      4, MALLOC, REALLOC, REALLOC, REALLOC);
+  assert_size_equal(output_size, size);
+  assert_memory_equal(output, expected, size);
+  _cbor_free(output);
+
+  WITH_MOCK_MALLOC(
+      {
+        assert_size_equal(cbor_serialize_alloc(item, &output, &output_size),
+                          0);
+      },
+      2, MALLOC, REALLOC_FAIL);
+  assert_null(output);
+  assert_size_equal(output_size, 0);
+
+  // Trimming is optional
+  WITH_MOCK_MALLOC(
+      {
+        assert_size_equal(cbor_serialize_alloc(item, &output, &output_size),
+                          size);
+      },
+      4, MALLOC, REALLOC, REALLOC, REALLOC_FAIL);
+  assert_memory_equal(output, expected, size);
+  _cbor_free(output);
+
+  free(expected);
+  cbor_decref(&item);
+}
+
+static void test_auto_serialize_tag_no_item(void** _state _CBOR_UNUSED) {
+  cbor_item_t* item = cbor_new_definite_array(1);
+  assert_true(cbor_array_push(item, cbor_move(cbor_new_tag(21))));
+  unsigned char* output;
+  size_t output_size;
+  assert_size_equal(cbor_serialize_alloc(item, &output, &output_size), 0);
+  assert_null(output);
+  assert_size_equal(output_size, 0);
+  cbor_decref(&item);
+}
+
+static void test_serialized_size_cached(void** _state _CBOR_UNUSED) {
+  cbor_item_t* item = build_mixed_array(3);
+  cbor_item_t* inner = cbor_new_indefinite_array();
+  assert_true(cbor_array_push(inner, cbor_move(cbor_build_uint8(1))));
+  assert_true(cbor_array_push(item, inner));
+  cbor_size_cache cache;
+  cbor_size_cache_init(&cache);
+  assert_size_equal(cbor_serialized_size_cached(&cache, item),
+                    cbor_serialized_size(item));
+  for (size_t i = 0; i < cbor_array_size(item); i++) {
+    cbor_item_t* element = cbor_array_get(item, i);
+    assert_size_equal(cbor_serialized_size_cached(&cache, element),
+                      cbor_serialized_size(element));
+    cbor_decref(&element);
+  }
+
+  // The recorded sizes are used without walking the items again
+  assert_true(cbor_array_push(inner, cbor_move(cbor_build_uint8(2))));
+  assert_size_equal(cbor_serialized_size_cached(&cache, inner), 3);
+  cbor_size_cache_release(&cache);
+  cbor_size_cache_init(&cache);
+  assert_size_equal(cbor_serialized_size_cached(&cache, inner), 4);
+  cbor_size_cache_release(&cache);
+  cbor_decref(&inner);
+  cbor_decref(&item);
+}
+
+static void test_serialized_size_cached_many(void** _state _CBOR_UNUSED) {
+  // Enough containers to grow the cache a few times
+  cbor_item_t* item = cbor_new_definite_map(500);
+  for (size_t i = 0; i < 500; i++) {
+    cbor_item_t* value = cbor_new_definite_array(1);
+    assert_true(cbor_array_push(value, cbor_move(cbor_build_uint16(i))));
+    assert_true(cbor_map_add(
+        item, (struct cbor_pair){.key = cbor_move(cbor_build_uint16(i)),
+                                 .value = cbor_move(value)}));
+  }
+  cbor_size_cache cache;
+  cbor_size_cache_init(&cache);
+  size_t size = cbor_serialized_size(item);
+  assert_size_equal(cbor_serialized_size_cached(&cache, item), size);
+  for (size_t i = 0; i < 500; i++) {
+    assert_size_equal(
+        cbor_serialized_size_cached(&cache, cbor_map_handle(item)[i].value),
+        4);
+  }
+  assert_size_equal(cbor_serialized_size_cached(&cache, item), size);
+  cbor_size_cache_release(&cache);
+  cbor_decref(&item);
+}
+
+static void test_serialized_size_cached_edge_cases(
+    void** _state _CBOR_UNUSED) {
+  cbor_size_cache cache;
+  cbor_size_cache_init(&cache);
+
+  cbor_item_t* item = cbor_new_tag(21);
+  assert_size_equal(cbor_serialized_size_cached(&cache, item), 0);
+  cbor_decref(&item);
+
+  item = cbor_build_uint32(1000);
+  assert_size_equal(cbor_serialized_size_cached(&cache, item), 5);
+  cbor_decref(&item);
+
+  // Not recorded, but still computed
+  item = cbor_new_definite_array(0);
+  WITH_FAILING_MALLOC(
+      { assert_size_equal(cbor_serialized_size_cached(&cache, item), 1); });
+  assert_size_equal(cbor_serialized_size_cached(&cache, item), 1);
+  cbor_decref(&item);
+
+  item = cbor_new_indefinite_bytestring();
+  cbor_item_t* chunk = cbor_new_definite_bytestring();
+  assert_true(cbor_bytestring_add_chunk(item, chunk));
+  assert_size_equal(cbor_serialized_size_cached(&cache, item), 3);
+  // Pretend the chunk is huge
+  cbor_size_cache_release(&cache);
+  chunk->metadata.bytestring_metadata.length = SIZE_MAX;
+  assert_size_equal(cbor_serialized_size_cached(&cache, item), 0);
+  chunk->metadata.bytestring_metadata.length = 0;
+  cbor_decref(&chunk);
+  cbor_decref(&item);
+  cbor_size_cache_release(&cache);
+}
+
 int main(void) {
   const struct CMUnitTest tests[] = {
       cmocka_unit_test(test_serialize_uint8_embed),
@@ -765,6 +929,11 @@ int main(void) {
       cmocka_unit_test(test_auto_serialize_zero_len_indef_array),
       cmocka_unit_test(test_auto_serialize_zero_len_map),
       cmocka_unit_test(test_auto_serialize_zero_len_indef_map),
+      cmocka_unit_test(test_auto_serialize_grows),
+      cmocka_unit_test(test_auto_serialize_tag_no_item),
+      cmocka_unit_test(test_serialized_size_cached),
+      cmocka_unit_test(test_serialized_size_cached_many),
+      cmocka_unit_test(test_serialized_size_cached_edge_cases),
   };
   return cmocka_run_group_tests(tests, NULL, NULL);
 }
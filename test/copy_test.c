@@ -162,6 +162,40 @@ static void test_ctrls(void** _state _CBOR_UNUSED) {
   cbor_decref(&copy);
 }
 
+static void test_shared_items(void** _state _CBOR_UNUSED) {
+  // Copies of shared items are fresh and can be modified
+  item = cbor_build_uint8(10);
+  copy = cbor_copy(item);
+  assert_ptr_not_equal(item, copy);
+  assert_size_equal(cbor_refcount(copy), 1);
+  cbor_set_uint8(copy, 11);
+  assert_uint8(copy, 11);
+  assert_uint8(item, 10);
+  cbor_decref(&copy);
+
+  item = cbor_build_negint8(10);
+  copy = cbor_copy(item);
+  assert_ptr_not_equal(item, copy);
+  assert_true(cbor_isa_negint(copy));
+  assert_true(cbor_get_uint8(copy) == 10);
+  assert_size_equal(cbor_refcount(copy), 1);
+  cbor_decref(&copy);
+
+  item = cbor_build_bool(true);
+  copy = cbor_copy(item);
+  assert_ptr_not_equal(item, copy);
+  assert_true(cbor_get_bool(copy));
+  assert_size_equal(cbor_refcount(copy), 1);
+  cbor_set_bool(copy, false);
+  assert_false(cbor_get_bool(copy));
+  assert_true(cbor_get_bool(item));
+  cbor_decref(&copy);
+
+  WITH_FAILING_MALLOC({ assert_null(cbor_copy(item)); });
+  item = cbor_build_uint8(10);
+  WITH_FAILING_MALLOC({ assert_null(cbor_copy(item)); });
+}
+
 static void test_floats(void** _state _CBOR_UNUSED) {
   item = cbor_build_float2(3.14f);
   assert_true(cbor_float_get_float2(copy = cbor_copy(item)) ==
@@ -568,7 +602,7 @@ static void test_definite_floats(void** _state _CBOR_UNUSED) {
 }
 
 static void test_alloc_failure_simple(void** _state _CBOR_UNUSED) {
-  item = cbor_build_uint8(10);
+  item = cbor_build_uint8(42);
 
   WITH_FAILING_MALLOC({ assert_null(cbor_copy(item)); });
   assert_size_equal(cbor_refcount(item), 1);
@@ -577,7 +611,7 @@ static void test_alloc_failure_simple(void** _state _CBOR_UNUSED) {
 }
 
 static void test_negint8_alloc_failure(void** _state _CBOR_UNUSED) {
-  item = cbor_build_negint8(10);
+  item = cbor_build_negint8(42);
   WITH_FAILING_MALLOC({ assert_null(cbor_copy(item)); });
   assert_size_equal(cbor_refcount(item), 1);
   cbor_decref(&item);
@@ -786,7 +820,7 @@ static void test_map_value_alloc_failure(void** _state _CBOR_UNUSED) {
   item = cbor_new_indefinite_map();
   assert_true(
       cbor_map_add(item, (struct cbor_pair){cbor_move(cbor_build_uint8(42)),
-                                            cbor_move(cbor_build_bool(true))}));
+                                            cbor_move(cbor_build_uint8(43))}));
 
   WITH_MOCK_MALLOC({ assert_null(cbor_copy(item)); }, 3,
                    // New map, key copy, value copy
@@ -861,6 +895,7 @@ int main(void) {
       cmocka_unit_test(test_indef_map),
       cmocka_unit_test(test_tag),
       cmocka_unit_test(test_ctrls),
+      cmocka_unit_test(test_shared_items),
       cmocka_unit_test(test_floats),
       cmocka_unit_test(test_alloc_failure_simple),
       cmocka_unit_test(test_negint8_alloc_failure),
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "assertions.h"
+#include "cbor.h"
+#include "test_allocator.h"
+
+struct counting_heap {
+  size_t allocations;
+  size_t live;
+  // Fail every allocation once this many have been made
+  size_t limit;
+};
+
+static void* counting_allocate(void* context, size_t size) {
+  struct counting_heap* heap = context;
+  if (heap->allocations == heap->limit) return NULL;
+  heap->allocations++;
+  heap->live++;
+  return malloc(size);
+}
+
+static void* counting_reallocate(void* context, void* ptr,
+                                 size_t old_size _CBOR_UNUSED,
+                                 size_t new_size) {
+  struct counting_heap* heap = context;
+  if (ptr == NULL) return counting_allocate(context, new_size);
+  if (heap->allocations == heap->limit) return NULL;
+  heap->allocations++;
+  return realloc(ptr, new_size);
+}
+
+static void counting_deallocate(void* context, void* ptr) {
+  struct counting_heap* heap = context;
+  if (ptr != NULL) heap->live--;
+  free(ptr);
+}
+
+struct counting_heap heap;
+struct cbor_allocator allocator = {.allocate = counting_allocate,
+                                   .reallocate = counting_reallocate,
+                                   .deallocate = counting_deallocate,
+                                   .context = &heap};
+
+static int setup(void** _state _CBOR_UNUSED) {
+  heap = (struct counting_heap){.limit = SIZE_MAX};
+  return 0;
+}
+
+// {"a": [1, -2, 3.5], "b": (_ h'01' h'02'), 0: 1(null)}
+static unsigned char message[] = {0xA3, 0x61, 0x61, 0x83, 0x01, 0x21, 0xF9,
+                                  0x43, 0x00, 0x61, 0x62, 0x5F, 0x41, 0x01,
+                                  0x41, 0x02, 0xFF, 0x00, 0xC1, 0xF6};
+
+static void test_load(void** _state _CBOR_UNUSED) {
+  struct cbor_load_result res;
+  cbor_item_t* item;
+  // Only the temporary parser stack comes from the global allocator
+  WITH_MOCK_MALLOC(
+      {
+        item = cbor_load_with(message, sizeof(message), &allocator, &res);
+        assert_non_null(item);
+      },
+      1, MALLOC);
+  assert_true(heap.allocations > 0);
+
+  cbor_item_t* reference = cbor_load(message, sizeof(message), &res);
+  assert_true(cbor_structurally_equal(item, reference));
+  cbor_decref(&reference);
+
+  WITH_MOCK_MALLOC({ cbor_decref(&item); }, 0, MALLOC);
+  assert_size_equal(heap.live, 0);
+}
+
+static void test_load_failure(void** _state _CBOR_UNUSED) {
+  struct cbor_load_result res;
+  for (size_t limit = 0; limit < 10; limit++) {
+    heap = (struct counting_heap){.limit = limit};
+    assert_null(cbor_load_with(message, sizeof(message), &allocator, &res));
+    assert_true(res.error.code == CBOR_ERR_MEMERROR);
+    assert_size_equal(heap.live, 0);
+  }
+}
+
+static void test_constructors(void** _state _CBOR_UNUSED) {
+  cbor_item_t* array;
+  WITH_MOCK_MALLOC(
+      {
+        array = cbor_new_indefinite_array_with(&allocator);
+        assert_true(cbor_array_push(
+            array, cbor_move(cbor_build_uint64_with(&allocator, 1))));
+        assert_true(cbor_array_push(
+            array, cbor_move(cbor_build_negint8_with(&allocator, 1))));
+        assert_true(cbor_array_push(
+            array, cbor_move(cbor_build_string_with(&allocator, "abc"))));
+        assert_true(cbor_array_push(
+            array,
+            cbor_move(cbor_build_bytestring_with(&allocator,
+                                                 (cbor_data) "\x01", 1))));
+        assert_true(cbor_array_push(
+            array, cbor_move(cbor_build_float8_with(&allocator, 1.5))));
+        assert_true(cbor_array_push(
+            array, cbor_move(cbor_build_bool_with(&allocator, true))));
+        assert_true(cbor_array_push(
+            array, cbor_move(cbor_new_null_with(&allocator))));
+        assert_true(cbor_array_push(
+            array,
+            cbor_move(cbor_build_tag_with(
+                &allocator, 1, cbor_move(cbor_new_undef_with(&allocator))))));
+        cbor_item_t* map = cbor_new_definite_map_with(&allocator, 1);
+        assert_true(cbor_map_add(
+            map, (struct cbor_pair){
+                     .key = cbor_move(cbor_build_stringn_with(&allocator,
+                                                              "key", 3)),
+                     .value = cbor_move(cbor_build_uint8_with(&allocator,
+                                                              2))}));
+        assert_true(cbor_array_push(array, cbor_move(map)));
+      },
+      0, MALLOC);
+  assert_size_equal(cbor_array_size(array), 9);
+  cbor_decref(&array);
+  assert_size_equal(heap.live, 0);
+}
+
+static void test_constructor_failure(void** _state _CBOR_UNUSED) {
+  // The item is allocated, its data is not
+  heap.limit = 1;
+  assert_null(cbor_build_string_with(&allocator, "abc"));
+  assert_size_equal(heap.live, 0);
+  heap = (struct counting_heap){.limit = 1};
+  assert_null(cbor_build_bytestring_with(&allocator, (cbor_data) "a", 1));
+  assert_size_equal(heap.live, 0);
+}
+
+static void test_null_allocator(void** _state _CBOR_UNUSED) {
+  cbor_item_t* item;
+  WITH_MOCK_MALLOC({ item = cbor_build_uint8_with(NULL, 42); }, 1, MALLOC);
+  assert_uint8(item, 42);
+  cbor_decref(&item);
+}
+
+static void test_serialize_alloc(void** _state _CBOR_UNUSED) {
+  cbor_item_t* item = cbor_build_string("Hello");
+  unsigned char* buffer;
+  size_t buffer_size;
+  size_t written;
+  WITH_MOCK_MALLOC(
+      {
+        written = cbor_serialize_alloc_with(item, &allocator, &buffer,
+                                            &buffer_size);
+      },
+      0, MALLOC);
+  assert_size_equal(written, 6);
+  assert_size_equal(buffer_size, 6);
+  assert_memory_equal(buffer, "\x65Hello", 6);
+  assert_size_equal(heap.allocations, 1);
+  allocator.deallocate(allocator.context, buffer);
+  assert_size_equal(heap.live, 0);
+
+  heap.limit = heap.allocations;
+  assert_size_equal(
+      cbor_serialize_alloc_with(item, &allocator, &buffer, &buffer_size), 0);
+  assert_null(buffer);
+  assert_size_equal(buffer_size, 0);
+  cbor_decref(&item);
+}
+
+static void test_serialize_canonical(void** _state _CBOR_UNUSED) {
+  // {2: 0, 1: 0}, the keys need sorting
+  cbor_item_t* map = cbor_new_definite_map_with(&allocator, 2);
+  for (uint8_t key = 2; key > 0; key--) {
+    assert_true(cbor_map_add(
+        map, (struct cbor_pair){.key = cbor_move(cbor_build_uint8(key)),
+                                .value = cbor_move(cbor_build_uint8(0))}));
+  }
+  size_t allocations = heap.allocations;
+  unsigned char buffer[8];
+  size_t written;
+  // The scratch buffers for sorting come from the map's allocator
+  WITH_MOCK_MALLOC(
+      { written = cbor_serialize_canonical(map, buffer, sizeof(buffer)); }, 0,
+      MALLOC);
+  assert_size_equal(written, 5);
+  assert_memory_equal(buffer, "\xA2\x01\x00\x02\x00", 5);
+  assert_size_equal(heap.allocations, allocations + 2);
+
+  heap.limit = heap.allocations + 1;
+  assert_size_equal(cbor_serialize_canonical(map, buffer, sizeof(buffer)), 0);
+  cbor_decref(&map);
+  assert_size_equal(heap.live, 0);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+      cmocka_unit_test_setup_teardown(test_load, setup, NULL),
+      cmocka_unit_test_setup_teardown(test_load_failure, setup, NULL),
+      cmocka_unit_test_setup_teardown(test_constructors, setup, NULL),
+      cmocka_unit_test_setup_teardown(test_constructor_failure, setup, NULL),
+      cmocka_unit_test_setup_teardown(test_null_allocator, setup, NULL),
+      cmocka_unit_test_setup_teardown(test_serialize_alloc, setup, NULL),
+      cmocka_unit_test_setup_teardown(test_serialize_canonical, setup, NULL),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include <cmocka.h>
+
+#include "assertions.h"
+#include "cbor.h"
+#include "test_allocator.h"
+
+cbor_decoder_t decoder;
+struct cbor_load_result res;
+
+// {"a": [1, 2, [3]], "bc": h'DEADBEEF', 4: (_ "x", "y")}
+static unsigned char message[] = {
+    0xA3, 0x61, 0x61, 0x83, 0x01, 0x02, 0x81, 0x03, 0x62, 0x62, 0x63,
+    0x44, 0xDE, 0xAD, 0xBE, 0xEF, 0x04, 0x7F, 0x61, 0x78, 0x61, 0x79, 0xFF};
+
+static void check_message(cbor_item_t* item) {
+  assert_non_null(item);
+  assert_true(res.error.code == CBOR_ERR_NONE);
+  assert_size_equal(res.read, sizeof(message));
+
+  cbor_item_t* reference = cbor_load(message, sizeof(message), &res);
+  assert_true(cbor_structurally_equal(item, reference));
+  cbor_decref(&reference);
+}
+
+static void test_load(void** _state _CBOR_UNUSED) {
+  for (int recycle = 0; recycle < 2; recycle++) {
+    cbor_decoder_init(&decoder, recycle);
+    for (int i = 0; i < 10; i++) {
+      cbor_item_t* item =
+          cbor_decoder_load(&decoder, message, sizeof(message), &res);
+      check_message(item);
+      cbor_decref(&item);
+    }
+    cbor_decoder_release(&decoder);
+  }
+}
+
+static void test_stack_is_reused(void** _state _CBOR_UNUSED) {
+  cbor_decoder_init(&decoder, false);
+  cbor_item_t* item =
+      cbor_decoder_load(&decoder, message, sizeof(message), &res);
+  cbor_decref(&item);
+
+  // Only the array and its storage are allocated, the stack is already there
+  // and small integers are shared
+  unsigned char array[] = {0x81, 0x01};
+  WITH_MOCK_MALLOC(
+      {
+        item = cbor_decoder_load(&decoder, array, sizeof(array), &res);
+        assert_non_null(item);
+        cbor_decref(&item);
+      },
+      2, MALLOC, MALLOC);
+  cbor_decoder_release(&decoder);
+}
+
+static void test_items_are_recycled(void** _state _CBOR_UNUSED) {
+  cbor_decoder_init(&decoder, true);
+  cbor_item_t* item =
+      cbor_decoder_load(&decoder, message, sizeof(message), &res);
+  cbor_decref(&item);
+
+  // All blocks of the previous message are back on the free-list
+  WITH_MOCK_MALLOC(
+      { item = cbor_decoder_load(&decoder, message, sizeof(message), &res); },
+      0, MALLOC);
+  check_message(item);
+  cbor_decref(&item);
+  cbor_decoder_release(&decoder);
+}
+
+static void test_recycled_items_are_mutable(void** _state _CBOR_UNUSED) {
+  cbor_decoder_init(&decoder, true);
+  unsigned char array[] = {0x9F, 0x01, 0xFF};
+  cbor_item_t* item = cbor_decoder_load(&decoder, array, sizeof(array), &res);
+  // Grow the array past the slab block size
+  for (int i = 0; i < 100; i++) {
+    assert_true(cbor_array_push(item, cbor_move(cbor_build_uint8(2))));
+  }
+  assert_size_equal(cbor_array_size(item), 101);
+  cbor_item_t* copy = cbor_copy(item);
+  assert_true(cbor_structurally_equal(item, copy));
+  cbor_decref(&copy);
+  cbor_decref(&item);
+  cbor_decoder_release(&decoder);
+}
+
+static void test_many_items(void** _state _CBOR_UNUSED) {
+  cbor_decoder_init(&decoder, true);
+  // An array of 10000 integers needs several slabs
+  size_t count = 10000;
+  unsigned char* data = malloc(3 + 3 * count);
+  data[0] = 0x99;
+  data[1] = (unsigned char)(count >> 8);
+  data[2] = (unsigned char)count;
+  for (size_t i = 0; i < count; i++) {
+    data[3 + 3 * i] = 0x19;
+    data[4 + 3 * i] = (unsigned char)(i >> 8);
+    data[5 + 3 * i] = (unsigned char)i;
+  }
+  for (int round = 0; round < 3; round++) {
+    cbor_item_t* item =
+        cbor_decoder_load(&decoder, data, 3 + 3 * count, &res);
+    assert_non_null(item);
+    assert_size_equal(cbor_array_size(item), count);
+    cbor_item_t* last = cbor_array_get(item, count - 1);
+    assert_true(cbor_get_int(last) == count - 1);
+    cbor_decref(&last);
+    cbor_decref(&item);
+  }
+  free(data);
+  cbor_decoder_release(&decoder);
+}
+
+static void test_errors(void** _state _CBOR_UNUSED) {
+  for (int recycle = 0; recycle < 2; recycle++) {
+    cbor_decoder_init(&decoder, recycle);
+    assert_null(cbor_decoder_load(&decoder, message, 0, &res));
+    assert_true(res.error.code == CBOR_ERR_NODATA);
+    // Truncated in the middle of nested containers
+    assert_null(cbor_decoder_load(&decoder, message, 7, &res));
+    assert_true(res.error.code == CBOR_ERR_NOTENOUGHDATA);
+    // The decoder still works afterwards
+    cbor_item_t* item =
+        cbor_decoder_load(&decoder, message, sizeof(message), &res);
+    check_message(item);
+    cbor_decref(&item);
+    cbor_decoder_release(&decoder);
+  }
+}
+
+static void test_stack_limit(void** _state _CBOR_UNUSED) {
+  cbor_decoder_init(&decoder, true);
+  size_t depth = CBOR_MAX_STACK_SIZE + 1;
+  unsigned char* data = malloc(depth + 1);
+  for (size_t i = 0; i < depth; i++) data[i] = 0x81;
+  data[depth] = 0x00;
+  assert_null(cbor_decoder_load(&decoder, data, depth + 1, &res));
+  assert_true(res.error.code == CBOR_ERR_MEMERROR);
+  // One level less fits
+  cbor_item_t* item = cbor_decoder_load(&decoder, data + 1, depth, &res);
+  assert_non_null(item);
+  cbor_decref(&item);
+  free(data);
+  cbor_decoder_release(&decoder);
+}
+
+static void test_slab_allocation_failure(void** _state _CBOR_UNUSED) {
+  cbor_decoder_init(&decoder, true);
+  WITH_FAILING_MALLOC({
+    assert_null(cbor_decoder_load(&decoder, message, sizeof(message), &res));
+    assert_true(res.error.code == CBOR_ERR_MEMERROR);
+  });
+  cbor_decoder_release(&decoder);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_load),
+      cmocka_unit_test(test_stack_is_reused),
+      cmocka_unit_test(test_items_are_recycled),
+      cmocka_unit_test(test_recycled_items_are_mutable),
+      cmocka_unit_test(test_many_items),
+      cmocka_unit_test(test_errors),
+      cmocka_unit_test(test_stack_limit),
+      cmocka_unit_test(test_slab_allocation_failure),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
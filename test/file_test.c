@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <errno.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cmocka.h>
+
+#include "assertions.h"
+#include "cbor.h"
+#include "test_allocator.h"
+
+static const char* path = "file_test.cbor";
+
+// {"name": "libcbor", "data": [1, 2, 3]}
+static unsigned char message[] = {0xA2, 0x64, 0x6E, 0x61, 0x6D, 0x65, 0x67,
+                                  0x6C, 0x69, 0x62, 0x63, 0x62, 0x6F, 0x72,
+                                  0x64, 0x64, 0x61, 0x74, 0x61, 0x83, 0x01,
+                                  0x02, 0x03};
+
+static void write_file(const unsigned char* data, size_t size) {
+  FILE* file = fopen(path, "wb");
+  assert_non_null(file);
+  assert_size_equal(fwrite(data, 1, size, file), size);
+  assert_int_equal(fclose(file), 0);
+}
+
+static void test_load(void** _state _CBOR_UNUSED) {
+  write_file(message, sizeof(message));
+  struct cbor_load_result res;
+  cbor_item_t* item = cbor_load_file(path, CBOR_FILE_SEQUENTIAL, &res);
+  assert_non_null(item);
+  assert_true(res.error.code == CBOR_ERR_NONE);
+  assert_size_equal(res.read, sizeof(message));
+  assert_size_equal(cbor_map_size(item), 2);
+  cbor_decref(&item);
+  remove(path);
+}
+
+static void test_open(void** _state _CBOR_UNUSED) {
+  write_file(message, sizeof(message));
+  cbor_file_t file;
+  assert_true(cbor_file_open(&file, path, CBOR_FILE_RANDOM));
+  assert_size_equal(file.size, sizeof(message));
+  assert_memory_equal(file.data, message, sizeof(message));
+
+  // The strings point into the contents of the file
+  struct cbor_load_result res;
+  cbor_item_t* item = cbor_load_borrowed(file.data, file.size, &res);
+  assert_non_null(item);
+  cbor_item_t* name = cbor_map_handle(item)[0].value;
+  assert_true(cbor_string_is_borrowed(name));
+  assert_ptr_equal(cbor_string_handle(name), file.data + 7);
+  cbor_decref(&item);
+
+  cbor_file_close(&file);
+  assert_null(file.data);
+  assert_size_equal(file.size, 0);
+  remove(path);
+}
+
+static void test_view(void** _state _CBOR_UNUSED) {
+  write_file(message, sizeof(message));
+  cbor_file_t file;
+  cbor_view_t view, data, element;
+  assert_true(cbor_view_open_file(path, &file, &view));
+  assert_true(cbor_view_map_find(view, "data", 4, &data));
+  assert_true(cbor_view_array_at(data, 2, &element));
+  uint64_t value;
+  assert_true(cbor_view_get_uint(element, &value));
+  assert_int_equal(value, 3);
+  cbor_file_close(&file);
+  remove(path);
+}
+
+static void test_empty(void** _state _CBOR_UNUSED) {
+  write_file(message, 0);
+  cbor_file_t file;
+  assert_true(cbor_file_open(&file, path, CBOR_FILE_SEQUENTIAL));
+  assert_null(file.data);
+  assert_size_equal(file.size, 0);
+  cbor_file_close(&file);
+
+  struct cbor_load_result res;
+  assert_null(cbor_load_file(path, CBOR_FILE_SEQUENTIAL, &res));
+  assert_true(res.error.code == CBOR_ERR_NODATA);
+  remove(path);
+}
+
+static void test_truncated(void** _state _CBOR_UNUSED) {
+  write_file(message, sizeof(message) - 1);
+  struct cbor_load_result res;
+  assert_null(cbor_load_file(path, CBOR_FILE_SEQUENTIAL, &res));
+  assert_true(res.error.code == CBOR_ERR_NOTENOUGHDATA);
+  remove(path);
+}
+
+static void test_missing(void** _state _CBOR_UNUSED) {
+  cbor_file_t file;
+  assert_false(cbor_file_open(&file, "file_test_missing.cbor",
+                              CBOR_FILE_SEQUENTIAL));
+
+  struct cbor_load_result res;
+  assert_null(
+      cbor_load_file("file_test_missing.cbor", CBOR_FILE_RANDOM, &res));
+  assert_true(res.error.code == CBOR_ERR_FILE);
+  assert_size_equal(res.read, 0);
+}
+
+static void test_read_alloc_failure(void** _state _CBOR_UNUSED) {
+  // Empty files are not mapped, they are read into a buffer
+  write_file(message, 0);
+  WITH_MOCK_MALLOC(
+      {
+        cbor_file_t file;
+        errno = 0;
+        assert_false(cbor_file_open(&file, path, CBOR_FILE_SEQUENTIAL));
+        assert_int_equal(errno, ENOMEM);
+
+        struct cbor_load_result res;
+        assert_null(cbor_load_file(path, CBOR_FILE_SEQUENTIAL, &res));
+        assert_true(res.error.code == CBOR_ERR_MEMERROR);
+        assert_size_equal(res.read, 0);
+      },
+      2, REALLOC_FAIL, REALLOC_FAIL);
+  remove(path);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_load),      cmocka_unit_test(test_open),
+      cmocka_unit_test(test_view),      cmocka_unit_test(test_empty),
+      cmocka_unit_test(test_truncated), cmocka_unit_test(test_missing),
+      cmocka_unit_test(test_read_alloc_failure),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
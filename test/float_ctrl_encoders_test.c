@@ -234,13 +234,103 @@ static void test_double(void** _state _CBOR_UNUSED) {
       9);
 }
 
+static void assert_preferred(double value, cbor_data expected,
+                             size_t expected_size) {
+  assert_size_equal(cbor_encode_preferred_float(value, buffer, 512),
+                    expected_size);
+  assert_memory_equal(buffer, expected, expected_size);
+  assert_size_equal(
+      cbor_encode_preferred_float(value, buffer, expected_size - 1), 0);
+}
+
+static void test_preferred(void** _state _CBOR_UNUSED) {
+  assert_preferred(0.0, (cbor_data) "\xF9\x00\x00", 3);
+  assert_preferred(-0.0, (cbor_data) "\xF9\x80\x00", 3);
+  assert_preferred(1.5, (cbor_data) "\xF9\x3E\x00", 3);
+  assert_preferred(65504.0, (cbor_data) "\xF9\x7B\xFF", 3);
+  assert_preferred(6.103515625e-05, (cbor_data) "\xF9\x04\x00", 3);
+  // Half-precision subnormals
+  assert_preferred(5.960464477539063e-8, (cbor_data) "\xF9\x00\x01", 3);
+  assert_preferred(-3.0 * 5.960464477539063e-8, (cbor_data) "\xF9\x80\x03",
+                   3);
+  assert_preferred(INFINITY, (cbor_data) "\xF9\x7C\x00", 3);
+  assert_preferred(-INFINITY, (cbor_data) "\xF9\xFC\x00", 3);
+  assert_preferred(NAN, (cbor_data) "\xF9\x7E\x00", 3);
+  assert_preferred(nan("3"), (cbor_data) "\xF9\x7E\x00", 3);
+
+  // Too precise, too large, or too small for half precision
+  assert_preferred(65505.0, (cbor_data) "\xFA\x47\x7F\xE1\x00", 5);
+  assert_preferred(100000.0, (cbor_data) "\xFA\x47\xC3\x50\x00", 5);
+  assert_preferred(2.9802322387695312e-8, (cbor_data) "\xFA\x33\x00\x00\x00",
+                   5);
+  assert_preferred(1.5 * 5.960464477539063e-8,
+                   (cbor_data) "\xFA\x33\xC0\x00\x00", 5);
+  assert_preferred(3.4028234663852886e+38,
+                   (cbor_data) "\xFA\x7F\x7F\xFF\xFF", 5);
+
+  // Not representable as a float
+  assert_preferred(1.1, (cbor_data) "\xFB\x3F\xF1\x99\x99\x99\x99\x99\x9A",
+                   9);
+  assert_preferred(1.0e+300,
+                   (cbor_data) "\xFB\x7E\x37\xE4\x3C\x88\x00\x75\x9C", 9);
+  assert_preferred(1.0e-300,
+                   (cbor_data) "\xFB\x01\xA5\x6E\x1F\xC2\xF8\xF3\x59", 9);
+}
+
+// Every half-precision value is encoded back to the same three bytes
+static void test_preferred_all_halves(void** _state _CBOR_UNUSED) {
+  unsigned char half[3] = {0xF9};
+  for (uint32_t bits = 0; bits <= 0xFFFF; bits++) {
+    half[1] = (unsigned char)(bits >> 8);
+    half[2] = (unsigned char)bits;
+    struct cbor_load_result res;
+    cbor_item_t* item = cbor_load(half, 3, &res);
+    assert_non_null(item);
+    double value = cbor_float_get_float(item);
+    cbor_decref(&item);
+    if (isnan(value)) continue;
+    assert_size_equal(cbor_encode_preferred_float(value, buffer, 512), 3);
+    assert_memory_equal(buffer, half, 3);
+  }
+}
+
+static void test_preferred_floats(void** _state _CBOR_UNUSED) {
+  const float values[] = {1.0f, 0.1f, -INFINITY, NAN};
+  const unsigned char expected[] = {0xF9, 0x3C, 0x00, 0xFA, 0x3D, 0xCC, 0xCC,
+                                    0xCD, 0xF9, 0xFC, 0x00, 0xF9, 0x7E, 0x00};
+  assert_size_equal(cbor_encode_preferred_floats(values, 4, buffer, 512),
+                    sizeof(expected));
+  assert_memory_equal(buffer, expected, sizeof(expected));
+  assert_size_equal(cbor_encode_preferred_floats(values, 4, buffer,
+                                                 sizeof(expected) - 1),
+                    0);
+  assert_size_equal(cbor_encode_preferred_floats(values, 0, buffer, 0), 0);
+}
+
+static void test_preferred_doubles(void** _state _CBOR_UNUSED) {
+  const double values[] = {-2.0, 0.1, 0.25, 1.0e40};
+  const unsigned char expected[] = {
+      0xF9, 0xC0, 0x00, 0xFB, 0x3F, 0xB9, 0x99, 0x99, 0x99, 0x99,
+      0x99, 0x9A, 0xF9, 0x34, 0x00, 0xFB, 0x48, 0x3D, 0x63, 0x29,
+      0xF1, 0xC3, 0x5C, 0xA5};
+  assert_size_equal(cbor_encode_preferred_doubles(values, 4, buffer, 512),
+                    sizeof(expected));
+  assert_memory_equal(buffer, expected, sizeof(expected));
+  assert_size_equal(cbor_encode_preferred_doubles(values, 4, buffer,
+                                                  sizeof(expected) - 1),
+                    0);
+}
+
 int main(void) {
   const struct CMUnitTest tests[] = {
       cmocka_unit_test(test_bools),         cmocka_unit_test(test_null),
       cmocka_unit_test(test_undef),         cmocka_unit_test(test_break),
       cmocka_unit_test(test_half),          cmocka_unit_test(test_float),
       cmocka_unit_test(test_double),        cmocka_unit_test(test_half_special),
-      cmocka_unit_test(test_half_infinity),
+      cmocka_unit_test(test_half_infinity), cmocka_unit_test(test_preferred),
+      cmocka_unit_test(test_preferred_all_halves),
+      cmocka_unit_test(test_preferred_floats),
+      cmocka_unit_test(test_preferred_doubles),
   };
   return cmocka_run_group_tests(tests, NULL, NULL);
 }
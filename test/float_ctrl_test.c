@@ -98,8 +98,6 @@ static void test_bool(void** _state _CBOR_UNUSED) {
     assert_true(cbor_float_get_width(float_ctrl) == CBOR_FLOAT_0);
     assert_true(cbor_is_bool(float_ctrl));
     assert_false(cbor_get_bool(float_ctrl));
-    cbor_set_bool(float_ctrl, true);
-    assert_true(cbor_get_bool(float_ctrl));
     assert_true(isnan(cbor_float_get_float(float_ctrl)));
     cbor_decref(&float_ctrl);
     assert_null(float_ctrl);
@@ -110,9 +108,17 @@ static void test_bool(void** _state _CBOR_UNUSED) {
     assert_true(cbor_float_get_width(float_ctrl) == CBOR_FLOAT_0);
     assert_true(cbor_is_bool(float_ctrl));
     assert_true(cbor_get_bool(float_ctrl));
+    assert_true(isnan(cbor_float_get_float(float_ctrl)));
+    cbor_decref(&float_ctrl);
+    assert_null(float_ctrl);
+
+    // Decoded booleans are shared, only new items can be modified
+    float_ctrl = cbor_new_ctrl();
+    cbor_set_ctrl(float_ctrl, CBOR_CTRL_FALSE);
+    cbor_set_bool(float_ctrl, true);
+    assert_true(cbor_get_bool(float_ctrl));
     cbor_set_bool(float_ctrl, false);
     assert_false(cbor_get_bool(float_ctrl));
-    assert_true(isnan(cbor_float_get_float(float_ctrl)));
     cbor_decref(&float_ctrl);
     assert_null(float_ctrl);
   });
@@ -126,13 +132,34 @@ static void test_float_ctrl_creation(void** _state _CBOR_UNUSED) {
   WITH_FAILING_MALLOC({ assert_null(cbor_new_null()); });
   WITH_FAILING_MALLOC({ assert_null(cbor_new_undef()); });
 
-  WITH_FAILING_MALLOC({ assert_null(cbor_build_bool(false)); });
+  // Shared items, nothing to allocate
+  WITH_MOCK_MALLOC({ assert_non_null(cbor_build_bool(false)); }, 0, MALLOC);
+  WITH_MOCK_MALLOC({ assert_non_null(cbor_build_ctrl(CBOR_CTRL_NULL)); }, 0,
+                   MALLOC);
   WITH_FAILING_MALLOC({ assert_null(cbor_build_float2(3.14f)); });
   WITH_FAILING_MALLOC({ assert_null(cbor_build_float4(3.14f)); });
   WITH_FAILING_MALLOC({ assert_null(cbor_build_float8(3.14)); });
   WITH_FAILING_MALLOC({ assert_null(cbor_build_ctrl(0xAF)); });
 }
 
+static void test_simple_values_are_shared(void** _state _CBOR_UNUSED) {
+  float_ctrl = cbor_load(bool_data + 1, 1, &res);
+  assert_ptr_equal(float_ctrl, cbor_build_bool(true));
+  assert_ptr_equal(float_ctrl, cbor_build_ctrl(CBOR_CTRL_TRUE));
+  assert_ptr_not_equal(float_ctrl, cbor_build_bool(false));
+  assert_size_equal(cbor_refcount(float_ctrl), SIZE_MAX);
+  cbor_decref(&float_ctrl);
+  assert_null(float_ctrl);
+
+  float_ctrl = cbor_load(null_data, 1, &res);
+  cbor_item_t* fresh = cbor_new_null();
+  assert_ptr_not_equal(float_ctrl, fresh);
+  assert_size_equal(cbor_refcount(fresh), 1);
+  assert_true(cbor_is_null(fresh));
+  cbor_decref(&fresh);
+  cbor_decref(&float_ctrl);
+}
+
 static void test_ctrl_on_float(void** _state _CBOR_UNUSED) {
   float_ctrl = cbor_build_float4(3.14f);
   assert_non_null(float_ctrl);
@@ -155,6 +182,7 @@ int main(void) {
       cmocka_unit_test(test_bool),
       cmocka_unit_test(test_float_ctrl_creation),
       cmocka_unit_test(test_ctrl_on_float),
+      cmocka_unit_test(test_simple_values_are_shared),
   };
   return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -0,0 +1,325 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <locale.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "assertions.h"
+#include "cbor.h"
+#include "test_allocator.h"
+
+unsigned char output[512];
+struct cbor_load_result res;
+
+// Convert the input and return the NUL-terminated output
+static const char* convert(const unsigned char* data, size_t size) {
+  cbor_writer writer;
+  cbor_writer_init_buffer(&writer, output, sizeof(output) - 1);
+  bool success = cbor_to_json(data, size, &writer, &res);
+  output[cbor_writer_length(&writer)] = 0;
+  assert_true(success == (res.error.code == CBOR_ERR_NONE));
+  return (const char*)output;
+}
+
+#define assert_json(expected, ...)                              \
+  do {                                                          \
+    unsigned char data[] = {__VA_ARGS__};                       \
+    assert_string_equal(convert(data, sizeof(data)), expected); \
+    assert_true(res.error.code == CBOR_ERR_NONE);               \
+    assert_size_equal(res.read, sizeof(data));                  \
+  } while (0)
+
+#define assert_json_error(expected_code, expected_position, ...) \
+  do {                                                           \
+    unsigned char data[] = {__VA_ARGS__};                        \
+    convert(data, sizeof(data));                                 \
+    assert_true(res.error.code == expected_code);                \
+    assert_size_equal(res.error.position, expected_position);    \
+  } while (0)
+
+static void test_integers(void** _state _CBOR_UNUSED) {
+  assert_json("0", 0x00);
+  assert_json("24", 0x18, 0x18);
+  assert_json("1000", 0x19, 0x03, 0xE8);
+  assert_json("1000000", 0x1A, 0x00, 0x0F, 0x42, 0x40);
+  assert_json("18446744073709551615", 0x1B, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+              0xFF, 0xFF, 0xFF);
+  assert_json("-1", 0x20);
+  assert_json("-100", 0x38, 0x63);
+  assert_json("-1000", 0x39, 0x03, 0xE7);
+  assert_json("-18446744073709551616", 0x3B, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+              0xFF, 0xFF, 0xFF);
+}
+
+static void test_floats(void** _state _CBOR_UNUSED) {
+  assert_json("0", 0xF9, 0x00, 0x00);
+  assert_json("-0", 0xF9, 0x80, 0x00);
+  assert_json("1.5", 0xF9, 0x3E, 0x00);
+  assert_json("-4", 0xF9, 0xC4, 0x00);
+  assert_json("65504", 0xF9, 0x7B, 0xFF);
+  assert_json("5.9604645e-08", 0xF9, 0x00, 0x01);
+  assert_json("100000", 0xFA, 0x47, 0xC3, 0x50, 0x00);
+  assert_json("0.1", 0xFA, 0x3D, 0xCC, 0xCC, 0xCD);
+  assert_json("3.4028235e+38", 0xFA, 0x7F, 0x7F, 0xFF, 0xFF);
+  assert_json("0.1", 0xFB, 0x3F, 0xB9, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9A);
+  assert_json("-4.1", 0xFB, 0xC0, 0x10, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66);
+  assert_json("1e+300", 0xFB, 0x7E, 0x37, 0xE4, 0x3C, 0x88, 0x00, 0x75,
+              0x9C);
+  assert_json("null", 0xF9, 0x7C, 0x00);
+  assert_json("null", 0xF9, 0x7E, 0x00);
+  assert_json("null", 0xFA, 0xFF, 0x80, 0x00, 0x00);
+  assert_json("null", 0xFB, 0x7F, 0xF8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00);
+}
+
+static void test_simple_values(void** _state _CBOR_UNUSED) {
+  assert_json("false", 0xF4);
+  assert_json("true", 0xF5);
+  assert_json("null", 0xF6);
+  assert_json("null", 0xF7);
+}
+
+static void test_floats_locale(void** _state _CBOR_UNUSED) {
+  // Locales that use a decimal comma, if any of them is installed
+  static const char* locales[] = {"de_DE.UTF-8", "de_DE.utf8", "de_DE",
+                                  "fr_FR.UTF-8", "fr_FR.utf8", "fr_FR",
+                                  "German",      "French"};
+  for (size_t i = 0; i < sizeof(locales) / sizeof(locales[0]); i++) {
+    if (setlocale(LC_NUMERIC, locales[i]) != NULL) break;
+  }
+  assert_json("1.5", 0xF9, 0x3E, 0x00);
+  assert_json("0.1", 0xFA, 0x3D, 0xCC, 0xCC, 0xCD);
+  assert_json("-4.1", 0xFB, 0xC0, 0x10, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66);
+  assert_json("5.9604645e-08", 0xF9, 0x00, 0x01);
+  setlocale(LC_NUMERIC, "C");
+}
+
+static void test_strings(void** _state _CBOR_UNUSED) {
+  assert_json("\"\"", 0x60);
+  assert_json("\"IETF\"", 0x64, 0x49, 0x45, 0x54, 0x46);
+  assert_json("\"\\\"\\\\\"", 0x62, 0x22, 0x5C);
+  assert_json("\"\xC3\xBC\xE6\xB0\xB4\"", 0x65, 0xC3, 0xBC, 0xE6, 0xB0, 0xB4);
+  assert_json("\"\\b\\t\\n\\f\\r\\u0000\\u001f\x7F\"", 0x68, 0x08, 0x09, 0x0A,
+              0x0C, 0x0D, 0x00, 0x1F, 0x7F);
+  // The escapes follow runs of plain text longer than a word
+  assert_json("\"abcdefghijklmnop\\nq\\\"\"", 0x73, 0x61, 0x62, 0x63, 0x64,
+              0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E,
+              0x6F, 0x70, 0x0A, 0x71, 0x22);
+  // (_ "strea", "ming")
+  assert_json("\"streaming\"", 0x7F, 0x65, 0x73, 0x74, 0x72, 0x65, 0x61,
+              0x64, 0x6D, 0x69, 0x6E, 0x67, 0xFF);
+  assert_json("\"\"", 0x7F, 0xFF);
+}
+
+static void test_byte_strings(void** _state _CBOR_UNUSED) {
+  // The RFC 4648 test vectors, in the URL-safe alphabet without padding
+  assert_json("\"\"", 0x40);
+  assert_json("\"Zg\"", 0x41, 0x66);
+  assert_json("\"Zm8\"", 0x42, 0x66, 0x6F);
+  assert_json("\"Zm9v\"", 0x43, 0x66, 0x6F, 0x6F);
+  assert_json("\"Zm9vYg\"", 0x44, 0x66, 0x6F, 0x6F, 0x62);
+  assert_json("\"Zm9vYmE\"", 0x45, 0x66, 0x6F, 0x6F, 0x62, 0x61);
+  assert_json("\"Zm9vYmFy\"", 0x46, 0x66, 0x6F, 0x6F, 0x62, 0x61, 0x72);
+  assert_json("\"-_8\"", 0x42, 0xFB, 0xFF);
+  // Chunks that do not end on a group boundary
+  assert_json("\"Zm9vYmFy\"", 0x5F, 0x41, 0x66, 0x40, 0x41, 0x6F, 0x43, 0x6F,
+              0x62, 0x61, 0x41, 0x72, 0xFF);
+  assert_json("\"Zm9vYg\"", 0x5F, 0x42, 0x66, 0x6F, 0x42, 0x6F, 0x62, 0xFF);
+  assert_json("\"\"", 0x5F, 0xFF);
+}
+
+static void test_long_byte_string(void** _state _CBOR_UNUSED) {
+  // Longer than the internal block of encoded characters
+  unsigned char data[3 + 300];
+  data[0] = 0x59;
+  data[1] = 0x01;
+  data[2] = 0x2C;
+  memset(data + 3, 0, 300);
+  const char* json = convert(data, sizeof(data));
+  assert_true(res.error.code == CBOR_ERR_NONE);
+  assert_size_equal(strlen(json), 2 + 400);
+  assert_int_equal(strspn(json + 1, "A"), 400);
+}
+
+static void test_long_string(void** _state _CBOR_UNUSED) {
+  // Longer than a vector, with a byte to escape at every offset
+  const unsigned char specials[] = {'"', '\\', 0x0A, 0x1F, 0x7F, 0xC3};
+  const char* escaped[] = {"\\\"", "\\\\", "\\n", "\\u001f", "\x7F",
+                           "\xC3"};
+  for (size_t kind = 0; kind < sizeof(specials); kind++) {
+    for (size_t offset = 0; offset < 100; offset++) {
+      unsigned char data[2 + 100];
+      data[0] = 0x78;
+      data[1] = 100;
+      memset(data + 2, 'a', 100);
+      data[2 + offset] = specials[kind];
+      const char* json = convert(data, sizeof(data));
+      assert_true(res.error.code == CBOR_ERR_NONE);
+      size_t length = strlen(escaped[kind]);
+      assert_size_equal(strlen(json), 2 + 99 + length);
+      assert_int_equal(strspn(json + 1, "a"), offset);
+      assert_memory_equal(json + 1 + offset, escaped[kind], length);
+      assert_int_equal(strspn(json + 1 + offset + length, "a"), 99 - offset);
+    }
+  }
+}
+
+static void test_containers(void** _state _CBOR_UNUSED) {
+  assert_json("[]", 0x80);
+  assert_json("{}", 0xA0);
+  assert_json("[1,[2,3],[4,5]]", 0x83, 0x01, 0x82, 0x02, 0x03, 0x82, 0x04,
+              0x05);
+  assert_json("{\"a\":1,\"b\":[2,3]}", 0xA2, 0x61, 0x61, 0x01, 0x61, 0x62,
+              0x82, 0x02, 0x03);
+  assert_json("[[],{},[[]]]", 0x83, 0x80, 0xA0, 0x81, 0x80);
+  // [_ 1, [2, 3], [_ 4, 5]]
+  assert_json("[1,[2,3],[4,5]]", 0x9F, 0x01, 0x82, 0x02, 0x03, 0x9F, 0x04,
+              0x05, 0xFF, 0xFF);
+  // {_ "Fun": true, "Amt": -2}
+  assert_json("{\"Fun\":true,\"Amt\":-2}", 0xBF, 0x63, 0x46, 0x75, 0x6E, 0xF5,
+              0x63, 0x41, 0x6D, 0x74, 0x21, 0xFF);
+  assert_json("[]", 0x9F, 0xFF);
+  assert_json("{}", 0xBF, 0xFF);
+}
+
+static void test_tags(void** _state _CBOR_UNUSED) {
+  // 1(1363896240)
+  assert_json("1363896240", 0xC1, 0x1A, 0x51, 0x4B, 0x67, 0xB0);
+  // [0("x"), 24(h'01')]
+  assert_json("[\"x\",\"AQ\"]", 0x82, 0xC0, 0x61, 0x78, 0xD8, 0x18, 0x41,
+              0x01);
+  // {1(2): 3}
+  assert_json("{\"2\":3}", 0xA1, 0xC1, 0x02, 0x03);
+}
+
+static void test_keys(void** _state _CBOR_UNUSED) {
+  // {1: 2, -1.5: true, false: null, null: [], h'01': 0}
+  assert_json("{\"1\":2,\"-1.5\":true,\"false\":null,\"null\":[],\"AQ\":0}",
+              0xA5, 0x01, 0x02, 0xF9, 0xBE, 0x00, 0xF5, 0xF4, 0xF6, 0xF6, 0x80,
+              0x41, 0x01, 0x00);
+  // {[1, "a"]: {"b": 2}}
+  assert_json("{\"[1,\\\"a\\\"]\":{\"b\":2}}", 0xA1, 0x82, 0x01, 0x61, 0x61,
+              0xA1, 0x61, 0x62, 0x02);
+  // {{[]: "\n"}: 1, {}: 2}
+  assert_json("{\"{\\\"[]\\\":\\\"\\\\n\\\"}\":1,\"{}\":2}", 0xA2, 0xA1, 0x80,
+              0x61, 0x0A, 0x01, 0xA0, 0x02);
+  // {_ [_ 1]: [_ 2]}
+  assert_json("{\"[1]\":[2]}", 0xBF, 0x9F, 0x01, 0xFF, 0x9F, 0x02, 0xFF,
+              0xFF);
+}
+
+static void test_first_item(void** _state _CBOR_UNUSED) {
+  unsigned char data[] = {0x82, 0x01, 0x02, 0x03};
+  assert_string_equal(convert(data, sizeof(data)), "[1,2]");
+  assert_size_equal(res.read, 3);
+}
+
+static void test_errors(void** _state _CBOR_UNUSED) {
+  assert_string_equal(convert(NULL, 0), "");
+  assert_true(res.error.code == CBOR_ERR_NODATA);
+
+  assert_json_error(CBOR_ERR_NOTENOUGHDATA, 3, 0x83, 0x01, 0x02);
+  assert_json_error(CBOR_ERR_NOTENOUGHDATA, 1, 0x81, 0x19, 0x01);
+  assert_json_error(CBOR_ERR_NOTENOUGHDATA, 1, 0xC1);
+  assert_json_error(CBOR_ERR_MALFORMATED, 1, 0x81, 0x1C);
+  assert_json_error(CBOR_ERR_SYNTAXERROR, 1, 0xFF);
+  assert_json_error(CBOR_ERR_SYNTAXERROR, 2, 0x81, 0xFF);
+  // {_ 1: <break>
+  assert_json_error(CBOR_ERR_SYNTAXERROR, 3, 0xBF, 0x01, 0xFF);
+  // (_ "a", h'01')
+  assert_json_error(CBOR_ERR_SYNTAXERROR, 5, 0x7F, 0x61, 0x61, 0x41, 0x01,
+                    0xFF);
+  // (_ [])
+  assert_json_error(CBOR_ERR_SYNTAXERROR, 2, 0x5F, 0x80, 0xFF);
+}
+
+static void test_writer_failure(void** _state _CBOR_UNUSED) {
+  unsigned char data[] = {0x63, 0x61, 0x62, 0x63};
+  unsigned char small[3];
+  cbor_writer writer;
+  cbor_writer_init_buffer(&writer, small, sizeof(small));
+  assert_false(cbor_to_json(data, sizeof(data), &writer, &res));
+  assert_true(res.error.code == CBOR_ERR_MEMERROR);
+}
+
+struct sink_state {
+  char data[64];
+  size_t length;
+  size_t calls;
+};
+
+static bool sink(void* context, cbor_data data, size_t size) {
+  struct sink_state* state = context;
+  assert_true(state->length + size < sizeof(state->data));
+  memcpy(state->data + state->length, data, size);
+  state->length += size;
+  state->calls++;
+  return true;
+}
+
+static void test_sink(void** _state _CBOR_UNUSED) {
+  // {"key": "value", "list": [1, 2, 3]}
+  unsigned char data[] = {0xA2, 0x63, 0x6B, 0x65, 0x79, 0x65, 0x76, 0x61,
+                          0x6C, 0x75, 0x65, 0x64, 0x6C, 0x69, 0x73, 0x74,
+                          0x83, 0x01, 0x02, 0x03};
+  struct sink_state state = {.length = 0, .calls = 0};
+  unsigned char staging[4];
+  cbor_writer writer;
+  cbor_writer_init_sink(&writer, sink, &state, staging, sizeof(staging));
+  assert_true(cbor_to_json(data, sizeof(data), &writer, &res));
+  assert_true(cbor_writer_flush(&writer));
+  const char* expected = "{\"key\":\"value\",\"list\":[1,2,3]}";
+  assert_size_equal(state.length, strlen(expected));
+  assert_memory_equal(state.data, expected, state.length);
+  assert_true(state.calls > 1);
+}
+
+static void test_allocation_failure(void** _state _CBOR_UNUSED) {
+  unsigned char array[] = {0x81, 0x01};
+  WITH_MOCK_MALLOC(
+      {
+        convert(array, sizeof(array));
+        assert_true(res.error.code == CBOR_ERR_MEMERROR);
+      },
+      1, REALLOC_FAIL);
+
+  // {[]: 1}, the key text is copied before it is escaped
+  unsigned char key[] = {0xA1, 0x80, 0x01};
+  WITH_MOCK_MALLOC(
+      {
+        convert(key, sizeof(key));
+        assert_true(res.error.code == CBOR_ERR_MEMERROR);
+      },
+      3, REALLOC, REALLOC, MALLOC_FAIL);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_integers),
+      cmocka_unit_test(test_floats),
+      cmocka_unit_test(test_floats_locale),
+      cmocka_unit_test(test_simple_values),
+      cmocka_unit_test(test_strings),
+      cmocka_unit_test(test_long_string),
+      cmocka_unit_test(test_byte_strings),
+      cmocka_unit_test(test_long_byte_string),
+      cmocka_unit_test(test_containers),
+      cmocka_unit_test(test_tags),
+      cmocka_unit_test(test_keys),
+      cmocka_unit_test(test_first_item),
+      cmocka_unit_test(test_errors),
+      cmocka_unit_test(test_writer_failure),
+      cmocka_unit_test(test_sink),
+      cmocka_unit_test(test_allocation_failure),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
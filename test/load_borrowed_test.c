@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "assertions.h"
+#include "cbor.h"
+#include "test_allocator.h"
+
+struct cbor_load_result res;
+cbor_item_t* item;
+
+unsigned char bytestring_data[] = {0x43, 0x01, 0x02, 0x03};
+static void test_bytestring(void** _state _CBOR_UNUSED) {
+  // Only the item itself is allocated
+  WITH_MOCK_MALLOC(
+      {
+        item = cbor_load_borrowed(bytestring_data, sizeof(bytestring_data),
+                                  &res);
+        assert_non_null(item);
+      },
+      1, MALLOC);
+  assert_true(cbor_isa_bytestring(item));
+  assert_true(cbor_bytestring_is_borrowed(item));
+  assert_ptr_equal(cbor_bytestring_handle(item), bytestring_data + 1);
+  assert_size_equal(cbor_bytestring_length(item), 3);
+  cbor_decref(&item);
+  assert_null(item);
+}
+
+unsigned char string_data[] = {0x63, 0x61, 0xC3, 0xA1};
+static void test_string(void** _state _CBOR_UNUSED) {
+  item = cbor_load_borrowed(string_data, sizeof(string_data), &res);
+  assert_non_null(item);
+  assert_true(cbor_isa_string(item));
+  assert_true(cbor_string_is_borrowed(item));
+  assert_ptr_equal(cbor_string_handle(item), string_data + 1);
+  assert_size_equal(cbor_string_length(item), 3);
+  assert_size_equal(cbor_string_codepoint_count(item), 2);
+  cbor_decref(&item);
+}
+
+// {"blob": h'00010203', "chunks": (_ h'04' h'0506')}
+unsigned char nested_data[] = {0xA2, 0x64, 0x62, 0x6C, 0x6F, 0x62, 0x44,
+                               0x00, 0x01, 0x02, 0x03, 0x66, 0x63, 0x68,
+                               0x75, 0x6E, 0x6B, 0x73, 0x5F, 0x41, 0x04,
+                               0x42, 0x05, 0x06, 0xFF};
+static void test_nested(void** _state _CBOR_UNUSED) {
+  cbor_item_t* copied = cbor_load(nested_data, sizeof(nested_data), &res);
+  assert_non_null(copied);
+  item = cbor_load_borrowed(nested_data, sizeof(nested_data), &res);
+  assert_non_null(item);
+  assert_size_equal(res.read, sizeof(nested_data));
+  assert_true(cbor_structurally_equal(item, copied));
+
+  struct cbor_pair* pairs = cbor_map_handle(item);
+  assert_true(cbor_string_is_borrowed(pairs[0].key));
+  assert_ptr_equal(cbor_bytestring_handle(pairs[0].value), nested_data + 7);
+  assert_true(cbor_bytestring_is_indefinite(pairs[1].value));
+  cbor_item_t* chunk = cbor_bytestring_chunks_handle(pairs[1].value)[1];
+  assert_true(cbor_bytestring_is_borrowed(chunk));
+  assert_ptr_equal(cbor_bytestring_handle(chunk), nested_data + 22);
+
+  cbor_decref(&copied);
+  cbor_decref(&item);
+}
+
+static void test_copy_is_owned(void** _state _CBOR_UNUSED) {
+  item = cbor_load_borrowed(bytestring_data, sizeof(bytestring_data), &res);
+  assert_non_null(item);
+  cbor_item_t* copy = cbor_copy(item);
+  assert_non_null(copy);
+  assert_false(cbor_bytestring_is_borrowed(copy));
+  assert_ptr_not_equal(cbor_bytestring_handle(copy), bytestring_data + 1);
+  assert_true(cbor_structurally_equal(item, copy));
+  cbor_decref(&item);
+  cbor_decref(&copy);
+}
+
+static void test_set_handle_takes_ownership(void** _state _CBOR_UNUSED) {
+  item = cbor_load_borrowed(bytestring_data, sizeof(bytestring_data), &res);
+  assert_non_null(item);
+  unsigned char* data = malloc(1);
+  data[0] = 0x2A;
+  cbor_bytestring_set_handle(item, data, 1);
+  assert_false(cbor_bytestring_is_borrowed(item));
+  // The new handle is freed
+  cbor_decref(&item);
+}
+
+static void test_default_load_is_owned(void** _state _CBOR_UNUSED) {
+  item = cbor_load(string_data, sizeof(string_data), &res);
+  assert_non_null(item);
+  assert_false(cbor_string_is_borrowed(item));
+  cbor_decref(&item);
+}
+
+// [h'0102', h'03' -- truncated
+unsigned char truncated_data[] = {0x82, 0x42, 0x01, 0x02, 0x41};
+static void test_failure(void** _state _CBOR_UNUSED) {
+  item = cbor_load_borrowed(truncated_data, sizeof(truncated_data), &res);
+  assert_null(item);
+  assert_true(res.error.code == CBOR_ERR_NOTENOUGHDATA);
+
+  WITH_MOCK_MALLOC(
+      {
+        assert_null(cbor_load_borrowed(bytestring_data,
+                                       sizeof(bytestring_data), &res));
+        assert_true(res.error.code == CBOR_ERR_MEMERROR);
+      },
+      1, MALLOC_FAIL);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_bytestring),
+      cmocka_unit_test(test_string),
+      cmocka_unit_test(test_nested),
+      cmocka_unit_test(test_copy_is_owned),
+      cmocka_unit_test(test_set_handle_takes_ownership),
+      cmocka_unit_test(test_default_load_is_owned),
+      cmocka_unit_test(test_failure),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
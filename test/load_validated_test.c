@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+
+#include <cmocka.h>
+
+#include "assertions.h"
+#include "cbor.h"
+#include "test_allocator.h"
+
+struct cbor_load_result res;
+cbor_item_t* item;
+
+// "aá"
+unsigned char valid_data[] = {0x63, 0x61, 0xC3, 0xA1};
+static void test_valid_string(void** _state _CBOR_UNUSED) {
+  item = cbor_load_validated(valid_data, sizeof(valid_data), &res);
+  assert_non_null(item);
+  assert_true(res.error.code == CBOR_ERR_NONE);
+  assert_size_equal(res.read, sizeof(valid_data));
+  assert_size_equal(cbor_string_length(item), 3);
+  assert_size_equal(cbor_string_codepoint_count(item), 2);
+  cbor_decref(&item);
+}
+
+// Unfinished 2B codepoint
+unsigned char invalid_data[] = {0x61, 0xC5};
+static void test_invalid_string(void** _state _CBOR_UNUSED) {
+  assert_null(cbor_load_validated(invalid_data, sizeof(invalid_data), &res));
+  assert_true(res.error.code == CBOR_ERR_INVALID_UTF8);
+
+  // Not rejected by the default decoder
+  item = cbor_load(invalid_data, sizeof(invalid_data), &res);
+  assert_non_null(item);
+  assert_size_equal(cbor_string_codepoint_count(item), 0);
+  cbor_decref(&item);
+}
+
+// [1, (_ "a" "\xC5"), "b"]
+unsigned char invalid_chunk_data[] = {0x83, 0x01, 0x7F, 0x61, 0x61, 0x61,
+                                      0xC5, 0xFF, 0x61, 0x62};
+static void test_invalid_chunk(void** _state _CBOR_UNUSED) {
+  assert_null(cbor_load_validated(invalid_chunk_data,
+                                  sizeof(invalid_chunk_data), &res));
+  assert_true(res.error.code == CBOR_ERR_INVALID_UTF8);
+}
+
+// {"a": (_ "b" "c")}
+unsigned char nested_data[] = {0xA1, 0x61, 0x61, 0x7F, 0x61,
+                               0x62, 0x61, 0x63, 0xFF};
+static void test_nested(void** _state _CBOR_UNUSED) {
+  item = cbor_load_validated(nested_data, sizeof(nested_data), &res);
+  assert_non_null(item);
+  cbor_item_t* reference = cbor_load(nested_data, sizeof(nested_data), &res);
+  assert_true(cbor_structurally_equal(item, reference));
+  cbor_decref(&reference);
+  cbor_decref(&item);
+}
+
+static void test_validation_does_not_allocate(void** _state _CBOR_UNUSED) {
+  // The item and its data, same as cbor_load
+  WITH_MOCK_MALLOC(
+      {
+        item = cbor_load_validated(valid_data, sizeof(valid_data), &res);
+        assert_non_null(item);
+        cbor_decref(&item);
+      },
+      2, MALLOC, MALLOC);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_valid_string),
+      cmocka_unit_test(test_invalid_string),
+      cmocka_unit_test(test_invalid_chunk),
+      cmocka_unit_test(test_nested),
+      cmocka_unit_test(test_validation_does_not_allocate),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -8,12 +8,14 @@
 #include <setjmp.h>
 #include <stdarg.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 
 #include <cmocka.h>
 
 #include "assertions.h"
 #include "cbor.h"
+#include "test_allocator.h"
 
 /* -------------------------------------------------------------------------
  * Custom equality functions used in tests
@@ -191,7 +193,7 @@ static void test_get_refcount(void** state _CBOR_UNUSED) {
   /* The returned value has its reference count incremented. */
   cbor_item_t* map = build_map();
 
-  cbor_item_t* key = cbor_build_string("one");
+  cbor_item_t* key = cbor_build_negint8(0);
   cbor_item_t* val = cbor_map_get(map, key, cbor_structurally_equal);
   assert_non_null(val);
   assert_true(cbor_refcount(val) == 2); /* held by map + returned ref */
@@ -230,6 +232,206 @@ static void test_get_negint_key(void** state _CBOR_UNUSED) {
   cbor_decref(&map);
 }
 
+static void test_get_indexed(void** state _CBOR_UNUSED) {
+  cbor_item_t* map = build_map();
+
+  cbor_item_t* key = cbor_build_string("two");
+  cbor_item_t* val = cbor_map_get_indexed(map, key);
+  assert_non_null(val);
+  assert_true(cbor_get_uint8(val) == 2);
+  cbor_decref(&val);
+  cbor_decref(&key);
+
+  key = cbor_build_negint8(0);
+  val = cbor_map_get_indexed(map, key);
+  assert_non_null(val);
+  assert_true(cbor_isa_string(val));
+  assert_true(cbor_refcount(val) == 2);
+  cbor_decref(&val);
+  cbor_decref(&key);
+
+  key = cbor_build_string("three");
+  assert_null(cbor_map_get_indexed(map, key));
+  cbor_decref(&key);
+  /* Same value, different major type */
+  key = cbor_build_uint8(0);
+  assert_null(cbor_map_get_indexed(map, key));
+  cbor_decref(&key);
+  key = cbor_build_bytestring((cbor_data) "one", 3);
+  assert_null(cbor_map_get_indexed(map, key));
+  cbor_decref(&key);
+
+  cbor_decref(&map);
+}
+
+static void test_get_indexed_ignores_width(void** state _CBOR_UNUSED) {
+  cbor_item_t* map = cbor_new_definite_map(1);
+  assert_true(cbor_map_add(
+      map, (struct cbor_pair){.key = cbor_move(cbor_build_uint8(7)),
+                              .value = cbor_move(cbor_build_bool(true))}));
+
+  cbor_item_t* key = cbor_build_uint64(7);
+  cbor_item_t* val = cbor_map_get_indexed(map, key);
+  assert_non_null(val);
+  assert_true(cbor_get_bool(val));
+  cbor_decref(&val);
+  cbor_decref(&key);
+
+  cbor_decref(&map);
+}
+
+static void test_get_indexed_first_match(void** state _CBOR_UNUSED) {
+  cbor_item_t* map = cbor_new_definite_map(2);
+  assert_true(cbor_map_add(
+      map, (struct cbor_pair){.key = cbor_move(cbor_build_uint8(1)),
+                              .value = cbor_move(cbor_build_uint8(1))}));
+  assert_true(cbor_map_add(
+      map, (struct cbor_pair){.key = cbor_move(cbor_build_uint16(1)),
+                              .value = cbor_move(cbor_build_uint8(2))}));
+
+  cbor_item_t* key = cbor_build_uint8(1);
+  cbor_item_t* val = cbor_map_get_indexed(map, key);
+  assert_non_null(val);
+  assert_true(cbor_get_uint8(val) == 1);
+  cbor_decref(&val);
+  cbor_decref(&key);
+
+  cbor_decref(&map);
+}
+
+static void test_get_indexed_unsupported_keys(void** state _CBOR_UNUSED) {
+  cbor_item_t* map = cbor_new_definite_map(2);
+  cbor_item_t* chunked = cbor_new_indefinite_string();
+  assert_true(
+      cbor_string_add_chunk(chunked, cbor_move(cbor_build_string("a"))));
+  assert_true(cbor_map_add(
+      map, (struct cbor_pair){.key = cbor_move(chunked),
+                              .value = cbor_move(cbor_build_uint8(1))}));
+  assert_true(cbor_map_add(
+      map, (struct cbor_pair){.key = cbor_move(cbor_new_null()),
+                              .value = cbor_move(cbor_build_uint8(2))}));
+
+  /* Indefinite keys are not indexed */
+  cbor_item_t* key = cbor_build_string("a");
+  assert_null(cbor_map_get_indexed(map, key));
+  cbor_decref(&key);
+  /* Only integers and strings can be looked up */
+  key = cbor_new_null();
+  assert_null(cbor_map_get_indexed(map, key));
+  cbor_decref(&key);
+
+  cbor_decref(&map);
+}
+
+static void test_get_indexed_large_map(void** state _CBOR_UNUSED) {
+  cbor_item_t* map = cbor_new_indefinite_map();
+  char buffer[16];
+  for (uint32_t i = 0; i < 1000; i++) {
+    snprintf(buffer, sizeof(buffer), "key%u", (unsigned)i);
+    assert_true(cbor_map_add(
+        map, (struct cbor_pair){.key = cbor_move(cbor_build_string(buffer)),
+                                .value = cbor_move(cbor_build_uint32(i))}));
+    /* Build the index halfway through, the rest is added incrementally */
+    if (i == 500) {
+      cbor_item_t* key = cbor_build_string("missing");
+      assert_null(cbor_map_get_indexed(map, key));
+      cbor_decref(&key);
+    }
+    assert_true(cbor_map_add(
+        map, (struct cbor_pair){.key = cbor_move(cbor_build_uint32(i)),
+                                .value = cbor_move(cbor_build_uint32(i))}));
+  }
+
+  for (uint32_t i = 0; i < 1000; i++) {
+    snprintf(buffer, sizeof(buffer), "key%u", (unsigned)i);
+    cbor_item_t* key = cbor_build_string(buffer);
+    cbor_item_t* val = cbor_map_get_indexed(map, key);
+    assert_non_null(val);
+    assert_true(cbor_get_uint32(val) == i);
+    cbor_decref(&val);
+    cbor_decref(&key);
+
+    key = cbor_build_uint32(i);
+    val = cbor_map_get_indexed(map, key);
+    assert_non_null(val);
+    assert_true(cbor_get_uint32(val) == i);
+    cbor_decref(&val);
+    cbor_decref(&key);
+  }
+
+  cbor_item_t* key = cbor_build_string("key1000");
+  assert_null(cbor_map_get_indexed(map, key));
+  cbor_decref(&key);
+
+  cbor_decref(&map);
+}
+
+static void test_get_indexed_decoded_map(void** state _CBOR_UNUSED) {
+  /* {"a": 1, 2: 3} */
+  struct cbor_load_result res;
+  cbor_item_t* map =
+      cbor_load((cbor_data) "\xA2\x61\x61\x01\x02\x03", 6, &res);
+  assert_non_null(map);
+
+  cbor_item_t* key = cbor_build_uint8(2);
+  cbor_item_t* val = cbor_map_get_indexed(map, key);
+  assert_non_null(val);
+  assert_true(cbor_get_uint8(val) == 3);
+  cbor_decref(&val);
+  cbor_decref(&key);
+
+  cbor_decref(&map);
+}
+
+static void test_get_indexed_growing_map(void** state _CBOR_UNUSED) {
+  cbor_item_t* map = cbor_new_indefinite_map();
+  cbor_item_t* key = cbor_build_uint8(0);
+  assert_null(cbor_map_get_indexed(map, key));
+  cbor_decref(&key);
+
+  /* The index is built early and has to survive the reallocations */
+  for (uint8_t i = 0; i < 40; i++) {
+    assert_true(cbor_map_add(
+        map, (struct cbor_pair){.key = cbor_move(cbor_build_uint8(i)),
+                                .value = cbor_move(cbor_build_uint8(i))}));
+    key = cbor_build_uint8(i / 2);
+    cbor_item_t* val = cbor_map_get_indexed(map, key);
+    assert_non_null(val);
+    assert_true(cbor_get_uint8(val) == i / 2);
+    cbor_decref(&val);
+    cbor_decref(&key);
+  }
+
+  cbor_decref(&map);
+}
+
+static void test_index_not_in_metadata(void** state _CBOR_UNUSED) {
+  /* The index must not make every item larger */
+  assert_true(sizeof(union cbor_item_metadata) ==
+              sizeof(struct _cbor_string_metadata));
+}
+
+static void test_get_indexed_alloc_failure(void** state _CBOR_UNUSED) {
+  cbor_item_t* map = build_map();
+  cbor_item_t* key = cbor_build_string("one");
+
+  /* Falls back to a linear scan */
+  WITH_FAILING_MALLOC({
+    cbor_item_t* val = cbor_map_get_indexed(map, key);
+    assert_non_null(val);
+    assert_true(cbor_get_uint8(val) == 1);
+    cbor_decref(&val);
+  });
+
+  cbor_item_t* val = cbor_map_get_indexed(map, key);
+  assert_non_null(val);
+  assert_true(cbor_get_uint8(val) == 1);
+  cbor_decref(&val);
+
+  cbor_decref(&key);
+  cbor_decref(&map);
+}
+
 int main(void) {
   const struct CMUnitTest tests[] = {
       cmocka_unit_test(test_get_existing_key),
@@ -243,6 +445,15 @@ int main(void) {
       cmocka_unit_test(test_get_refcount),
       cmocka_unit_test(test_get_indefinite_map),
       cmocka_unit_test(test_get_negint_key),
+      cmocka_unit_test(test_get_indexed),
+      cmocka_unit_test(test_get_indexed_ignores_width),
+      cmocka_unit_test(test_get_indexed_first_match),
+      cmocka_unit_test(test_get_indexed_unsupported_keys),
+      cmocka_unit_test(test_get_indexed_large_map),
+      cmocka_unit_test(test_get_indexed_decoded_map),
+      cmocka_unit_test(test_get_indexed_growing_map),
+      cmocka_unit_test(test_index_not_in_metadata),
+      cmocka_unit_test(test_get_indexed_alloc_failure),
   };
   return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "assertions.h"
+#include "cbor.h"
+#include "test_allocator.h"
+
+struct cbor_load_result res;
+cbor_item_t* item;
+
+#define SEQUENCE_LENGTH 1000
+
+// A sequence of records like [i, "record", {"value": i * 1000}, [_ i]]
+static unsigned char* build_sequence(size_t count, size_t* size) {
+  cbor_writer writer;
+  cbor_writer_init_growable(&writer);
+  for (size_t i = 0; i < count; i++) {
+    cbor_writer_array_start(&writer, 4);
+    cbor_writer_uint(&writer, i);
+    cbor_writer_string(&writer, "record", 6);
+    cbor_writer_map_start(&writer, 1);
+    cbor_writer_string(&writer, "value", 5);
+    cbor_writer_uint(&writer, i * 1000);
+    cbor_writer_indef_array_start(&writer);
+    cbor_writer_uint(&writer, i);
+    cbor_writer_break(&writer);
+  }
+  unsigned char* data = cbor_writer_take_buffer(&writer, size);
+  assert_non_null(data);
+  return data;
+}
+
+static void check_sequence(cbor_item_t* sequence, cbor_data data,
+                           size_t size) {
+  assert_non_null(sequence);
+  assert_true(res.error.code == CBOR_ERR_NONE);
+  assert_size_equal(res.read, size);
+  assert_true(cbor_array_is_definite(sequence));
+  size_t offset = 0;
+  for (size_t i = 0; i < cbor_array_size(sequence); i++) {
+    struct cbor_load_result item_result;
+    cbor_item_t* expected =
+        cbor_load(data + offset, size - offset, &item_result);
+    assert_non_null(expected);
+    assert_true(
+        cbor_structurally_equal(cbor_array_handle(sequence)[i], expected));
+    cbor_decref(&expected);
+    offset += item_result.read;
+  }
+  assert_size_equal(offset, size);
+}
+
+static void test_sequence(void** _state _CBOR_UNUSED) {
+  size_t size;
+  unsigned char* data = build_sequence(SEQUENCE_LENGTH, &size);
+  size_t thread_counts[] = {0, 1, 2, 7, 64};
+  for (size_t i = 0; i < sizeof(thread_counts) / sizeof(size_t); i++) {
+    item = cbor_load_sequence_parallel(data, size, thread_counts[i], &res);
+    assert_size_equal(cbor_array_size(item), SEQUENCE_LENGTH);
+    check_sequence(item, data, size);
+    cbor_decref(&item);
+  }
+  free(data);
+}
+
+static void test_more_threads_than_items(void** _state _CBOR_UNUSED) {
+  unsigned char data[] = {0x01, 0x61, 0x61, 0xF6};
+  item = cbor_load_sequence_parallel(data, sizeof(data), 16, &res);
+  assert_size_equal(cbor_array_size(item), 3);
+  check_sequence(item, data, sizeof(data));
+  cbor_decref(&item);
+}
+
+static void test_empty_sequence(void** _state _CBOR_UNUSED) {
+  item = cbor_load_sequence_parallel(NULL, 0, 4, &res);
+  assert_non_null(item);
+  assert_true(res.error.code == CBOR_ERR_NONE);
+  assert_size_equal(cbor_array_size(item), 0);
+  cbor_decref(&item);
+}
+
+static void test_truncated_item(void** _state _CBOR_UNUSED) {
+  size_t size;
+  unsigned char* data = build_sequence(SEQUENCE_LENGTH, &size);
+  // The last item is [999, "record", {"value": 999000}, [_ 999]]
+  assert_null(cbor_load_sequence_parallel(data, size - 3, 4, &res));
+  assert_true(res.error.code == CBOR_ERR_NOTENOUGHDATA);
+  free(data);
+}
+
+static void test_malformed_item(void** _state _CBOR_UNUSED) {
+  // 1, "a", reserved additional information, null
+  unsigned char data[] = {0x01, 0x61, 0x61, 0x1C, 0xF6};
+  assert_null(cbor_load_sequence_parallel(data, sizeof(data), 4, &res));
+  assert_true(res.error.code == CBOR_ERR_MALFORMATED);
+  assert_size_equal(res.error.position, 3);
+}
+
+static size_t allocations_left;
+
+static void* limited_malloc(size_t size) {
+  if (allocations_left == 0) return NULL;
+  allocations_left--;
+  return malloc(size);
+}
+
+static void* limited_realloc(void* ptr, size_t size) {
+  if (allocations_left == 0) return NULL;
+  allocations_left--;
+  return realloc(ptr, size);
+}
+
+static void test_item_failure_releases_others(void** _state _CBOR_UNUSED) {
+  size_t size;
+  unsigned char* data = build_sequence(SEQUENCE_LENGTH, &size);
+  // Fails in the middle of the items, the ones decoded before must be released
+  allocations_left = 2000;
+  cbor_set_allocs(limited_malloc, limited_realloc, free);
+  assert_null(cbor_load_sequence_parallel(data, size, 1, &res));
+  cbor_set_allocs(malloc, realloc, free);
+  assert_true(res.error.code == CBOR_ERR_MEMERROR);
+  assert_true(res.error.position > 0);
+  assert_true(res.error.position < size);
+  free(data);
+}
+
+static void test_allocation_failure(void** _state _CBOR_UNUSED) {
+  unsigned char data[] = {0x01, 0x02};
+  WITH_FAILING_MALLOC({
+    assert_null(cbor_load_sequence_parallel(data, sizeof(data), 4, &res));
+    assert_true(res.error.code == CBOR_ERR_MEMERROR);
+  });
+}
+
+// Compares cbor_load_parallel with cbor_load on various thread counts
+static void check_load_parallel(cbor_data data, size_t size) {
+  struct cbor_load_result expected_result;
+  cbor_item_t* expected = cbor_load(data, size, &expected_result);
+  size_t thread_counts[] = {0, 1, 2, 7};
+  for (size_t i = 0; i < sizeof(thread_counts) / sizeof(size_t); i++) {
+    item = cbor_load_parallel(data, size, thread_counts[i], &res);
+    assert_true(res.error.code == expected_result.error.code);
+    if (expected == NULL) {
+      assert_null(item);
+      assert_size_equal(res.error.position, expected_result.error.position);
+      continue;
+    }
+    assert_size_equal(res.read, expected_result.read);
+    assert_true(cbor_structurally_equal(item, expected));
+    cbor_decref(&item);
+  }
+  if (expected != NULL) cbor_decref(&expected);
+}
+
+static void test_load_array(void** _state _CBOR_UNUSED) {
+  size_t size;
+  unsigned char* records = build_sequence(SEQUENCE_LENGTH, &size);
+  // [record, ...] followed by a stray byte
+  unsigned char* data = malloc(size + 4);
+  memcpy(data, "\x99\x03\xE8", 3);
+  memcpy(data + 3, records, size);
+  data[size + 3] = 0x00;
+  check_load_parallel(data, size + 4);
+
+  item = cbor_load_parallel(data, size + 4, 4, &res);
+  assert_true(cbor_array_is_definite(item));
+  assert_size_equal(cbor_array_size(item), SEQUENCE_LENGTH);
+  assert_size_equal(res.read, size + 3);
+  cbor_decref(&item);
+
+  // Truncated in the last element
+  check_load_parallel(data, size);
+  free(data);
+  free(records);
+}
+
+static void test_load_map(void** _state _CBOR_UNUSED) {
+  cbor_writer writer;
+  cbor_writer_init_growable(&writer);
+  cbor_writer_map_start(&writer, SEQUENCE_LENGTH);
+  for (size_t i = 0; i < SEQUENCE_LENGTH; i++) {
+    cbor_writer_uint(&writer, i);
+    cbor_writer_array_start(&writer, 2);
+    cbor_writer_string(&writer, "value", 5);
+    cbor_writer_double(&writer, (double)i / 4);
+  }
+  size_t size;
+  unsigned char* data = cbor_writer_take_buffer(&writer, &size);
+  check_load_parallel(data, size);
+
+  item = cbor_load_parallel(data, size, 4, &res);
+  assert_true(cbor_map_is_definite(item));
+  assert_size_equal(cbor_map_size(item), SEQUENCE_LENGTH);
+  cbor_item_t* key = cbor_build_uint16(999);
+  cbor_item_t* value = cbor_map_get_indexed(item, key);
+  assert_non_null(value);
+  assert_size_equal(cbor_array_size(value), 2);
+  cbor_decref(&value);
+  cbor_decref(&key);
+  cbor_decref(&item);
+
+  // Missing the last value
+  check_load_parallel(data, size - 9);
+  free(data);
+}
+
+static void test_load_other_items(void** _state _CBOR_UNUSED) {
+  // 42
+  check_load_parallel((cbor_data) "\x18\x2A", 2);
+  // [_ 1, 2]
+  check_load_parallel((cbor_data) "\x9F\x01\x02\xFF", 4);
+  // [[1, 2]]
+  check_load_parallel((cbor_data) "\x81\x82\x01\x02", 4);
+  // [], {}
+  check_load_parallel((cbor_data) "\x80", 1);
+  check_load_parallel((cbor_data) "\xA0", 1);
+  // [1, reserved]
+  check_load_parallel((cbor_data) "\x82\x01\x1C", 3);
+  // A huge declared length
+  check_load_parallel((cbor_data) "\x9B\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x01",
+                      10);
+  check_load_parallel(NULL, 0);
+}
+
+#define FAILING_STRING "cannot allocate me"
+
+// Stateless, so that it can be used from several threads
+static void* malloc_failing_string(size_t size) {
+  if (size == strlen(FAILING_STRING)) return NULL;
+  return malloc(size);
+}
+
+static void test_load_item_failure(void** _state _CBOR_UNUSED) {
+  // Elements before and after the failing one are decoded and released
+  cbor_writer writer;
+  cbor_writer_init_growable(&writer);
+  cbor_writer_array_start(&writer, SEQUENCE_LENGTH);
+  for (size_t i = 0; i < SEQUENCE_LENGTH; i++) {
+    if (i == SEQUENCE_LENGTH / 2) {
+      cbor_writer_string(&writer, FAILING_STRING, strlen(FAILING_STRING));
+    } else {
+      cbor_writer_array_start(&writer, 2);
+      cbor_writer_uint(&writer, i);
+      cbor_writer_string(&writer, "record", 6);
+    }
+  }
+  size_t size;
+  unsigned char* data = cbor_writer_take_buffer(&writer, &size);
+  cbor_set_allocs(malloc_failing_string, realloc, free);
+  assert_null(cbor_load_parallel(data, size, 4, &res));
+  cbor_set_allocs(malloc, realloc, free);
+  assert_true(res.error.code == CBOR_ERR_MEMERROR);
+  free(data);
+}
+
+// Compares cbor_serialize_alloc_parallel with cbor_serialize_alloc
+static void check_serialize_parallel(cbor_item_t* value) {
+  unsigned char* expected;
+  size_t expected_size = cbor_serialize_alloc(value, &expected, NULL);
+  assert_non_null(expected);
+  size_t thread_counts[] = {0, 1, 2, 7, 64};
+  for (size_t i = 0; i < sizeof(thread_counts) / sizeof(size_t); i++) {
+    unsigned char* buffer;
+    size_t buffer_size;
+    assert_size_equal(cbor_serialize_alloc_parallel(value, thread_counts[i],
+                                                    &buffer, &buffer_size),
+                      expected_size);
+    assert_size_equal(buffer_size, expected_size);
+    assert_memory_equal(buffer, expected, expected_size);
+    free(buffer);
+  }
+  free(expected);
+}
+
+static void test_serialize_array(void** _state _CBOR_UNUSED) {
+  size_t size;
+  unsigned char* data = build_sequence(SEQUENCE_LENGTH, &size);
+  item = cbor_load_sequence_parallel(data, size, 1, &res);
+  check_serialize_parallel(item);
+
+  cbor_item_t* indefinite = cbor_new_indefinite_array();
+  for (size_t i = 0; i < cbor_array_size(item); i++) {
+    assert_true(
+        cbor_array_push(indefinite, cbor_move(cbor_array_get(item, i))));
+  }
+  check_serialize_parallel(indefinite);
+  cbor_decref(&indefinite);
+  cbor_decref(&item);
+  free(data);
+}
+
+static void test_serialize_map(void** _state _CBOR_UNUSED) {
+  cbor_item_t* definite = cbor_new_definite_map(SEQUENCE_LENGTH);
+  cbor_item_t* indefinite = cbor_new_indefinite_map();
+  for (size_t i = 0; i < SEQUENCE_LENGTH; i++) {
+    struct cbor_pair pair = {.key = cbor_move(cbor_build_uint32(i)),
+                             .value = cbor_move(cbor_build_string("value"))};
+    assert_true(cbor_map_add(definite, pair));
+    assert_true(cbor_map_add(indefinite, pair));
+  }
+  check_serialize_parallel(definite);
+  check_serialize_parallel(indefinite);
+  cbor_decref(&definite);
+  cbor_decref(&indefinite);
+}
+
+static void test_serialize_shared_tags(void** _state _CBOR_UNUSED) {
+  // Every element is the same tag, all threads walk into the same subtree
+  cbor_item_t* subtree = cbor_build_string("shared");
+  cbor_item_t* tag = cbor_build_tag(1000, subtree);
+  item = cbor_new_definite_array(SEQUENCE_LENGTH);
+  for (size_t i = 0; i < SEQUENCE_LENGTH; i++) {
+    assert_true(cbor_array_push(item, tag));
+  }
+  check_serialize_parallel(item);
+  // Serialization does not touch the reference counts
+  assert_size_equal(cbor_refcount(tag), SEQUENCE_LENGTH + 1);
+  assert_size_equal(cbor_refcount(subtree), 2);
+  cbor_decref(&item);
+  cbor_decref(&tag);
+  cbor_decref(&subtree);
+}
+
+static void test_serialize_other_items(void** _state _CBOR_UNUSED) {
+  item = cbor_build_string("Hello");
+  check_serialize_parallel(item);
+  cbor_decref(&item);
+
+  item = cbor_new_definite_array(1);
+  assert_true(cbor_array_push(item, cbor_move(cbor_build_uint8(1))));
+  check_serialize_parallel(item);
+  cbor_decref(&item);
+
+  item = cbor_new_indefinite_map();
+  check_serialize_parallel(item);
+  cbor_decref(&item);
+}
+
+static void test_serialize_allocation_failure(void** _state _CBOR_UNUSED) {
+  item = cbor_new_definite_array(2);
+  assert_true(cbor_array_push(item, cbor_move(cbor_build_uint8(1))));
+  assert_true(cbor_array_push(item, cbor_move(cbor_build_uint8(2))));
+  unsigned char* buffer;
+  size_t buffer_size;
+  // The offsets of the tasks
+  WITH_FAILING_MALLOC({
+    assert_size_equal(
+        cbor_serialize_alloc_parallel(item, 4, &buffer, &buffer_size), 0);
+  });
+  assert_null(buffer);
+  assert_size_equal(buffer_size, 0);
+
+  // The output buffer, the workers array is allocated before it
+  allocations_left = 2;
+  cbor_set_allocs(limited_malloc, limited_realloc, free);
+  assert_size_equal(
+      cbor_serialize_alloc_parallel(item, 4, &buffer, &buffer_size), 0);
+  cbor_set_allocs(malloc, realloc, free);
+  assert_null(buffer);
+  assert_size_equal(buffer_size, 0);
+  cbor_decref(&item);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_sequence),
+      cmocka_unit_test(test_more_threads_than_items),
+      cmocka_unit_test(test_empty_sequence),
+      cmocka_unit_test(test_truncated_item),
+      cmocka_unit_test(test_malformed_item),
+      cmocka_unit_test(test_item_failure_releases_others),
+      cmocka_unit_test(test_allocation_failure),
+      cmocka_unit_test(test_load_array),
+      cmocka_unit_test(test_load_map),
+      cmocka_unit_test(test_load_other_items),
+      cmocka_unit_test(test_load_item_failure),
+      cmocka_unit_test(test_serialize_array),
+      cmocka_unit_test(test_serialize_map),
+      cmocka_unit_test(test_serialize_shared_tags),
+      cmocka_unit_test(test_serialize_other_items),
+      cmocka_unit_test(test_serialize_allocation_failure),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "assertions.h"
+#include "cbor.h"
+#include "test_allocator.h"
+
+cbor_parser_t parser;
+struct cbor_load_result res;
+
+// {"a": [1, 2, [3]], "bc": h'DEADBEEF', 4: (_ "x", "y"), 5: 1.5}
+static unsigned char message[] = {
+    0xA4, 0x61, 0x61, 0x83, 0x01, 0x02, 0x81, 0x03, 0x62, 0x62, 0x63,
+    0x44, 0xDE, 0xAD, 0xBE, 0xEF, 0x04, 0x7F, 0x61, 0x78, 0x61, 0x79,
+    0xFF, 0x05, 0xFB, 0x3F, 0xF8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+static void check_message(cbor_item_t* item) {
+  assert_non_null(item);
+  struct cbor_load_result load_result;
+  cbor_item_t* reference = cbor_load(message, sizeof(message), &load_result);
+  assert_true(cbor_structurally_equal(item, reference));
+  cbor_decref(&reference);
+  cbor_decref(&item);
+}
+
+// Feed `length` bytes and expect all of them to be consumed
+static cbor_item_t* feed(cbor_data chunk, size_t length) {
+  cbor_item_t* item = cbor_parser_feed(&parser, chunk, length, &res);
+  assert_size_equal(res.read, length);
+  assert_true(res.error.code ==
+              (item == NULL ? CBOR_ERR_NOTENOUGHDATA : CBOR_ERR_NONE));
+  return item;
+}
+
+static void test_whole(void** _state _CBOR_UNUSED) {
+  cbor_parser_init(&parser);
+  for (int i = 0; i < 3; i++) check_message(feed(message, sizeof(message)));
+  cbor_parser_release(&parser);
+}
+
+static void test_byte_by_byte(void** _state _CBOR_UNUSED) {
+  cbor_parser_init(&parser);
+  for (size_t i = 0; i < sizeof(message) - 1; i++) {
+    assert_null(feed(message + i, 1));
+  }
+  check_message(feed(message + sizeof(message) - 1, 1));
+  cbor_parser_release(&parser);
+}
+
+static void test_all_splits(void** _state _CBOR_UNUSED) {
+  cbor_parser_init(&parser);
+  for (size_t split = 0; split < sizeof(message); split++) {
+    assert_null(feed(message, split));
+    check_message(feed(message + split, sizeof(message) - split));
+  }
+  cbor_parser_release(&parser);
+}
+
+static void test_empty_chunk(void** _state _CBOR_UNUSED) {
+  cbor_parser_init(&parser);
+  assert_null(feed(message, 0));
+  assert_null(feed(message, 2));
+  assert_null(feed(message + 2, 0));
+  check_message(feed(message + 2, sizeof(message) - 2));
+  cbor_parser_release(&parser);
+}
+
+static void test_sequence(void** _state _CBOR_UNUSED) {
+  // 1, "abc", [2] split as 01 63 61 | 62 63 81 | 02
+  unsigned char sequence[] = {0x01, 0x63, 0x61, 0x62, 0x63, 0x81, 0x02};
+  cbor_parser_init(&parser);
+
+  cbor_item_t* item = cbor_parser_feed(&parser, sequence, 3, &res);
+  assert_true(res.error.code == CBOR_ERR_NONE);
+  assert_size_equal(res.read, 1);
+  assert_uint8(item, 1);
+  cbor_decref(&item);
+  assert_null(feed(sequence + 1, 2));
+
+  // Only the rest of the string is taken from the chunk
+  item = cbor_parser_feed(&parser, sequence + 3, 3, &res);
+  assert_true(res.error.code == CBOR_ERR_NONE);
+  assert_size_equal(res.read, 2);
+  assert_size_equal(cbor_string_length(item), 3);
+  assert_memory_equal(cbor_string_handle(item), "abc", 3);
+  cbor_decref(&item);
+  assert_null(feed(sequence + 5, 1));
+
+  item = feed(sequence + 6, 1);
+  assert_size_equal(cbor_array_size(item), 1);
+  cbor_decref(&item);
+  cbor_parser_release(&parser);
+}
+
+static void test_large_string(void** _state _CBOR_UNUSED) {
+  const size_t length = 100000;
+  unsigned char* data = malloc(length + 5);
+  data[0] = 0x5A;
+  data[1] = 0x00;
+  data[2] = 0x01;
+  data[3] = 0x86;
+  data[4] = 0xA0;
+  for (size_t i = 0; i < length; i++) data[5 + i] = (unsigned char)i;
+
+  cbor_parser_init(&parser);
+  cbor_item_t* item = NULL;
+  for (size_t offset = 0; offset < length + 5; offset += 1000) {
+    assert_null(item);
+    size_t chunk = length + 5 - offset < 1000 ? length + 5 - offset : 1000;
+    item = feed(data + offset, chunk);
+  }
+  assert_non_null(item);
+  assert_size_equal(cbor_bytestring_length(item), length);
+  assert_memory_equal(cbor_bytestring_handle(item), data + 5, length);
+  cbor_decref(&item);
+  cbor_parser_release(&parser);
+  free(data);
+}
+
+static void test_malformed(void** _state _CBOR_UNUSED) {
+  cbor_parser_init(&parser);
+  // [1, 2, <reserved>] split after the second element
+  unsigned char malformed[] = {0x83, 0x01, 0x02, 0x1C};
+  assert_null(feed(malformed, 3));
+  assert_null(cbor_parser_feed(&parser, malformed + 3, 1, &res));
+  assert_true(res.error.code == CBOR_ERR_MALFORMATED);
+  assert_size_equal(res.error.position, 3);
+
+  // The parser is reset
+  check_message(feed(message, sizeof(message)));
+
+  unsigned char unexpected_break[] = {0x81, 0xFF};
+  assert_null(cbor_parser_feed(&parser, unexpected_break, 2, &res));
+  assert_true(res.error.code == CBOR_ERR_SYNTAXERROR);
+  assert_size_equal(res.error.position, 1);
+  cbor_parser_release(&parser);
+}
+
+static void test_release_incomplete(void** _state _CBOR_UNUSED) {
+  cbor_parser_init(&parser);
+  assert_null(feed(message, 14));
+  cbor_parser_release(&parser);
+  check_message(feed(message, sizeof(message)));
+  cbor_parser_release(&parser);
+}
+
+static void test_allocation_failure(void** _state _CBOR_UNUSED) {
+  unsigned char string[] = {0x63, 0x61, 0x62, 0x63};
+  cbor_parser_init(&parser);
+  // The pending bytes
+  WITH_MOCK_MALLOC(
+      {
+        assert_null(cbor_parser_feed(&parser, string, 2, &res));
+        assert_true(res.error.code == CBOR_ERR_MEMERROR);
+      },
+      1, REALLOC_FAIL);
+
+  // The item itself
+  unsigned char array[] = {0x82, 0x01, 0x63, 0x61, 0x62, 0x63};
+  assert_null(feed(array, 4));
+  WITH_MOCK_MALLOC(
+      {
+        assert_null(cbor_parser_feed(&parser, array + 4, 2, &res));
+        assert_true(res.error.code == CBOR_ERR_MEMERROR);
+        assert_size_equal(res.error.position, 2);
+      },
+      2, REALLOC, MALLOC_FAIL);
+  check_message(feed(message, sizeof(message)));
+  cbor_parser_release(&parser);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_whole),
+      cmocka_unit_test(test_byte_by_byte),
+      cmocka_unit_test(test_all_splits),
+      cmocka_unit_test(test_empty_chunk),
+      cmocka_unit_test(test_sequence),
+      cmocka_unit_test(test_large_string),
+      cmocka_unit_test(test_malformed),
+      cmocka_unit_test(test_release_incomplete),
+      cmocka_unit_test(test_allocation_failure),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+
+#include <cmocka.h>
+
+#include "assertions.h"
+#include "cbor.h"
+#include "cbor/internal/threads.h"
+
+/*
+ * Reference counts are only safe to update from several threads when the
+ * library is built with -DCBOR_ATOMIC_REFCOUNT=ON. Otherwise, the tasks run on
+ * a single thread.
+ */
+
+#if CBOR_ATOMIC_REFCOUNT
+#define THREADS 8
+#else
+#define THREADS 1
+#endif
+#define TASKS 64
+#define ITERATIONS 10000
+
+cbor_item_t* item;
+
+static void incref_decref_task(void* context, size_t task _CBOR_UNUSED) {
+  cbor_item_t* shared = context;
+  for (size_t i = 0; i < ITERATIONS; i++) {
+    cbor_item_t* reference = cbor_incref(shared);
+    cbor_decref(&reference);
+  }
+}
+
+static void test_incref_decref(void** _state _CBOR_UNUSED) {
+  item = cbor_build_uint32(1000);
+  _cbor_parallel_for(THREADS, TASKS, incref_decref_task, item);
+  assert_size_equal(cbor_refcount(item), 1);
+  assert_uint32(item, 1000);
+  cbor_decref(&item);
+}
+
+static void hold_task(void* context, size_t task _CBOR_UNUSED) {
+  cbor_item_t* shared = context;
+  cbor_item_t* references[ITERATIONS / 10];
+  for (size_t i = 0; i < ITERATIONS / 10; i++) {
+    references[i] = cbor_incref(shared);
+  }
+  for (size_t i = 0; i < ITERATIONS / 10; i++) {
+    cbor_decref(&references[i]);
+  }
+}
+
+static void test_shared_tree(void** _state _CBOR_UNUSED) {
+  // The members are touched through the array by every thread
+  item = cbor_new_definite_array(2);
+  cbor_item_t* member = cbor_build_string("shared");
+  assert_true(cbor_array_push(item, member));
+  assert_true(cbor_array_push(item, cbor_move(cbor_build_uint32(1000))));
+  _cbor_parallel_for(THREADS, TASKS, hold_task, member);
+  _cbor_parallel_for(THREADS, TASKS, hold_task, item);
+  assert_size_equal(cbor_refcount(item), 1);
+  assert_size_equal(cbor_refcount(member), 2);
+  cbor_decref(&member);
+  cbor_decref(&item);
+}
+
+static void release_task(void* context, size_t task) {
+  cbor_item_t** references = context;
+  cbor_decref(&references[task]);
+}
+
+static void test_last_release(void** _state _CBOR_UNUSED) {
+  // Whichever thread drops the last reference frees the item
+  cbor_item_t* references[TASKS];
+  item = cbor_build_string("released on another thread");
+  for (size_t i = 0; i < TASKS; i++) references[i] = cbor_incref(item);
+  cbor_decref(&item);
+  assert_size_equal(cbor_refcount(references[0]), TASKS);
+  _cbor_parallel_for(THREADS, TASKS, release_task, references);
+  // Only the last release clears the reference
+  size_t released = 0;
+  for (size_t i = 0; i < TASKS; i++) released += references[i] == NULL;
+  assert_size_equal(released, 1);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_incref_decref),
+      cmocka_unit_test(test_shared_tree),
+      cmocka_unit_test(test_last_release),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "assertions.h"
+#include "cbor.h"
+#include "test_allocator.h"
+
+cbor_serializer serializer;
+unsigned char buffer[512];
+size_t written;
+
+// Serialize `item` in pieces of `chunk_size` bytes into `buffer`
+static size_t serialize_in_chunks(const cbor_item_t* item, size_t chunk_size) {
+  cbor_serializer_init(&serializer, item);
+  size_t total = 0;
+  enum cbor_serializer_status status;
+  do {
+    assert_true(total + chunk_size <= sizeof(buffer));
+    status = cbor_serializer_write(&serializer, buffer + total, chunk_size,
+                                   &written);
+    assert_true(written <= chunk_size);
+    total += written;
+  } while (status == CBOR_SERIALIZER_BUFFER_FULL);
+  assert_true(status == CBOR_SERIALIZER_FINISHED);
+  cbor_serializer_release(&serializer);
+  return total;
+}
+
+// {"a": [1, -500, h'0102', (_ "x", "yz")], 2: 3(4294967296), _ [_ 1.5, true]}
+static cbor_item_t* build_item(void) {
+  cbor_item_t* array = cbor_new_definite_array(4);
+  assert_true(cbor_array_push(array, cbor_move(cbor_build_uint8(1))));
+  assert_true(cbor_array_push(array, cbor_move(cbor_build_negint16(499))));
+  assert_true(cbor_array_push(
+      array, cbor_move(cbor_build_bytestring((cbor_data) "\x01\x02", 2))));
+  cbor_item_t* chunked = cbor_new_indefinite_string();
+  assert_true(
+      cbor_string_add_chunk(chunked, cbor_move(cbor_build_string("x"))));
+  assert_true(
+      cbor_string_add_chunk(chunked, cbor_move(cbor_build_string("yz"))));
+  assert_true(cbor_array_push(array, cbor_move(chunked)));
+
+  cbor_item_t* indefinite = cbor_new_indefinite_array();
+  assert_true(cbor_array_push(indefinite, cbor_move(cbor_build_float4(1.5f))));
+  assert_true(cbor_array_push(indefinite, cbor_move(cbor_build_bool(true))));
+
+  cbor_item_t* map = cbor_new_indefinite_map();
+  assert_true(cbor_map_add(
+      map, (struct cbor_pair){.key = cbor_move(cbor_build_string("a")),
+                              .value = cbor_move(array)}));
+  assert_true(cbor_map_add(
+      map,
+      (struct cbor_pair){
+          .key = cbor_move(cbor_build_uint8(2)),
+          .value = cbor_move(cbor_build_tag(
+              3, cbor_move(cbor_build_uint64(4294967296ULL))))}));
+  assert_true(cbor_map_add(
+      map, (struct cbor_pair){.key = cbor_move(cbor_new_undef()),
+                              .value = cbor_move(indefinite)}));
+  return map;
+}
+
+static void test_matches_cbor_serialize(void** _state _CBOR_UNUSED) {
+  cbor_item_t* item = build_item();
+  unsigned char expected[128];
+  size_t expected_size = cbor_serialize(item, expected, sizeof(expected));
+  assert_true(expected_size > 0);
+
+  for (size_t chunk_size = 1; chunk_size <= expected_size + 1; chunk_size++) {
+    memset(buffer, 0, sizeof(buffer));
+    assert_size_equal(serialize_in_chunks(item, chunk_size), expected_size);
+    assert_memory_equal(buffer, expected, expected_size);
+  }
+  cbor_decref(&item);
+}
+
+static void test_scalar(void** _state _CBOR_UNUSED) {
+  cbor_item_t* item = cbor_build_uint8(42);
+  assert_size_equal(serialize_in_chunks(item, 64), 2);
+  assert_memory_equal(buffer, "\x18\x2A", 2);
+  cbor_decref(&item);
+}
+
+static void test_empty_buffer(void** _state _CBOR_UNUSED) {
+  cbor_item_t* item = cbor_build_uint8(1);
+  cbor_serializer_init(&serializer, item);
+  assert_true(cbor_serializer_write(&serializer, buffer, 0, &written) ==
+              CBOR_SERIALIZER_BUFFER_FULL);
+  assert_size_equal(written, 0);
+  assert_true(cbor_serializer_write(&serializer, buffer, 1, &written) ==
+              CBOR_SERIALIZER_FINISHED);
+  assert_size_equal(written, 1);
+  // Finished serializers stay finished
+  assert_true(cbor_serializer_write(&serializer, buffer, 1, &written) ==
+              CBOR_SERIALIZER_FINISHED);
+  assert_size_equal(written, 0);
+  cbor_serializer_release(&serializer);
+  cbor_decref(&item);
+}
+
+static void test_deep_nesting(void** _state _CBOR_UNUSED) {
+  const size_t depth = 10000;
+  cbor_item_t* root = cbor_new_definite_array(1);
+  cbor_item_t* current = root;
+  for (size_t i = 1; i < depth; i++) {
+    cbor_item_t* nested = cbor_new_definite_array(1);
+    assert_true(cbor_array_push(current, cbor_move(nested)));
+    current = nested;
+  }
+  assert_true(cbor_array_push(current, cbor_move(cbor_build_uint8(0))));
+
+  cbor_serializer_init(&serializer, root);
+  size_t total = 0;
+  enum cbor_serializer_status status;
+  do {
+    status = cbor_serializer_write(&serializer, buffer, 100, &written);
+    for (size_t i = 0; i < written; i++) {
+      assert_true(buffer[i] == (total + i < depth ? 0x81 : 0x00));
+    }
+    total += written;
+  } while (status == CBOR_SERIALIZER_BUFFER_FULL);
+  assert_true(status == CBOR_SERIALIZER_FINISHED);
+  assert_size_equal(total, depth + 1);
+  cbor_serializer_release(&serializer);
+  cbor_decref(&root);
+}
+
+static void test_missing_tagged_item(void** _state _CBOR_UNUSED) {
+  cbor_item_t* array = cbor_new_definite_array(2);
+  assert_true(cbor_array_push(array, cbor_move(cbor_build_uint8(1))));
+  assert_true(cbor_array_push(array, cbor_move(cbor_new_tag(1))));
+
+  cbor_serializer_init(&serializer, array);
+  assert_true(cbor_serializer_write(&serializer, buffer, sizeof(buffer),
+                                    &written) == CBOR_SERIALIZER_ERROR);
+  // The output up to the failure is still reported
+  assert_size_equal(written, 3);
+  assert_true(cbor_serializer_write(&serializer, buffer, sizeof(buffer),
+                                    &written) == CBOR_SERIALIZER_ERROR);
+  assert_size_equal(written, 0);
+  cbor_serializer_release(&serializer);
+  cbor_decref(&array);
+}
+
+static void test_stack_allocation_failure(void** _state _CBOR_UNUSED) {
+  cbor_item_t* array = cbor_new_definite_array(0);
+  WITH_MOCK_MALLOC(
+      {
+        cbor_serializer_init(&serializer, array);
+        assert_true(cbor_serializer_write(&serializer, buffer, sizeof(buffer),
+                                          &written) == CBOR_SERIALIZER_ERROR);
+        cbor_serializer_release(&serializer);
+      },
+      1, REALLOC_FAIL);
+  cbor_decref(&array);
+}
+
+static void test_scalars_do_not_allocate(void** _state _CBOR_UNUSED) {
+  cbor_item_t* item = cbor_build_string("Hello!");
+  WITH_MOCK_MALLOC({ assert_size_equal(serialize_in_chunks(item, 3), 7); }, 0,
+                   MALLOC);
+  cbor_decref(&item);
+}
+
+static void test_release_unfinished(void** _state _CBOR_UNUSED) {
+  cbor_item_t* item = build_item();
+  cbor_serializer_init(&serializer, item);
+  assert_true(cbor_serializer_write(&serializer, buffer, 4, &written) ==
+              CBOR_SERIALIZER_BUFFER_FULL);
+  cbor_serializer_release(&serializer);
+  cbor_decref(&item);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_matches_cbor_serialize),
+      cmocka_unit_test(test_scalar),
+      cmocka_unit_test(test_empty_buffer),
+      cmocka_unit_test(test_deep_nesting),
+      cmocka_unit_test(test_missing_tagged_item),
+      cmocka_unit_test(test_stack_allocation_failure),
+      cmocka_unit_test(test_scalars_do_not_allocate),
+      cmocka_unit_test(test_release_unfinished),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
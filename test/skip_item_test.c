@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "assertions.h"
+#include "cbor.h"
+
+size_t end;
+
+static void assert_skip(cbor_data data, size_t length, size_t expected_end) {
+  end = 0;
+  assert_true(cbor_skip_item(data, length, &end) == CBOR_DECODER_FINISHED);
+  assert_size_equal(end, expected_end);
+}
+
+static void assert_skip_status(cbor_data data, size_t length,
+                               enum cbor_decoder_status expected) {
+  assert_true(cbor_skip_item(data, length, &end) == expected);
+}
+
+static void test_scalars(void** _state _CBOR_UNUSED) {
+  assert_skip((cbor_data) "\x17", 1, 1);
+  assert_skip((cbor_data) "\x18\xFF", 2, 2);
+  assert_skip((cbor_data) "\x39\x01\x00", 3, 3);
+  assert_skip((cbor_data) "\x1B\x00\x00\x00\x00\x00\x00\x00\x01", 9, 9);
+  assert_skip((cbor_data) "\xF5", 1, 1);
+  assert_skip((cbor_data) "\xF9\x3C\x00", 3, 3);
+  assert_skip((cbor_data) "\xFB\x3F\xF0\x00\x00\x00\x00\x00\x00", 9, 9);
+  assert_skip((cbor_data) "\xC1\x01", 2, 2);
+  // Trailing data is ignored
+  assert_skip((cbor_data) "\x01\x02", 2, 1);
+}
+
+static void test_strings(void** _state _CBOR_UNUSED) {
+  assert_skip((cbor_data) "\x40", 1, 1);
+  assert_skip((cbor_data) "\x63\x61\x62\x63\x00", 5, 4);
+  assert_skip((cbor_data) "\x59\x00\x02\x01\x02", 5, 5);
+  assert_skip((cbor_data) "\x5F\x41\x01\x42\x02\x03\xFF", 7, 7);
+  assert_skip((cbor_data) "\x7F\xFF", 2, 2);
+}
+
+static void test_containers(void** _state _CBOR_UNUSED) {
+  // [1, [2, 3], {4: [5]}]
+  assert_skip((cbor_data) "\x83\x01\x82\x02\x03\xA1\x04\x81\x05", 9, 9);
+  // [_ {_ 1: [_ ]}, (_ "a"), 1(2)]
+  assert_skip((cbor_data) "\x9F\xBF\x01\x9F\xFF\xFF\x7F\x61\x61\xFF\xC1\x02"
+                          "\xFF",
+              13, 13);
+  // Empty containers
+  assert_skip((cbor_data) "\x80", 1, 1);
+  assert_skip((cbor_data) "\xA0", 1, 1);
+  assert_skip((cbor_data) "\x9F\xFF", 2, 2);
+}
+
+static void test_sequence(void** _state _CBOR_UNUSED) {
+  // 1, [2], "a", {_ }
+  unsigned char data[] = {0x01, 0x81, 0x02, 0x61, 0x61, 0xBF, 0xFF};
+  size_t expected[] = {1, 2, 2, 2};
+  size_t offset = 0;
+  for (size_t i = 0; i < 4; i++) {
+    assert_skip(data + offset, sizeof(data) - offset, expected[i]);
+    offset += end;
+  }
+  assert_size_equal(offset, sizeof(data));
+  assert_skip_status(data + offset, 0, CBOR_DECODER_NEDATA);
+}
+
+static void test_truncated(void** _state _CBOR_UNUSED) {
+  assert_skip_status((cbor_data) "", 0, CBOR_DECODER_NEDATA);
+  assert_skip_status((cbor_data) "\x19\x01", 2, CBOR_DECODER_NEDATA);
+  assert_skip_status((cbor_data) "\x43\x01\x02", 3, CBOR_DECODER_NEDATA);
+  assert_skip_status((cbor_data) "\x82\x01", 2, CBOR_DECODER_NEDATA);
+  assert_skip_status((cbor_data) "\x9F\x01", 2, CBOR_DECODER_NEDATA);
+  assert_skip_status((cbor_data) "\xC1", 1, CBOR_DECODER_NEDATA);
+  // Huge declared sizes are rejected without scanning
+  assert_skip_status((cbor_data) "\x9B\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF", 9,
+                     CBOR_DECODER_NEDATA);
+  assert_skip_status((cbor_data) "\xBB\x80\x00\x00\x00\x00\x00\x00\x00", 9,
+                     CBOR_DECODER_NEDATA);
+  assert_skip_status((cbor_data) "\x5B\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF", 9,
+                     CBOR_DECODER_NEDATA);
+}
+
+static void test_malformed(void** _state _CBOR_UNUSED) {
+  // Reserved
+  assert_skip_status((cbor_data) "\x1C", 1, CBOR_DECODER_ERROR);
+  assert_skip_status((cbor_data) "\x3F", 1, CBOR_DECODER_ERROR);
+  assert_skip_status((cbor_data) "\xDF", 1, CBOR_DECODER_ERROR);
+  assert_skip_status((cbor_data) "\xFC", 1, CBOR_DECODER_ERROR);
+  // Unassigned simple values
+  assert_skip_status((cbor_data) "\xE0", 1, CBOR_DECODER_ERROR);
+  assert_skip_status((cbor_data) "\xF8\x20", 2, CBOR_DECODER_ERROR);
+  // Unexpected breaks
+  assert_skip_status((cbor_data) "\xFF", 1, CBOR_DECODER_ERROR);
+  assert_skip_status((cbor_data) "\x81\xFF", 2, CBOR_DECODER_ERROR);
+  assert_skip_status((cbor_data) "\x9F\x81\xFF", 3, CBOR_DECODER_ERROR);
+  // Indefinite map with a missing value
+  assert_skip_status((cbor_data) "\xBF\x01\xFF", 3, CBOR_DECODER_ERROR);
+  // Bad string chunks
+  assert_skip_status((cbor_data) "\x5F\x01\xFF", 3, CBOR_DECODER_ERROR);
+  assert_skip_status((cbor_data) "\x5F\x61\x61\xFF", 4, CBOR_DECODER_ERROR);
+  assert_skip_status((cbor_data) "\x5F\x5F\xFF\xFF", 4, CBOR_DECODER_ERROR);
+}
+
+static void test_nesting_limit(void** _state _CBOR_UNUSED) {
+  unsigned char data[2 * (CBOR_MAX_STACK_SIZE + 1)];
+  memset(data, 0x9F, CBOR_MAX_STACK_SIZE + 1);
+  memset(data + CBOR_MAX_STACK_SIZE + 1, 0xFF, CBOR_MAX_STACK_SIZE + 1);
+  assert_skip_status(data, sizeof(data), CBOR_DECODER_ERROR);
+  assert_skip(data + 1, sizeof(data) - 2, sizeof(data) - 2);
+}
+
+static void* capped_malloc(size_t size) {
+  if (size > (1 << 19)) return NULL;
+  return malloc(size);
+}
+
+// Whatever cbor_load accepts must be skipped with the same extent, and
+// whatever it rejects for reasons other than resource limits must not be.
+static void test_agrees_with_load(void** _state _CBOR_UNUSED) {
+  cbor_set_allocs(capped_malloc, realloc, free);
+  srand(42);
+  unsigned char data[64];
+  for (size_t round = 0; round < 20000; round++) {
+    size_t length = (size_t)(rand() % sizeof(data)) + 1;
+    for (size_t i = 0; i < length; i++) {
+      // Bias towards small headers so that more inputs are well-formed
+      data[i] = (unsigned char)(rand() % 4 == 0 ? rand() % 256
+                                                : (rand() % 8) << 5 |
+                                                      (rand() % 4));
+    }
+
+    struct cbor_load_result res;
+    cbor_item_t* item = cbor_load(data, length, &res);
+    enum cbor_decoder_status status = cbor_skip_item(data, length, &end);
+    if (item != NULL) {
+      assert_true(status == CBOR_DECODER_FINISHED);
+      assert_size_equal(end, res.read);
+      cbor_decref(&item);
+    } else if (res.error.code != CBOR_ERR_MEMERROR) {
+      // The error kinds may differ: declared sizes and chunk types are
+      // checked up front, so the first problem found is not always the same
+      assert_true(status != CBOR_DECODER_FINISHED);
+    }
+  }
+  cbor_set_allocs(malloc, realloc, free);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_scalars),
+      cmocka_unit_test(test_strings),
+      cmocka_unit_test(test_containers),
+      cmocka_unit_test(test_sequence),
+      cmocka_unit_test(test_truncated),
+      cmocka_unit_test(test_malformed),
+      cmocka_unit_test(test_nesting_limit),
+      cmocka_unit_test(test_agrees_with_load),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "assertions.h"
+#include "cbor.h"
+
+// The callbacks append a line per event to the log. Parts of a string are
+// joined, so that the log does not depend on how the input is split.
+struct events {
+  char log[1024];
+  size_t length;
+  size_t parts;
+  bool in_string;
+};
+
+struct events events;
+cbor_stream_decoder_t decoder;
+
+static void record(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  events.length += (size_t)vsnprintf(events.log + events.length,
+                                     sizeof(events.log) - events.length,
+                                     format, args);
+  va_end(args);
+  assert_true(events.length < sizeof(events.log));
+}
+
+static void record_string(const char* kind, cbor_data data, uint64_t length) {
+  record("%s ", kind);
+  for (size_t i = 0; i < length; i++) record("%02X", data[i]);
+  record("\n");
+}
+
+static void uint8_callback(void* context _CBOR_UNUSED, uint8_t value) {
+  record("uint %u\n", value);
+}
+
+static void uint32_callback(void* context _CBOR_UNUSED, uint32_t value) {
+  record("uint %u\n", value);
+}
+
+static void array_start_callback(void* context _CBOR_UNUSED, uint64_t size) {
+  record("array %u\n", (unsigned)size);
+}
+
+static void indef_map_start_callback(void* context _CBOR_UNUSED) {
+  record("map\n");
+}
+
+static void indef_break_callback(void* context _CBOR_UNUSED) {
+  record("break\n");
+}
+
+static void float8_callback(void* context _CBOR_UNUSED, double value) {
+  record("float %g\n", value);
+}
+
+static void byte_string_callback(void* context _CBOR_UNUSED, cbor_data data,
+                                 uint64_t length) {
+  record_string("bytes", data, length);
+}
+
+static void string_callback(void* context _CBOR_UNUSED, cbor_data data,
+                            uint64_t length) {
+  record_string("string", data, length);
+}
+
+static void part_callback(const char* kind, cbor_data data, uint64_t length,
+                          uint64_t remaining) {
+  assert_true(length > 0);
+  if (!events.in_string) record("%s ", kind);
+  events.in_string = remaining > 0;
+  events.parts++;
+  for (size_t i = 0; i < length; i++) record("%02X", data[i]);
+  if (remaining == 0) record("\n");
+}
+
+static void byte_string_part_callback(void* context _CBOR_UNUSED,
+                                      cbor_data data, uint64_t length,
+                                      uint64_t remaining) {
+  part_callback("bytes", data, length, remaining);
+}
+
+static void string_part_callback(void* context _CBOR_UNUSED, cbor_data data,
+                                 uint64_t length, uint64_t remaining) {
+  part_callback("string", data, length, remaining);
+}
+
+static struct cbor_callbacks callbacks;
+
+static void init(void) {
+  callbacks = cbor_empty_callbacks;
+  callbacks.uint8 = uint8_callback;
+  callbacks.uint32 = uint32_callback;
+  callbacks.array_start = array_start_callback;
+  callbacks.indef_map_start = indef_map_start_callback;
+  callbacks.indef_break = indef_break_callback;
+  callbacks.float8 = float8_callback;
+  callbacks.byte_string = byte_string_callback;
+  callbacks.string = string_callback;
+  events = (struct events){.length = 0};
+  cbor_stream_decoder_init(&decoder, &callbacks, byte_string_part_callback,
+                           string_part_callback, NULL);
+}
+
+// [{_ "ab": h'01020304'}, 100000, 1.5, h'', "xyz"]
+static unsigned char message[] = {
+    0x85, 0xBF, 0x62, 0x61, 0x62, 0x44, 0x01, 0x02, 0x03, 0x04, 0xFF,
+    0x1A, 0x00, 0x01, 0x86, 0xA0, 0xFB, 0x3F, 0xF8, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x40, 0x63, 0x78, 0x79, 0x7A};
+
+static const char* expected_log =
+    "array 5\nmap\nstring 6162\nbytes 01020304\nbreak\nuint 100000\n"
+    "float 1.5\nbytes \nstring 78797A\n";
+
+static void feed(cbor_data chunk, size_t chunk_size,
+                 enum cbor_decoder_status status) {
+  struct cbor_decoder_result result =
+      cbor_stream_decoder_feed(&decoder, chunk, chunk_size);
+  assert_true(result.status == status);
+  assert_size_equal(result.read, chunk_size);
+}
+
+static void test_whole(void** _state _CBOR_UNUSED) {
+  init();
+  feed(message, sizeof(message), CBOR_DECODER_FINISHED);
+  assert_string_equal(events.log, expected_log);
+  assert_size_equal(events.parts, 0);
+}
+
+static void test_all_splits(void** _state _CBOR_UNUSED) {
+  for (size_t split = 0; split <= sizeof(message); split++) {
+    init();
+    struct cbor_decoder_result result =
+        cbor_stream_decoder_feed(&decoder, message, split);
+    assert_size_equal(result.read, split);
+    feed(message + split, sizeof(message) - split, CBOR_DECODER_FINISHED);
+    assert_string_equal(events.log, expected_log);
+  }
+}
+
+static void test_byte_by_byte(void** _state _CBOR_UNUSED) {
+  init();
+  for (size_t i = 0; i < sizeof(message); i++) {
+    struct cbor_decoder_result result =
+        cbor_stream_decoder_feed(&decoder, message + i, 1);
+    assert_true(result.status != CBOR_DECODER_ERROR);
+    assert_size_equal(result.read, 1);
+  }
+  assert_string_equal(events.log, expected_log);
+  // One part for each byte of the non-empty strings
+  assert_size_equal(events.parts, 2 + 4 + 3);
+}
+
+static void test_required(void** _state _CBOR_UNUSED) {
+  init();
+  struct cbor_decoder_result result =
+      cbor_stream_decoder_feed(&decoder, message + 11, 2);
+  assert_true(result.status == CBOR_DECODER_NEDATA);
+  assert_size_equal(result.required, 3);
+
+  init();
+  result = cbor_stream_decoder_feed(&decoder, message + 5, 3);
+  assert_true(result.status == CBOR_DECODER_NEDATA);
+  assert_size_equal(result.required, 2);
+  result = cbor_stream_decoder_feed(&decoder, message + 8, 2);
+  assert_true(result.status == CBOR_DECODER_FINISHED);
+  assert_string_equal(events.log, "bytes 01020304\n");
+  assert_size_equal(events.parts, 2);
+}
+
+static size_t received;
+
+static void count_part_callback(void* context _CBOR_UNUSED,
+                                cbor_data data _CBOR_UNUSED, uint64_t length,
+                                uint64_t remaining) {
+  events.parts++;
+  events.in_string = remaining > 0;
+  received += length;
+}
+
+static void test_large_string(void** _state _CBOR_UNUSED) {
+  // An 8-byte length header, split itself, and 10 MB of payload
+  unsigned char header[] = {0x5B, 0x00, 0x00, 0x00, 0x00,
+                            0x00, 0x98, 0x96, 0x80};
+  unsigned char chunk[4096];
+  memset(chunk, 0xAB, sizeof(chunk));
+  init();
+  cbor_stream_decoder_init(&decoder, &callbacks, count_part_callback,
+                           string_part_callback, NULL);
+  received = 0;
+  feed(header, 4, CBOR_DECODER_NEDATA);
+  feed(header + 4, 5, CBOR_DECODER_NEDATA);
+  size_t remaining = 10000000;
+  while (remaining > sizeof(chunk)) {
+    feed(chunk, sizeof(chunk), CBOR_DECODER_NEDATA);
+    remaining -= sizeof(chunk);
+  }
+  feed(chunk, remaining, CBOR_DECODER_FINISHED);
+  assert_false(events.in_string);
+  assert_size_equal(received, 10000000);
+  assert_size_equal(events.parts, (10000000 + sizeof(chunk) - 1) /
+                                      sizeof(chunk));
+}
+
+static void test_malformed(void** _state _CBOR_UNUSED) {
+  init();
+  unsigned char malformed[] = {0x01, 0x02, 0x1C};
+  struct cbor_decoder_result result =
+      cbor_stream_decoder_feed(&decoder, malformed, sizeof(malformed));
+  assert_true(result.status == CBOR_DECODER_ERROR);
+  assert_size_equal(result.read, 2);
+
+  // A split header of a one-byte simple value below 32
+  init();
+  unsigned char simple[] = {0xF8, 0x10};
+  feed(simple, 1, CBOR_DECODER_NEDATA);
+  result = cbor_stream_decoder_feed(&decoder, simple + 1, 1);
+  assert_true(result.status == CBOR_DECODER_ERROR);
+  assert_size_equal(result.read, 0);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_whole),
+      cmocka_unit_test(test_all_splits),
+      cmocka_unit_test(test_byte_by_byte),
+      cmocka_unit_test(test_required),
+      cmocka_unit_test(test_large_string),
+      cmocka_unit_test(test_malformed),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -338,6 +338,22 @@ static void test_set_handle_invalid_utf(void** _state _CBOR_UNUSED) {
   cbor_decref(&string);
 }
 
+static void test_codepoint_count_recomputed(void** _state _CBOR_UNUSED) {
+  string = cbor_build_string("abc");
+  assert_size_equal(cbor_string_codepoint_count(string), 3);
+  assert_size_equal(cbor_string_codepoint_count(string), 3);
+
+  // A new handle invalidates the cached count
+  unsigned char* old_data = cbor_string_handle(string);
+  unsigned char* string_data = malloc(2);
+  memcpy(string_data, "\xc3\xa1", 2);
+  cbor_string_set_handle(string, string_data, 2);
+  free(old_data);
+  assert_size_equal(cbor_string_codepoint_count(string), 1);
+
+  cbor_decref(&string);
+}
+
 int main(void) {
   const struct CMUnitTest tests[] = {
       cmocka_unit_test(test_empty_string),
@@ -356,6 +372,7 @@ int main(void) {
       cmocka_unit_test(test_set_handle),
       cmocka_unit_test(test_set_handle_multibyte_codepoint),
       cmocka_unit_test(test_set_handle_invalid_utf),
+      cmocka_unit_test(test_codepoint_count_recomputed),
   };
   return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -14,8 +14,11 @@ struct cbor_load_result res;
 
 unsigned char embedded_tag_data[] = {0xC0, 0x00};
 
+/* Tag 0 + uint 42, small integers are shared and not refcounted */
+unsigned char refcounted_tag_data[] = {0xC0, 0x18, 0x2A};
+
 static void test_refcounting(void** _state _CBOR_UNUSED) {
-  tag = cbor_load(embedded_tag_data, 2, &res);
+  tag = cbor_load(refcounted_tag_data, 3, &res);
   assert_true(cbor_refcount(tag) == 1);
   cbor_item_t* item = cbor_tag_item(tag);
   assert_true(cbor_refcount(item) == 2);
@@ -144,8 +147,8 @@ static void test_build_tag_failure(void** _state _CBOR_UNUSED) {
 }
 
 static void test_set_item_replaces_previous(void** _state _CBOR_UNUSED) {
-  cbor_item_t* item1 = cbor_build_uint8(1);
-  cbor_item_t* item2 = cbor_build_uint8(2);
+  cbor_item_t* item1 = cbor_build_uint8(42);
+  cbor_item_t* item2 = cbor_build_uint8(43);
   tag = cbor_build_tag(0, item1);
 
   assert_size_equal(cbor_refcount(item1), 2);
@@ -156,7 +159,7 @@ static void test_set_item_replaces_previous(void** _state _CBOR_UNUSED) {
   // item1 should have been released by cbor_tag_set_item
   assert_size_equal(cbor_refcount(item1), 1);
   assert_size_equal(cbor_refcount(item2), 2);
-  assert_uint8(cbor_move(cbor_tag_item(tag)), 2);
+  assert_uint8(cbor_move(cbor_tag_item(tag)), 43);
 
   cbor_decref(&item1);
   cbor_decref(&item2);
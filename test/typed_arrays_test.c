@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "assertions.h"
+#include "cbor.h"
+#include "test_allocator.h"
+
+struct cbor_load_result res;
+struct cbor_typed_array array;
+int64_t ints[8];
+double doubles[8];
+
+static bool host_is_little_endian(void) {
+  uint16_t one = 1;
+  return *(unsigned char*)&one == 1;
+}
+
+static void test_int_array(void** _state _CBOR_UNUSED) {
+  // [1, -1, 1000000, -9223372036854775808]
+  unsigned char data[] = {0x84, 0x01, 0x20, 0x1A, 0x00, 0x0F, 0x42,
+                          0x40, 0x3B, 0x7F, 0xFF, 0xFF, 0xFF, 0xFF,
+                          0xFF, 0xFF, 0xFF};
+  assert_size_equal(
+      cbor_load_int64_array(data, sizeof(data), ints, 8, &res), 4);
+  assert_true(res.error.code == CBOR_ERR_NONE);
+  assert_size_equal(res.read, sizeof(data));
+  assert_true(ints[0] == 1);
+  assert_true(ints[1] == -1);
+  assert_true(ints[2] == 1000000);
+  assert_true(ints[3] == INT64_MIN);
+}
+
+static void test_indefinite_int_array(void** _state _CBOR_UNUSED) {
+  // [_ 1, 2, -3] followed by trailing data
+  unsigned char data[] = {0x9F, 0x01, 0x02, 0x22, 0xFF, 0x00};
+  assert_size_equal(
+      cbor_load_int64_array(data, sizeof(data), ints, 8, &res), 3);
+  assert_true(res.error.code == CBOR_ERR_NONE);
+  assert_size_equal(res.read, 5);
+  assert_true(ints[2] == -3);
+
+  assert_size_equal(cbor_load_int64_array(data, 4, ints, 8, &res), 0);
+  assert_true(res.error.code == CBOR_ERR_NOTENOUGHDATA);
+}
+
+static void test_int_array_errors(void** _state _CBOR_UNUSED) {
+  assert_size_equal(cbor_load_int64_array(NULL, 0, ints, 8, &res), 0);
+  assert_true(res.error.code == CBOR_ERR_NODATA);
+
+  // Too large
+  assert_size_equal(
+      cbor_load_int64_array(
+          (cbor_data) "\x81\x1B\x80\x00\x00\x00\x00\x00\x00\x00", 10, ints, 8,
+          &res),
+      0);
+  assert_true(res.error.code == CBOR_ERR_SYNTAXERROR);
+  assert_size_equal(res.error.position, 1);
+
+  // Not an integer
+  assert_size_equal(
+      cbor_load_int64_array((cbor_data) "\x82\x01\xF9\x3C\x00", 5, ints, 8,
+                            &res),
+      0);
+  assert_true(res.error.code == CBOR_ERR_SYNTAXERROR);
+
+  // Not an array
+  assert_size_equal(cbor_load_int64_array((cbor_data) "\x01", 1, ints, 8, &res),
+                    0);
+  assert_true(res.error.code == CBOR_ERR_SYNTAXERROR);
+
+  // Reserved
+  assert_size_equal(
+      cbor_load_int64_array((cbor_data) "\x81\x1C", 2, ints, 8, &res), 0);
+  assert_true(res.error.code == CBOR_ERR_MALFORMATED);
+
+  // Truncated
+  assert_size_equal(
+      cbor_load_int64_array((cbor_data) "\x83\x01\x02", 3, ints, 8, &res), 0);
+  assert_true(res.error.code == CBOR_ERR_NOTENOUGHDATA);
+  assert_size_equal(
+      cbor_load_int64_array(
+          (cbor_data) "\x9B\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF", 9, ints, 8, &res),
+      0);
+  assert_true(res.error.code == CBOR_ERR_NOTENOUGHDATA);
+}
+
+static void test_buffer_too_small(void** _state _CBOR_UNUSED) {
+  unsigned char data[] = {0x83, 0x01, 0x02, 0x03};
+  assert_size_equal(cbor_load_int64_array(data, sizeof(data), ints, 2, &res),
+                    3);
+  assert_true(res.error.code == CBOR_ERR_BUFFER_TOO_SMALL);
+  assert_true(ints[1] == 2);
+
+  assert_size_equal(cbor_load_int64_array(data, sizeof(data), NULL, 0, &res),
+                    3);
+  assert_true(res.error.code == CBOR_ERR_BUFFER_TOO_SMALL);
+
+  // The rest is still validated
+  assert_size_equal(
+      cbor_load_int64_array((cbor_data) "\x83\x01\x02\x60", 4, NULL, 0, &res),
+      0);
+  assert_true(res.error.code == CBOR_ERR_SYNTAXERROR);
+}
+
+static void test_double_array(void** _state _CBOR_UNUSED) {
+  // [_ 1.5 (half), 1.5 (single), -0.25 (double)]
+  unsigned char data[] = {0x9F, 0xF9, 0x3E, 0x00, 0xFA, 0x3F, 0xC0, 0x00,
+                          0x00, 0xFB, 0xBF, 0xD0, 0x00, 0x00, 0x00, 0x00,
+                          0x00, 0x00, 0xFF};
+  assert_size_equal(
+      cbor_load_double_array(data, sizeof(data), doubles, 8, &res), 3);
+  assert_true(res.error.code == CBOR_ERR_NONE);
+  assert_size_equal(res.read, sizeof(data));
+  assert_true(doubles[0] == 1.5);
+  assert_true(doubles[1] == 1.5);
+  assert_true(doubles[2] == -0.25);
+
+  // Integers are not converted
+  assert_size_equal(
+      cbor_load_double_array((cbor_data) "\x81\x01", 2, doubles, 8, &res), 0);
+  assert_true(res.error.code == CBOR_ERR_SYNTAXERROR);
+  // Neither are simple values
+  assert_size_equal(
+      cbor_load_double_array((cbor_data) "\x81\xF6", 2, doubles, 8, &res), 0);
+  assert_true(res.error.code == CBOR_ERR_SYNTAXERROR);
+}
+
+static void test_typed_array_parse(void** _state _CBOR_UNUSED) {
+  // 77(h'0100FFFF'), sint16 little endian
+  unsigned char data[] = {0xD8, 0x4D, 0x44, 0x01, 0x00, 0xFF, 0xFF};
+  assert_true(cbor_typed_array_parse(data, sizeof(data), &array, &res));
+  assert_true(array.type == CBOR_TYPED_ARRAY_SINT16);
+  assert_true(array.little_endian);
+  assert_size_equal(array.element_size, 2);
+  assert_size_equal(array.length, 2);
+  assert_ptr_equal(array.data, data + 3);
+  assert_size_equal(res.read, sizeof(data));
+
+  // 68(h'00'), clamped
+  assert_true(cbor_typed_array_parse((cbor_data) "\xD8\x44\x41\x00", 4, &array,
+                                     &res));
+  assert_true(array.type == CBOR_TYPED_ARRAY_UINT8_CLAMPED);
+  assert_false(array.little_endian);
+
+  // 87(h''), binary128 little endian
+  assert_true(
+      cbor_typed_array_parse((cbor_data) "\xD8\x57\x40", 3, &array, &res));
+  assert_true(array.type == CBOR_TYPED_ARRAY_FLOAT128);
+  assert_size_equal(array.element_size, 16);
+  assert_size_equal(array.length, 0);
+}
+
+static void test_typed_array_parse_errors(void** _state _CBOR_UNUSED) {
+  // Reserved tag 76
+  assert_false(
+      cbor_typed_array_parse((cbor_data) "\xD8\x4C\x40", 3, &array, &res));
+  assert_true(res.error.code == CBOR_ERR_SYNTAXERROR);
+  // Other tag
+  assert_false(
+      cbor_typed_array_parse((cbor_data) "\xD8\x58\x40", 3, &array, &res));
+  assert_true(res.error.code == CBOR_ERR_SYNTAXERROR);
+  // Not a byte string
+  assert_false(
+      cbor_typed_array_parse((cbor_data) "\xD8\x40\x80", 3, &array, &res));
+  assert_true(res.error.code == CBOR_ERR_SYNTAXERROR);
+  // Indefinite byte string
+  assert_false(cbor_typed_array_parse((cbor_data) "\xD8\x40\x5F\xFF", 4,
+                                      &array, &res));
+  assert_true(res.error.code == CBOR_ERR_SYNTAXERROR);
+  // Partial element
+  assert_false(cbor_typed_array_parse((cbor_data) "\xD8\x41\x43\x00\x01\x02",
+                                      6, &array, &res));
+  assert_true(res.error.code == CBOR_ERR_SYNTAXERROR);
+  // Truncated
+  assert_false(cbor_typed_array_parse((cbor_data) "\xD8\x41\x42\x00", 4,
+                                      &array, &res));
+  assert_true(res.error.code == CBOR_ERR_NOTENOUGHDATA);
+  assert_false(cbor_typed_array_parse((cbor_data) "\xD8", 1, &array, &res));
+  assert_true(res.error.code == CBOR_ERR_NOTENOUGHDATA);
+}
+
+static void test_typed_array_native(void** _state _CBOR_UNUSED) {
+  // 65(h'01020304') is big endian, 69(h'01020304') little endian
+  unsigned char native_tag = host_is_little_endian() ? 0x45 : 0x41;
+  unsigned char foreign_tag = native_tag ^ 0x04;
+  // Aligned so that the payload starts at an even address
+  uint16_t storage[5];
+  unsigned char* data = (unsigned char*)storage + 1;
+  memcpy(data, "\xD8\x00\x44\x01\x02\x03\x04", 7);
+  uint16_t buffer[2];
+
+  data[1] = native_tag;
+  assert_true(cbor_typed_array_parse(data, 7, &array, &res));
+  assert_ptr_equal(cbor_typed_array_native(&array, NULL), data + 3);
+
+  data[1] = foreign_tag;
+  assert_true(cbor_typed_array_parse(data, 7, &array, &res));
+  assert_null(cbor_typed_array_native(&array, NULL));
+  const uint16_t* elements = cbor_typed_array_native(&array, buffer);
+  assert_ptr_equal(elements, buffer);
+  assert_true(elements[0] == (host_is_little_endian() ? 0x0102 : 0x0201));
+  assert_true(elements[1] == (host_is_little_endian() ? 0x0304 : 0x0403));
+
+  // Misaligned payload in the host order is copied as is
+  data = (unsigned char*)storage;
+  memcpy(data, "\xD8\x00\x44\x01\x02\x03\x04", 7);
+  data[1] = native_tag;
+  assert_true(cbor_typed_array_parse(data, 7, &array, &res));
+  elements = cbor_typed_array_native(&array, buffer);
+  assert_ptr_equal(elements, buffer);
+  assert_memory_equal(buffer, data + 3, 4);
+}
+
+static void test_typed_array_int64(void** _state _CBOR_UNUSED) {
+  // 72(h'FF7F80'), sint8
+  assert_size_equal(
+      cbor_load_int64_array((cbor_data) "\xD8\x48\x43\xFF\x7F\x80", 6, ints, 8,
+                            &res),
+      3);
+  assert_true(res.error.code == CBOR_ERR_NONE);
+  assert_true(ints[0] == -1);
+  assert_true(ints[1] == 127);
+  assert_true(ints[2] == -128);
+
+  // 66(h'00010000'), uint32 big endian
+  assert_size_equal(
+      cbor_load_int64_array((cbor_data) "\xD8\x42\x44\x00\x01\x00\x00", 7, ints,
+                            8, &res),
+      1);
+  assert_true(ints[0] == 65536);
+
+  // 79(h'FEFFFFFFFFFFFFFF 0000000000000080'), sint64 little endian
+  unsigned char sint64[] = {0xD8, 0x4F, 0x50, 0xFE, 0xFF, 0xFF, 0xFF,
+                            0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00,
+                            0x00, 0x00, 0x00, 0x00, 0x80};
+  assert_size_equal(
+      cbor_load_int64_array(sint64, sizeof(sint64), ints, 8, &res), 2);
+  assert_true(ints[0] == -2);
+  assert_true(ints[1] == INT64_MIN);
+
+  // 67(h'8000000000000000'), uint64 that does not fit
+  assert_size_equal(
+      cbor_load_int64_array(
+          (cbor_data) "\xD8\x43\x48\x80\x00\x00\x00\x00\x00\x00\x00", 11, ints,
+          8, &res),
+      0);
+  assert_true(res.error.code == CBOR_ERR_SYNTAXERROR);
+
+  // Float typed array
+  assert_size_equal(
+      cbor_load_int64_array((cbor_data) "\xD8\x50\x42\x3C\x00", 5, ints, 8,
+                            &res),
+      0);
+  assert_true(res.error.code == CBOR_ERR_SYNTAXERROR);
+
+  // Too small a buffer
+  assert_size_equal(
+      cbor_load_int64_array((cbor_data) "\xD8\x40\x42\x01\x02", 5, ints, 1,
+                            &res),
+      2);
+  assert_true(res.error.code == CBOR_ERR_BUFFER_TOO_SMALL);
+}
+
+static void test_typed_array_double(void** _state _CBOR_UNUSED) {
+  // 86(h'000000000000F83F'), float64 little endian: 1.5
+  assert_size_equal(
+      cbor_load_double_array(
+          (cbor_data) "\xD8\x56\x48\x00\x00\x00\x00\x00\x00\xF8\x3F", 11,
+          doubles, 8, &res),
+      1);
+  assert_true(res.error.code == CBOR_ERR_NONE);
+  assert_true(doubles[0] == 1.5);
+
+  // 82(h'3FF8000000000000'), float64 big endian: 1.5
+  assert_size_equal(
+      cbor_load_double_array(
+          (cbor_data) "\xD8\x52\x48\x3F\xF8\x00\x00\x00\x00\x00\x00", 11,
+          doubles, 8, &res),
+      1);
+  assert_true(doubles[0] == 1.5);
+
+  // 85(h'0000C0BF'), float32 little endian: -1.5
+  assert_size_equal(
+      cbor_load_double_array((cbor_data) "\xD8\x55\x44\x00\x00\xC0\xBF", 7,
+                             doubles, 8, &res),
+      1);
+  assert_true(doubles[0] == -1.5);
+
+  // 84(h'003E'), float16 little endian: 1.5
+  assert_size_equal(
+      cbor_load_double_array((cbor_data) "\xD8\x54\x42\x00\x3E", 5, doubles, 8,
+                             &res),
+      1);
+  assert_true(doubles[0] == 1.5);
+
+  // binary128 is not supported
+  assert_size_equal(
+      cbor_load_double_array((cbor_data) "\xD8\x53\x40", 3, doubles, 8, &res),
+      0);
+  assert_true(res.error.code == CBOR_ERR_SYNTAXERROR);
+
+  // Integer typed array
+  assert_size_equal(
+      cbor_load_double_array((cbor_data) "\xD8\x40\x41\x01", 4, doubles, 8,
+                             &res),
+      0);
+  assert_true(res.error.code == CBOR_ERR_SYNTAXERROR);
+
+  // Empty
+  assert_size_equal(
+      cbor_load_double_array((cbor_data) "\xD8\x56\x40", 3, NULL, 0, &res), 0);
+  assert_true(res.error.code == CBOR_ERR_NONE);
+}
+
+static void test_no_allocations(void** _state _CBOR_UNUSED) {
+  WITH_MOCK_MALLOC(
+      {
+        assert_size_equal(
+            cbor_load_int64_array((cbor_data) "\x82\x01\x02", 3, ints, 8, &res),
+            2);
+        assert_size_equal(
+            cbor_load_double_array((cbor_data) "\xD8\x54\x42\x00\x3E", 5,
+                                   doubles, 8, &res),
+            1);
+      },
+      0, MALLOC);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_int_array),
+      cmocka_unit_test(test_indefinite_int_array),
+      cmocka_unit_test(test_int_array_errors),
+      cmocka_unit_test(test_buffer_too_small),
+      cmocka_unit_test(test_double_array),
+      cmocka_unit_test(test_typed_array_parse),
+      cmocka_unit_test(test_typed_array_parse_errors),
+      cmocka_unit_test(test_typed_array_native),
+      cmocka_unit_test(test_typed_array_int64),
+      cmocka_unit_test(test_typed_array_double),
+      cmocka_unit_test(test_no_allocations),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -142,6 +142,40 @@ static void test_int_creation(void** _state _CBOR_UNUSED) {
   WITH_FAILING_MALLOC({ assert_null(cbor_build_uint64(0xFF)); });
 }
 
+static void test_small_ints_are_shared(void** _state _CBOR_UNUSED) {
+  WITH_MOCK_MALLOC({ number = cbor_build_uint8(23); }, 0, MALLOC);
+  unsigned char encoded[] = {0x17};
+  cbor_item_t* other = cbor_load(encoded, 1, &res);
+  assert_ptr_equal(number, other);
+  assert_size_equal(cbor_refcount(number), SIZE_MAX);
+  assert_uint8(number, 23);
+  assert_ptr_equal(cbor_incref(number), other);
+  cbor_decref(&other);
+  assert_null(other);
+  assert_uint8(number, 23);
+
+  // Negative integers have their own instances
+  other = cbor_build_negint8(23);
+  assert_ptr_not_equal(number, other);
+  assert_true(cbor_isa_negint(other));
+  assert_true(cbor_get_uint8(other) == 23);
+
+  // Copies and fresh items are not shared
+  cbor_item_t* copy = cbor_copy(other);
+  assert_ptr_not_equal(copy, other);
+  assert_size_equal(cbor_refcount(copy), 1);
+  cbor_decref(&copy);
+  copy = cbor_new_int8();
+  assert_ptr_not_equal(copy, number);
+  cbor_decref(&copy);
+
+  cbor_decref(&other);
+  cbor_decref(&number);
+  number = cbor_build_uint8(24);
+  assert_size_equal(cbor_refcount(number), 1);
+  cbor_decref(&number);
+}
+
 int main(void) {
   const struct CMUnitTest tests[] = {
       cmocka_unit_test(test_very_short_int),
@@ -154,6 +188,7 @@ int main(void) {
       cmocka_unit_test(test_empty_input),
       cmocka_unit_test(test_inline_creation),
       cmocka_unit_test(test_int_creation),
+      cmocka_unit_test(test_small_ints_are_shared),
   };
   return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -5,6 +5,8 @@
  * it under the terms of the MIT license. See LICENSE for details.
  */
 
+#include <string.h>
+
 #include "assertions.h"
 
 #include "../src/cbor/internal/unicode.h"
@@ -35,8 +37,72 @@ static void test_invalid_sequence(void** _state _CBOR_UNUSED) {
   assert_true(status.location == 2);
 }
 
+struct sequence {
+  const char* data;
+  size_t length;
+  /* Codepoints if valid */
+  size_t codepoints;
+  /* Offset of the error within the sequence, or -1 if valid */
+  int error;
+};
+
+static const struct sequence sequences[] = {
+    {"\xC4\x8C", 2, 1, -1},          /* 2 bytes */
+    {"\xE2\x82\xAC", 3, 1, -1},      /* 3 bytes */
+    {"\xF0\x9F\x98\x80", 4, 1, -1},  /* 4 bytes */
+    {"\xC4\x8C\xE2\x82\xAC", 5, 2, -1},
+    {"\x80", 1, 0, 0},                /* Lone continuation */
+    {"\xC4\x41", 2, 0, 1},            /* Missing continuation */
+    {"\xE0\x80\x80", 3, 0, 1},        /* Overlong */
+    {"\xED\xA0\x80", 3, 0, 1},        /* Surrogate */
+    {"\xF4\x90\x80\x80", 4, 0, 1},    /* Above U+10FFFF */
+    {"\xFF", 1, 0, 0},
+};
+
+/* The ASCII fast path works on blocks, move the sequence across them */
+static void test_sequence_positions(void** _state _CBOR_UNUSED) {
+  unsigned char data[160];
+  for (size_t i = 0; i < sizeof(sequences) / sizeof(sequences[0]); i++) {
+    const struct sequence* sequence = &sequences[i];
+    for (size_t offset = 0; offset < 80; offset++) {
+      for (size_t suffix = 0; suffix < 70; suffix += 23) {
+        size_t length = offset + sequence->length + suffix;
+        memset(data, 'a', length);
+        memcpy(data + offset, sequence->data, sequence->length);
+
+        size_t count = _cbor_unicode_codepoint_count(data, length, &status);
+        if (sequence->error < 0) {
+          assert_size_equal(count, offset + sequence->codepoints + suffix);
+          assert_true(status.status == _CBOR_UNICODE_OK);
+        } else {
+          assert_size_equal(count, 0);
+          assert_true(status.status == _CBOR_UNICODE_BADCP);
+          assert_size_equal(status.location, offset + (size_t)sequence->error);
+        }
+      }
+    }
+  }
+}
+
+static void test_truncated_at_end(void** _state _CBOR_UNUSED) {
+  unsigned char data[100];
+  memset(data, 'a', sizeof(data));
+  data[sizeof(data) - 1] = 0xE2;
+  assert_size_equal(_cbor_unicode_codepoint_count(data, sizeof(data), &status),
+                    0);
+  assert_true(status.status == _CBOR_UNICODE_BADCP);
+  assert_size_equal(status.location, sizeof(data));
+
+  assert_size_equal(
+      _cbor_unicode_codepoint_count(data, sizeof(data) - 1, &status),
+      sizeof(data) - 1);
+  assert_true(status.status == _CBOR_UNICODE_OK);
+}
+
 int main(void) {
   const struct CMUnitTest tests[] = {cmocka_unit_test(test_missing_bytes),
-                                     cmocka_unit_test(test_invalid_sequence)};
+                                     cmocka_unit_test(test_invalid_sequence),
+                                     cmocka_unit_test(test_sequence_positions),
+                                     cmocka_unit_test(test_truncated_at_end)};
   return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "assertions.h"
+#include "cbor.h"
+#include "test_allocator.h"
+
+cbor_view_t view, result_view;
+cbor_type type;
+
+// {"id": 42, "tags": ["a", "b"], 1: -1, "nested": {_ "x": [_ 1, 2]},
+//  (_ "na" "me"): h'0102', "last": 1(null)}
+unsigned char map_data[] = {
+    0xA6, 0x62, 0x69, 0x64, 0x18, 0x2A, 0x64, 0x74, 0x61, 0x67, 0x73, 0x82,
+    0x61, 0x61, 0x61, 0x62, 0x01, 0x20, 0x66, 0x6E, 0x65, 0x73, 0x74, 0x65,
+    0x64, 0xBF, 0x61, 0x78, 0x9F, 0x01, 0x02, 0xFF, 0xFF, 0x7F, 0x62, 0x6E,
+    0x61, 0x62, 0x6D, 0x65, 0xFF, 0x42, 0x01, 0x02, 0x64, 0x6C, 0x61, 0x73,
+    0x74, 0xC1, 0xF6};
+
+static void test_type(void** _state _CBOR_UNUSED) {
+  assert_true(cbor_view_type(cbor_view_init(map_data, sizeof(map_data)),
+                             &type));
+  assert_true(type == CBOR_TYPE_MAP);
+
+  assert_false(cbor_view_type(cbor_view_init(map_data, 0), &type));
+  // Reserved header
+  assert_false(cbor_view_type(cbor_view_init((cbor_data) "\x1C", 1), &type));
+  // Break is not an item
+  assert_false(cbor_view_type(cbor_view_init((cbor_data) "\xFF", 1), &type));
+}
+
+static void test_skip(void** _state _CBOR_UNUSED) {
+  unsigned char sequence[sizeof(map_data) + 1];
+  memcpy(sequence, map_data, sizeof(map_data));
+  sequence[sizeof(map_data)] = 0x07;
+
+  view = cbor_view_init(sequence, sizeof(sequence));
+  assert_true(cbor_view_skip(view, &result_view));
+  assert_ptr_equal(result_view.data, sequence + sizeof(map_data));
+  assert_size_equal(result_view.size, 1);
+  assert_true(cbor_view_skip(result_view, &result_view));
+  assert_size_equal(result_view.size, 0);
+  assert_false(cbor_view_skip(result_view, &result_view));
+}
+
+static void test_skip_malformed(void** _state _CBOR_UNUSED) {
+  // Every strict prefix is truncated
+  for (size_t i = 0; i < sizeof(map_data); i++) {
+    assert_false(
+        cbor_view_skip(cbor_view_init(map_data, i), &result_view));
+  }
+  // Unexpected break
+  assert_false(cbor_view_skip(cbor_view_init((cbor_data) "\x81\xFF", 2),
+                              &result_view));
+  // Indefinite string with a non-string chunk
+  assert_false(cbor_view_skip(
+      cbor_view_init((cbor_data) "\x5F\x41\x00\x01\xFF", 5), &result_view));
+  // Indefinite string with a chunk of a different type
+  assert_false(cbor_view_skip(
+      cbor_view_init((cbor_data) "\x7F\x41\x00\xFF", 4), &result_view));
+  // Nested indefinite string
+  assert_false(cbor_view_skip(
+      cbor_view_init((cbor_data) "\x5F\x5F\xFF\xFF", 4), &result_view));
+  // Indefinite map with a missing value
+  assert_false(cbor_view_skip(cbor_view_init((cbor_data) "\xBF\x01\xFF", 3),
+                              &result_view));
+}
+
+static void test_skip_deep_nesting(void** _state _CBOR_UNUSED) {
+  // CBOR_MAX_STACK_SIZE + 1 nested indefinite arrays
+  unsigned char data[2 * (CBOR_MAX_STACK_SIZE + 1)];
+  memset(data, 0x9F, CBOR_MAX_STACK_SIZE + 1);
+  memset(data + CBOR_MAX_STACK_SIZE + 1, 0xFF, CBOR_MAX_STACK_SIZE + 1);
+  assert_false(cbor_view_skip(cbor_view_init(data, sizeof(data)),
+                              &result_view));
+  assert_true(cbor_view_skip(cbor_view_init(data + 1, sizeof(data) - 2),
+                             &result_view));
+  assert_size_equal(result_view.size, 0);
+}
+
+static void test_array_at(void** _state _CBOR_UNUSED) {
+  view = cbor_view_init(map_data, sizeof(map_data));
+  cbor_view_t tags;
+  assert_true(cbor_view_map_find(view, "tags", 4, &tags));
+
+  cbor_data data;
+  size_t length;
+  assert_true(cbor_view_array_at(tags, 1, &result_view));
+  assert_true(cbor_view_string(result_view, &data, &length));
+  assert_size_equal(length, 1);
+  assert_memory_equal(data, "b", 1);
+  assert_false(cbor_view_array_at(tags, 2, &result_view));
+  // Not an array
+  assert_false(cbor_view_array_at(view, 0, &result_view));
+}
+
+static void test_indefinite_array_at(void** _state _CBOR_UNUSED) {
+  view = cbor_view_init(map_data, sizeof(map_data));
+  cbor_view_t nested, x;
+  assert_true(cbor_view_map_find(view, "nested", 6, &nested));
+  assert_true(cbor_view_map_find(nested, "x", 1, &x));
+
+  uint64_t value;
+  assert_true(cbor_view_array_at(x, 1, &result_view));
+  assert_true(cbor_view_get_uint(result_view, &value));
+  assert_true(value == 2);
+  assert_false(cbor_view_array_at(x, 2, &result_view));
+}
+
+static void test_map_find(void** _state _CBOR_UNUSED) {
+  view = cbor_view_init(map_data, sizeof(map_data));
+  uint64_t value;
+  assert_true(cbor_view_map_find(view, "id", 2, &result_view));
+  assert_true(cbor_view_get_uint(result_view, &value));
+  assert_true(value == 42);
+
+  // Indefinite key
+  cbor_data data;
+  size_t length;
+  assert_true(cbor_view_map_find(view, "name", 4, &result_view));
+  assert_true(cbor_view_type(result_view, &type));
+  assert_true(type == CBOR_TYPE_BYTESTRING);
+  assert_true(cbor_view_string(result_view, &data, &length));
+  assert_size_equal(length, 2);
+  assert_ptr_equal(data, map_data + 42);
+
+  assert_true(cbor_view_map_find(view, "last", 4, &result_view));
+  assert_true(cbor_view_type(result_view, &type));
+  assert_true(type == CBOR_TYPE_TAG);
+
+  assert_false(cbor_view_map_find(view, "nam", 3, &result_view));
+  assert_false(cbor_view_map_find(view, "names", 5, &result_view));
+  assert_false(cbor_view_map_find(view, "missing", 7, &result_view));
+  // Not a map
+  assert_false(cbor_view_map_find(result_view, "id", 2, &result_view));
+}
+
+static void test_map_find_truncated(void** _state _CBOR_UNUSED) {
+  // The key is found before the truncation
+  view = cbor_view_init(map_data, 8);
+  assert_true(cbor_view_map_find(view, "id", 2, &result_view));
+  assert_false(cbor_view_map_find(view, "last", 4, &result_view));
+}
+
+static void test_accessor_type_mismatch(void** _state _CBOR_UNUSED) {
+  cbor_data data;
+  size_t length;
+  uint64_t value;
+  view = cbor_view_init(map_data, sizeof(map_data));
+  assert_false(cbor_view_string(view, &data, &length));
+  assert_false(cbor_view_get_uint(view, &value));
+  assert_true(cbor_view_map_find(view, "tags", 4, &result_view));
+  assert_false(cbor_view_get_uint(result_view, &value));
+}
+
+static void test_load(void** _state _CBOR_UNUSED) {
+  view = cbor_view_init(map_data, sizeof(map_data));
+  cbor_view_t tags;
+  assert_true(cbor_view_map_find(view, "tags", 4, &tags));
+  struct cbor_load_result res;
+  cbor_item_t* item = cbor_view_load(tags, &res);
+  assert_non_null(item);
+  assert_true(cbor_isa_array(item));
+  assert_size_equal(cbor_array_size(item), 2);
+  assert_size_equal(res.read, 5);
+  cbor_decref(&item);
+}
+
+static void test_no_allocations(void** _state _CBOR_UNUSED) {
+  WITH_MOCK_MALLOC(
+      {
+        view = cbor_view_init(map_data, sizeof(map_data));
+        assert_true(cbor_view_skip(view, &result_view));
+        assert_true(cbor_view_map_find(view, "last", 4, &result_view));
+      },
+      0, MALLOC);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_type),
+      cmocka_unit_test(test_skip),
+      cmocka_unit_test(test_skip_malformed),
+      cmocka_unit_test(test_skip_deep_nesting),
+      cmocka_unit_test(test_array_at),
+      cmocka_unit_test(test_indefinite_array_at),
+      cmocka_unit_test(test_map_find),
+      cmocka_unit_test(test_map_find_truncated),
+      cmocka_unit_test(test_accessor_type_mismatch),
+      cmocka_unit_test(test_load),
+      cmocka_unit_test(test_no_allocations),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
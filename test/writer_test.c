@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2014-2020 Pavel Kalvoda <me@pavelkalvoda.com>
+ *
+ * libcbor is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "assertions.h"
+#include "cbor.h"
+#include "test_allocator.h"
+
+cbor_writer writer;
+unsigned char buffer[512];
+
+// Collects the sink output
+unsigned char sink_output[4096];
+size_t sink_length;
+size_t sink_calls;
+size_t sink_fail_after;
+
+static bool collecting_sink(void* context, cbor_data data, size_t size) {
+  assert_ptr_equal(context, &sink_length);
+  assert_true(size > 0);
+  if (sink_calls++ >= sink_fail_after) return false;
+  assert_true(sink_length + size <= sizeof(sink_output));
+  memcpy(sink_output + sink_length, data, size);
+  sink_length += size;
+  return true;
+}
+
+static void reset_sink(void) {
+  sink_length = 0;
+  sink_calls = 0;
+  sink_fail_after = SIZE_MAX;
+}
+
+// [1, -500, "abc", h'0102', 5(_ [_ null]), {true: 1.5}, 24, 4294967296]
+static const unsigned char expected[] = {
+    0x88, 0x01, 0x39, 0x01, 0xF3, 0x63, 0x61, 0x62, 0x63, 0x42,
+    0x01, 0x02, 0xC5, 0x9F, 0xF6, 0xFF, 0xA1, 0xF5, 0xF9, 0x3E,
+    0x00, 0x18, 0x18, 0x1B, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+    0x00, 0x00};
+
+static void write_items(void) {
+  assert_true(cbor_writer_array_start(&writer, 8));
+  assert_true(cbor_writer_uint(&writer, 1));
+  assert_true(cbor_writer_negint(&writer, 499));
+  assert_true(cbor_writer_string(&writer, "abc", 3));
+  assert_true(cbor_writer_bytestring(&writer, (cbor_data) "\x01\x02", 2));
+  assert_true(cbor_writer_tag(&writer, 5));
+  assert_true(cbor_writer_indef_array_start(&writer));
+  assert_true(cbor_writer_null(&writer));
+  assert_true(cbor_writer_break(&writer));
+  assert_true(cbor_writer_map_start(&writer, 1));
+  assert_true(cbor_writer_bool(&writer, true));
+  assert_true(cbor_writer_half(&writer, 1.5f));
+  assert_true(cbor_writer_uint(&writer, 24));
+  assert_true(cbor_writer_uint(&writer, 4294967296ULL));
+}
+
+static void test_fixed_buffer(void** _state _CBOR_UNUSED) {
+  cbor_writer_init_buffer(&writer, buffer, sizeof(buffer));
+  write_items();
+  assert_true(cbor_writer_flush(&writer));
+  assert_size_equal(cbor_writer_length(&writer), sizeof(expected));
+  assert_memory_equal(buffer, expected, sizeof(expected));
+  cbor_writer_release(&writer);
+}
+
+static void test_fixed_buffer_overflow(void** _state _CBOR_UNUSED) {
+  cbor_writer_init_buffer(&writer, buffer, 4);
+  assert_true(cbor_writer_uint(&writer, 1000));
+  assert_false(cbor_writer_uint(&writer, 1000));
+  // Errors are sticky, even if the item would fit
+  assert_false(cbor_writer_uint(&writer, 1));
+  assert_false(cbor_writer_flush(&writer));
+  assert_size_equal(cbor_writer_length(&writer), 3);
+  assert_memory_equal(buffer, ((unsigned char[]){0x19, 0x03, 0xE8}), 3);
+}
+
+static void test_growable(void** _state _CBOR_UNUSED) {
+  cbor_writer_init_growable(&writer);
+  write_items();
+  size_t length;
+  unsigned char* output = cbor_writer_take_buffer(&writer, &length);
+  assert_non_null(output);
+  assert_size_equal(length, sizeof(expected));
+  assert_memory_equal(output, expected, sizeof(expected));
+  _cbor_free(output);
+
+  // The writer can be reused
+  assert_size_equal(cbor_writer_length(&writer), 0);
+  assert_null(cbor_writer_take_buffer(&writer, &length));
+  assert_true(cbor_writer_null(&writer));
+  cbor_writer_release(&writer);
+}
+
+static void test_growable_large(void** _state _CBOR_UNUSED) {
+  cbor_writer_init_growable(&writer);
+  assert_true(cbor_writer_indef_array_start(&writer));
+  for (uint64_t i = 0; i < 100000; i++) {
+    assert_true(cbor_writer_uint(&writer, i));
+  }
+  assert_true(cbor_writer_break(&writer));
+
+  size_t length;
+  unsigned char* output = cbor_writer_take_buffer(&writer, &length);
+  struct cbor_load_result res;
+  cbor_item_t* item = cbor_load(output, length, &res);
+  assert_true(res.error.code == CBOR_ERR_NONE);
+  assert_size_equal(res.read, length);
+  assert_size_equal(cbor_array_size(item), 100000);
+  cbor_item_t* last = cbor_array_get(item, 99999);
+  assert_true(cbor_get_int(last) == 99999);
+  cbor_decref(&last);
+  cbor_decref(&item);
+  _cbor_free(output);
+  cbor_writer_release(&writer);
+}
+
+static void test_growable_allocation_failure(void** _state _CBOR_UNUSED) {
+  cbor_writer_init_growable(&writer);
+  WITH_MOCK_MALLOC(
+      {
+        assert_false(cbor_writer_uint(&writer, 1));
+        assert_false(cbor_writer_uint(&writer, 1));
+      },
+      1, REALLOC_FAIL);
+  size_t length;
+  assert_null(cbor_writer_take_buffer(&writer, &length));
+  cbor_writer_release(&writer);
+}
+
+static void test_sink(void** _state _CBOR_UNUSED) {
+  // Try staging buffers that are too small for some of the writes
+  size_t sizes[] = {0, 1, 2, 5, 9, 10, 16, 512};
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    reset_sink();
+    cbor_writer_init_sink(&writer, collecting_sink, &sink_length,
+                          sizes[i] == 0 ? NULL : buffer, sizes[i]);
+    write_items();
+    assert_size_equal(cbor_writer_length(&writer), sizeof(expected));
+    assert_true(cbor_writer_flush(&writer));
+    assert_size_equal(sink_length, sizeof(expected));
+    assert_memory_equal(sink_output, expected, sizeof(expected));
+    cbor_writer_release(&writer);
+  }
+}
+
+static void test_sink_batches(void** _state _CBOR_UNUSED) {
+  reset_sink();
+  cbor_writer_init_sink(&writer, collecting_sink, &sink_length, buffer, 100);
+  for (int i = 0; i < 1000; i++) {
+    assert_true(cbor_writer_uint(&writer, 1));
+  }
+  assert_true(cbor_writer_flush(&writer));
+  assert_size_equal(sink_length, 1000);
+  assert_size_equal(sink_calls, 10);
+}
+
+static void test_sink_failure(void** _state _CBOR_UNUSED) {
+  reset_sink();
+  sink_fail_after = 1;
+  cbor_writer_init_sink(&writer, collecting_sink, &sink_length, buffer, 4);
+  assert_true(cbor_writer_uint(&writer, 1000));
+  assert_true(cbor_writer_uint(&writer, 1000));
+  assert_false(cbor_writer_uint(&writer, 1000));
+  assert_false(cbor_writer_flush(&writer));
+  // The sink is not called again
+  assert_size_equal(sink_calls, 2);
+  assert_size_equal(sink_length, 3);
+}
+
+static void test_file(void** _state _CBOR_UNUSED) {
+  FILE* file = tmpfile();
+  assert_non_null(file);
+  cbor_writer_init_file(&writer, file, buffer, 8);
+  write_items();
+  assert_true(cbor_writer_flush(&writer));
+
+  unsigned char contents[64];
+  rewind(file);
+  assert_size_equal(fread(contents, 1, sizeof(contents), file),
+                    sizeof(expected));
+  assert_memory_equal(contents, expected, sizeof(expected));
+  fclose(file);
+}
+
+static void test_item(void** _state _CBOR_UNUSED) {
+  struct cbor_load_result res;
+  cbor_item_t* item = cbor_load(expected, sizeof(expected), &res);
+  assert_non_null(item);
+
+  cbor_writer_init_growable(&writer);
+  assert_true(cbor_writer_item(&writer, item));
+  assert_true(cbor_writer_item(&writer, item));
+  size_t length;
+  unsigned char* output = cbor_writer_take_buffer(&writer, &length);
+  assert_size_equal(length, 2 * sizeof(expected));
+  assert_memory_equal(output, expected, sizeof(expected));
+  assert_memory_equal(output + sizeof(expected), expected, sizeof(expected));
+  _cbor_free(output);
+  cbor_writer_release(&writer);
+
+  size_t sizes[] = {0, 3, 512};
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    reset_sink();
+    cbor_writer_init_sink(&writer, collecting_sink, &sink_length,
+                          sizes[i] == 0 ? NULL : buffer, sizes[i]);
+    assert_true(cbor_writer_item(&writer, item));
+    assert_true(cbor_writer_flush(&writer));
+    assert_size_equal(sink_length, sizeof(expected));
+    assert_memory_equal(sink_output, expected, sizeof(expected));
+  }
+
+  cbor_writer_init_buffer(&writer, buffer, sizeof(expected) - 1);
+  assert_false(cbor_writer_item(&writer, item));
+  cbor_decref(&item);
+}
+
+static void test_item_without_tagged_item(void** _state _CBOR_UNUSED) {
+  cbor_item_t* tag = cbor_new_tag(1);
+  cbor_writer_init_buffer(&writer, buffer, sizeof(buffer));
+  assert_false(cbor_writer_item(&writer, tag));
+  assert_false(cbor_writer_flush(&writer));
+  cbor_decref(&tag);
+}
+
+static void test_matches_encoders(void** _state _CBOR_UNUSED) {
+  unsigned char encoded[16];
+  cbor_writer_init_buffer(&writer, buffer, sizeof(buffer));
+  size_t offset = 0;
+
+#define CHECK(write, encode)                                          \
+  do {                                                                \
+    assert_true(write);                                               \
+    size_t encoded_length = encode;                                   \
+    assert_size_equal(cbor_writer_length(&writer),                    \
+                      offset + encoded_length);                       \
+    assert_memory_equal(buffer + offset, encoded, encoded_length);    \
+    offset += encoded_length;                                         \
+  } while (0)
+
+  CHECK(cbor_writer_uint(&writer, 0xFFFFFFFFFFFFFFFFULL),
+        cbor_encode_uint(0xFFFFFFFFFFFFFFFFULL, encoded, sizeof(encoded)));
+  CHECK(cbor_writer_negint(&writer, 0x10000),
+        cbor_encode_negint(0x10000, encoded, sizeof(encoded)));
+  CHECK(cbor_writer_bytestring_start(&writer, 300),
+        cbor_encode_bytestring_start(300, encoded, sizeof(encoded)));
+  CHECK(cbor_writer_indef_bytestring_start(&writer),
+        cbor_encode_indef_bytestring_start(encoded, sizeof(encoded)));
+  CHECK(cbor_writer_string_start(&writer, 30),
+        cbor_encode_string_start(30, encoded, sizeof(encoded)));
+  CHECK(cbor_writer_indef_string_start(&writer),
+        cbor_encode_indef_string_start(encoded, sizeof(encoded)));
+  CHECK(cbor_writer_array_start(&writer, 70000),
+        cbor_encode_array_start(70000, encoded, sizeof(encoded)));
+  CHECK(cbor_writer_indef_map_start(&writer),
+        cbor_encode_indef_map_start(encoded, sizeof(encoded)));
+  CHECK(cbor_writer_map_start(&writer, 2),
+        cbor_encode_map_start(2, encoded, sizeof(encoded)));
+  CHECK(cbor_writer_tag(&writer, 55799),
+        cbor_encode_tag(55799, encoded, sizeof(encoded)));
+  CHECK(cbor_writer_undef(&writer),
+        cbor_encode_undef(encoded, sizeof(encoded)));
+  CHECK(cbor_writer_single(&writer, 3.14f),
+        cbor_encode_single(3.14f, encoded, sizeof(encoded)));
+  CHECK(cbor_writer_double(&writer, 1e300),
+        cbor_encode_double(1e300, encoded, sizeof(encoded)));
+  CHECK(cbor_writer_preferred_float(&writer, 0.5),
+        cbor_encode_preferred_float(0.5, encoded, sizeof(encoded)));
+  CHECK(cbor_writer_ctrl(&writer, 100),
+        cbor_encode_ctrl(100, encoded, sizeof(encoded)));
+#undef CHECK
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+      cmocka_unit_test(test_fixed_buffer),
+      cmocka_unit_test(test_fixed_buffer_overflow),
+      cmocka_unit_test(test_growable),
+      cmocka_unit_test(test_growable_large),
+      cmocka_unit_test(test_growable_allocation_failure),
+      cmocka_unit_test(test_sink),
+      cmocka_unit_test(test_sink_batches),
+      cmocka_unit_test(test_sink_failure),
+      cmocka_unit_test(test_file),
+      cmocka_unit_test(test_item),
+      cmocka_unit_test(test_item_without_tagged_item),
+      cmocka_unit_test(test_matches_encoders),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}